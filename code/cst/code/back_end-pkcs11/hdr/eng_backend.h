@@ -19,15 +19,28 @@
 #ifndef BACKEND_ENGINE_H
 #define BACKEND_ENGINE_H
 
+#include <pthread.h>
 #include <openssl/cms.h>
 #include <adapt_layer.h>
 #include "openssl_helper.h"
 
 #define MAX_ERR_STR_BYTES     120    /**< Max. error string bytes */
 
+/* Certificate and key loaded from the token */
+struct cst_engine_object {
+struct cst_engine_object *next;
+char *cert_ref;         /**< Reference the objects were loaded with */
+X509 *cert;             /**< Certificate */
+EVP_PKEY *key;          /**< Private key, NULL until a signature needs it */
+};
+
 struct cst_engine_ctx {
 /* Engine configuration */
 ENGINE *engine;
+/* Objects already loaded, kept for the lifetime of the context */
+struct cst_engine_object *objects;
+/* Serializes the objects and token operations, shared_ctx contexts only */
+pthread_mutex_t lock;
 };
 
 typedef struct cst_engine_ctx ENGINE_CTX;
@@ -85,6 +98,62 @@ int32_t ctx_init(ENGINE_CTX *ctx);
  */
 int32_t ctx_finish(ENGINE_CTX *ctx);
 
+/** ctx_get
+ *
+ * Returns the context shared by the whole process. The engine is loaded
+ * and initialized on the first call only, so the token module is loaded
+ * and logged in once, then its session is reused by every operation.
+ * The context is finished when the process exits.
+ *
+ * The context may be used from several threads, which take turns on its
+ * session with ctx_lock().
+ *
+ * @returns the shared context if successful, NULL otherwise. A failed
+ *          initialization is retried on the next call.
+ */
+ENGINE_CTX *ctx_get(void);
+
+/** ctx_lock
+ *
+ * Takes the session of the shared context for a token operation, waiting
+ * for the operation of another thread to complete.
+ *
+ * @param[in] ctx context returned by ctx_get()
+ *
+ * @post the session must be returned with ctx_unlock()
+ */
+void ctx_lock(ENGINE_CTX *ctx);
+
+/** ctx_unlock
+ *
+ * Returns the session taken with ctx_lock().
+ *
+ * @param[in] ctx context returned by ctx_get()
+ */
+void ctx_unlock(ENGINE_CTX *ctx);
+
+/** ctx_load_objects
+ *
+ * Looks up the certificate and private key of a reference, loading them
+ * from the token the first time only. The objects are shared by every
+ * thread.
+ *
+ * @param[in] ctx context returned by ctx_get()
+ *
+ * @param[in] cert_ref certificate and key reference
+ *
+ * @param[out] cert new reference to the certificate, the caller must
+ *             release it with X509_free()
+ *
+ * @param[out] key new reference to the private key, the caller must
+ *             release it with EVP_PKEY_free(). NULL if only the
+ *             certificate is needed.
+ *
+ * @returns CAL_SUCCESS if successful, CAL_CRYPTO_API_ERROR otherwise.
+ */
+int32_t ctx_load_objects(ENGINE_CTX *ctx, const char *cert_ref, X509 **cert,
+                         EVP_PKEY **key);
+
 /**  ENGINE_load_certificate
  *
  * Read certificate with a given reference from engine.
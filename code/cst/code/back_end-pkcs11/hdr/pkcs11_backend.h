@@ -19,6 +19,19 @@ pkcs11_gen_sig_data(const char *in_file, const char *cert_ref,
                     uint8_t *sig_buf, size_t *sig_buf_bytes,
                     func_mode_t mode);
 
+int32_t
+pkcs11_gen_sig_data_buffer(const uint8_t *data, size_t data_bytes,
+                           const char *data_name, const char *cert_ref,
+                           hash_alg_t hash_alg, sig_fmt_t sig_fmt,
+                           uint8_t *sig_buf, size_t *sig_buf_bytes,
+                           func_mode_t mode);
+
+int32_t
+pkcs11_gen_sig_data_digest(const uint8_t *digest, size_t digest_bytes,
+                           const char *cert_ref, hash_alg_t hash_alg,
+                           sig_fmt_t sig_fmt, uint8_t *sig_buf,
+                           size_t *sig_buf_bytes, func_mode_t mode);
+
 X509*
 pkcs11_read_certificate(const char *cert_ref);
 
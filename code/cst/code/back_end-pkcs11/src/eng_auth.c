@@ -211,8 +211,9 @@ encryptccm(unsigned char *plaintext, int plaintext_len,
  gen_auth_encrypted_data
  ---------------------------*/
 int32_t
-gen_auth_encrypted_data(const char *in_file, const char *out_file,
-				aead_alg_t aead_alg, uint8_t *aad, size_t aad_bytes,
+gen_auth_encrypted_data(dek_t *dek, const char *in_file,
+				const char *out_file, aead_alg_t aead_alg,
+				uint8_t *aad, size_t aad_bytes,
 				uint8_t *nonce, size_t nonce_bytes, uint8_t *mac,
 				size_t mac_bytes, size_t key_bytes,
 				const char *cert_file, const char *key_file,
@@ -229,6 +230,8 @@ gen_auth_encrypted_data(const char *in_file, const char *out_file,
     int32_t i;       /**< used in for loops */
 #endif
 
+    /* A key is generated for each call */
+    UNUSED(dek);
     UNUSED(aead_alg);
 
     do {
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <pthread.h>
 #include <adapt_layer.h>
 
 /* Library Openssl includes */
@@ -34,6 +35,25 @@
 #include "openssl_helper.h"
 #include "eng_backend.h"
 
+/*=======================================================================+
+ LOCAL VARIABLES
+ =======================================================================*/
+/* Context shared by the process, NULL until initialized */
+static ENGINE_CTX *shared_ctx = NULL;
+
+/* Protects shared_ctx */
+static pthread_mutex_t shared_ctx_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*=======================================================================+
+ LOCAL FUNCTION PROTOTYPES
+ =======================================================================*/
+/** Finishes the shared context, at process exit */
+static void ctx_release(void);
+
+/** Same as ctx_load_objects(), with the lock of @a ctx held */
+static int32_t load_objects(ENGINE_CTX *ctx, const char *cert_ref, X509 **cert,
+                            EVP_PKEY **key);
+
 /*=======================================================================+
  LOCAL FUNCTION IMPLEMENTATIONS
  =======================================================================*/
@@ -108,6 +128,181 @@ int32_t ctx_finish(ENGINE_CTX *ctx)
     return 1;
 }
 
+/*--------------------------
+ ctx_release
+ ---------------------------*/
+static void ctx_release(void)
+{
+    struct cst_engine_object *object = NULL;
+
+    if (shared_ctx == NULL) {
+        return;
+    }
+
+    while (shared_ctx->objects != NULL) {
+        object = shared_ctx->objects;
+        shared_ctx->objects = object->next;
+        X509_free(object->cert);
+        EVP_PKEY_free(object->key);
+        OPENSSL_free(object->cert_ref);
+        OPENSSL_free(object);
+    }
+
+    pthread_mutex_destroy(&shared_ctx->lock);
+
+    /* ctx_finish is not called here since ENGINE_finish cleanups the
+     * engine instance. Calling ctx_destroy next would dereference it. */
+    ctx_destroy(shared_ctx);
+    shared_ctx = NULL;
+}
+
+/*--------------------------
+ ctx_get
+ ---------------------------*/
+ENGINE_CTX *ctx_get(void)
+{
+    static int registered = 0;
+    ENGINE_CTX *ctx = NULL;
+
+    pthread_mutex_lock(&shared_ctx_lock);
+    do {
+        if (shared_ctx != NULL) {
+            break;
+        }
+
+        ctx = ctx_new();
+        if (ctx == NULL) {
+            break;
+        }
+        ctx->engine = NULL;
+        ctx->objects = NULL;
+
+        if (!ctx_init(ctx)) {
+            OPENSSL_free(ctx);
+            break;
+        }
+        pthread_mutex_init(&ctx->lock, NULL);
+
+        shared_ctx = ctx;
+        if (!registered) {
+            atexit(ctx_release);
+            registered = 1;
+        }
+    } while (0);
+    ctx = shared_ctx;
+    pthread_mutex_unlock(&shared_ctx_lock);
+
+    return ctx;
+}
+
+/*--------------------------
+ ctx_lock
+ ---------------------------*/
+void ctx_lock(ENGINE_CTX *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+}
+
+/*--------------------------
+ ctx_unlock
+ ---------------------------*/
+void ctx_unlock(ENGINE_CTX *ctx)
+{
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+/*--------------------------
+ load_objects
+ ---------------------------*/
+static int32_t load_objects(ENGINE_CTX *ctx, const char *cert_ref, X509 **cert,
+                            EVP_PKEY **key)
+{
+    struct cst_engine_object *object = NULL;
+
+    *cert = NULL;
+    if (key) {
+        *key = NULL;
+    }
+
+    for (object = ctx->objects; object != NULL; object = object->next) {
+        if (strcmp(object->cert_ref, cert_ref) == 0) {
+            break;
+        }
+    }
+
+    if (object == NULL) {
+        object = OPENSSL_zalloc(sizeof(*object));
+        if (object == NULL) {
+            return CAL_CRYPTO_API_ERROR;
+        }
+        object->cert_ref = OPENSSL_strdup(cert_ref);
+        if (object->cert_ref != NULL) {
+            object->cert = ENGINE_load_certificate(ctx->engine, cert_ref);
+        }
+        if (object->cert == NULL) {
+            OPENSSL_free(object->cert_ref);
+            OPENSSL_free(object);
+            return CAL_CRYPTO_API_ERROR;
+        }
+#ifdef DEBUG
+        X509_print_fp(stdout, object->cert);
+#endif
+        object->next = ctx->objects;
+        ctx->objects = object;
+    }
+
+    if (key && object->key == NULL) {
+        EVP_PKEY *loaded = ENGINE_load_private_key(ctx->engine, cert_ref, 0, 0);
+
+        if (loaded == NULL) {
+            return CAL_CRYPTO_API_ERROR;
+        }
+
+        /**
+        * OpenSSL expects EVP_PKEY to contain the ec_point. PKCS#11 does not
+        * return the ec_point as an attribute for private key.
+        */
+        if (EVP_PKEY_base_id(loaded) == EVP_PKEY_RSA &&
+            !X509_check_private_key(object->cert, loaded)) {
+            EVP_PKEY_free(loaded);
+            return CAL_CRYPTO_API_ERROR;
+        }
+        object->key = loaded;
+    }
+
+    if (!X509_up_ref(object->cert)) {
+        return CAL_CRYPTO_API_ERROR;
+    }
+    *cert = object->cert;
+
+    if (key) {
+        if (!EVP_PKEY_up_ref(object->key)) {
+            X509_free(*cert);
+            *cert = NULL;
+            return CAL_CRYPTO_API_ERROR;
+        }
+        *key = object->key;
+    }
+
+    return CAL_SUCCESS;
+}
+
+/*--------------------------
+ ctx_load_objects
+ ---------------------------*/
+int32_t ctx_load_objects(ENGINE_CTX *ctx, const char *cert_ref, X509 **cert,
+                         EVP_PKEY **key)
+{
+    int32_t error = CAL_SUCCESS;
+
+    /* Token objects are looked up one thread at a time */
+    ctx_lock(ctx);
+    error = load_objects(ctx, cert_ref, cert, key);
+    ctx_unlock(ctx);
+
+    return error;
+}
+
 /*--------------------------
  ENGINE_load_certificate
  ---------------------------*/
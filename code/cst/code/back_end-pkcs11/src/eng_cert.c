@@ -47,40 +47,16 @@ pkcs11_read_certificate(const char* cert_ref)
        return NULL;
     }
 
-    /* Allocate new context */
-    ctx = ctx_new();
-
+    /* The engine, its session and the certificate are loaded once */
+    ctx = ctx_get();
     if(!ctx){
         error = CAL_CRYPTO_API_ERROR;
         goto out;
     }
 
-    /* Initialize the context */
-    if(!ctx_init(ctx)){
-        error = CAL_CRYPTO_API_ERROR;
-        goto out;
-    }
-
-    cert = ENGINE_load_certificate (ctx->engine, cert_ref);
-    if (!cert)
-    {
-        error = CAL_CRYPTO_API_ERROR;
-        goto out;
-    }
-
-#ifdef DEBUG
-    X509_print_fp(stdout, cert);
-#endif
+    error = ctx_load_objects(ctx, cert_ref, &cert, NULL);
 
 out:
-    if(ctx) {
-
-   /* Destroy the context: ctx_finish is not called here since
-	* ENGINE_finish cleanups the engine instance. Calling ctx_destroy
-	* next will lead to null pointer dereference. */
-        ctx_destroy(ctx);
-    }
-
     if (error)
         ERR_print_errors_fp(stderr);
 
@@ -84,18 +84,14 @@ get_NID (hash_alg_t hash_alg);
 
 /** Generate ECDSA Signature Data
  *
- * Generates a ECDSA signature for the given data file,
- * signer certificate, and hash algorithm. The signature data is returned
- * in a buffer provided by caller.  Note that sign_data cannot be used
- * here since that function requires an input buffer as an argument.
- * For large files it becomes unreasonable to allocate a contigous
- * block of memory.
+ * Generates a ECDSA signature for the given digest and signing key.
+ * The signature data is returned in a buffer provided by caller.
  *
- * @param[in] in_file string containing path to file with data to sign
+ * @param[in] digest message digest of the data to sign
  *
- * @param[in] key signing key
+ * @param[in] digest_bytes size of @a digest in bytes
  *
- * @param[in] hash_alg hash algorithm from #hash_alg_t
+ * @param[in] key signing key
  *
  * @param[out] sig_buf signature data buffer
  *
@@ -103,7 +99,7 @@ get_NID (hash_alg_t hash_alg);
  *                              a sig_buf in bytes, On output, contains
  *                                size of signature in bytes.
  *
- * @pre @a in_file, @a key, @a sig_buf and
+ * @pre @a digest, @a key, @a sig_buf and
  *        @a sig_buf_bytes must not be NULL.
  *
  * @post On success @a sig_buf is updated to hold the resulting
@@ -117,20 +113,20 @@ get_NID (hash_alg_t hash_alg);
  * @retval #CAL_CRYPTO_API_ERROR An Openssl related error has occurred
  */
 static int32_t
-pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
-                           hash_alg_t hash_alg, uint8_t * sig_buf,
+pkcs11_gen_sig_data_ecdsa (const uint8_t *digest, size_t digest_bytes,
+                           EVP_PKEY * key, uint8_t * sig_buf,
                            size_t * sig_buf_bytes);
 
 /** Generate CMS Signature Data
  *
- * Generates a CMS signature for the given data file,
- * signer certificate, and hash algorithm. The signature data is returned
- * in a buffer provided by caller.  Note that sign_data cannot be used
- * here since that function requires an input buffer as an argument.
- * For large files it becomes unreasonable to allocate a contigous
- * block of memory.
+ * Generates a CMS signature for the given digest,
+ * signer certificate, and hash algorithm. The signed attributes are
+ * derived from the digest. The signature data is returned in a buffer
+ * provided by caller.
+ *
+ * @param[in] digest message digest of the data to sign
  *
- * @param[in] in_file string containing path to file with data to sign
+ * @param[in] digest_bytes size of @a digest in bytes
  *
  * @param[in] x509 X509 signer certificate object
  *
@@ -142,7 +138,7 @@ pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
  *                              a sig_buf in bytes, On output, contains
  *                                size of signature in bytes.
  *
- * @pre @a in_file, @a cert_file, @a key_file, @a sig_buf and
+ * @pre @a digest, @a x509, @a pkey, @a sig_buf and
  *        @a sig_buf_bytes must not be NULL.
  *
  * @post On success @a sig_buf is updated to hold the resulting
@@ -156,17 +152,20 @@ pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
  * @retval #CAL_CRYPTO_API_ERROR An Openssl related error has occurred
  */
 static int32_t
-pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
+pkcs11_gen_sig_data_cms (const uint8_t *digest, size_t digest_bytes,
+                         X509 * x509, EVP_PKEY * pkey,
                          hash_alg_t hash_alg, uint8_t * sig_buf,
                          size_t * sig_buf_bytes);
 
 /** Generate raw PKCS#1 Signature Data
  *
- * Generates a raw PKCS#1 v1.5 signature for the given data file, signer
+ * Generates a raw PKCS#1 v1.5 signature for the given digest, signer
  * certificate, and hash algorithm. The signature data is returned in
  * a buffer provided by caller.
  *
- * @param[in] in_file string containing path to file with data to sign
+ * @param[in] digest message digest of the data to sign
+ *
+ * @param[in] digest_bytes size of @a digest in bytes
  *
  * @param[in] key EVP_PKEY signing key
  *
@@ -178,7 +177,7 @@ pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
  *       @a sig_buf in bytes, On output,
  *         contains size of signature in bytes.
  *
- * @pre @a in_file, @a cert_file, @a key_file, @a sig_buf
+ * @pre @a digest, @a key, @a sig_buf
  *       and @a sig_buf_bytes must not be NULL.
  *
  * @post On success @a sig_buf is updated to hold the resulting
@@ -191,9 +190,27 @@ pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
  * @retval #CAL_CRYPTO_API_ERROR An Openssl related error has occurred
  */
 static int32_t
-pkcs11_gen_sig_data_raw (const char *in_file, EVP_PKEY * key,
-                         hash_alg_t hash_alg, uint8_t * sig_buf,
-                         int32_t * sig_buf_bytes);
+pkcs11_gen_sig_data_raw (const uint8_t *digest, size_t digest_bytes,
+                         EVP_PKEY * key, hash_alg_t hash_alg,
+                         uint8_t * sig_buf, int32_t * sig_buf_bytes);
+
+/** Read a whole file
+ *
+ * @param[in] in_file path to the file to read
+ *
+ * @param[out] data allocated buffer holding the file content, the caller
+ *                  must release it with free()
+ *
+ * @param[out] data_bytes size of @a data in bytes
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_FILE_NOT_FOUND @a in_file cannot be read
+ *
+ * @retval #CAL_INSUFFICIENT_MEMORY @a data cannot be allocated
+ */
+static int32_t
+read_data_file (const char *in_file, uint8_t ** data, size_t * data_bytes);
 
 /*===========================================================================
                                LOCAL FUNCTIONS
@@ -284,22 +301,17 @@ get_NID (hash_alg_t hash_alg)
   pkcs11_gen_sig_data_ecdsa
 ---------------------------*/
 static int32_t
-pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
-                           hash_alg_t hash_alg, uint8_t * sig_buf,
+pkcs11_gen_sig_data_ecdsa (const uint8_t *digest, size_t digest_bytes,
+                           EVP_PKEY * key, uint8_t * sig_buf,
                            size_t * sig_buf_bytes)
 {
-    BIO *bio_in = NULL;        /**< BIO for in_file data    */
     uint32_t key_size = 0;       /**< n of bytes of key param */
-    const EVP_MD *sign_md = NULL;          /**< Digest name             */
-    uint8_t *hash = NULL;          /**< Hash data of in_file    */
-    int32_t hash_bytes = 0;    /**< Length of hash buffer   */
     uint8_t *sign = NULL;          /**< Signature data in DER   */
     uint32_t sign_bytes = 0;     /**< Length of DER signature */
     uint8_t *r = NULL, *s = NULL;          /**< Raw signature data R&S  */
     size_t bn_bytes = 0;         /**< Length of R,S big num   */
     ECDSA_SIG *sign_dec = NULL;        /**< Raw signature data R|S  */
     int32_t err_value = CAL_SUCCESS;     /**< Return value            */
-    char err_str[MAX_ERR_STR_BYTES];     /**< Error string            */
     /**< signature numbers defined as OpenSSL BIGNUM */
     const BIGNUM *sig_r, *sig_s;
 
@@ -308,37 +320,12 @@ pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
         return CAL_INVALID_ARGUMENT;
     }
 
-    /* Set signature message digest alg */
-    sign_md = EVP_get_digestbyname (get_digest_name (hash_alg));
-    if (sign_md == NULL) {
-        fprintf (stderr, "Invalid hash digest algorithm\n");
-        return CAL_INVALID_ARGUMENT;
-    }
-
     do {
-        /* Read Data to be signed */
-        if (!(bio_in = BIO_new_file (in_file, "rb"))) {
-            snprintf (err_str, MAX_ERR_STR_BYTES,
-                     "Cannot open data file %s", in_file);
-            fprintf (stderr, "%s\n", err_str);
-            err_value = CAL_CRYPTO_API_ERROR;
-            break;
-        }
-
-        /* Generate hash of data from in_file */
-        hash_bytes = HASH_BYTES_MAX;
-        hash = OPENSSL_malloc (HASH_BYTES_MAX);
-
-        err_value = calculate_hash (in_file, hash_alg, hash, &hash_bytes);
-        if (err_value != CAL_SUCCESS) {
-            break;
-        }
-
         /* Generate ECDSA signature with DER encoding */
         sign_bytes = ECDSA_size (EVP_PKEY_get0_EC_KEY (key));
         sign = OPENSSL_malloc (sign_bytes);
 
-        if (0 == ECDSA_sign (0 /* ignored */ , hash, hash_bytes, sign,
+        if (0 == ECDSA_sign (0 /* ignored */ , digest, digest_bytes, sign,
                    &sign_bytes, EVP_PKEY_get0_EC_KEY (key))) {
             fprintf (stderr, "Failed to generate ECDSA signature\n");
             err_value = CAL_CRYPTO_API_ERROR;
@@ -385,10 +372,6 @@ pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
         ERR_print_errors_fp (stderr);
     }
 
-    /* Close everything down */
-    if (bio_in)
-       BIO_free (bio_in);
-
   return err_value;
 }
 
@@ -396,21 +379,21 @@ pkcs11_gen_sig_data_ecdsa (const char *in_file, EVP_PKEY * key,
   pkcs11_gen_sig_data_cms
 ---------------------------*/
 static int32_t
-pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
+pkcs11_gen_sig_data_cms (const uint8_t *digest, size_t digest_bytes,
+                         X509 * x509, EVP_PKEY * pkey,
                          hash_alg_t hash_alg, uint8_t * sig_buf,
                          size_t * sig_buf_bytes)
 {
-    BIO *bio_in = NULL;        /**< BIO for in_file data */
     CMS_ContentInfo *cms = NULL;         /**< Ptr used with openssl API */
+    CMS_SignerInfo *si = NULL;           /**< Signer of the signature */
     const EVP_MD *sign_md = NULL;          /**< Ptr to digest name */
     int32_t err_value = CAL_SUCCESS;     /**< Used for return value */
-    /** Array to hold error string */
-    char err_str[MAX_ERR_STR_BYTES];
     /* flags set to match Openssl command line options for generating
-     *  signatures
+     *  signatures, the signature is completed here instead of CMS_final()
+     *  hashing the content
      */
     int32_t flags = CMS_DETACHED | CMS_NOCERTS |
-                    CMS_NOSMIMECAP | CMS_BINARY;
+                    CMS_NOSMIMECAP | CMS_BINARY | CMS_PARTIAL;
 
     if (!pkey || !x509) {
         fprintf (stderr, "Invalid certificate or key\n");
@@ -425,41 +408,37 @@ pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
     }
 
     do {
-        /* Read Data to be signed */
-        if (!(bio_in = BIO_new_file (in_file, "rb"))) {
-            snprintf (err_str, MAX_ERR_STR_BYTES - 1,
-                  "Cannot open data file %s", in_file);
-            fprintf (stderr, "%s\n",err_str);
-            err_value = CAL_CRYPTO_API_ERROR;
-            break;
-         }
-
-        /* Generate CMS Signature - can only use CMS_sign if default
-         * MD is used which is SHA1 */
-        flags |= CMS_PARTIAL;
-
-        cms = CMS_sign (NULL, NULL, NULL, bio_in, flags);
+        cms = CMS_sign (NULL, NULL, NULL, NULL, flags);
         if (!cms) {
             fprintf (stderr, "Failed to initialize CMS signature\n");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
 
-        if (!CMS_add1_signer (cms, x509, pkey, sign_md, flags)) {
+        si = CMS_add1_signer (cms, x509, pkey, sign_md, flags);
+        if (!si) {
             fprintf (stderr, "Failed to generate CMS signature\n");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
          }
 
-        /* Finalize the signature */
-        if (!CMS_final (cms, bio_in, NULL, flags)) {
+        /* Signed attributes CMS_final() would have derived from the
+         * content, then sign them on the token
+         */
+        if (!CMS_signed_add1_attr_by_NID (si, NID_pkcs9_messageDigest,
+                                          V_ASN1_OCTET_STRING, digest,
+                                          (int) digest_bytes) ||
+            !CMS_signed_add1_attr_by_NID (si, NID_pkcs9_contentType,
+                                          V_ASN1_OBJECT,
+                                          CMS_get0_eContentType (cms), -1) ||
+            !CMS_SignerInfo_sign (si)) {
             fprintf (stderr, "Failed to finalize CMS signature\n");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
 
         /* Write CMS signature to output buffer - DER format */
-        err_value = cms_to_buf (cms, bio_in, sig_buf, sig_buf_bytes,
+        err_value = cms_to_buf (cms, NULL, sig_buf, sig_buf_bytes,
                                flags);
     } while (0);
 
@@ -471,8 +450,6 @@ pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
     /* Close everything down */
     if (cms)
         CMS_ContentInfo_free (cms);
-    if (bio_in)
-        BIO_free (bio_in);
 
     return err_value;
 }
@@ -481,15 +458,13 @@ pkcs11_gen_sig_data_cms (const char *in_file, X509 * x509, EVP_PKEY * pkey,
   pkcs11_gen_sig_data_raw
 ---------------------------*/
 static int32_t
-pkcs11_gen_sig_data_raw (const char *in_file, EVP_PKEY * key,
-                         hash_alg_t hash_alg, uint8_t * sig_buf,
-                         int32_t * sig_buf_bytes)
+pkcs11_gen_sig_data_raw (const uint8_t *digest, size_t digest_bytes,
+                         EVP_PKEY * key, hash_alg_t hash_alg,
+                         uint8_t * sig_buf, int32_t * sig_buf_bytes)
 {
 
     RSA *rsa = NULL;     /**< Ptr to rsa of key data */
-    uint8_t *rsa_in = NULL;    /**< Mem ptr for hash data of in_file */
     uint8_t *rsa_out = NULL;     /**< Mem ptr for encrypted data */
-    int32_t rsa_inbytes;         /**< Holds the length of rsa_in buf */
     int32_t rsa_outbytes = 0;      /**< Holds the length of rsa_out buf */
     int32_t key_bytes;       /**< Size of key data */
     int32_t hash_nid;      /**< hash id needed for RSA_sign() */
@@ -497,8 +472,8 @@ pkcs11_gen_sig_data_raw (const char *in_file, EVP_PKEY * key,
     int32_t err_value = CAL_CRYPTO_API_ERROR;
 
     do {
+        /* The caller keeps its reference to key */
         rsa = EVP_PKEY_get1_RSA (key);
-        EVP_PKEY_free (key);
 
         if (!rsa) {
             fprintf (stderr,
@@ -506,23 +481,14 @@ pkcs11_gen_sig_data_raw (const char *in_file, EVP_PKEY * key,
             break;
         }
 
-        rsa_inbytes = HASH_BYTES_MAX;
-        rsa_in = (unsigned char *) OPENSSL_malloc (HASH_BYTES_MAX);
         key_bytes = RSA_size (rsa);
         rsa_out = (unsigned char *) OPENSSL_malloc (key_bytes);
 
-        /* Generate hash data of data from in_file */
-        err_value =
-            calculate_hash (in_file, hash_alg, rsa_in, &rsa_inbytes);
-        if (err_value != CAL_SUCCESS) {
-            break;
-         }
-
         /* Compute signature.  Note: RSA_sign() adds the appropriate DER
          * encoded prefix internally.
          */
         hash_nid = get_NID (hash_alg);
-        if (!RSA_sign (hash_nid, rsa_in, rsa_inbytes, rsa_out,
+        if (!RSA_sign (hash_nid, digest, digest_bytes, rsa_out,
                    (unsigned int *) &rsa_outbytes, rsa)) {
             err_value = CAL_CRYPTO_API_ERROR;
             fprintf (stderr, "Unable to generate signature");
@@ -543,13 +509,56 @@ pkcs11_gen_sig_data_raw (const char *in_file, EVP_PKEY * key,
 
     if (rsa)
         RSA_free (rsa);
-    if (rsa_in)
-        OPENSSL_free (rsa_in);
     if (rsa_out)
         OPENSSL_free (rsa_out);
     return err_value;
 }
 
+/*--------------------------
+  read_data_file
+---------------------------*/
+static int32_t
+read_data_file (const char *in_file, uint8_t ** data, size_t * data_bytes)
+{
+    FILE *fh = NULL;           /**< Input file handle */
+    long file_size = 0;        /**< Size of in_file */
+    int32_t err_value = CAL_SUCCESS;     /**< Return value */
+
+    fh = fopen (in_file, "rb");
+    if (fh == NULL) {
+        fprintf (stderr, "Cannot open data file %s\n", in_file);
+        return CAL_FILE_NOT_FOUND;
+    }
+
+    do {
+        if (fseek (fh, 0, SEEK_END) != 0 || (file_size = ftell (fh)) < 0) {
+            err_value = CAL_FILE_NOT_FOUND;
+            break;
+        }
+        rewind (fh);
+
+        /* Keep a valid allocation for empty files */
+        *data = malloc (file_size + 1);
+        if (*data == NULL) {
+            err_value = CAL_INSUFFICIENT_MEMORY;
+            break;
+        }
+
+        if (fread (*data, 1, file_size, fh) != (size_t) file_size) {
+            fprintf (stderr, "Cannot read data file %s\n", in_file);
+            free (*data);
+            *data = NULL;
+            err_value = CAL_FILE_NOT_FOUND;
+            break;
+        }
+
+        *data_bytes = file_size;
+    } while (0);
+
+    fclose (fh);
+    return err_value;
+}
+
 /*===========================================================================
                                GLOBAL FUNCTIONS
 =============================================================================*/
@@ -560,6 +569,68 @@ int32_t
 pkcs11_gen_sig_data (const char *in_file, const char *cert_ref,
               hash_alg_t hash_alg, sig_fmt_t sig_fmt, uint8_t * sig_buf,
               size_t * sig_buf_bytes, func_mode_t mode)
+{
+    uint8_t *data = NULL;      /**< Content of in_file */
+    size_t data_bytes = 0;     /**< Size of in_file */
+    int32_t error = CAL_SUCCESS;
+
+    /* Check for valid arguments */
+    if ((!in_file) || (!cert_ref) || (!sig_buf) || (!sig_buf_bytes)) {
+       return CAL_INVALID_ARGUMENT;
+    }
+
+    error = read_data_file (in_file, &data, &data_bytes);
+    if (error != CAL_SUCCESS) {
+        return error;
+    }
+
+    error = pkcs11_gen_sig_data_buffer (data, data_bytes, in_file, cert_ref,
+                                        hash_alg, sig_fmt, sig_buf,
+                                        sig_buf_bytes, mode);
+
+    free (data);
+    return error;
+}
+
+/*--------------------------
+ pkcs11_gen_sig_data_buffer
+ ---------------------------*/
+int32_t
+pkcs11_gen_sig_data_buffer (const uint8_t * data, size_t data_bytes,
+              const char *data_name, const char *cert_ref,
+              hash_alg_t hash_alg, sig_fmt_t sig_fmt, uint8_t * sig_buf,
+              size_t * sig_buf_bytes, func_mode_t mode)
+{
+    uint8_t hash[HASH_BYTES_MAX];      /**< Message digest of data */
+    int32_t hash_bytes = HASH_BYTES_MAX;
+    int32_t error = CAL_SUCCESS;
+
+    UNUSED(data_name);
+
+    /* Check for valid arguments */
+    if ((!data) || (!cert_ref) || (!sig_buf) || (!sig_buf_bytes)) {
+       return CAL_INVALID_ARGUMENT;
+    }
+
+    /* Only the digest is sent to the token */
+    error = calculate_hash_buffer (data, data_bytes, hash_alg, hash,
+                                   &hash_bytes);
+    if (error != CAL_SUCCESS) {
+        return error;
+    }
+
+    return pkcs11_gen_sig_data_digest (hash, hash_bytes, cert_ref, hash_alg,
+                                       sig_fmt, sig_buf, sig_buf_bytes,
+                                       mode);
+}
+
+/*--------------------------
+ pkcs11_gen_sig_data_digest
+ ---------------------------*/
+int32_t
+pkcs11_gen_sig_data_digest (const uint8_t * digest, size_t digest_bytes,
+              const char *cert_ref, hash_alg_t hash_alg, sig_fmt_t sig_fmt,
+              uint8_t * sig_buf, size_t * sig_buf_bytes, func_mode_t mode)
 {
     /* Engine configuration */
     ENGINE_CTX *ctx = NULL;
@@ -568,83 +639,58 @@ pkcs11_gen_sig_data (const char *in_file, const char *cert_ref,
     X509 *cert = NULL;
     EVP_PKEY *key = NULL;
 
+    /* Algorithm of digest */
+    const EVP_MD *md = NULL;
+
       /* Operation completed successfully */
     int32_t error = CAL_SUCCESS;
 
+    UNUSED(mode);
+
     /* Check for valid arguments */
-    if ((!in_file) || (!cert_ref) || (!sig_buf) || (!sig_buf_bytes)) {
+    if ((!digest) || (!cert_ref) || (!sig_buf) || (!sig_buf_bytes)) {
        return CAL_INVALID_ARGUMENT;
     }
 
-    /* Allocate new context */
-    ctx = ctx_new();
-
-    if(ctx == NULL){
-        error = CAL_CRYPTO_API_ERROR;
-        goto out;
-    }
-
-    /* Initialize the context */
-    if(!ctx_init(ctx)){
-        error = CAL_CRYPTO_API_ERROR;
-        goto out;
+    md = EVP_get_digestbyname (get_digest_name (hash_alg));
+    if ((md == NULL) || (digest_bytes != (size_t) EVP_MD_size (md))) {
+        fprintf (stderr, "Invalid hash digest algorithm\n");
+        return CAL_INVALID_ARGUMENT;
     }
 
-    cert = ENGINE_load_certificate (ctx->engine, cert_ref);
-    if (!cert)
-    {
+    /* The engine, its session and the objects are loaded once */
+    ctx = ctx_get();
+    if (ctx == NULL) {
         error = CAL_CRYPTO_API_ERROR;
         goto out;
     }
-#ifdef DEBUG
-    X509_print_fp(stdout, cert);
-#endif
-
-    key = ENGINE_load_private_key(ctx->engine, cert_ref, 0, 0);
 
-    if (key == NULL) {
-        error = CAL_CRYPTO_API_ERROR;
+    error = ctx_load_objects(ctx, cert_ref, &cert, &key);
+    if (error != CAL_SUCCESS) {
         goto out;
     }
 
-    /**
-    * OpenSSL expects EVP_PKEY to contain the ec_point. PKCS#11 does not
-	* return the ec_point as an attribute for private key.
-    */
-    if(EVP_PKEY_base_id(key) == EVP_PKEY_RSA) {
-        error = X509_check_private_key(cert, key);
-        if (!error) {
-            error = CAL_CRYPTO_API_ERROR;
-            goto out;
-        }
-    }
-
+    /* The engine session runs one token operation at a time */
+    ctx_lock(ctx);
     if (sig_fmt == SIG_FMT_ECDSA) {
-        error = pkcs11_gen_sig_data_ecdsa (in_file, key, hash_alg, sig_buf,
-                                           sig_buf_bytes);
+        error = pkcs11_gen_sig_data_ecdsa (digest, digest_bytes, key,
+                                           sig_buf, sig_buf_bytes);
     }
     else if (sig_fmt == SIG_FMT_PKCS1) {
-        error = pkcs11_gen_sig_data_raw (in_file, key, hash_alg, sig_buf,
-                                         (int32_t *) sig_buf_bytes);
+        error = pkcs11_gen_sig_data_raw (digest, digest_bytes, key, hash_alg,
+                                         sig_buf, (int32_t *) sig_buf_bytes);
     }
     else if (sig_fmt == SIG_FMT_CMS) {
-        error = pkcs11_gen_sig_data_cms (in_file, cert, key, hash_alg, sig_buf,
-                                         sig_buf_bytes);
+        error = pkcs11_gen_sig_data_cms (digest, digest_bytes, cert, key,
+                                         hash_alg, sig_buf, sig_buf_bytes);
     }
     else {
         fprintf (stderr, "Invalid signature format\n");
-        return CAL_INVALID_ARGUMENT;
+        error = CAL_INVALID_ARGUMENT;
     }
+    ctx_unlock(ctx);
 
 out:
-    if(ctx) {
-    
-   /* Destroy the context: ctx_finish is not called here since
-	* ENGINE_finish cleanups the engine instance. Calling ctx_destroy
-	* next will lead to null pointer dereference. */
-        ctx_destroy(ctx);
-    }
-
     if (error)
         ERR_print_errors_fp(stderr);
     if (cert)
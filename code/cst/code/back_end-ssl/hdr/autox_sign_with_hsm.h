@@ -21,11 +21,12 @@ int32_t autox_sign_with_hsm_buffer(const char *ca_cert,
                                    const char *ssl_cert,
                                    const char *ssl_key,
                                    const char *url,
-                                   uint8_t *i_buffer,
+                                   const uint8_t *i_buffer,
                                    size_t i_len,
                                    uint8_t *o_buffer,
                                    size_t *o_len);
 int32_t autox_download_root_ca(const char *url,
+                               const char *ca_cert,
                                const char *outname);
 
 #endif /* _SIGN_WITH_HSM */
\ No newline at end of file
@@ -0,0 +1,110 @@
+/*
+   Copyright 2026 CST contributors
+   SPDX-License-Identifier: BSD-3-Clause
+
+   ===========================================================================
+
+   @file    https_client.h
+
+   @brief   Minimal HTTP/1.1 client over OpenSSL talking to the remote
+            signing server. Connections are kept alive and reused by the
+            following requests to the same server, so the TCP and TLS
+            handshakes are paid once per process rather than per signature.
+            Requests may be made from several threads, they then run
+            concurrently on a small pool of connections.
+
+   ===========================================================================
+ */
+#ifndef HTTPS_CLIENT_H
+#define HTTPS_CLIENT_H
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdint.h>
+#include <stddef.h>
+
+/*===========================================================================
+                                MACROS
+=============================================================================*/
+#define HTTPS_IO_BYTES      (16 * 1024) /**< Bytes read from a connection */
+#define HTTPS_LINE_BYTES    (8 * 1024)  /**< Max. bytes of a header line  */
+#define HTTPS_MAX_CONNECTIONS (16)      /**< Connections kept per server  */
+#define HTTPS_MAX_BODY_BYTES (1024 * 1024) /**< Max. bytes of a response  */
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Upload data as a multipart/form-data file field
+ *
+ * Sends what `curl --form "file=@<filename>"` sends, with the content of
+ * the file taken from @a data, and returns the response body.
+ *
+ * @param[in] url "https://host[:port]/path", or "http://" for a server
+ *            without TLS
+ *
+ * @param[in] ca_cert CA certificates verifying the server, required for
+ *            https, NULL for http
+ *
+ * @param[in] cert client certificate chain, NULL for none
+ *
+ * @param[in] key private key of @a cert
+ *
+ * @param[in] filename file name given to the server for @a data
+ *
+ * @param[in] data content of the file field
+ *
+ * @param[in] data_bytes bytes of @a data
+ *
+ * @param[out] resp buffer receiving the response body
+ *
+ * @param[in,out] resp_bytes size of @a resp, then bytes of the body
+ *
+ * @retval #CAL_SUCCESS the server answered with a 2xx status
+ *
+ * @retval #CAL_INVALID_ARGUMENT @a url is not supported, or is https
+ *         without @a ca_cert
+ *
+ * @retval #CAL_INSUFFICIENT_BUFFER_LEN the body does not fit in @a resp
+ *         or is over #HTTPS_MAX_BODY_BYTES
+ *
+ * @retval #CAL_CRYPTO_API_ERROR the connection or the request failed
+ */
+int32_t
+https_post_file(const char *url, const char *ca_cert, const char *cert,
+                const char *key, const char *filename, const uint8_t *data,
+                size_t data_bytes, uint8_t *resp, size_t *resp_bytes);
+
+/** Download a resource
+ *
+ * @param[in] url same as for https_post_file()
+ *
+ * @param[in] ca_cert same as for https_post_file()
+ *
+ * @param[out] resp allocated response body, to free with free()
+ *
+ * @param[out] resp_bytes bytes of @a resp
+ *
+ * @retval same as https_post_file()
+ */
+int32_t
+https_get(const char *url, const char *ca_cert, uint8_t **resp,
+          size_t *resp_bytes);
+
+/** Close every kept alive connection
+ *
+ * Called at exit, connections are opened again when needed. Must not be
+ * called while requests are running.
+ */
+void
+https_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPS_CLIENT_H */
@@ -19,5 +19,48 @@ ssl_gen_sig_data(const char *in_file,
                  size_t *sig_buf_bytes,
                  func_mode_t mode);
 
+int32_t
+ssl_gen_sig_data_buffer(const uint8_t *data,
+                        size_t data_bytes,
+                        const char *data_name,
+                        const char *cert_file,
+                        hash_alg_t hash_alg,
+                        sig_fmt_t sig_fmt,
+                        uint8_t *sig_buf,
+                        size_t *sig_buf_bytes,
+                        func_mode_t mode);
+
+int32_t
+ssl_gen_sig_data_digest(const uint8_t *digest,
+                        size_t digest_bytes,
+                        const char *cert_file,
+                        hash_alg_t hash_alg,
+                        sig_fmt_t sig_fmt,
+                        uint8_t *sig_buf,
+                        size_t *sig_buf_bytes,
+                        func_mode_t mode);
+
+/** Set if ssl_gen_sig_data_buffer() may be called from several threads at
+ *  once */
+extern const uint32_t ssl_gen_sig_data_concurrent;
+
 X509*
 ssl_read_certificate(const char* filename);
+
+/** Allocate the data encryption key of a CSF
+ *
+ * The DEK is generated or read by the first gen_auth_encrypted function
+ * given it, and shared by every encrypted block of the CSF.
+ *
+ * @returns the DEK, to be freed with ssl_free_dek(), NULL if it cannot be
+ *          allocated
+ */
+dek_t *
+ssl_new_dek(void);
+
+/** Free the data encryption key of a CSF
+ *
+ * @param[in] dek DEK allocated with ssl_new_dek(), may be NULL
+ */
+void
+ssl_free_dek(dek_t *dek);
@@ -0,0 +1,128 @@
+/*
+   Copyright 2026 CST contributors
+   SPDX-License-Identifier: BSD-3-Clause
+
+   ===========================================================================
+
+   @file    ssl_cache.h
+
+   @brief   Cache of parsed certificates, private keys and key passphrases
+            used by the SSL backend, so each file is read and decoded only
+            once per process. The functions may be called from several
+            threads.
+
+   ===========================================================================
+ */
+#ifndef SSL_CACHE_H
+#define SSL_CACHE_H
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <openssl/x509.h>
+#include <openssl/evp.h>
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Find a cached certificate
+ *
+ * An entry whose file changed size or modification time since it was
+ * cached is dropped.
+ *
+ * @param[in] filename Certificate file name, relative or absolute
+ *
+ * @retval New reference to the cached certificate, the caller must release
+ *         it with X509_free()
+ *
+ * @retval NULL if the certificate is not cached or its file changed
+ */
+X509 *
+ssl_cache_find_certificate(const char *filename);
+
+/** Add a certificate to the cache
+ *
+ * The cache takes its own reference on @a cert, the caller keeps ownership
+ * of the reference it passes in.
+ *
+ * @param[in] filename Certificate file name the object was read from
+ *
+ * @param[in] cert Parsed certificate
+ */
+void
+ssl_cache_add_certificate(const char *filename, X509 *cert);
+
+/** Find a cached private key
+ *
+ * An entry whose file changed size or modification time since it was
+ * cached is dropped.
+ *
+ * @param[in] filename Private key file name, relative or absolute
+ *
+ * @retval New reference to the cached key, the caller must release it with
+ *         EVP_PKEY_free()
+ *
+ * @retval NULL if the key is not cached or its file changed
+ */
+EVP_PKEY *
+ssl_cache_find_private_key(const char *filename);
+
+/** Add a private key to the cache
+ *
+ * The cache takes its own reference on @a key, the caller keeps ownership
+ * of the reference it passes in.
+ *
+ * @param[in] filename Private key file name the object was read from
+ *
+ * @param[in] key Decrypted private key
+ */
+void
+ssl_cache_add_private_key(const char *filename, EVP_PKEY *key);
+
+/** Copy a cached passphrase
+ *
+ * The passphrase is copied while the cache is locked, so that another
+ * thread dropping the entry meanwhile cannot free it under the caller.
+ *
+ * @param[in] filename Password file name, relative or absolute
+ *
+ * @param[out] buf Receives the passphrase, NUL terminated and truncated
+ *                 to @a size - 1 characters
+ *
+ * @param[in] size Bytes of @a buf
+ *
+ * @retval Length of the passphrase copied to @a buf, 0 if @a size is not
+ *         positive
+ *
+ * @retval -1 if the passphrase is not cached or its file changed
+ */
+int
+ssl_cache_copy_passphrase(const char *filename, char *buf, int size);
+
+/** Add a passphrase to the cache
+ *
+ * The passphrase is copied to the OpenSSL secure heap, which keeps it in
+ * locked memory when the heap was set up with CRYPTO_secure_malloc_init(),
+ * and is cleared when dropped.
+ *
+ * @param[in] filename Password file name the passphrase was read from
+ *
+ * @param[in] passphrase Passphrase, NUL terminated
+ */
+void
+ssl_cache_add_passphrase(const char *filename, const char *passphrase);
+
+/** Drop every cached certificate, private key and passphrase
+ */
+void
+ssl_cache_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SSL_CACHE_H */
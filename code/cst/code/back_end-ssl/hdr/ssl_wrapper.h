@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                             INCLUDE FILES
 =============================================================================*/
+#include <stdio.h>
 #ifndef REMOVE_ENCRYPTION
 #include <openssl/evp.h>
 #endif
@@ -47,6 +48,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
                                 MACROS
 =============================================================================*/
 #define MAX_ERR_STR_BYTES (120) /**< Max. error string bytes */
+#define CCM_STREAM_CHUNK_BYTES (1024 * 1024) /**< Bytes encrypted at once */
 
 /*===========================================================================
                          FUNCTION PROTOTYPES
@@ -57,13 +59,58 @@ extern "C" {
 
 void handle_errors(char * str,  int32_t *err_value, char *err_str);
 
-int32_t encryptccm(unsigned char *plaintext, int plaintext_len, unsigned char *aad,
+/** Streaming AES-CCM encryption context */
+typedef struct ccm_stream ccm_stream_t;
+
+/** Start an AES-CCM encryption
+ *
+ * The message is fed to ccm_stream_update() in as many pieces as needed,
+ * so that it never has to be held in memory as a whole. Its total length
+ * is given up front, as AES-CCM authenticates it first.
+ *
+ * @param[in] key AES key
+ * @param[in] key_len bytes of @a key, 16, 24 or 32
+ * @param[in] iv nonce
+ * @param[in] iv_len bytes of @a iv, 7 to 13
+ * @param[in] msg_len total bytes of the message
+ * @param[in] tag_len bytes of the tag, even from 4 to 16
+ * @param[out] err_value set to #CAL_CRYPTO_API_ERROR on failure
+ * @param[out] err_str error details on failure
+ *
+ * @returns the context to free with ccm_stream_free(), NULL on failure
+ */
+ccm_stream_t *ccm_stream_new(unsigned char *key, int key_len, unsigned char *iv,
+    int iv_len, size_t msg_len, int tag_len, int32_t *err_value, char *err_str);
+
+/** Encrypt the next piece of the message
+ *
+ * @a ciphertext receives @a len bytes, it may be @a plaintext.
+ *
+ * @returns *err_value
+ */
+int32_t ccm_stream_update(ccm_stream_t *ccm, const unsigned char *plaintext,
+    unsigned char *ciphertext, size_t len, int32_t *err_value, char *err_str);
+
+/** Get the tag once the whole message is encrypted
+ *
+ * @returns *err_value
+ */
+int32_t ccm_stream_final(ccm_stream_t *ccm, unsigned char *tag,
+    int32_t *err_value, char *err_str);
+
+/** Free an AES-CCM encryption context, @a ccm may be NULL */
+void ccm_stream_free(ccm_stream_t *ccm);
+
+/** Encrypt @a plaintext_len bytes read from @a in into @a out_file with
+ *  AES-CCM, a chunk at a time */
+int32_t encryptccm(FILE *in, size_t plaintext_len, unsigned char *aad,
                    int aad_len, unsigned char *key, int key_len, unsigned char *iv,
                    int iv_len, const char * out_file, unsigned char *tag, int tag_len,
                    int32_t *err_value, char *err_str);
 
 int32_t encryptcbc(unsigned char *plaintext, int plaintext_len, unsigned char *key,
-    int key_len, unsigned char *iv, const char *out_file, int32_t *err_value, char *err_str);
+    int key_len, unsigned char *iv, unsigned char *ciphertext, int32_t *err_value,
+    char *err_str);
 
 #ifdef __cplusplus
 }
@@ -44,10 +44,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
                                 INCLUDE FILES
 =============================================================================*/
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <strings.h>
+#include <time.h>
 #include "ssl_wrapper.h"
 #include <string.h>
 #include <openssl/bio.h>
@@ -63,8 +66,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ssl_backend.h"
 #include "openssl_helper.h"
 #include "pkey.h"
+#include "ssl_cache.h"
 #include "csf.h"
 #include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
 #if (defined _WIN32 || defined __CYGWIN__) && defined USE_APPLINK
 #include <openssl/applink.c>
 #endif
@@ -96,10 +102,6 @@ static CSF_IMG get_image_type(const char *in_file)
 #if AUTOX_SIGN
 #include "autox_sign_with_hsm.h"
 
-#define SIGN_SERVER_SIGNED_CSF_OUT_NAME "autox_signed_file_csf.bin"
-#define SIGN_SERVER_SIGNED_IMAGE_OUT_NAME "autox_signed_file_image.bin"
-#define SIGN_SERVER_SIGNED_CSF_IN_NAME "autox_to_sign_file_csf.bin"
-#define SIGN_SERVER_SIGNED_IMAGE_IN_NAME "autox_to_sign_file_image.bin"
 #define SIGN_SERVER_SSL_CSF_CERT "sign_server.crt"
 #define SIGN_SERVER_SSL_IMG_CERT "sign_server.crt"
 #define SIGN_SERVER_SSL_KEY "sign_server.key"
@@ -108,13 +110,25 @@ static CSF_IMG get_image_type(const char *in_file)
 #define SIGN_SERVER_API_CSF_URL "https://dev.xsec-gateway.autox.tech:443/v1/signServer/cms/sign?type=xnavcsf"
 #define SIGN_SERVER_CA_URL "https://dev.ca.autox.tech/ejbca/publicweb/webdist/certdist?cmd=cachain&caid=-238079556&format=pem"
 
-int32_t autox_gen_sig_data_cms(const char* in_file,
+int32_t autox_gen_sig_data_cms(const uint8_t *data,
+                               size_t data_bytes,
+                               CSF_IMG type,
                                uint8_t* sig_buf,
-                               size_t *sig_buf_bytes,
-                               char *sig_out_file);
+                               size_t *sig_buf_bytes);
 
 #endif /* AUTOX_SIGN */
-static int32_t autox_write_binary_all(const char *filename, uint8_t *buffer, size_t o_len);
+
+/** Reads a whole file into a newly allocated buffer
+ *
+ * @param[in] filename file to read
+ *
+ * @param[out] buffer allocated buffer, the caller must free it
+ *
+ * @param[out] o_len size of the file in bytes
+ *
+ * @returns 0 on success, -1 otherwise
+ */
+static int32_t read_binary_all(const char *filename, uint8_t **buffer, size_t *o_len);
 /*===========================================================================
                                  LOCAL MACROS
 =============================================================================*/
@@ -124,6 +138,12 @@ static int32_t autox_write_binary_all(const char *filename, uint8_t *buffer, siz
 /*===========================================================================
                   LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 =============================================================================*/
+/** Data encryption key of a CSF */
+struct dek {
+    uint8_t key[MAX_AES_KEY_LENGTH];        /**< DEK shared by the CSF     */
+    uint8_t init_done;                      /**< Status of DEK generation */
+    pthread_mutex_t lock;                   /**< Protects the DEK         */
+};
 
 /*===========================================================================
                           LOCAL FUNCTION PROTOTYPES
@@ -131,12 +151,25 @@ static int32_t autox_write_binary_all(const char *filename, uint8_t *buffer, siz
 #if ENABLE_VERIFY
 
 int32_t
-verify_sig_data_cms(const char *in_file,
+verify_sig_data_cms(const uint8_t *data,
+                    size_t data_bytes,
                     const char *cert_ca,
                     const char *cert_signer,
-                    const char *sig_file,
+                    const uint8_t *sig_buf,
+                    size_t sig_buf_bytes,
                     hash_alg_t hash_alg);
 
+#if !AUTOX_SIGN
+int32_t
+verify_sig_digest_cms(const uint8_t *digest,
+                      size_t digest_bytes,
+                      const char *cert_ca,
+                      const char *cert_signer,
+                      const uint8_t *sig_buf,
+                      size_t sig_buf_bytes,
+                      hash_alg_t hash_alg);
+#endif /* !AUTOX_SIGN */
+
 #define DUMP_WIDTH 16
 static void bio_dump(const char *s, int len)
 {
@@ -211,11 +244,13 @@ get_NID(hash_alg_t hash_alg);
 
 /** Generate raw PKCS#1 Signature Data
  *
- * Generates a raw PKCS#1 v1.5 signature for the given data file, signer
+ * Generates a raw PKCS#1 v1.5 signature for the given digest, signer
  * certificate, and hash algorithm. The signature data is returned in
  * a buffer provided by caller.
  *
- * @param[in] in_file string containing path to file with data to sign
+ * @param[in] digest message digest of the data to sign
+ *
+ * @param[in] digest_bytes size of @a digest in bytes
  *
  * @param[in] key_file string containing path to signing key
  *
@@ -226,7 +261,7 @@ get_NID(hash_alg_t hash_alg);
  * @param[in,out] sig_buf_bytes On input, contains size of @a sig_buf in bytes,
  *                              On output, contains size of signature in bytes.
  *
- * @pre @a in_file, @a cert_file, @a key_file, @a sig_buf and @a sig_buf_bytes
+ * @pre @a digest, @a key_file, @a sig_buf and @a sig_buf_bytes
  *         must not be NULL.
  *
  * @post On success @a sig_buf is updated to hold the resulting signature and
@@ -238,7 +273,8 @@ get_NID(hash_alg_t hash_alg);
  * @retval #CAL_CRYPTO_API_ERROR An Openssl related error has occured
  */
 static int32_t
-gen_sig_data_raw(const char *in_file,
+gen_sig_data_raw(const uint8_t *digest,
+                 size_t digest_bytes,
                  const char *key_file,
                  hash_alg_t hash_alg,
                  uint8_t *sig_buf,
@@ -246,13 +282,13 @@ gen_sig_data_raw(const char *in_file,
 
 /** Generate CMS Signature Data
  *
- * Generates a CMS signature for the given data file, signer certificate, and
+ * Generates a CMS signature for the given data, signer certificate, and
  * hash algorithm. The signature data is returned in a buffer provided by
- * caller.  Note that sign_data cannot be used here since that function
- * requires an input buffer as an argument.  For large files it becomes
- * unreasonable to allocate a contigous block of memory.
+ * caller.
+ *
+ * @param[in] data buffer holding the data to sign
  *
- * @param[in] in_file string containing path to file with data to sign
+ * @param[in] data_bytes size of @a data in bytes
  *
  * @param[in] cert_file string constaining path to signer certificate
  *
@@ -263,7 +299,7 @@ gen_sig_data_raw(const char *in_file,
  * @param[in,out] sig_buf_bytes On input, contains size of @a sig_buf in bytes,
  *                              On output, contains size of signature in bytes.
  *
- * @pre @a in_file, @a cert_file, @a key_file, @a sig_buf and @a sig_buf_bytes
+ * @pre @a data, @a cert_file, @a key_file, @a sig_buf and @a sig_buf_bytes
  *         must not be NULL.
  *
  * @post On success @a sig_buf is updated to hold the resulting signature and
@@ -278,12 +314,48 @@ gen_sig_data_raw(const char *in_file,
  */
 #if !AUTOX_SIGN
 static int32_t
-gen_sig_data_cms(const char *in_file,
+gen_sig_data_cms(const uint8_t *data,
+                 size_t data_bytes,
                  const char *cert_file,
                  const char *key_file,
                  hash_alg_t hash_alg,
                  uint8_t *sig_buf,
                  size_t *sig_buf_bytes);
+
+/** Generate CMS Signature Data from a Digest
+ *
+ * Same as gen_sig_data_cms(), with the message digest of the data computed
+ * by the caller.
+ *
+ * @param[in] digest message digest of the data to sign
+ *
+ * @param[in] digest_bytes size of @a digest in bytes, must match @a hash_alg
+ *
+ * @param[in] cert_file string constaining path to signer certificate
+ *
+ * @param[in] key_file string constaining path to signer private key
+ *
+ * @param[in] hash_alg hash algorithm @a digest was computed with
+ *
+ * @param[out] sig_buf signature data buffer
+ *
+ * @param[in,out] sig_buf_bytes On input, contains size of @a sig_buf in bytes,
+ *                              On output, contains size of signature in bytes.
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_INVALID_ARGUMENT One of the input arguments is invalid
+ *
+ * @retval #CAL_CRYPTO_API_ERROR An Openssl related error has occured
+ */
+static int32_t
+gen_sig_data_cms_digest(const uint8_t *digest,
+                        size_t digest_bytes,
+                        const char *cert_file,
+                        const char *key_file,
+                        hash_alg_t hash_alg,
+                        uint8_t *sig_buf,
+                        size_t *sig_buf_bytes);
 #endif /* !AUTOX_SIGN */
 
 /** Copies CMS Content Info with encrypted or signature data to buffer
@@ -375,13 +447,122 @@ int32_t encrypt_dek_key(uint8_t * key, size_t key_bytes,
 static void
 display_error(const char *err);
 
+/** Read a private key
+ *
+ * Returns the private key parsed from @a key_file, reusing the copy kept
+ * in the SSL backend cache when the file was already decrypted by this
+ * process.
+ *
+ * @param[in] key_file Private key file name
+ *
+ * @pre  @a key_file is not NULL
+ *
+ * @returns key reference the caller must release with EVP_PKEY_free(),
+ *          NULL on failure
+ */
+static EVP_PKEY *
+load_private_key(const char *key_file);
+
+/** Initialize the data encryption key
+ *
+ * Reads the DEK from @a key_file when it is reused, otherwise generates it
+ * and saves it to @a key_file, encrypted with @a cert_file if not NULL.
+ * Done once for all the encrypted data of a CSF, whatever the number of
+ * threads asking for it.
+ *
+ * @param[in,out] dek DEK of the CSF
+ *
+ * @param[in] key_bytes size of the DEK
+ *
+ * @param[in] cert_file certificate the DEK is encrypted with, may be NULL
+ *
+ * @param[in] key_file DEK file
+ *
+ * @param[in] reuse_dek set if @a key_file already holds the DEK
+ *
+ * @returns #CAL_SUCCESS, #CAL_FILE_NOT_FOUND or #CAL_CRYPTO_API_ERROR
+ */
+static int32_t
+init_dek(dek_t *dek, size_t key_bytes, const char *cert_file,
+         const char *key_file, int reuse_dek);
+
+/** Generate the AES-CCM nonce
+ *
+ * The random generator is run twice to check it does not repeat itself.
+ *
+ * @param[out] nonce nonce bytes
+ *
+ * @param[in] nonce_bytes size of nonce
+ *
+ * @returns #CAL_SUCCESS or #CAL_CRYPTO_API_ERROR
+ */
+static int32_t
+gen_nonce(uint8_t *nonce, size_t nonce_bytes);
+
+/** Encrypt a file with AES-CBC using the DEK
+ *
+ * Reads @a in_bytes from @a in and writes their encryption to @a out_file,
+ * #CCM_STREAM_CHUNK_BYTES at a time, chaining the IV across chunks.
+ *
+ * @param[in] dek DEK of the CSF, initialized
+ *
+ * @param[in] in file positioned at the data to encrypt
+ *
+ * @param[in] in_bytes bytes to encrypt, a multiple of #AES_BLOCK_BYTES
+ *
+ * @param[in] key_bytes size of the DEK
+ *
+ * @param[in] iv initialization vector of #AES_BLOCK_BYTES
+ *
+ * @param[in] out_file encrypted data file
+ *
+ * @returns #CAL_SUCCESS, #CAL_CRYPTO_API_ERROR or #CAL_FAILED_FILE_CREATE
+ */
+static int32_t
+encrypt_cbc_file(const dek_t *dek, FILE *in, size_t in_bytes,
+                 size_t key_bytes, const uint8_t *iv, const char *out_file);
+
 /*===========================================================================
                                GLOBAL VARIABLES
 =============================================================================*/
+#if AUTOX_SIGN
+/* Requests to the signing server run concurrently on a connection pool */
+const uint32_t ssl_gen_sig_data_concurrent = 1;
+#else
+const uint32_t ssl_gen_sig_data_concurrent = 0;
+#endif /* AUTOX_SIGN */
+
+/*===========================================================================
+                               LOCAL VARIABLES
+=============================================================================*/
 
 /*===========================================================================
                                LOCAL FUNCTIONS
 =============================================================================*/
+/*--------------------------
+  load_private_key
+---------------------------*/
+EVP_PKEY *
+load_private_key(const char *key_file)
+{
+    EVP_PKEY *key = ssl_cache_find_private_key(key_file);
+
+    if (key != NULL)
+    {
+        return key;
+    }
+
+    key = read_private_key(key_file,
+                           (pem_password_cb *)get_passcode_to_key_file,
+                           key_file);
+    if (key != NULL)
+    {
+        ssl_cache_add_private_key(key_file, key);
+    }
+
+    return key;
+}
+
 /*--------------------------
   get_NID
 ---------------------------*/
@@ -395,7 +576,8 @@ get_NID(hash_alg_t hash_alg)
   gen_sig_data_raw
 ---------------------------*/
 int32_t
-gen_sig_data_raw(const char *in_file,
+gen_sig_data_raw(const uint8_t *digest,
+                 size_t digest_bytes,
                  const char *key_file,
                  hash_alg_t hash_alg,
                  uint8_t *sig_buf,
@@ -403,9 +585,7 @@ gen_sig_data_raw(const char *in_file,
 {
     EVP_PKEY *key = NULL; /**< Ptr to read key data */
     RSA *rsa = NULL; /**< Ptr to rsa of key data */
-    uint8_t *rsa_in = NULL; /**< Mem ptr for hash data of in_file */
     uint8_t *rsa_out = NULL; /**< Mem ptr for encrypted data */
-    int32_t rsa_inbytes; /**< Holds the length of rsa_in buf */
     unsigned int rsa_outbytes = 0; /**< Holds the length of rsa_out buf */
     int32_t key_bytes; /**< Size of key data */
     int32_t hash_nid; /**< hash id needed for RSA_sign() */
@@ -417,9 +597,7 @@ gen_sig_data_raw(const char *in_file,
     do
     {
         /* Read key */
-        key = read_private_key(key_file,
-                           (pem_password_cb *)get_passcode_to_key_file,
-                           key_file);
+        key = load_private_key(key_file);
         if (!key) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
                      "Cannot open key file %s", key_file);
@@ -435,23 +613,15 @@ gen_sig_data_raw(const char *in_file,
             break;
         }
 
-        rsa_inbytes = HASH_BYTES_MAX;
-        rsa_in = OPENSSL_malloc(HASH_BYTES_MAX);
         key_bytes = RSA_size(rsa);
         rsa_out = OPENSSL_malloc(key_bytes);
 
-        /* Generate hash data of data from in_file */
-        err_value = calculate_hash(in_file, hash_alg, rsa_in, &rsa_inbytes);
-        if (err_value != CAL_SUCCESS) {
-            break;
-        }
-
         /* Compute signature.  Note: RSA_sign() adds the appropriate DER
          * encoded prefix internally.
          */
         hash_nid = get_NID(hash_alg);
-        if (!RSA_sign(hash_nid, rsa_in,
-                      rsa_inbytes, rsa_out,
+        if (!RSA_sign(hash_nid, digest,
+                      digest_bytes, rsa_out,
                       (unsigned int *)&rsa_outbytes, rsa)) {
             err_value = CAL_CRYPTO_API_ERROR;
             display_error("Unable to generate signature");
@@ -471,7 +641,6 @@ gen_sig_data_raw(const char *in_file,
     }
 
     if (rsa) RSA_free(rsa);
-    if (rsa_in) OPENSSL_free(rsa_in);
     if (rsa_out) OPENSSL_free(rsa_out);
     return err_value;
 }
@@ -480,7 +649,7 @@ gen_sig_data_raw(const char *in_file,
   gen_sig_data_pss
 ---------------------------*/
 int32_t
-gen_sig_data_pss(const char *in_file,
+gen_sig_data_pss(const uint8_t *digest,
                  const char *key_file,
                  hash_alg_t hash_alg,
                  uint8_t *sig_buf,
@@ -489,8 +658,6 @@ gen_sig_data_pss(const char *in_file,
     const EVP_MD *md = EVP_get_digestbyname(get_digest_name(hash_alg));
     EVP_PKEY *key = NULL; /**< Ptr to read key data */
     RSA *rsa = NULL; /**< Ptr to rsa of key data */
-    uint8_t *hash_msg = NULL; /**< Mem ptr for hash data of in_file */
-    int32_t hash_msg_size; /**< Holds the length of hash_msg buf */
     uint8_t *enc_sig = NULL; /**< Mem ptr for encrypted signature */
     size_t enc_sig_size; /**< Holds the length of encrypted signature buf */
     uint8_t *em = NULL; /**< Mem ptr for encoded message */
@@ -501,9 +668,7 @@ gen_sig_data_pss(const char *in_file,
     do
     {
         /* Read key */
-        key = read_private_key(key_file,
-                           (pem_password_cb *)get_passcode_to_key_file,
-                           key_file);
+        key = load_private_key(key_file);
         if (!key) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
                      "Cannot open key file %s", key_file);
@@ -515,19 +680,6 @@ gen_sig_data_pss(const char *in_file,
         rsa = EVP_PKEY_get1_RSA(key);
         EVP_PKEY_free(key);
 
-        hash_msg_size = HASH_BYTES_MAX;
-        hash_msg = OPENSSL_malloc(HASH_BYTES_MAX);
-        if (hash_msg == NULL) {
-          err_value = CAL_CRYPTO_API_ERROR;
-          break;
-        }
-
-        /* Generate hash data of data from in_file */
-        err_value = calculate_hash(in_file, hash_alg, hash_msg, &hash_msg_size);
-        if (err_value != CAL_SUCCESS) {
-            break;
-        }
-
         em_size = RSA_size(rsa);
         em = OPENSSL_malloc(em_size);
         if (em == NULL) {
@@ -536,7 +688,7 @@ gen_sig_data_pss(const char *in_file,
         }
 
         /* Create encoded RSA PSS message */
-        if (RSA_padding_add_PKCS1_PSS(rsa, em, hash_msg, md, -1) != 1) {
+        if (RSA_padding_add_PKCS1_PSS(rsa, em, digest, md, -1) != 1) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
                      "Cannot create EM %s", key_file);
             display_error(err_str);
@@ -565,11 +717,11 @@ gen_sig_data_pss(const char *in_file,
         }
         *sig_buf_bytes = enc_sig_size;
         memcpy(sig_buf, enc_sig, enc_sig_size);
+        err_value = CAL_SUCCESS;
 
     } while(0);
 
     if (rsa) RSA_free(rsa);
-    if (hash_msg) OPENSSL_free(hash_msg);
     if (em) OPENSSL_free(em);
     if (enc_sig) OPENSSL_free(enc_sig);
     return err_value;
@@ -723,18 +875,47 @@ X509_STORE *load_cert_chain(const char *file)
 }
 
 /*--------------------------
-  gen_sig_data_cms
+  check_signed_digest
 ---------------------------*/
-int32_t
-verify_sig_data_cms(const char *in_file,
-                    const char *cert_ca,
-                    const char *cert_signer,
-                    const char *sig_file,
-                    hash_alg_t hash_alg)
+static int check_signed_digest(CMS_ContentInfo* cms, const uint8_t *digest,
+                               size_t digest_bytes)
+{
+    int i;
+    STACK_OF(CMS_SignerInfo) *infos = CMS_get0_SignerInfos(cms);
+
+    for (i = 0; i < sk_CMS_SignerInfo_num(infos); ++i) {
+        CMS_SignerInfo *si = sk_CMS_SignerInfo_value(infos, i);
+        ASN1_OCTET_STRING *md = CMS_signed_get0_data_by_OBJ(si,
+                                    OBJ_nid2obj(NID_pkcs9_messageDigest),
+                                    -3, V_ASN1_OCTET_STRING);
+
+        if (md == NULL || (size_t)ASN1_STRING_length(md) != digest_bytes ||
+            memcmp(ASN1_STRING_get0_data(md), digest, digest_bytes) != 0) {
+            LOG_DEBUG("Signer %d did not sign the expected digest\n", i);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*--------------------------
+  verify_sig_cms
+---------------------------*/
+static int32_t
+verify_sig_cms(const uint8_t *data,
+               size_t data_bytes,
+               const uint8_t *digest,
+               size_t digest_bytes,
+               const char *cert_ca,
+               const char *cert_signer,
+               const uint8_t *sig_buf,
+               size_t sig_buf_bytes,
+               hash_alg_t hash_alg)
 
 {
-    BIO             *bio_in = NULL;   /**< BIO for in_file data */
-    BIO             *bio_sigfile = NULL;   /**< BIO for sigfile data */
+    BIO             *bio_in = NULL;   /**< BIO for signed data */
+    BIO             *bio_sigfile = NULL;   /**< BIO for signature data */
     X509_STORE      *store = NULL;     /**< Ptr to X509 certificate read data */
     X509            *signer_cert = NULL;
     CMS_ContentInfo *cms = NULL;      /**< Ptr used with openssl API */
@@ -756,6 +937,11 @@ verify_sig_data_cms(const char *in_file,
         return CAL_INVALID_ARGUMENT;
     }
 
+    /* Without the data, the signed message digest is compared instead */
+    if (digest != NULL) {
+        flags |= CMS_NO_CONTENT_VERIFY;
+    }
+
     do {
         store = load_cert_chain(cert_ca);
         if (store == NULL) {
@@ -776,10 +962,8 @@ verify_sig_data_cms(const char *in_file,
         }
 
         /* Read signature Data */
-        if (!(bio_sigfile = BIO_new_file(sig_file, "rb"))) {
-            snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                     "Cannot open signature file %s", sig_file);
-            display_error(err_str);
+        if (!(bio_sigfile = BIO_new_mem_buf(sig_buf, sig_buf_bytes))) {
+            display_error("Cannot allocate signature BIO");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
@@ -798,21 +982,19 @@ verify_sig_data_cms(const char *in_file,
             break;
         }
 
-        /* Open the content file (data which was signed) */
-        if (!(bio_in = BIO_new_file(in_file, "rb"))) {
-            snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                     "Cannot open data which was signed  %s", in_file);
-            display_error(err_str);
+        /* Wrap the content (data which was signed) */
+        if (!(bio_in = BIO_new_mem_buf(data, data_bytes))) {
+            display_error("Cannot allocate signed data BIO");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
 
         rc = CMS_verify(cms, NULL, store, bio_in, NULL, flags);
+        if (rc && digest != NULL) {
+            rc = (check_signed_digest(cms, digest, digest_bytes) == 0);
+        }
         if (!rc) {
-            snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                     "\n\n\n!!!!!!!!! Failed to verify the signature file [%s] !!!!!!!!\n\n",
-                     sig_file);
-            display_error(err_str);
+            display_error("\n\n\n!!!!!!!!! Failed to verify the signature !!!!!!!!\n\n");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
@@ -843,32 +1025,129 @@ verify_sig_data_cms(const char *in_file,
     return err_value;
 }
 
+/*--------------------------
+  verify_sig_data_cms
+---------------------------*/
+int32_t
+verify_sig_data_cms(const uint8_t *data,
+                    size_t data_bytes,
+                    const char *cert_ca,
+                    const char *cert_signer,
+                    const uint8_t *sig_buf,
+                    size_t sig_buf_bytes,
+                    hash_alg_t hash_alg)
+{
+    return verify_sig_cms(data, data_bytes, NULL, 0, cert_ca, cert_signer,
+                          sig_buf, sig_buf_bytes, hash_alg);
+}
+
+#if !AUTOX_SIGN
+/*--------------------------
+  verify_sig_digest_cms
+---------------------------*/
+int32_t
+verify_sig_digest_cms(const uint8_t *digest,
+                      size_t digest_bytes,
+                      const char *cert_ca,
+                      const char *cert_signer,
+                      const uint8_t *sig_buf,
+                      size_t sig_buf_bytes,
+                      hash_alg_t hash_alg)
+{
+    /* The content is not hashed, only the signed attributes are checked */
+    return verify_sig_cms((const uint8_t *)"", 0, digest, digest_bytes,
+                          cert_ca, cert_signer, sig_buf, sig_buf_bytes,
+                          hash_alg);
+}
+#endif /* !AUTOX_SIGN */
+
 #endif /* ENABLE_VERIFY */
 /*--------------------------
   gen_sig_data_cms
 ---------------------------*/
 #if !AUTOX_SIGN
 int32_t
-gen_sig_data_cms(const char *in_file,
+gen_sig_data_cms(const uint8_t *data,
+                 size_t data_bytes,
                  const char *cert_file,
                  const char *key_file,
                  hash_alg_t hash_alg,
                  uint8_t *sig_buf,
                  size_t *sig_buf_bytes)
 {
-    BIO             *bio_in = NULL;   /**< BIO for in_file data */
+    uint8_t hash[HASH_BYTES_MAX];     /**< Message digest of data */
+    int32_t hash_bytes = HASH_BYTES_MAX;
+    int32_t err_value = CAL_SUCCESS;  /**< Used for return value */
+
+    /* The signed attributes only depend on the message digest */
+    err_value = calculate_hash_buffer(data, data_bytes, hash_alg,
+                                      hash, &hash_bytes);
+    if (err_value != CAL_SUCCESS) {
+        return err_value;
+    }
+
+    return gen_sig_data_cms_digest(hash, hash_bytes, cert_file, key_file,
+                                   hash_alg, sig_buf, sig_buf_bytes);
+}
+
+/*--------------------------
+  add_signing_time
+---------------------------*/
+static int add_signing_time(CMS_SignerInfo *si)
+{
+    const char *epoch = getenv("SOURCE_DATE_EPOCH");
+    char *end = NULL;
+    unsigned long long secs = 0;
+    ASN1_TIME *t = NULL;
+    int ok = 0;
+
+    /* Otherwise CMS_SignerInfo_sign() adds the current time */
+    if (epoch == NULL || *epoch == '\0') {
+        return 1;
+    }
+
+    errno = 0;
+    secs = strtoull(epoch, &end, 10);
+    if (*end != '\0' || errno != 0 || *epoch == '-') {
+        display_error("Invalid SOURCE_DATE_EPOCH");
+        return 0;
+    }
+
+    t = ASN1_TIME_set(NULL, (time_t)secs);
+    ok = (t != NULL &&
+          CMS_signed_add1_attr_by_NID(si, NID_pkcs9_signingTime, t->type, t,
+                                      -1));
+    ASN1_TIME_free(t);
+
+    return ok;
+}
+
+/*--------------------------
+  gen_sig_data_cms_digest
+---------------------------*/
+int32_t
+gen_sig_data_cms_digest(const uint8_t *digest,
+                        size_t digest_bytes,
+                        const char *cert_file,
+                        const char *key_file,
+                        hash_alg_t hash_alg,
+                        uint8_t *sig_buf,
+                        size_t *sig_buf_bytes)
+{
     X509            *cert = NULL;     /**< Ptr to X509 certificate read data */
     EVP_PKEY        *key = NULL;      /**< Ptr to key read data */
     CMS_ContentInfo *cms = NULL;      /**< Ptr used with openssl API */
+    CMS_SignerInfo  *si = NULL;       /**< Signer of the CMS signature */
     const EVP_MD    *sign_md = NULL;  /**< Ptr to digest name */
     int32_t err_value = CAL_SUCCESS;  /**< Used for return value */
     /** Array to hold error string */
     char err_str[MAX_ERR_STR_BYTES];
     /* flags set to match Openssl command line options for generating
-     *  signatures
+     * signatures, the signature is completed here instead of CMS_final()
+     * hashing the content
      */
     int32_t         flags = CMS_DETACHED | CMS_NOCERTS |
-                            CMS_NOSMIMECAP | CMS_BINARY;
+                            CMS_NOSMIMECAP | CMS_BINARY | CMS_PARTIAL;
 
     /* Set signature message digest alg */
     sign_md = EVP_get_digestbyname(get_digest_name(hash_alg));
@@ -889,9 +1168,7 @@ gen_sig_data_cms(const char *in_file,
         }
 
         /* Read key */
-        key = read_private_key(key_file,
-                           (pem_password_cb *)get_passcode_to_key_file,
-                           key_file);
+        key = load_private_key(key_file);
         if (!key) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
                      "Cannot open key file %s", key_file);
@@ -900,41 +1177,39 @@ gen_sig_data_cms(const char *in_file,
             break;
         }
 
-        /* Read Data to be signed */
-        if (!(bio_in = BIO_new_file(in_file, "rb"))) {
-            snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                     "Cannot open data file %s", in_file);
-            display_error(err_str);
-            err_value = CAL_CRYPTO_API_ERROR;
-            break;
-        }
-
-        /* Generate CMS Signature - can only use CMS_sign if default
-         * MD is used which is SHA1 */
-        flags |= CMS_PARTIAL;
-
-        cms = CMS_sign(NULL, NULL, NULL, bio_in, flags);
+        cms = CMS_sign(NULL, NULL, NULL, NULL, flags);
         if (!cms) {
             display_error("Failed to initialize CMS signature");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
 
-        if (!CMS_add1_signer(cms, cert, key, sign_md, flags)) {
+        si = CMS_add1_signer(cms, cert, key, sign_md, flags);
+        if (!si) {
             display_error("Failed to generate CMS signature");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
 
-        /* Finalize the signature */
-        if (!CMS_final(cms, bio_in, NULL, flags)) {
+        /* Signed attributes CMS_final() would have derived from the
+         * content, then sign them. SOURCE_DATE_EPOCH pins the signing
+         * time, so that signing again gives the same signature
+         */
+        if (!add_signing_time(si) ||
+            !CMS_signed_add1_attr_by_NID(si, NID_pkcs9_messageDigest,
+                                         V_ASN1_OCTET_STRING, digest,
+                                         (int)digest_bytes) ||
+            !CMS_signed_add1_attr_by_NID(si, NID_pkcs9_contentType,
+                                         V_ASN1_OBJECT,
+                                         CMS_get0_eContentType(cms), -1) ||
+            !CMS_SignerInfo_sign(si)) {
             display_error("Failed to finalize CMS signature");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
 
         /* Write CMS signature to output buffer - DER format */
-        err_value = cms_to_buf(cms, bio_in, sig_buf, sig_buf_bytes, flags);
+        err_value = cms_to_buf(cms, NULL, sig_buf, sig_buf_bytes, flags);
     } while(0);
 
     /* Print any Openssl errors */
@@ -946,7 +1221,6 @@ gen_sig_data_cms(const char *in_file,
     if (cms)      CMS_ContentInfo_free(cms);
     if (cert)     X509_free(cert);
     if (key)      EVP_PKEY_free(key);
-    if (bio_in)   BIO_free(bio_in);
 
     return err_value;
 }
@@ -955,18 +1229,14 @@ gen_sig_data_cms(const char *in_file,
   gen_sig_data_ecdsa
 ---------------------------*/
 int32_t
-gen_sig_data_ecdsa(const char *in_file,
+gen_sig_data_ecdsa(const uint8_t *digest,
+                   size_t     digest_bytes,
                    const char *key_file,
-                   hash_alg_t hash_alg,
                    uint8_t    *sig_buf,
                    size_t     *sig_buf_bytes)
 {
-    BIO          *bio_in    = NULL;          /**< BIO for in_file data    */
     EVP_PKEY     *key       = NULL;          /**< Private key data        */
     size_t       key_size   = 0;             /**< n of bytes of key param */
-    const EVP_MD *sign_md   = NULL;          /**< Digest name             */
-    uint8_t      *hash      = NULL;          /**< Hash data of in_file    */
-    int32_t      hash_bytes = 0;             /**< Length of hash buffer   */
     uint8_t      *sign      = NULL;          /**< Signature data in DER   */
     uint32_t     sign_bytes = 0;             /**< Length of DER signature */
     uint8_t      *r = NULL, *s = NULL;       /**< Raw signature data R&S  */
@@ -976,19 +1246,10 @@ gen_sig_data_ecdsa(const char *in_file,
     char         err_str[MAX_ERR_STR_BYTES]; /**< Error string            */
     const BIGNUM *sig_r, *sig_s;             /**< signature numbers defined as OpenSSL BIGNUM */
 
-    /* Set signature message digest alg */
-    sign_md = EVP_get_digestbyname(get_digest_name(hash_alg));
-    if (sign_md == NULL) {
-        display_error("Invalid hash digest algorithm");
-        return CAL_INVALID_ARGUMENT;
-    }
-
     do
     {
         /* Read key */
-        key = read_private_key(key_file,
-                               (pem_password_cb *)get_passcode_to_key_file,
-                               key_file);
+        key = load_private_key(key_file);
         if (!key) {
             snprintf(err_str, MAX_ERR_STR_BYTES,
                      "Cannot open key file %s", key_file);
@@ -997,29 +1258,11 @@ gen_sig_data_ecdsa(const char *in_file,
             break;
         }
 
-        /* Read Data to be signed */
-        if (!(bio_in = BIO_new_file(in_file, "rb"))) {
-            snprintf(err_str, MAX_ERR_STR_BYTES,
-                     "Cannot open data file %s", in_file);
-            display_error(err_str);
-            err_value = CAL_CRYPTO_API_ERROR;
-            break;
-        }
-
-        /* Generate hash of data from in_file */
-        hash_bytes = HASH_BYTES_MAX;
-        hash = OPENSSL_malloc(HASH_BYTES_MAX);
-
-        err_value = calculate_hash(in_file, hash_alg, hash, &hash_bytes);
-        if (err_value != CAL_SUCCESS) {
-            break;
-        }
-
         /* Generate ECDSA signature with DER encoding */
         sign_bytes = ECDSA_size(EVP_PKEY_get0_EC_KEY(key));
         sign = OPENSSL_malloc(sign_bytes);
 
-        if (0 == ECDSA_sign(0 /* ignored */, hash, hash_bytes, sign, &sign_bytes, EVP_PKEY_get0_EC_KEY(key))) {
+        if (0 == ECDSA_sign(0 /* ignored */, digest, digest_bytes, sign, &sign_bytes, EVP_PKEY_get0_EC_KEY(key))) {
             display_error("Failed to generate ECDSA signature");
             err_value = CAL_CRYPTO_API_ERROR;
             break;
@@ -1067,7 +1310,6 @@ gen_sig_data_ecdsa(const char *in_file,
 
     /* Close everything down */
     if (key)    EVP_PKEY_free(key);
-    if (bio_in) BIO_free(bio_in);
 
     return err_value;
 }
@@ -1132,71 +1374,56 @@ calculate_sig_buf_size(const char *cert_file) {
   export_habv4_signature_request
 ---------------------------*/
 int32_t
-export_habv4_signature_request(const char *in_file,
+export_habv4_signature_request(const uint8_t *data,
+                               size_t data_bytes,
+                               const char *data_name,
                                const char *cert_file,
                                uint8_t *sig_buf,
                                size_t *sig_buf_bytes)
 {
     FILE *sig_req_fp = NULL;
     int unique_ident[2];
-    FILE *in_file_fp = NULL;
     FILE *cpy_data_fp = NULL;
     char tmp_filename[80];
-    int in_data_size = 0;
-
-    /* Seed rand() to generate unique data tags */
-    srand(time(0));
+    static int seeded = 0;
 
-    /* Open data file */
-    if(!(in_file_fp = fopen(in_file, "rb")))
-    {
-      printf("Unable to open tmp data file\n");
-      return -1;
+    /* Seed rand() once to generate unique data tags, mixing in the process
+     * id for instances started within the same second */
+    if (!seeded) {
+        srand(time(0) ^ getpid());
+        seeded = 1;
     }
 
-    /* Determine the data file size */
-    if(fseek(in_file_fp,0L,SEEK_END) == -1)
+    /* Create unique identifier */
+    unique_ident[0] = rand();
+    unique_ident[1] = rand();
+
+    /* Create the output data file name, tagged so that concurrent requests
+     * from the same directory do not overwrite each other */
+    snprintf(tmp_filename, sizeof(tmp_filename), "data_%08x%08x_%s",
+             unique_ident[1], unique_ident[0], data_name);
+
+    /* Export the data to the output data file */
+    if (!(cpy_data_fp = fopen(tmp_filename, "wb")))
     {
-      printf("Unable to get in_data filesize\n");
-      fclose(in_file_fp);
-      return -1;
-    }
-    if ((in_data_size = ftell(in_file_fp)) < 0) {
-      printf("Unable to get in_data filesize\n");
-      fclose(in_file_fp);
+      printf("Unable to create %s\n", tmp_filename);
       return -1;
     }
 
-    /* Set the fp to the beginning of the data file */
-    rewind(in_file_fp);
-
-    /* Create the output data file name */
-    strcpy(tmp_filename,"data_");
-    strcat(tmp_filename,in_file);
-
-    /* Copy the data file to the output data file */
-    cpy_data_fp = fopen(tmp_filename, "w");
-
-    while (in_data_size--)
+    if (fwrite(data, 1, data_bytes, cpy_data_fp) != data_bytes)
     {
-      char tmp;
-      tmp = fgetc(in_file_fp);  // copying file character by character
-      fputc(tmp, cpy_data_fp);
+      printf("Unable to write %s\n", tmp_filename);
+      fclose(cpy_data_fp);
+      return -1;
     }
 
-    /* Create unique identifier */
-    unique_ident[0] = rand();
-    unique_ident[1] = rand();
-
-    /* Add entry to signing request file for new data file */
+    /* Add entry to signing request file for new data file, in a single
+     * append so that concurrent requests are not interleaved */
     sig_req_fp = fopen("sig_request.txt", "a");
-    fseek(sig_req_fp, 0L, SEEK_END);
-    fprintf(sig_req_fp,"Signing Request:\n");
-    fprintf(sig_req_fp,"%s\n", tmp_filename);
-    fprintf(sig_req_fp,"unique tag: %08x%08x\n",unique_ident[1], unique_ident[0]);
+    fprintf(sig_req_fp,"Signing Request:\n%s\nunique tag: %08x%08x\n",
+            tmp_filename, unique_ident[1], unique_ident[0]);
 
     /* Close all files */
-    fclose(in_file_fp);
     fclose(cpy_data_fp);
     fclose(sig_req_fp);
 
@@ -1264,21 +1491,78 @@ int32_t ssl_gen_sig_data(const char* in_file,
                      func_mode_t mode)
 {
     int32_t err = CAL_SUCCESS; /**< Used for return value */
-    char *key_file = NULL;     /**< Mem ptr for key filename */
+    uint8_t *data = NULL;      /**< Content of in_file */
+    size_t data_bytes = 0;     /**< Size of in_file */
 
     /* Check for valid arguments */
     if ((!in_file) || (!cert_file) || (!sig_buf) || (!sig_buf_bytes)) {
         return CAL_INVALID_ARGUMENT;
     }
 
+    /* AHAB signing requests only reference the data file, unlike the HAB
+       CMS requests */
+    if ((MODE_HSM == mode) && (SIG_FMT_CMS != sig_fmt)) {
+        return export_signature_request(in_file, cert_file);
+    }
+
+    if (read_binary_all(in_file, &data, &data_bytes) != 0) {
+        return CAL_FILE_NOT_FOUND;
+    }
+
+    err = ssl_gen_sig_data_buffer(data, data_bytes, in_file, cert_file,
+                                  hash_alg, sig_fmt, sig_buf, sig_buf_bytes,
+                                  mode);
+
+    free(data);
+    return err;
+}
+
+/*--------------------------
+  ssl_gen_sig_data_buffer
+---------------------------*/
+int32_t ssl_gen_sig_data_buffer(const uint8_t* data,
+                     size_t data_bytes,
+                     const char* data_name,
+                     const char* cert_file,
+                     hash_alg_t hash_alg,
+                     sig_fmt_t sig_fmt,
+                     uint8_t* sig_buf,
+                     size_t *sig_buf_bytes,
+                     func_mode_t mode)
+{
+    int32_t err = CAL_SUCCESS; /**< Used for return value */
+    char *key_file = NULL;     /**< Mem ptr for key filename */
+
+    /* Check for valid arguments */
+    if ((!data) || (!data_name) || (!cert_file) || (!sig_buf) ||
+        (!sig_buf_bytes)) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
     if (MODE_HSM == mode)
     {
-        if ( TGT_AHAB == g_target ) {
-            return export_signature_request(in_file, cert_file);
-        } else if ( TGT_HAB == g_target ) {
-            return export_habv4_signature_request(in_file, cert_file,
-                                            sig_buf, sig_buf_bytes);
+        if ( SIG_FMT_CMS != sig_fmt ) {
+            return export_signature_request(data_name, cert_file);
+        } else {
+            return export_habv4_signature_request(data, data_bytes, data_name,
+                                                  cert_file, sig_buf,
+                                                  sig_buf_bytes);
+        }
+    }
+
+    /* Only CMS signatures need the data, the other formats sign its
+     * digest */
+    if (SIG_FMT_CMS != sig_fmt) {
+        uint8_t hash[HASH_BYTES_MAX];     /**< Message digest of data */
+        int32_t hash_bytes = HASH_BYTES_MAX;
+
+        err = calculate_hash_buffer(data, data_bytes, hash_alg,
+                                    hash, &hash_bytes);
+        if (err != CAL_SUCCESS) {
+            return err;
         }
+        return ssl_gen_sig_data_digest(hash, hash_bytes, cert_file, hash_alg,
+                                       sig_fmt, sig_buf, sig_buf_bytes, mode);
     }
 
     /* Determine private key filename from given certificate filename */
@@ -1289,84 +1573,51 @@ int32_t ssl_gen_sig_data(const char* in_file,
         return CAL_FILE_NOT_FOUND;
     }
 
-    if (SIG_FMT_PKCS1 == sig_fmt) {
-        err = gen_sig_data_raw(in_file, key_file,
-                               hash_alg, sig_buf, (int32_t *)sig_buf_bytes);
-    }
-    else if (SIG_FMT_RSA_PSS == sig_fmt) {
-        err = gen_sig_data_pss(in_file, key_file,
-                               hash_alg, sig_buf, (int32_t *)sig_buf_bytes);
-    }
-    else if (SIG_FMT_CMS == sig_fmt) {
+#if ENABLE_VERIFY || AUTOX_SIGN
+    CSF_IMG type = get_image_type(data_name);
+#endif /* ENABLE_VERIFY || AUTOX_SIGN */
 #if AUTOX_SIGN
-        char autox_signed_file_name[1024];
-        err = autox_gen_sig_data_cms(in_file, sig_buf,
-                                     sig_buf_bytes, autox_signed_file_name);
-        if (err != CAL_SUCCESS) {
-            goto finish;
-        }
-        if (*sig_buf_bytes > 1024) {
-            printf("sig_buf_bytes is oversize!!! %lu\n", *sig_buf_bytes);
-            err = CAL_INVALID_SIG_DATA_SIZE;
-            goto finish;
-        }
+    err = autox_gen_sig_data_cms(data, data_bytes, type, sig_buf,
+                                 sig_buf_bytes);
+    if (err != CAL_SUCCESS) {
+        goto finish;
+    }
+    if (*sig_buf_bytes > 1024) {
+        printf("sig_buf_bytes is oversize!!! %lu\n", *sig_buf_bytes);
+        err = CAL_INVALID_SIG_DATA_SIZE;
+        goto finish;
+    }
 #else
-        char nxp_signed_file_name[1024];
-        err = gen_sig_data_cms(in_file, cert_file, key_file,
-                               hash_alg, sig_buf, sig_buf_bytes);
-
-        sprintf(nxp_signed_file_name, "nxp_signed_%s", in_file);
-        (void)autox_write_binary_all(nxp_signed_file_name, sig_buf, *sig_buf_bytes);
-
+    err = gen_sig_data_cms(data, data_bytes, cert_file, key_file,
+                           hash_alg, sig_buf, sig_buf_bytes);
 #endif /* AUTOX_SIGN */
-    printf("Sign Done! Signature size is %lu\n", *sig_buf_bytes);
 #if ENABLE_VERIFY
-        if (err != CAL_SUCCESS) {
-            goto finish;
-        }
+    if (err != CAL_SUCCESS) {
+        goto finish;
+    }
 
-        CSF_IMG type = get_image_type(in_file);
-        const char *ca_cert = NULL;
-        const char *signer_cert = NULL;
-        const char *sign_out_file = NULL;
+    const char *ca_cert = NULL;
+    const char *signer_cert = NULL;
 
-        if (type == FILE_TYPE_ERR) {
-            printf("[err] file type error!\n");
-            err = -1;
-            goto finish;
-        }
-#if AUTOX_SIGN
-        ca_cert = "keys/ca_cert_chains.crt";
-        signer_cert = (type == FILE_TYPE_IMAGE) ? \
-                      "keys/IMG1_1_sha256_2048_65537_v3_usr_crt.pem" : \
-                      "keys/CSF1_1_sha256_2048_65537_v3_usr_crt.pem";
-        sign_out_file = (const char *)autox_signed_file_name;
-#else /* NXP_SIGN */
-        ca_cert = "keys/ca_cert_chains.crt";
-        signer_cert = (type == FILE_TYPE_IMAGE) ? \
-                      "keys/IMG1_1_sha256_2048_65537_v3_usr_crt.pem" : \
-                      "keys/CSF1_1_sha256_2048_65537_v3_usr_crt.pem";
-        sign_out_file = (const char *)nxp_signed_file_name;
-#endif /* AUTOX_SIGN */
-        printf("\n-------------------------[Verify infomation]----------------------\n");
-        printf("original file  : %s\n", in_file);
-        printf("signature file : %s\n", sign_out_file);
-        printf("ca cert        : %s\n", ca_cert);
-        printf("signer cert    : %s\n", signer_cert);
-        printf("hash_alg       : %d\n", hash_alg);
-        printf("--------------------------------------------------------------------\n\n");
-        err = verify_sig_data_cms(in_file, ca_cert, signer_cert, sign_out_file, hash_alg);
-#endif /* ENABLE_VERIFY */
-    }
-    else if (SIG_FMT_ECDSA == sig_fmt) {
-        err = gen_sig_data_ecdsa(in_file, key_file,
-                                 hash_alg, sig_buf, sig_buf_bytes);
-    }
-    else {
-        free(key_file);
-        display_error("Invalid signature format");
-        return CAL_INVALID_ARGUMENT;
+    if (type == FILE_TYPE_ERR) {
+        printf("[err] file type error!\n");
+        err = -1;
+        goto finish;
     }
+    ca_cert = "keys/ca_cert_chains.crt";
+    signer_cert = (type == FILE_TYPE_IMAGE) ? \
+                  "keys/IMG1_1_sha256_2048_65537_v3_usr_crt.pem" : \
+                  "keys/CSF1_1_sha256_2048_65537_v3_usr_crt.pem";
+    printf("\n-------------------------[Verify infomation]----------------------\n");
+    printf("original data  : %s (%zu bytes)\n", data_name, data_bytes);
+    printf("signature      : %zu bytes\n", *sig_buf_bytes);
+    printf("ca cert        : %s\n", ca_cert);
+    printf("signer cert    : %s\n", signer_cert);
+    printf("hash_alg       : %d\n", hash_alg);
+    printf("--------------------------------------------------------------------\n\n");
+    err = verify_sig_data_cms(data, data_bytes, ca_cert, signer_cert,
+                              sig_buf, *sig_buf_bytes, hash_alg);
+#endif /* ENABLE_VERIFY */
 #if ENABLE_VERIFY || AUTOX_SIGN
 finish:
 #endif /* ENABLE_VERIFY */
@@ -1375,30 +1626,92 @@ finish:
     return err;
 }
 
-static int32_t autox_write_binary_all(const char *filename, uint8_t *buffer, size_t o_len)
+/*--------------------------
+  ssl_gen_sig_data_digest
+---------------------------*/
+int32_t ssl_gen_sig_data_digest(const uint8_t* digest,
+                     size_t digest_bytes,
+                     const char* cert_file,
+                     hash_alg_t hash_alg,
+                     sig_fmt_t sig_fmt,
+                     uint8_t* sig_buf,
+                     size_t *sig_buf_bytes,
+                     func_mode_t mode)
 {
-    int32_t ret = 0;
-    FILE *fp = NULL;
+    int32_t err = CAL_SUCCESS; /**< Used for return value */
+    char *key_file = NULL;     /**< Mem ptr for key filename */
+    const EVP_MD *md = NULL;   /**< Algorithm of digest */
 
-    fp = fopen(filename, "wb+");
-    if (fp == NULL) {
-        ret = -1;
-        goto finish;
+    /* Check for valid arguments */
+    if ((!digest) || (!cert_file) || (!sig_buf) || (!sig_buf_bytes)) {
+        return CAL_INVALID_ARGUMENT;
     }
 
-    size_t blocks_write = fwrite(buffer, o_len, 1, fp);
-    if (blocks_write != 1) {
-        ret = -1;
-        goto finish;
+    /* HSM signing requests export the data */
+    if (MODE_HSM == mode) {
+        return CAL_NOT_SUPPORTED;
     }
+#if AUTOX_SIGN
+    /* The remote signer is sent the data itself */
+    if (SIG_FMT_CMS == sig_fmt) {
+        return CAL_NOT_SUPPORTED;
+    }
+#endif /* AUTOX_SIGN */
 
-finish:
-    if (fp != NULL) fclose(fp);
-    return ret;
+    md = EVP_get_digestbyname(get_digest_name(hash_alg));
+    if ((md == NULL) || (digest_bytes != (size_t)EVP_MD_size(md))) {
+        display_error("Invalid hash digest algorithm");
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    /* Determine private key filename from given certificate filename */
+    key_file = malloc(strlen(cert_file)+1);
+    err = get_key_file(cert_file, key_file);
+    if ( err != CAL_SUCCESS) {
+        free(key_file);
+        return CAL_FILE_NOT_FOUND;
+    }
+
+    if (SIG_FMT_PKCS1 == sig_fmt) {
+        err = gen_sig_data_raw(digest, digest_bytes, key_file,
+                               hash_alg, sig_buf, (int32_t *)sig_buf_bytes);
+    }
+    else if (SIG_FMT_RSA_PSS == sig_fmt) {
+        err = gen_sig_data_pss(digest, key_file,
+                               hash_alg, sig_buf, (int32_t *)sig_buf_bytes);
+    }
+#if !AUTOX_SIGN
+    else if (SIG_FMT_CMS == sig_fmt) {
+        err = gen_sig_data_cms_digest(digest, digest_bytes, cert_file,
+                                      key_file, hash_alg, sig_buf,
+                                      sig_buf_bytes);
+#if ENABLE_VERIFY
+        /* Same check as ssl_gen_sig_data_buffer(), against the digest */
+        if (err == CAL_SUCCESS) {
+            err = verify_sig_digest_cms(digest, digest_bytes,
+                                        "keys/ca_cert_chains.crt", cert_file,
+                                        sig_buf, *sig_buf_bytes, hash_alg);
+        }
+#endif /* ENABLE_VERIFY */
+    }
+#endif /* !AUTOX_SIGN */
+    else if (SIG_FMT_ECDSA == sig_fmt) {
+        err = gen_sig_data_ecdsa(digest, digest_bytes, key_file,
+                                 sig_buf, sig_buf_bytes);
+    }
+    else {
+        display_error("Invalid signature format");
+        err = CAL_INVALID_ARGUMENT;
+    }
+
+    free(key_file);
+    return err;
 }
 
-#if AUTOX_SIGN
-static int32_t autox_read_binary_all(const char *filename, uint8_t **buffer, size_t *o_len)
+/*--------------------------
+  read_binary_all
+---------------------------*/
+static int32_t read_binary_all(const char *filename, uint8_t **buffer, size_t *o_len)
 {
     int32_t ret = 0;
     struct stat info;
@@ -1409,7 +1722,8 @@ static int32_t autox_read_binary_all(const char *filename, uint8_t **buffer, siz
         goto finish;
     }
 
-    *buffer = (uint8_t *)calloc(1, info.st_size);
+    /* Keep a valid allocation for empty files */
+    *buffer = (uint8_t *)calloc(1, info.st_size + 1);
     if (NULL == *buffer) {
         LOG_DEBUG("Malloc Buffer failed!\n");
         ret = -1;
@@ -1419,21 +1733,16 @@ static int32_t autox_read_binary_all(const char *filename, uint8_t **buffer, siz
     fp = fopen(filename, "rb");
     if (fp == NULL) {
         ret = -1;
-        if (*buffer != NULL) {
-            free(*buffer);
-            *buffer = NULL;
-        }
+        free(*buffer);
+        *buffer = NULL;
         goto finish;
     }
 
     /* Try to read a single block of info.st_size bytes */
-    size_t blocks_read = fread(*buffer, info.st_size, 1, fp);
-    if (blocks_read != 1) {
+    if (fread(*buffer, 1, info.st_size, fp) != (size_t)info.st_size) {
         ret = -1;
-        if (*buffer != NULL) {
-            free(*buffer);
-            *buffer = NULL;
-        }
+        free(*buffer);
+        *buffer = NULL;
         goto finish;
     }
 
@@ -1445,29 +1754,26 @@ finish:
     return ret;
 }
 
+#if AUTOX_SIGN
 static int32_t autox_request_sign_data(int32_t srk_num,
                                        int32_t csf_or_image,
-                                       const char *in_file,
+                                       const uint8_t *data,
+                                       size_t data_bytes,
                                        uint8_t *sig_buf,
-                                       size_t *sig_buf_bytes,
-                                       char *out_name)
+                                       size_t *sig_buf_bytes)
 {
     int32_t err = 0;
     char err_str[MAX_ERR_STR_BYTES];
-    char *signed_file = NULL;
-    uint8_t *buffer = NULL;
     const char *ssl_cert = NULL;
     const char *ssl_key = SIGN_SERVER_SSL_KEY;
     const char *root_ca = SIGN_SERVER_ROOT_CA;
     const char *url_api = NULL;
 
     UNUSED(srk_num);
-    UNUSED(in_file);
 
-    if (NULL == in_file ||
+    if (NULL == data ||
         NULL == sig_buf ||
-        NULL == sig_buf_bytes ||
-        NULL == out_name) {
+        NULL == sig_buf_bytes) {
         snprintf(err_str, MAX_ERR_STR_BYTES-1,
                 "input parameters error!");
         display_error(err_str);
@@ -1487,61 +1793,42 @@ static int32_t autox_request_sign_data(int32_t srk_num,
     ssl_cert = csf_or_image ? \
                   SIGN_SERVER_SSL_CSF_CERT : \
                   SIGN_SERVER_SSL_IMG_CERT;
-    signed_file = csf_or_image ? \
-                  SIGN_SERVER_SIGNED_CSF_OUT_NAME : \
-                  SIGN_SERVER_SIGNED_IMAGE_OUT_NAME;
     url_api = csf_or_image ? \
                   SIGN_SERVER_API_CSF_URL : \
                   SIGN_SERVER_API_IMG_URL;
 
-    strcpy(out_name, signed_file);
-
-    err = autox_sign_with_hsm(in_file,
-                              root_ca,
-                              ssl_cert,
-                              ssl_key,
-                              url_api,
-                              out_name);
-    if (err != 0) {
-        snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                "autox_sign_with_hsm_file_buffer %s failed!", in_file);
-        display_error(err_str);
-        err = CAL_INVALID_ARGUMENT;
-        goto finish;
-    }
-
-    err = autox_read_binary_all(out_name, &buffer, sig_buf_bytes);
+    err = autox_sign_with_hsm_buffer(root_ca,
+                                     ssl_cert,
+                                     ssl_key,
+                                     url_api,
+                                     data,
+                                     data_bytes,
+                                     sig_buf,
+                                     sig_buf_bytes);
     if (err != 0) {
         snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                "autox_read_binary_all %s failed!", out_name);
+                "autox_sign_with_hsm_buffer %s failed!", url_api);
         display_error(err_str);
         err = CAL_INVALID_ARGUMENT;
         goto finish;
     }
 
-    memcpy(sig_buf, buffer, *sig_buf_bytes);
-
 finish:
-    if (buffer != NULL) {
-        free(buffer);
-    }
     return err;
 }
 
-int32_t autox_gen_sig_data_cms(const char* in_file,
+int32_t autox_gen_sig_data_cms(const uint8_t *data,
+                               size_t data_bytes,
+                               CSF_IMG type,
                                uint8_t* sig_buf,
-                               size_t *sig_buf_bytes,
-                               char *sig_out_file)
+                               size_t *sig_buf_bytes)
 {
     int32_t err = CAL_SUCCESS; /**< Used for return value */
     char err_str[MAX_ERR_STR_BYTES];
-    size_t o_len = 0;
-    uint8_t *buffer = NULL;
 
-    if (NULL == in_file ||
+    if (NULL == data ||
         NULL == sig_buf ||
-        NULL == sig_buf_bytes ||
-        NULL == sig_out_file) {
+        NULL == sig_buf_bytes) {
         snprintf(err_str, MAX_ERR_STR_BYTES-1,
                 "input parameters error!");
         err = CAL_INVALID_ARGUMENT;
@@ -1550,9 +1837,6 @@ int32_t autox_gen_sig_data_cms(const char* in_file,
 
     LOG_DEBUG("Bypass NXP signing, makes use of the AUTOX's signer!!!!\n");
 
-    char *dup_in_file_name = NULL;
-    CSF_IMG type = get_image_type(in_file);
-
     if (type >= FILE_TYPE_ERR) {
         snprintf(err_str, MAX_ERR_STR_BYTES-1,
                 "Internal Error, No %s or %s set!", FILE_SIG_IMG_DATA, FILE_SIG_CSF_DATA);
@@ -1561,46 +1845,21 @@ int32_t autox_gen_sig_data_cms(const char* in_file,
         goto finish;
     }
 
-    // backup the origin sign file
-    err = autox_read_binary_all(in_file, &buffer, &o_len);
-    if (err != 0) {
-        snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                "input parameters error!");
-        display_error(err_str);
-        err = CAL_FAILED_FILE_CREATE;
-        goto finish;
-    }
-
-    dup_in_file_name = (type == FILE_TYPE_IMAGE) ? \
-                       SIGN_SERVER_SIGNED_IMAGE_IN_NAME:
-                       SIGN_SERVER_SIGNED_CSF_IN_NAME;
-
-    err = autox_write_binary_all(dup_in_file_name, buffer, o_len);
-    if (err != 0) {
-        snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                "autox_write_binary_all error!");
-        display_error(err_str);
-        err = CAL_FAILED_FILE_CREATE;
-        goto finish;
-    }
-
     err = autox_request_sign_data(1,
                                   type,
-                                  dup_in_file_name,
+                                  data,
+                                  data_bytes,
                                   sig_buf,
-                                  sig_buf_bytes,
-                                  sig_out_file);
+                                  sig_buf_bytes);
     if (err != 0) {
         snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                "Internal Error, call autox_request_sign_data for %s failed!", in_file);
+                "Internal Error, call autox_request_sign_data for %s failed!",
+                (type == FILE_TYPE_IMAGE) ? FILE_SIG_IMG_DATA : FILE_SIG_CSF_DATA);
         display_error(err_str);
         goto finish;
     }
 
 finish:
-    if (buffer != NULL) {
-        free(buffer);
-    }
     return err;
 }
 #endif /* AUTOX_SIGN */
@@ -1797,76 +2056,24 @@ int32_t encrypt_dek_key(uint8_t * key, size_t key_bytes,
 }
 
 /*--------------------------
-  gen_auth_encrypted_data
+  init_dek
 ---------------------------*/
-int32_t gen_auth_encrypted_data(const char* in_file,
-                     const char* out_file,
-                     aead_alg_t aead_alg,
-                     uint8_t *aad,
-                     size_t aad_bytes,
-                     uint8_t *nonce,
-                     size_t nonce_bytes,
-                     uint8_t *mac,
-                     size_t mac_bytes,
-                     size_t key_bytes,
-                     const char* cert_file,
-                     const char* key_file,
-                     int reuse_dek)
+static int32_t
+init_dek(dek_t *dek, size_t key_bytes, const char *cert_file,
+         const char *key_file, int reuse_dek)
 {
     int32_t err_value = CAL_SUCCESS;         /**< status of function calls */
     char err_str[MAX_ERR_STR_BYTES];         /**< Array to hold error string */
-    static uint8_t key[MAX_AES_KEY_LENGTH];  /**< Buffer for random key */
-    static uint8_t key_init_done = 0;        /**< Status of key initialization */
     FILE *fh = NULL;                         /**< Used with files */
-    size_t file_size;                        /**< Size of in_file */
-    unsigned char *plaintext = NULL;                /**< Array to read file data */
     int32_t bytes_read;
 #ifdef DEBUG
     int32_t i;                                        /**< used in for loops */
 #endif
-    uint8_t nonce_temp[nonce_bytes];
-    int32_t j = 1;
+
+    pthread_mutex_lock(&dek->lock);
 
     do {
-        if (AES_CCM == aead_alg) { /* HAB4 */
-            /* Test random byte generation twice for functional confirmation */
-            do {
-                /* Generate Nonce */
-                err_value = gen_random_bytes((uint8_t*)nonce, nonce_bytes);
-                if (err_value != CAL_SUCCESS) {
-                    snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                                "Failed to get nonce");
-                    display_error(err_str);
-                    err_value = CAL_CRYPTO_API_ERROR;
-                    break;
-                }
-                /* Copy nonce in temp variable to compare in next iteration */
-                if (1 == j) {
-                    memcpy(&nonce_temp, nonce, nonce_bytes);
-                }
-                else {
-                    /* If random numbers in two iterations are equal, throw an error */
-                    if (!memcmp(&nonce_temp, nonce, nonce_bytes)) {
-                        snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                                    "Invalid nonce generated");
-                        display_error(err_str);
-                        err_value = CAL_CRYPTO_API_ERROR;
-                        break;
-                    }
-                }
-            } while (j--);
-        }
-        /* Exit this loop if error encountered in random bytes generation */
-        if (err_value != CAL_SUCCESS)
-            break;
-#ifdef DEBUG
-        printf("nonce bytes: ");
-        for(i=0; i<nonce_bytes; i++) {
-            printf("%02x ", nonce[i]);
-        }
-        printf("\n");
-#endif
-        if (0 == key_init_done) {
+        if (0 == dek->init_done) {
             if (reuse_dek) {
                 fh = fopen(key_file, "rb");
                 if (fh == NULL) {
@@ -1877,7 +2084,7 @@ int32_t gen_auth_encrypted_data(const char* in_file,
                     break;
                 }
                 /* Read encrypted data into input_buffer */
-                bytes_read = fread(key, 1, key_bytes, fh);
+                bytes_read = fread(dek->key, 1, key_bytes, fh);
                 if (bytes_read == 0) {
                     snprintf(err_str, MAX_ERR_STR_BYTES-1,
                         "Cannot read file %s", key_file);
@@ -1890,7 +2097,7 @@ int32_t gen_auth_encrypted_data(const char* in_file,
             }
             else {
                 /* Generate random aes key to use it for encrypting data */
-                    err_value = generate_dek_key(key, key_bytes);
+                    err_value = generate_dek_key(dek->key, key_bytes);
                     if (err_value) {
                         snprintf(err_str, MAX_ERR_STR_BYTES-1,
                                     "Failed to generate random key");
@@ -1903,13 +2110,13 @@ int32_t gen_auth_encrypted_data(const char* in_file,
 #ifdef DEBUG
             printf("random key : ");
             for (i=0; i<key_bytes; i++) {
-                printf("%02x ", key[i]);
+                printf("%02x ", dek->key[i]);
             }
             printf("\n");
 #endif
             if (cert_file!=NULL) {
                 /* Encrypt key using cert file and save it in the key_file */
-                err_value = encrypt_dek_key(key, key_bytes, cert_file, key_file);
+                err_value = encrypt_dek_key(dek->key, key_bytes, cert_file, key_file);
                 if (err_value) {
                     snprintf(err_str, MAX_ERR_STR_BYTES-1,
                             "Failed to encrypt and save key");
@@ -1919,7 +2126,7 @@ int32_t gen_auth_encrypted_data(const char* in_file,
                 }
             } else {
                 /* Save key in the key_file */
-                err_value = write_plaintext_dek_key(key, key_bytes, cert_file, key_file);
+                err_value = write_plaintext_dek_key(dek->key, key_bytes, cert_file, key_file);
                 if (err_value) {
                     snprintf(err_str, MAX_ERR_STR_BYTES-1,
                             "Failed to save key");
@@ -1929,59 +2136,212 @@ int32_t gen_auth_encrypted_data(const char* in_file,
                 }
             }
 
-            key_init_done = 1;
+            dek->init_done = 1;
         }
+    } while(0);
 
-        /* Get the size of in_file */
-        fh = fopen(in_file, "rb");
-        if (fh == NULL) {
+    pthread_mutex_unlock(&dek->lock);
+
+    return err_value;
+}
+
+/*--------------------------
+  gen_nonce
+---------------------------*/
+static int32_t
+gen_nonce(uint8_t *nonce, size_t nonce_bytes)
+{
+    int32_t err_value = CAL_SUCCESS;         /**< status of function calls */
+    char err_str[MAX_ERR_STR_BYTES];         /**< Array to hold error string */
+#ifdef DEBUG
+    int32_t i;                                        /**< used in for loops */
+#endif
+    uint8_t nonce_temp[nonce_bytes];
+    int32_t j = 1;
+
+    /* Test random byte generation twice for functional confirmation */
+    do {
+        /* Generate Nonce */
+        err_value = gen_random_bytes((uint8_t*)nonce, nonce_bytes);
+        if (err_value != CAL_SUCCESS) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                     "Unable to open binary file %s", in_file);
+                        "Failed to get nonce");
             display_error(err_str);
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
-        fseek(fh, 0, SEEK_END);
-        file_size = ftell(fh);
-        plaintext = (unsigned char*)malloc(file_size);;
-        if (plaintext == NULL) {
+        /* Copy nonce in temp variable to compare in next iteration */
+        if (1 == j) {
+            memcpy(&nonce_temp, nonce, nonce_bytes);
+        }
+        else {
+            /* If random numbers in two iterations are equal, throw an error */
+            if (!memcmp(&nonce_temp, nonce, nonce_bytes)) {
+                snprintf(err_str, MAX_ERR_STR_BYTES-1,
+                            "Invalid nonce generated");
+                display_error(err_str);
+                err_value = CAL_CRYPTO_API_ERROR;
+                break;
+            }
+        }
+    } while (j--);
+
+#ifdef DEBUG
+    if (err_value == CAL_SUCCESS) {
+        printf("nonce bytes: ");
+        for(i=0; i<nonce_bytes; i++) {
+            printf("%02x ", nonce[i]);
+        }
+        printf("\n");
+    }
+#endif
+    return err_value;
+}
+
+/*--------------------------
+  encrypt_cbc_file
+---------------------------*/
+static int32_t
+encrypt_cbc_file(const dek_t *dek, FILE *in, size_t in_bytes,
+                 size_t key_bytes, const uint8_t *iv, const char *out_file)
+{
+    int32_t err_value = CAL_SUCCESS;         /**< status of function calls */
+    char err_str[MAX_ERR_STR_BYTES];         /**< Array to hold error string */
+    uint8_t chain[AES_BLOCK_BYTES];          /**< IV of the next chunk */
+    uint8_t *plaintext = NULL;               /**< Chunk read from in */
+    uint8_t *ciphertext = NULL;              /**< Chunk written to out_file */
+    FILE *fh = NULL;                         /**< out_file */
+    size_t piece;                            /**< Bytes of the chunk */
+
+    memcpy(chain, iv, AES_BLOCK_BYTES);
+
+    do {
+        plaintext  = malloc(CCM_STREAM_CHUNK_BYTES);
+        ciphertext = malloc(CCM_STREAM_CHUNK_BYTES);
+        if (plaintext == NULL || ciphertext == NULL) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
                          "Not enough allocated memory" );
             display_error(err_str);
             err_value = CAL_CRYPTO_API_ERROR;
             break;
         }
-        fclose(fh);
 
-        fh = fopen(in_file, "rb");
+        fh = fopen(out_file, "wb");
         if (fh == NULL) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                         "Cannot open file %s", in_file);
+                     "Unable to create binary file %s", out_file);
             display_error(err_str);
-            err_value = CAL_FILE_NOT_FOUND;
+            err_value = CAL_FAILED_FILE_CREATE;
             break;
         }
 
-        /* Read encrypted data into input_buffer */
-        bytes_read = fread(plaintext, 1, file_size, fh);
-        fclose(fh);
+        while (in_bytes > 0) {
+            piece = (in_bytes < CCM_STREAM_CHUNK_BYTES) ? in_bytes
+                                                        : CCM_STREAM_CHUNK_BYTES;
+
+            if (fread(plaintext, 1, piece, in) != piece) {
+                snprintf(err_str, MAX_ERR_STR_BYTES-1,
+                         "Unable to read binary file");
+                display_error(err_str);
+                err_value = CAL_CRYPTO_API_ERROR;
+                break;
+            }
+            err_value = encryptcbc(plaintext, (int)piece,
+                                   (uint8_t *)dek->key, key_bytes,
+                                   chain, ciphertext, &err_value, err_str);
+            if (err_value != CAL_SUCCESS) {
+                break;
+            }
+            if (fwrite(ciphertext, 1, piece, fh) != piece) {
+                snprintf(err_str, MAX_ERR_STR_BYTES-1,
+                         "Unable to write binary file %s", out_file);
+                display_error(err_str);
+                err_value = CAL_FAILED_FILE_CREATE;
+                break;
+            }
+            /* CBC carries on from the last ciphertext block */
+            memcpy(chain, ciphertext + piece - AES_BLOCK_BYTES, AES_BLOCK_BYTES);
+            in_bytes -= piece;
+        }
+    } while(0);
+
+    if (fh && fclose(fh) != 0 && err_value == CAL_SUCCESS) {
+        snprintf(err_str, MAX_ERR_STR_BYTES-1,
+                 "Unable to write binary file %s", out_file);
+        display_error(err_str);
+        err_value = CAL_FAILED_FILE_CREATE;
+    }
+    free(plaintext);
+    free(ciphertext);
+
+    return err_value;
+}
+
+/*--------------------------
+  gen_auth_encrypted_data
+---------------------------*/
+int32_t gen_auth_encrypted_data(dek_t *dek,
+                     const char* in_file,
+                     const char* out_file,
+                     aead_alg_t aead_alg,
+                     uint8_t *aad,
+                     size_t aad_bytes,
+                     uint8_t *nonce,
+                     size_t nonce_bytes,
+                     uint8_t *mac,
+                     size_t mac_bytes,
+                     size_t key_bytes,
+                     const char* cert_file,
+                     const char* key_file,
+                     int reuse_dek)
+{
+    int32_t err_value = CAL_SUCCESS;         /**< status of function calls */
+    char err_str[MAX_ERR_STR_BYTES];         /**< Array to hold error string */
+    FILE *fh = NULL;                         /**< Used with files */
+    size_t file_size;                        /**< Size of in_file */
+
+    do {
+        if (AES_CCM == aead_alg) { /* HAB4 */
+            err_value = gen_nonce(nonce, nonce_bytes);
+            if (err_value != CAL_SUCCESS) {
+                break;
+            }
+        }
+        err_value = init_dek(dek, key_bytes, cert_file, key_file, reuse_dek);
+        if (err_value != CAL_SUCCESS) {
+            break;
+        }
+
+        /* Get the size of in_file */
+        fh = fopen(in_file, "rb");
+        if (fh == NULL) {
+            snprintf(err_str, MAX_ERR_STR_BYTES-1,
+                     "Unable to open binary file %s", in_file);
+            display_error(err_str);
+            err_value = CAL_CRYPTO_API_ERROR;
+            break;
+        }
+        fseek(fh, 0, SEEK_END);
+        file_size = ftell(fh);
+        fseek(fh, 0, SEEK_SET);
         /* Reached EOF? */
-        if (bytes_read == 0) {
+        if (file_size == 0) {
             snprintf(err_str, MAX_ERR_STR_BYTES-1,
-                         "Cannot read file %s", out_file);
+                         "Cannot read file %s", in_file);
             display_error(err_str);
             err_value = CAL_FILE_NOT_FOUND;
            break;
         }
 
+        /* The data is encrypted a chunk at a time, never held as a whole */
         if (AES_CCM == aead_alg) { /* HAB4 */
-            err_value = encryptccm(plaintext, file_size, aad, aad_bytes,
-                                key, key_bytes, nonce, nonce_bytes, out_file,
+            err_value = encryptccm(fh, file_size, aad, aad_bytes,
+                                dek->key, key_bytes, nonce, nonce_bytes, out_file,
                                 mac, mac_bytes, &err_value, err_str);
         }
         else if (AES_CBC == aead_alg) { /* AHAB */
-            err_value = encryptcbc(plaintext, file_size, key, key_bytes, nonce,
-                                   out_file, &err_value, err_str);
+            err_value = encrypt_cbc_file(dek, fh, file_size, key_bytes,
+                                         nonce, out_file);
         }
         else {
             err_value = CAL_INVALID_ARGUMENT;
@@ -1992,8 +2352,154 @@ int32_t gen_auth_encrypted_data(const char* in_file,
         }
     } while(0);
 
-    free(plaintext);
-
     /* Clean up */
+    if (fh) {
+        fclose(fh);
+    }
     return err_value;
 }
+
+/*--------------------------
+  gen_auth_encrypted_segments
+---------------------------*/
+int32_t gen_auth_encrypted_segments(dek_t *dek,
+                     aead_segment_t *segments,
+                     size_t segment_count,
+                     aead_alg_t aead_alg,
+                     uint8_t *aad,
+                     size_t aad_bytes,
+                     uint8_t *nonce,
+                     size_t nonce_bytes,
+                     uint8_t *mac,
+                     size_t mac_bytes,
+                     size_t key_bytes,
+                     const char* cert_file,
+                     const char* key_file,
+                     int reuse_dek)
+{
+    int32_t err_value = CAL_SUCCESS;         /**< status of function calls */
+    char err_str[MAX_ERR_STR_BYTES];         /**< Array to hold error string */
+    ccm_stream_t *ccm = NULL;                /**< AES-CCM over all segments */
+    size_t total_bytes = 0;                  /**< Size of the message */
+    size_t i;
+
+    /* No additional data is authenticated */
+    UNUSED(aad);
+    UNUSED(aad_bytes);
+
+    if (AES_CCM != aead_alg) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    err_str[0] = '\0';
+    for (i = 0; i < segment_count; i++) {
+        total_bytes += segments[i].bytes;
+    }
+
+    do {
+        err_value = gen_nonce(nonce, nonce_bytes);
+        if (err_value != CAL_SUCCESS) {
+            break;
+        }
+
+        err_value = init_dek(dek, key_bytes, cert_file, key_file, reuse_dek);
+        if (err_value != CAL_SUCCESS) {
+            break;
+        }
+
+        ccm = ccm_stream_new(dek->key, key_bytes, nonce, nonce_bytes,
+                             total_bytes, mac_bytes, &err_value, err_str);
+        if (ccm == NULL) {
+            break;
+        }
+
+        /* The message is the segments one after the other */
+        for (i = 0; i < segment_count && err_value == CAL_SUCCESS; i++) {
+            ccm_stream_update(ccm, segments[i].data, segments[i].data,
+                              segments[i].bytes, &err_value, err_str);
+        }
+        if (err_value != CAL_SUCCESS) {
+            break;
+        }
+
+        ccm_stream_final(ccm, mac, &err_value, err_str);
+    } while(0);
+
+    if (err_value == CAL_NO_CRYPTO_API_ERROR) {
+        printf("Encryption not enabled\n");
+    }
+    else if (err_value != CAL_SUCCESS && err_str[0] != '\0') {
+        display_error(err_str);
+    }
+
+    ccm_stream_free(ccm);
+
+    return err_value;
+}
+
+/*--------------------------
+  gen_auth_encrypted_buffer
+---------------------------*/
+int32_t gen_auth_encrypted_buffer(dek_t *dek,
+                     const uint8_t *plaintext,
+                     size_t plaintext_bytes,
+                     uint8_t *ciphertext,
+                     aead_alg_t aead_alg,
+                     const uint8_t *iv,
+                     size_t iv_bytes,
+                     size_t key_bytes,
+                     const char* cert_file,
+                     const char* key_file,
+                     int reuse_dek)
+{
+    int32_t err_value = CAL_SUCCESS;         /**< status of function calls */
+    char err_str[MAX_ERR_STR_BYTES];         /**< Array to hold error string */
+
+    if (AES_CBC != aead_alg || AES_BLOCK_BYTES != iv_bytes ||
+        plaintext_bytes > INT_MAX) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    err_value = init_dek(dek, key_bytes, cert_file, key_file, reuse_dek);
+    if (err_value != CAL_SUCCESS) {
+        return err_value;
+    }
+
+    err_value = encryptcbc((uint8_t *)plaintext, (int)plaintext_bytes,
+                           dek->key, key_bytes, (uint8_t *)iv, ciphertext,
+                           &err_value, err_str);
+    if (err_value == CAL_NO_CRYPTO_API_ERROR) {
+        printf("Encryption not enabled\n");
+    }
+
+    return err_value;
+}
+
+/*--------------------------
+  ssl_new_dek
+---------------------------*/
+dek_t *ssl_new_dek(void)
+{
+    dek_t *dek = calloc(1, sizeof(dek_t));
+
+    if (dek != NULL && pthread_mutex_init(&dek->lock, NULL) != 0) {
+        free(dek);
+        dek = NULL;
+    }
+
+    return dek;
+}
+
+/*--------------------------
+  ssl_free_dek
+---------------------------*/
+void ssl_free_dek(dek_t *dek)
+{
+    if (dek == NULL) {
+        return;
+    }
+
+    OPENSSL_cleanse(dek->key, sizeof(dek->key));
+    pthread_mutex_destroy(&dek->lock);
+    free(dek);
+}
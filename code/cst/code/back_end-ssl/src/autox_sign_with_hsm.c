@@ -7,58 +7,33 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include "autox_sign_with_hsm.h"
+#include "https_client.h"
 
 #define LOG_INFO printf("[HSM_LIB] "); printf
-#define LINE_MAX_BUFFER_SIZE 1024
 
-static int32_t run_external_command(const char *cmd,
-                                    char lines[][LINE_MAX_BUFFER_SIZE],
-                                    size_t *line_num)
+/* Largest signature accepted from the signing server */
+#define SIGNATURE_MAX_BYTES (16 * 1024)
+
+/* Name the data is uploaded under, as the server always received it */
+#define SIGN_FORM_FILENAME "temp_buffer_in.bin"
+
+static int32_t read_binary_alloc(const char *filename, uint8_t **buffer,
+                                 size_t *o_len)
 {
     int32_t ret = 0;
+    struct stat info;
     FILE *fp = NULL;
-    char path[LINE_MAX_BUFFER_SIZE];
 
-    if (NULL == cmd) {
-        LOG_INFO("input error!\n");
-        ret = -1;
-        goto finish;
-    }
+    *buffer = NULL;
 
-    fp = popen(cmd, "r");
-    if (NULL == fp) {
-        LOG_INFO("popen error!\n");
+    if (stat(filename, &info) != 0) {
         ret = -1;
         goto finish;
     }
 
-    LOG_INFO("Run : \n %s\n", cmd);
-
-    if (lines != NULL) {
-        size_t cnt = 0;
-        while (fgets(path, sizeof(path), fp) != NULL) {
-            strcpy(lines[cnt], path);
-            cnt ++;
-        }
-        if (line_num != NULL) {
-            *line_num = cnt;
-        }
-    }
-
-finish:
-    if (fp != NULL) {
-        pclose(fp);
-    }
-    return ret;
-}
-
-static int32_t read_binary_all(const char *filename, uint8_t *buffer, size_t *o_len)
-{
-    int32_t ret = 0;
-    struct stat info;
-    FILE *fp = NULL;
-
-    if (stat(filename, &info) != 0) {
+    /* One more byte so that empty files get a buffer too */
+    *buffer = malloc(info.st_size + 1);
+    if (*buffer == NULL) {
         ret = -1;
         goto finish;
     }
@@ -69,9 +44,7 @@ static int32_t read_binary_all(const char *filename, uint8_t *buffer, size_t *o_
         goto finish;
     }
 
-    /* Try to read a single block of info.st_size bytes */
-    size_t blocks_read = fread(buffer, info.st_size, 1, fp);
-    if (blocks_read != 1) {
+    if (fread(*buffer, 1, info.st_size, fp) != (size_t)info.st_size) {
         ret = -1;
         goto finish;
     }
@@ -79,12 +52,15 @@ static int32_t read_binary_all(const char *filename, uint8_t *buffer, size_t *o_
     *o_len = info.st_size;
 
 finish:
-
+    if (ret != 0) {
+        free(*buffer);
+        *buffer = NULL;
+    }
     if (fp != NULL) fclose(fp);
     return ret;
 }
 
-static int32_t write_binary_all(const char *filename, uint8_t *buffer, size_t o_len)
+static int32_t write_binary_all(const char *filename, const uint8_t *buffer, size_t o_len)
 {
     int32_t ret = 0;
     FILE *fp = NULL;
@@ -114,51 +90,40 @@ int32_t autox_sign_with_hsm(const char *file_to_sign,
                             const char *signature_name)
 {
     int32_t ret = 0;
+    uint8_t *signature = NULL;
+    size_t signature_len = SIGNATURE_MAX_BYTES;
 
-    if (NULL == file_to_sign ||
-        NULL == ca_cert ||
-        NULL == ssl_cert ||
-        NULL == ssl_key ||
-        NULL == url ||
-        NULL == signature_name) {
+    if (NULL == signature_name) {
         LOG_INFO("input invalid!\n");
         ret = -1;
         goto finish;
     }
 
-    char cmd[2048] = {0};
-    char output[100][LINE_MAX_BUFFER_SIZE];
-
-    sprintf(cmd,
-            "curl \"%s\" \\\n"
-            "   --silent \\\n"
-            "   --cacert \"%s\" \\\n"
-            "   --request POST \\\n"
-            "   --output \"%s\" \\\n"
-            "   --header \"Content-Type: multipart/form-data\" \\\n"
-            "   --cert %s \\\n"
-            "   --key %s \\\n"
-            "   --form \"file=@%s\" ",
-            url,
-            ca_cert,
-            signature_name,
-            ssl_cert,
-            ssl_key,
-            file_to_sign
-    );
-
-    size_t line_count = 0;
-    ret = run_external_command(cmd, output, &line_count);
+    signature = malloc(signature_len);
+    if (signature == NULL) {
+        ret = -1;
+        goto finish;
+    }
+
+    ret = autox_sign_with_hsm_file_buffer(file_to_sign,
+                                          ca_cert,
+                                          ssl_cert,
+                                          ssl_key,
+                                          url,
+                                          signature,
+                                          &signature_len);
     if (ret != 0) {
-        LOG_INFO("Call run cmd failed.\n cmd: %s\n", cmd);
         goto finish;
     }
 
-    for (size_t i = 0; i < line_count; ++ i) {
-        LOG_INFO("%s", output[i]);
+    ret = write_binary_all(signature_name, signature, signature_len);
+    if (ret != 0) {
+        LOG_INFO("write signature %s failed\n", signature_name);
+        goto finish;
     }
 
 finish:
+    free(signature);
     return ret;
 }
 
@@ -171,39 +136,32 @@ int32_t autox_sign_with_hsm_file_buffer(const char *file_to_sign,
                                         size_t *o_len)
 {
     int32_t ret = 0;
-    const char *out_name = "temp_buffer.out";
+    uint8_t *data = NULL;
+    size_t data_len = 0;
 
-    if (NULL == o_buffer ||
-        NULL == o_len) {
+    if (NULL == file_to_sign) {
         ret = -1;
         LOG_INFO("input invalid!\n");
         goto finish;
     }
 
-    ret = autox_sign_with_hsm(file_to_sign,
-                              ca_cert,
-                              ssl_cert,
-                              ssl_key,
-                              url,
-                              out_name);
+    ret = read_binary_alloc(file_to_sign, &data, &data_len);
     if (ret != 0) {
-        LOG_INFO("call sign_with_hsm failed\n");
+        LOG_INFO("call read binary %s failed\n", file_to_sign);
         goto finish;
     }
 
-    ret = read_binary_all(out_name, o_buffer, o_len);
-    if (ret != 0) {
-        LOG_INFO("call read binary all failed\n");
-        goto finish;
-    }
-
-    ret = remove(out_name);
-    if (ret != 0) {
-        LOG_INFO("call remove file %s failed\n", out_name);
-        goto finish;
-    }
+    ret = autox_sign_with_hsm_buffer(ca_cert,
+                                     ssl_cert,
+                                     ssl_key,
+                                     url,
+                                     data,
+                                     data_len,
+                                     o_buffer,
+                                     o_len);
 
 finish:
+    free(data);
     return ret;
 }
 
@@ -211,42 +169,39 @@ int32_t autox_sign_with_hsm_buffer(const char *ca_cert,
                                    const char *ssl_cert,
                                    const char *ssl_key,
                                    const char *url,
-                                   uint8_t *i_buffer,
+                                   const uint8_t *i_buffer,
                                    size_t i_len,
                                    uint8_t *o_buffer,
                                    size_t *o_len)
 {
     int32_t ret = 0;
-    const char *in_name = "temp_buffer_in.bin";
 
-    if (NULL == i_buffer ||
-        0 == i_len) {
+    if (NULL == ca_cert ||
+        NULL == ssl_cert ||
+        NULL == ssl_key ||
+        NULL == url ||
+        NULL == i_buffer ||
+        0 == i_len ||
+        NULL == o_buffer ||
+        NULL == o_len) {
         LOG_INFO("input invalid!\n");
         ret = -1;
         goto finish;
     }
 
-    ret = write_binary_all(in_name, i_buffer, i_len);
-    if (ret != 0) {
-        LOG_INFO("write signature buffer failed\n");
-        goto finish;
-    }
-
-    ret = autox_sign_with_hsm_file_buffer(in_name,
-                                          ca_cert,
-                                          ssl_cert,
-                                          ssl_key,
-                                          url,
-                                          o_buffer,
-                                          o_len);
-    if (ret != 0) {
-        LOG_INFO("call sign_with_hsm_file_buffer failed\n");
-        goto finish;
-    }
-
-    ret = remove(in_name);
+    /* The data is streamed from memory on a connection kept alive */
+    ret = https_post_file(url,
+                          ca_cert,
+                          ssl_cert,
+                          ssl_key,
+                          SIGN_FORM_FILENAME,
+                          i_buffer,
+                          i_len,
+                          o_buffer,
+                          o_len);
     if (ret != 0) {
-        LOG_INFO("call remove temp failed\n");
+        LOG_INFO("POST %s failed\n", url);
+        ret = -1;
         goto finish;
     }
 
@@ -255,33 +210,35 @@ finish:
 }
 
 int32_t autox_download_root_ca(const char *url,
+                               const char *ca_cert,
                                const char *outname)
 {
     int32_t ret = 0;
-    char cmd[1024] = {0};
+    uint8_t *ca = NULL;
+    size_t ca_len = 0;
 
     if (NULL == url ||
+        NULL == ca_cert ||
         NULL == outname) {
         ret = -1;
         LOG_INFO("invalid input\n");
         goto finish;
     }
 
-    sprintf(cmd,
-            "curl \\\n"
-            "   -sk \"%s\" \\\n"
-            "   -o \"%s\" \n",
-            url,
-            outname
-    );
-
-    ret = run_external_command(cmd, NULL, NULL);
+    ret = https_get(url, ca_cert, &ca, &ca_len);
     if (ret != 0) {
         ret = -1;
-        LOG_INFO("run_external_command %s failed!\n", cmd);
+        LOG_INFO("GET %s failed!\n", url);
+        goto finish;
+    }
+
+    ret = write_binary_all(outname, ca, ca_len);
+    if (ret != 0) {
+        LOG_INFO("write %s failed!\n", outname);
         goto finish;
     }
 
 finish:
+    free(ca);
     return ret;
-}
\ No newline at end of file
+}
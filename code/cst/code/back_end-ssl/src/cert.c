@@ -53,6 +53,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <openssl/err.h>
 #include <openssl/pem.h>
 #include "openssl_helper.h"
+#include "ssl_cache.h"
 
 /*===========================================================================
                                GLOBAL FUNCTIONS
@@ -71,6 +72,13 @@ ssl_read_certificate(const char* filename)
     const char *temp = filename + strlen(filename) -
                        PEM_FILE_EXTENSION_BYTES;
 
+    /* Reuse the certificate if it was already parsed by this process */
+    cert = ssl_cache_find_certificate(filename);
+    if (cert != NULL)
+    {
+        return cert;
+    }
+
     bio_cert = BIO_new(BIO_s_file());
     if (bio_cert == NULL)
     {
@@ -99,5 +107,11 @@ ssl_read_certificate(const char* filename)
     }
 
     BIO_free(bio_cert);
+
+    if (cert != NULL)
+    {
+        ssl_cache_add_certificate(filename, cert);
+    }
+
     return cert;
 }
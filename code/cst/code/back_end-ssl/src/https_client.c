@@ -0,0 +1,988 @@
+/*
+   Copyright 2026 CST contributors
+   SPDX-License-Identifier: BSD-3-Clause
+
+   ===========================================================================
+
+   @file    https_client.c
+
+   @brief   Minimal HTTP/1.1 client over OpenSSL talking to the remote
+            signing server. Up to #HTTPS_MAX_CONNECTIONS connections are
+            kept per server and client certificate, so that requests made
+            from several threads run concurrently, each on its own
+            connection. The TLS session of each connection is kept too so
+            that a connection closed by the server resumes without a full
+            handshake. Request bodies are written straight from the caller
+            buffers and the response body is read straight into the caller
+            buffer.
+
+   ===========================================================================
+ */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <signal.h>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include <adapt_layer.h>
+#include "https_client.h"
+
+/*===========================================================================
+                                MACROS
+=============================================================================*/
+#define HTTPS_HOST_BYTES     (256) /**< Max. bytes of a host name      */
+#define HTTPS_PORT_BYTES     (8)   /**< Max. bytes of a port number    */
+#define HTTPS_BOUNDARY_BYTES (16)  /**< Random bytes of a form boundary */
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/* Parts of a URL */
+typedef struct https_url {
+    int tls;                        /**< Set for https                     */
+    char host[HTTPS_HOST_BYTES];    /**< Host name, without brackets       */
+    char port[HTTPS_PORT_BYTES];    /**< Port number                       */
+    int default_port;               /**< Set if no port was given          */
+    const char *path;               /**< Path and query, points in the URL */
+} https_url_t;
+
+/* Connection kept alive to a server */
+typedef struct https_conn {
+    struct https_conn *next;
+    int tls;                        /**< Set for https                     */
+    char *host;                     /**< Server name                       */
+    char *port;                     /**< Server port                       */
+    char *ca_cert;                  /**< CA file, NULL without TLS         */
+    char *cert;                     /**< Client certificate, NULL if none  */
+    char *key;                      /**< Client key, NULL if none          */
+    SSL_CTX *ssl_ctx;               /**< TLS settings, NULL for http       */
+    SSL_SESSION *session;           /**< Session resumed when reconnecting */
+    BIO *bio;                       /**< NULL while not connected          */
+    int busy;                       /**< Set while a request runs on it    */
+    size_t in_pos;                  /**< Next byte of in to return         */
+    size_t in_len;                  /**< Bytes read in in                  */
+    uint8_t in[HTTPS_IO_BYTES];     /**< Bytes read ahead                  */
+} https_conn_t;
+
+/* Destination of a response body */
+typedef struct https_body {
+    uint8_t *data;                  /**< Body bytes                        */
+    size_t bytes;                   /**< Bytes in data                     */
+    size_t size;                    /**< Size of data                      */
+    int grow;                       /**< Set if data may be reallocated    */
+} https_body_t;
+
+/* Piece of a request, written as is */
+typedef struct https_part {
+    const void *data;
+    size_t bytes;
+} https_part_t;
+
+/*===========================================================================
+                            LOCAL VARIABLES
+=============================================================================*/
+/* Connections kept alive */
+static https_conn_t *connections = NULL;
+
+/* Protects connections and their busy flags */
+static pthread_mutex_t connections_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signaled whenever a connection stops being busy */
+static pthread_cond_t connections_released = PTHREAD_COND_INITIALIZER;
+
+/*===========================================================================
+                            LOCAL FUNCTION PROTOTYPES
+=============================================================================*/
+/** Split @a url, returns #CAL_INVALID_ARGUMENT if it is not supported */
+static int32_t parse_url(const char *url, https_url_t *parts);
+
+/** Allocate a connection to a server, sharing the TLS settings of
+ *  @a same if not NULL */
+static https_conn_t *new_conn(const https_url_t *url, const char *ca_cert,
+                              const char *cert, const char *key,
+                              https_conn_t *same);
+
+/** Take an idle connection to a server, opening a new one if all of them
+ *  are busy and the pool is not full, waiting otherwise. Called with
+ *  connections_lock held. */
+static https_conn_t *acquire_conn(const https_url_t *url, const char *ca_cert,
+                                  const char *cert, const char *key);
+
+/** Give a connection taken with acquire_conn() back */
+static void release_conn(https_conn_t *conn);
+
+/** Connect, returns 1 if successful 0 otherwise */
+static int conn_open(https_conn_t *conn);
+
+/** Disconnect, keeping the TLS session to resume */
+static void conn_close(https_conn_t *conn);
+
+/** Free a connection and its settings */
+static void conn_free(https_conn_t *conn);
+
+/** Write @a bytes of @a data, returns 1 if successful 0 otherwise */
+static int conn_write(https_conn_t *conn, const void *data, size_t bytes);
+
+/** Read up to @a bytes into @a data, returns the bytes read, 0 on error
+ *  or end of stream */
+static size_t conn_read(https_conn_t *conn, uint8_t *data, size_t bytes);
+
+/** Read a line without its end, returns 1 if successful 0 otherwise */
+static int conn_read_line(https_conn_t *conn, char *line, size_t size);
+
+/** Read @a bytes of body, returns 1 if successful 0 otherwise */
+static int read_body(https_conn_t *conn, https_body_t *body, size_t bytes,
+                     int32_t *err);
+
+/** Read a response, see send_request() */
+static int32_t read_response(https_conn_t *conn, https_body_t *body,
+                             int *status, int *keep_alive, int *received);
+
+/** Send a request made of @a parts and read its response into @a body */
+static int32_t send_request(const char *url, const char *ca_cert,
+                            const char *cert, const char *key,
+                            const https_part_t *parts, size_t part_count,
+                            https_body_t *body);
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  parse_url
+---------------------------*/
+static int32_t parse_url(const char *url, https_url_t *parts)
+{
+    const char *host = NULL;
+    const char *host_end = NULL;
+    const char *port = NULL;
+    size_t bytes = 0;
+
+    if (strncmp(url, "https://", 8) == 0) {
+        parts->tls = 1;
+        host = url + 8;
+    }
+    else if (strncmp(url, "http://", 7) == 0) {
+        parts->tls = 0;
+        host = url + 7;
+    }
+    else {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    parts->path = host + strcspn(host, "/?");
+    if (*host == '[') {
+        /* IPv6 address */
+        host++;
+        host_end = memchr(host, ']', parts->path - host);
+        if (host_end == NULL) {
+            return CAL_INVALID_ARGUMENT;
+        }
+        port = (host_end[1] == ':') ? host_end + 2 : NULL;
+    }
+    else {
+        host_end = memchr(host, ':', parts->path - host);
+        if (host_end == NULL) {
+            host_end = parts->path;
+        }
+        port = (*host_end == ':') ? host_end + 1 : NULL;
+    }
+
+    bytes = host_end - host;
+    if (bytes == 0 || bytes >= HTTPS_HOST_BYTES) {
+        return CAL_INVALID_ARGUMENT;
+    }
+    memcpy(parts->host, host, bytes);
+    parts->host[bytes] = '\0';
+
+    parts->default_port = (port == NULL);
+    if (port == NULL) {
+        strcpy(parts->port, parts->tls ? "443" : "80");
+    }
+    else {
+        bytes = parts->path - port;
+        if (bytes == 0 || bytes >= HTTPS_PORT_BYTES ||
+            strspn(port, "0123456789") != bytes) {
+            return CAL_INVALID_ARGUMENT;
+        }
+        memcpy(parts->port, port, bytes);
+        parts->port[bytes] = '\0';
+    }
+
+    return CAL_SUCCESS;
+}
+
+/*--------------------------
+  same_string
+---------------------------*/
+static int same_string(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    return strcmp(a, b) == 0;
+}
+
+/*--------------------------
+  copy_string
+---------------------------*/
+static char *copy_string(const char *s, int *failed)
+{
+    char *copy = NULL;
+
+    if (s != NULL) {
+        copy = OPENSSL_strdup(s);
+        if (copy == NULL) {
+            *failed = 1;
+        }
+    }
+    return copy;
+}
+
+/*--------------------------
+  new_conn
+---------------------------*/
+static https_conn_t *new_conn(const https_url_t *url, const char *ca_cert,
+                              const char *cert, const char *key,
+                              https_conn_t *same)
+{
+    static int registered = 0;
+    https_conn_t *conn = NULL;
+    int failed = 0;
+
+    conn = OPENSSL_zalloc(sizeof(*conn));
+    if (conn == NULL) {
+        return NULL;
+    }
+    conn->tls = url->tls;
+    conn->host = copy_string(url->host, &failed);
+    conn->port = copy_string(url->port, &failed);
+    conn->ca_cert = copy_string(ca_cert, &failed);
+    conn->cert = copy_string(cert, &failed);
+    conn->key = copy_string(key, &failed);
+
+    do {
+        if (failed || !conn->tls) {
+            break;
+        }
+
+        /* Connections to the same server share their settings */
+        if (same != NULL) {
+            if (SSL_CTX_up_ref(same->ssl_ctx) != 1) {
+                failed = 1;
+                break;
+            }
+            conn->ssl_ctx = same->ssl_ctx;
+            break;
+        }
+
+        conn->ssl_ctx = SSL_CTX_new(TLS_client_method());
+        if (conn->ssl_ctx == NULL) {
+            failed = 1;
+            break;
+        }
+        SSL_CTX_set_mode(conn->ssl_ctx, SSL_MODE_AUTO_RETRY);
+        SSL_CTX_set_session_cache_mode(conn->ssl_ctx, SSL_SESS_CACHE_CLIENT);
+
+        if (ca_cert != NULL) {
+            if (SSL_CTX_load_verify_locations(conn->ssl_ctx, ca_cert,
+                                              NULL) != 1) {
+                failed = 1;
+                break;
+            }
+            SSL_CTX_set_verify(conn->ssl_ctx, SSL_VERIFY_PEER, NULL);
+        }
+
+        if (cert != NULL &&
+            (SSL_CTX_use_certificate_chain_file(conn->ssl_ctx, cert) != 1 ||
+             SSL_CTX_use_PrivateKey_file(conn->ssl_ctx, key ? key : cert,
+                                         SSL_FILETYPE_PEM) != 1 ||
+             SSL_CTX_check_private_key(conn->ssl_ctx) != 1)) {
+            failed = 1;
+            break;
+        }
+    } while (0);
+
+    if (failed) {
+        ERR_print_errors_fp(stderr);
+        conn_free(conn);
+        return NULL;
+    }
+
+    if (!registered) {
+        atexit(https_close);
+#ifdef SIGPIPE
+        /* Writing to a connection the server closed must fail, not
+           terminate the process, so the request is retried */
+        signal(SIGPIPE, SIG_IGN);
+#endif
+        registered = 1;
+    }
+    conn->next = connections;
+    connections = conn;
+
+    return conn;
+}
+
+/*--------------------------
+  acquire_conn
+---------------------------*/
+static https_conn_t *acquire_conn(const https_url_t *url, const char *ca_cert,
+                                  const char *cert, const char *key)
+{
+    https_conn_t *conn = NULL;
+    https_conn_t *idle = NULL;
+    https_conn_t *same = NULL;
+    size_t count = 0;
+
+    for (;;) {
+        idle = NULL;
+        same = NULL;
+        count = 0;
+        for (conn = connections; conn != NULL; conn = conn->next) {
+            if (conn->tls != url->tls || strcmp(conn->host, url->host) != 0 ||
+                strcmp(conn->port, url->port) != 0 ||
+                !same_string(conn->ca_cert, ca_cert) ||
+                !same_string(conn->cert, cert) ||
+                !same_string(conn->key, key)) {
+                continue;
+            }
+            count++;
+            same = conn;
+            /* Connections still open first */
+            if (!conn->busy && (idle == NULL || idle->bio == NULL)) {
+                idle = conn;
+            }
+        }
+
+        if (idle != NULL) {
+            idle->busy = 1;
+            return idle;
+        }
+        if (count < HTTPS_MAX_CONNECTIONS) {
+            conn = new_conn(url, ca_cert, cert, key, same);
+            if (conn != NULL) {
+                conn->busy = 1;
+            }
+            return conn;
+        }
+
+        pthread_cond_wait(&connections_released, &connections_lock);
+    }
+}
+
+/*--------------------------
+  release_conn
+---------------------------*/
+static void release_conn(https_conn_t *conn)
+{
+    pthread_mutex_lock(&connections_lock);
+    conn->busy = 0;
+    pthread_cond_signal(&connections_released);
+    pthread_mutex_unlock(&connections_lock);
+}
+
+/*--------------------------
+  conn_open
+---------------------------*/
+static int conn_open(https_conn_t *conn)
+{
+    SSL *ssl = NULL;
+
+    conn->in_pos = 0;
+    conn->in_len = 0;
+
+    if (conn->tls) {
+        conn->bio = BIO_new_ssl_connect(conn->ssl_ctx);
+        if (conn->bio == NULL || BIO_get_ssl(conn->bio, &ssl) != 1) {
+            conn_close(conn);
+            return 0;
+        }
+        if (SSL_set_tlsext_host_name(ssl, conn->host) != 1 ||
+            (conn->ca_cert != NULL && SSL_set1_host(ssl, conn->host) != 1)) {
+            conn_close(conn);
+            return 0;
+        }
+        if (conn->session != NULL) {
+            SSL_set_session(ssl, conn->session);
+        }
+    }
+    else {
+        conn->bio = BIO_new(BIO_s_connect());
+        if (conn->bio == NULL) {
+            return 0;
+        }
+    }
+
+    BIO_set_conn_hostname(conn->bio, conn->host);
+    BIO_set_conn_port(conn->bio, conn->port);
+
+    if (BIO_do_connect(conn->bio) <= 0 ||
+        (conn->tls && BIO_do_handshake(conn->bio) <= 0)) {
+        ERR_print_errors_fp(stderr);
+        conn_close(conn);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------
+  conn_close
+---------------------------*/
+static void conn_close(https_conn_t *conn)
+{
+    SSL *ssl = NULL;
+    SSL_SESSION *session = NULL;
+
+    if (conn->bio == NULL) {
+        return;
+    }
+
+    if (conn->tls && BIO_get_ssl(conn->bio, &ssl) == 1 && ssl != NULL) {
+        session = SSL_get1_session(ssl);
+        if (session != NULL) {
+            SSL_SESSION_free(conn->session);
+            conn->session = session;
+        }
+    }
+
+    BIO_free_all(conn->bio);
+    conn->bio = NULL;
+    conn->in_pos = 0;
+    conn->in_len = 0;
+    ERR_clear_error();
+}
+
+/*--------------------------
+  conn_free
+---------------------------*/
+static void conn_free(https_conn_t *conn)
+{
+    conn_close(conn);
+    SSL_SESSION_free(conn->session);
+    SSL_CTX_free(conn->ssl_ctx);
+    OPENSSL_free(conn->host);
+    OPENSSL_free(conn->port);
+    OPENSSL_free(conn->ca_cert);
+    OPENSSL_free(conn->cert);
+    OPENSSL_free(conn->key);
+    OPENSSL_free(conn);
+}
+
+/*--------------------------
+  conn_write
+---------------------------*/
+static int conn_write(https_conn_t *conn, const void *data, size_t bytes)
+{
+    const uint8_t *next = data;
+    int written = 0;
+
+    while (bytes > 0) {
+        written = BIO_write(conn->bio, next,
+                            (bytes > INT32_MAX) ? INT32_MAX : (int)bytes);
+        if (written <= 0) {
+            return 0;
+        }
+        next += written;
+        bytes -= written;
+    }
+
+    return 1;
+}
+
+/*--------------------------
+  conn_read
+---------------------------*/
+static size_t conn_read(https_conn_t *conn, uint8_t *data, size_t bytes)
+{
+    int got = 0;
+
+    if (conn->in_pos < conn->in_len) {
+        if (bytes > conn->in_len - conn->in_pos) {
+            bytes = conn->in_len - conn->in_pos;
+        }
+        memcpy(data, conn->in + conn->in_pos, bytes);
+        conn->in_pos += bytes;
+        return bytes;
+    }
+
+    /* Large reads go straight to the destination */
+    if (bytes >= sizeof(conn->in)) {
+        got = BIO_read(conn->bio, data,
+                       (bytes > INT32_MAX) ? INT32_MAX : (int)bytes);
+        return (got > 0) ? (size_t)got : 0;
+    }
+
+    got = BIO_read(conn->bio, conn->in, sizeof(conn->in));
+    if (got <= 0) {
+        return 0;
+    }
+    conn->in_pos = 0;
+    conn->in_len = got;
+
+    return conn_read(conn, data, bytes);
+}
+
+/*--------------------------
+  conn_read_line
+---------------------------*/
+static int conn_read_line(https_conn_t *conn, char *line, size_t size)
+{
+    size_t len = 0;
+    uint8_t c = 0;
+
+    for (;;) {
+        if (conn_read(conn, &c, 1) != 1) {
+            return 0;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (len + 1 >= size) {
+            return 0;
+        }
+        line[len++] = (char)c;
+    }
+
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    line[len] = '\0';
+
+    return 1;
+}
+
+/*--------------------------
+  grow_body
+---------------------------*/
+static int32_t grow_body(https_body_t *body, size_t bytes)
+{
+    uint8_t *data = NULL;
+
+    if (bytes <= body->size - body->bytes) {
+        return CAL_SUCCESS;
+    }
+    /* Lengths are given by the server */
+    if (!body->grow || bytes > SIZE_MAX - body->bytes ||
+        body->bytes + bytes > HTTPS_MAX_BODY_BYTES) {
+        return CAL_INSUFFICIENT_BUFFER_LEN;
+    }
+
+    data = realloc(body->data, body->bytes + bytes);
+    if (data == NULL) {
+        return CAL_INSUFFICIENT_MEMORY;
+    }
+    body->data = data;
+    body->size = body->bytes + bytes;
+
+    return CAL_SUCCESS;
+}
+
+/*--------------------------
+  read_body
+---------------------------*/
+static int read_body(https_conn_t *conn, https_body_t *body, size_t bytes,
+                     int32_t *err)
+{
+    size_t got = 0;
+
+    *err = grow_body(body, bytes);
+    if (*err != CAL_SUCCESS) {
+        return 0;
+    }
+
+    while (bytes > 0) {
+        got = conn_read(conn, body->data + body->bytes, bytes);
+        if (got == 0) {
+            *err = CAL_CRYPTO_API_ERROR;
+            return 0;
+        }
+        body->bytes += got;
+        bytes -= got;
+    }
+
+    return 1;
+}
+
+/*--------------------------
+  read_response
+---------------------------*/
+static int32_t read_response(https_conn_t *conn, https_body_t *body,
+                             int *status, int *keep_alive, int *received)
+{
+    char line[HTTPS_LINE_BYTES];
+    int32_t err = CAL_SUCCESS;
+    int minor = 0;
+    int chunked = 0;
+    int has_length = 0;
+    size_t length = 0;
+    char *value = NULL;
+    uint8_t extra = 0;
+    size_t got = 0;
+
+    /* Interim 1xx responses have no body */
+    do {
+        if (!conn_read_line(conn, line, sizeof(line))) {
+            return CAL_CRYPTO_API_ERROR;
+        }
+        *received = 1;
+        if (sscanf(line, "HTTP/1.%d %d", &minor, status) != 2) {
+            return CAL_CRYPTO_API_ERROR;
+        }
+        *keep_alive = (minor >= 1);
+
+        for (;;) {
+            if (!conn_read_line(conn, line, sizeof(line))) {
+                return CAL_CRYPTO_API_ERROR;
+            }
+            if (line[0] == '\0') {
+                break;
+            }
+            value = strchr(line, ':');
+            if (value == NULL) {
+                continue;
+            }
+            *value++ = '\0';
+            value += strspn(value, " \t");
+
+            if (strcasecmp(line, "Content-Length") == 0) {
+                length = (size_t)strtoull(value, NULL, 10);
+                has_length = 1;
+            }
+            else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+                chunked = (strstr(value, "chunked") != NULL);
+            }
+            else if (strcasecmp(line, "Connection") == 0) {
+                if (strcasecmp(value, "close") == 0) {
+                    *keep_alive = 0;
+                }
+                else if (strcasecmp(value, "keep-alive") == 0) {
+                    *keep_alive = 1;
+                }
+            }
+        }
+    } while (*status >= 100 && *status < 200);
+
+    if (*status == 204 || *status == 304) {
+        return CAL_SUCCESS;
+    }
+
+    if (chunked) {
+        for (;;) {
+            if (!conn_read_line(conn, line, sizeof(line))) {
+                return CAL_CRYPTO_API_ERROR;
+            }
+            length = (size_t)strtoull(line, NULL, 16);
+            if (length == 0) {
+                break;
+            }
+            if (!read_body(conn, body, length, &err) ||
+                !conn_read_line(conn, line, sizeof(line))) {
+                return (err != CAL_SUCCESS) ? err : CAL_CRYPTO_API_ERROR;
+            }
+        }
+        /* Trailers */
+        do {
+            if (!conn_read_line(conn, line, sizeof(line))) {
+                return CAL_CRYPTO_API_ERROR;
+            }
+        } while (line[0] != '\0');
+    }
+    else if (has_length) {
+        if (!read_body(conn, body, length, &err)) {
+            return err;
+        }
+    }
+    else {
+        /* The body ends with the connection */
+        *keep_alive = 0;
+        for (;;) {
+            err = grow_body(body, HTTPS_IO_BYTES);
+            if (err != CAL_SUCCESS && body->bytes == body->size) {
+                /* Full, which is only fine if the body ends here */
+                if (conn_read(conn, &extra, 1) != 0) {
+                    return err;
+                }
+                break;
+            }
+            got = conn_read(conn, body->data + body->bytes,
+                            body->size - body->bytes);
+            if (got == 0) {
+                break;
+            }
+            body->bytes += got;
+        }
+    }
+
+    return CAL_SUCCESS;
+}
+
+/*--------------------------
+  send_request
+---------------------------*/
+static int32_t send_request(const char *url, const char *ca_cert,
+                            const char *cert, const char *key,
+                            const https_part_t *parts, size_t part_count,
+                            https_body_t *body)
+{
+    https_url_t parsed;
+    https_conn_t *conn = NULL;
+    int32_t err = CAL_SUCCESS;
+    int status = 0;
+    int keep_alive = 0;
+    int received = 0;
+    int reused = 0;
+    int attempt = 0;
+    size_t i = 0;
+
+    err = parse_url(url, &parsed);
+    if (err != CAL_SUCCESS) {
+        fprintf(stderr, "Unsupported URL: %s\n", url);
+        return err;
+    }
+    if (parsed.tls && ca_cert == NULL) {
+        fprintf(stderr, "No CA certificate to verify %s\n", url);
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    pthread_mutex_lock(&connections_lock);
+    conn = acquire_conn(&parsed, ca_cert, cert, key);
+    pthread_mutex_unlock(&connections_lock);
+
+    do {
+        if (conn == NULL) {
+            err = CAL_CRYPTO_API_ERROR;
+            break;
+        }
+
+        /* A kept alive connection may have been closed by the server in
+         * the meantime, the request is then sent again on a new one */
+        for (attempt = 0; attempt < 2; attempt++) {
+            reused = (conn->bio != NULL);
+            if (!reused && !conn_open(conn)) {
+                err = CAL_CRYPTO_API_ERROR;
+                break;
+            }
+
+            err = CAL_SUCCESS;
+            for (i = 0; i < part_count; i++) {
+                if (!conn_write(conn, parts[i].data, parts[i].bytes)) {
+                    err = CAL_CRYPTO_API_ERROR;
+                    break;
+                }
+            }
+
+            received = 0;
+            body->bytes = 0;
+            if (err == CAL_SUCCESS) {
+                err = read_response(conn, body, &status, &keep_alive,
+                                    &received);
+            }
+            if (err == CAL_SUCCESS && keep_alive) {
+                break;
+            }
+
+            conn_close(conn);
+            if (err == CAL_SUCCESS || !reused || received) {
+                break;
+            }
+        }
+        release_conn(conn);
+    } while (0);
+
+    if (err != CAL_SUCCESS) {
+        fprintf(stderr, "Request to %s failed\n", url);
+        return err;
+    }
+    if (status < 200 || status > 299) {
+        fprintf(stderr, "Request to %s failed with HTTP status %d\n", url,
+                status);
+        return CAL_CRYPTO_API_ERROR;
+    }
+
+    return CAL_SUCCESS;
+}
+
+/*--------------------------
+  format_head
+---------------------------*/
+static int format_head(char *head, size_t size, const char *method,
+                       const char *url, const char *extra)
+{
+    https_url_t parsed;
+    const char *path = NULL;
+    int len = 0;
+
+    if (parse_url(url, &parsed) != CAL_SUCCESS) {
+        return -1;
+    }
+    path = (*parsed.path == '/') ? parsed.path : "/";
+
+    len = snprintf(head, size,
+                   "%s %s%s HTTP/1.1\r\n"
+                   "Host: %s%s%s%s%s\r\n"
+                   "User-Agent: cst\r\n"
+                   "Accept: */*\r\n"
+                   "Connection: keep-alive\r\n"
+                   "%s"
+                   "\r\n",
+                   method, path, (path == parsed.path) ? "" : parsed.path,
+                   strchr(parsed.host, ':') ? "[" : "", parsed.host,
+                   strchr(parsed.host, ':') ? "]" : "",
+                   parsed.default_port ? "" : ":",
+                   parsed.default_port ? "" : parsed.port, extra);
+
+    return (len < 0 || (size_t)len >= size) ? -1 : len;
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  https_post_file
+---------------------------*/
+int32_t
+https_post_file(const char *url, const char *ca_cert, const char *cert,
+                const char *key, const char *filename, const uint8_t *data,
+                size_t data_bytes, uint8_t *resp, size_t *resp_bytes)
+{
+    uint8_t random[HTTPS_BOUNDARY_BYTES];
+    char boundary[2 * HTTPS_BOUNDARY_BYTES + 1];
+    char extra[256];
+    char head[HTTPS_LINE_BYTES];
+    char form[HTTPS_LINE_BYTES];
+    char tail[2 * HTTPS_BOUNDARY_BYTES + 16];
+    int head_len = 0;
+    int form_len = 0;
+    int tail_len = 0;
+    https_part_t parts[4];
+    https_body_t body;
+    int32_t err = CAL_SUCCESS;
+    size_t i = 0;
+
+    if (url == NULL || filename == NULL || (data == NULL && data_bytes > 0) ||
+        resp == NULL || resp_bytes == NULL) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    /* The boundary must not show up in the data */
+    if (RAND_bytes(random, sizeof(random)) != 1) {
+        return CAL_RAND_API_ERROR;
+    }
+    for (i = 0; i < sizeof(random); i++) {
+        sprintf(&boundary[2 * i], "%02x", random[i]);
+    }
+
+    form_len = snprintf(form, sizeof(form),
+                        "--%s\r\n"
+                        "Content-Disposition: form-data; name=\"file\"; "
+                        "filename=\"%s\"\r\n"
+                        "Content-Type: application/octet-stream\r\n"
+                        "\r\n",
+                        boundary, filename);
+    tail_len = snprintf(tail, sizeof(tail), "\r\n--%s--\r\n", boundary);
+    if (form_len < 0 || (size_t)form_len >= sizeof(form)) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    snprintf(extra, sizeof(extra),
+             "Content-Type: multipart/form-data; boundary=%s\r\n"
+             "Content-Length: %llu\r\n",
+             boundary,
+             (unsigned long long)(form_len + data_bytes + tail_len));
+    head_len = format_head(head, sizeof(head), "POST", url, extra);
+    if (head_len < 0) {
+        fprintf(stderr, "Unsupported URL: %s\n", url);
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    parts[0].data = head;
+    parts[0].bytes = head_len;
+    parts[1].data = form;
+    parts[1].bytes = form_len;
+    parts[2].data = data;
+    parts[2].bytes = data_bytes;
+    parts[3].data = tail;
+    parts[3].bytes = tail_len;
+
+    body.data = resp;
+    body.bytes = 0;
+    body.size = *resp_bytes;
+    body.grow = 0;
+
+    err = send_request(url, ca_cert, cert, key, parts, 4, &body);
+    if (err == CAL_SUCCESS) {
+        *resp_bytes = body.bytes;
+    }
+
+    return err;
+}
+
+/*--------------------------
+  https_get
+---------------------------*/
+int32_t
+https_get(const char *url, const char *ca_cert, uint8_t **resp,
+          size_t *resp_bytes)
+{
+    char head[HTTPS_LINE_BYTES];
+    int head_len = 0;
+    https_part_t part;
+    https_body_t body;
+    int32_t err = CAL_SUCCESS;
+
+    if (url == NULL || resp == NULL || resp_bytes == NULL) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    head_len = format_head(head, sizeof(head), "GET", url, "");
+    if (head_len < 0) {
+        fprintf(stderr, "Unsupported URL: %s\n", url);
+        return CAL_INVALID_ARGUMENT;
+    }
+    part.data = head;
+    part.bytes = head_len;
+
+    body.data = NULL;
+    body.bytes = 0;
+    body.size = 0;
+    body.grow = 1;
+
+    err = send_request(url, ca_cert, NULL, NULL, &part, 1, &body);
+    if (err != CAL_SUCCESS) {
+        free(body.data);
+        return err;
+    }
+
+    *resp = body.data;
+    *resp_bytes = body.bytes;
+
+    return CAL_SUCCESS;
+}
+
+/*--------------------------
+  https_close
+---------------------------*/
+void
+https_close(void)
+{
+    https_conn_t *conn = NULL;
+
+    pthread_mutex_lock(&connections_lock);
+    while (connections != NULL) {
+        conn = connections;
+        connections = conn->next;
+        conn_free(conn);
+    }
+    pthread_mutex_unlock(&connections_lock);
+}
@@ -19,16 +19,21 @@
 OBJECTS += \
 	adapt_layer_openssl.o \
 	autox_sign_with_hsm.o \
+	https_client.o \
 	pkey.o \
 	cert.o \
+	ssl_cache.o \
 	ssl_wrapper.o
 
 OBJECTS_BACKEND_SSL += \
 	adapt_layer_openssl.o \
 	autox_sign_with_hsm.o \
+	https_client.o \
 	pkey.o \
 	cert.o \
+	ssl_cache.o \
 	ssl_wrapper.o
 
 OBJECTS_SRKTOOL += \
-	cert.o
+	cert.o \
+	ssl_cache.o
@@ -54,6 +54,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <openssl/pem.h>
 #include <openssl_helper.h>
 #include <adapt_layer.h>
+#include "ssl_cache.h"
 
 /*===========================================================================
                           LOCAL FUNCTION PROTOTYPES
@@ -88,6 +89,7 @@ chomp(char *s)
 int get_passcode_to_key_file(char *buf, int size, int rwflag, void *userdata)
 {
     FILE * password_fp;
+    int cached_bytes;
     char * ptr_to_last_slash;
     char key_file_path[255];
     char *key_file = (char *)userdata;
@@ -115,6 +117,13 @@ int get_passcode_to_key_file(char *buf, int size, int rwflag, void *userdata)
     /* Concatenate with key_pass.txt to form the complete path */
     strcat(key_file_path, "key_pass.txt");
 
+    /* Keys of the same folder share the password file, read it once */
+    cached_bytes = ssl_cache_copy_passphrase(key_file_path, buf, size);
+    if (cached_bytes >= 0)
+    {
+        return cached_bytes;
+    }
+
     /*
      * This particular implementation assumes file key_file.txt to be present
      * in keys folder with password string.
@@ -127,9 +136,15 @@ int get_passcode_to_key_file(char *buf, int size, int rwflag, void *userdata)
         return 0;
     }
 
-    fgets(buf, size, password_fp);
+    if (fgets(buf, size, password_fp) == NULL)
+    {
+        buf[0] = 0;
+    }
+    fclose(password_fp);
     chomp(buf);
 
+    ssl_cache_add_passphrase(key_file_path, buf);
+
     return strlen(buf);
 }
 
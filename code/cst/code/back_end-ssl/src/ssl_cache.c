@@ -0,0 +1,351 @@
+/*
+   Copyright 2026 CST contributors
+   SPDX-License-Identifier: BSD-3-Clause
+
+   ===========================================================================
+
+   @file    ssl_cache.c
+
+   @brief   Cache of parsed certificates, private keys and key passphrases
+            used by the SSL backend. Entries are keyed by the device and
+            inode of the file they were read from, so the same file reached
+            through different relative paths or working directories maps to
+            one entry. The size and modification time of the file are
+            checked on every lookup, so that a file replaced while a daemon
+            or batch keeps running is read again rather than served stale.
+
+   ===========================================================================
+ */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <pthread.h>
+#include <openssl/x509.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
+#include "ssl_cache.h"
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/* Cached objects build into lists */
+typedef struct ssl_cache_entry {
+    struct ssl_cache_entry *next;
+    dev_t dev;                      /**< Device of the source file         */
+    ino_t ino;                      /**< Inode of the source file          */
+    off_t size;                     /**< Size of the source file           */
+    time_t mtime;                   /**< Modification time, seconds        */
+    long mtime_ns;                  /**< Modification time, nanoseconds    */
+    void *object;                   /**< X509, EVP_PKEY or passphrase      */
+} ssl_cache_entry_t;
+
+/* Releases the object of an entry */
+typedef void (*ssl_cache_free_t)(void *object);
+
+/*===========================================================================
+                               LOCAL VARIABLES
+=============================================================================*/
+/** Head of the cached certificates list */
+static ssl_cache_entry_t *cert_cache = NULL;
+
+/** Head of the cached private keys list */
+static ssl_cache_entry_t *key_cache = NULL;
+
+/** Head of the cached passphrases list */
+static ssl_cache_entry_t *passphrase_cache = NULL;
+
+/** Protects the lists, signatures may be generated from several threads */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  mtime_ns
+---------------------------*/
+static long
+mtime_ns(const struct stat *st)
+{
+#if defined(__linux__)
+    return st->st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    return st->st_mtimespec.tv_nsec;
+#else
+    (void)st;
+    return 0;
+#endif
+}
+
+/*--------------------------
+  find_entry
+---------------------------*/
+static ssl_cache_entry_t *
+find_entry(ssl_cache_entry_t **head, const char *filename,
+           ssl_cache_free_t free_object)
+{
+    ssl_cache_entry_t **link = head;
+    ssl_cache_entry_t *entry = NULL;
+    struct stat st;
+
+    if (stat(filename, &st) != 0)
+    {
+        return NULL;
+    }
+
+    while (*link != NULL &&
+           ((*link)->dev != st.st_dev || (*link)->ino != st.st_ino))
+    {
+        link = &(*link)->next;
+    }
+
+    entry = *link;
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    /* The file was rewritten since it was cached */
+    if (entry->size != st.st_size || entry->mtime != st.st_mtime ||
+        entry->mtime_ns != mtime_ns(&st))
+    {
+        *link = entry->next;
+        free_object(entry->object);
+        free(entry);
+        return NULL;
+    }
+
+    return entry;
+}
+
+/*--------------------------
+  add_entry
+---------------------------*/
+static int
+add_entry(ssl_cache_entry_t **head, const char *filename, void *object)
+{
+    ssl_cache_entry_t *entry = NULL;
+    struct stat st;
+
+    if (stat(filename, &st) != 0)
+    {
+        return 0;
+    }
+
+    entry = malloc(sizeof(ssl_cache_entry_t));
+    if (entry == NULL)
+    {
+        return 0;
+    }
+
+    entry->dev = st.st_dev;
+    entry->ino = st.st_ino;
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+    entry->mtime_ns = mtime_ns(&st);
+    entry->object = object;
+    entry->next = *head;
+    *head = entry;
+
+    return 1;
+}
+
+/*--------------------------
+  free_certificate
+---------------------------*/
+static void
+free_certificate(void *object)
+{
+    X509_free(object);
+}
+
+/*--------------------------
+  free_private_key
+---------------------------*/
+static void
+free_private_key(void *object)
+{
+    EVP_PKEY_free(object);
+}
+
+/*--------------------------
+  free_passphrase
+---------------------------*/
+static void
+free_passphrase(void *object)
+{
+    OPENSSL_secure_clear_free(object, strlen(object) + 1);
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  ssl_cache_find_certificate
+---------------------------*/
+X509 *
+ssl_cache_find_certificate(const char *filename)
+{
+    ssl_cache_entry_t *entry = NULL;
+    X509 *cert = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    entry = find_entry(&cert_cache, filename, free_certificate);
+    if (entry != NULL && X509_up_ref(entry->object))
+    {
+        cert = entry->object;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return cert;
+}
+
+/*--------------------------
+  ssl_cache_add_certificate
+---------------------------*/
+void
+ssl_cache_add_certificate(const char *filename, X509 *cert)
+{
+    pthread_mutex_lock(&cache_lock);
+    if (find_entry(&cert_cache, filename, free_certificate) == NULL &&
+        X509_up_ref(cert) && !add_entry(&cert_cache, filename, cert))
+    {
+        X509_free(cert);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/*--------------------------
+  ssl_cache_find_private_key
+---------------------------*/
+EVP_PKEY *
+ssl_cache_find_private_key(const char *filename)
+{
+    ssl_cache_entry_t *entry = NULL;
+    EVP_PKEY *key = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    entry = find_entry(&key_cache, filename, free_private_key);
+    if (entry != NULL && EVP_PKEY_up_ref(entry->object))
+    {
+        key = entry->object;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return key;
+}
+
+/*--------------------------
+  ssl_cache_add_private_key
+---------------------------*/
+void
+ssl_cache_add_private_key(const char *filename, EVP_PKEY *key)
+{
+    pthread_mutex_lock(&cache_lock);
+    if (find_entry(&key_cache, filename, free_private_key) == NULL &&
+        EVP_PKEY_up_ref(key) && !add_entry(&key_cache, filename, key))
+    {
+        EVP_PKEY_free(key);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/*--------------------------
+  ssl_cache_copy_passphrase
+---------------------------*/
+int
+ssl_cache_copy_passphrase(const char *filename, char *buf, int size)
+{
+    ssl_cache_entry_t *entry = NULL;
+    int bytes = -1;
+
+    pthread_mutex_lock(&cache_lock);
+    entry = find_entry(&passphrase_cache, filename, free_passphrase);
+    if (entry != NULL)
+    {
+        bytes = 0;
+        if (size > 0)
+        {
+            strncpy(buf, entry->object, size - 1);
+            buf[size - 1] = 0;
+            bytes = (int)strlen(buf);
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return bytes;
+}
+
+/*--------------------------
+  ssl_cache_add_passphrase
+---------------------------*/
+void
+ssl_cache_add_passphrase(const char *filename, const char *passphrase)
+{
+    size_t bytes = strlen(passphrase) + 1;
+    char *copy = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    do {
+        if (find_entry(&passphrase_cache, filename, free_passphrase) != NULL)
+        {
+            break;
+        }
+
+        /* Locked memory when the OpenSSL secure heap is set up */
+        copy = OPENSSL_secure_malloc(bytes);
+        if (copy == NULL)
+        {
+            break;
+        }
+        memcpy(copy, passphrase, bytes);
+
+        if (!add_entry(&passphrase_cache, filename, copy))
+        {
+            free_passphrase(copy);
+        }
+    } while (0);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/*--------------------------
+  ssl_cache_flush
+---------------------------*/
+void
+ssl_cache_flush(void)
+{
+    ssl_cache_entry_t *entry = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    while (cert_cache != NULL)
+    {
+        entry = cert_cache;
+        cert_cache = entry->next;
+        X509_free(entry->object);
+        free(entry);
+    }
+
+    while (key_cache != NULL)
+    {
+        entry = key_cache;
+        key_cache = entry->next;
+        EVP_PKEY_free(entry->object);
+        free(entry);
+    }
+
+    while (passphrase_cache != NULL)
+    {
+        entry = passphrase_cache;
+        passphrase_cache = entry->next;
+        free_passphrase(entry->object);
+        free(entry);
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
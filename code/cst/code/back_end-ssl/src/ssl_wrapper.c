@@ -48,108 +48,290 @@ void handle_errors(char * str,  int32_t *err_value, char *err_str) {
     *err_value = CAL_CRYPTO_API_ERROR;
 }
 
-int32_t encryptccm(unsigned char *plaintext, int plaintext_len, unsigned char *aad,
-    int aad_len, unsigned char *key, int key_len, unsigned char *iv, int iv_len,
-    const char * out_file, unsigned char *tag, int tag_len, int32_t *err_value,
-    char *err_str) {
+#ifndef REMOVE_ENCRYPTION
+/* AES-CCM encryption of a message fed in pieces */
+struct ccm_stream {
+    EVP_CIPHER_CTX *ctr;            /**< AES-CTR producing the ciphertext  */
+    EVP_CIPHER_CTX *mac;            /**< AES-CBC computing the CBC-MAC     */
+    uint8_t        s0[AES_BLOCK_BYTES];  /**< Encrypted counter block 0    */
+    uint8_t        last[AES_BLOCK_BYTES]; /**< Last CBC-MAC output block   */
+    uint8_t        *scratch;        /**< Discarded CBC-MAC output          */
+    size_t         remaining;       /**< Message bytes not yet fed         */
+    size_t         mac_bytes;       /**< Bytes fed to the CBC-MAC          */
+    int            tag_len;         /**< Bytes of the tag                  */
+};
+
+/* Returns the AES cipher of the given key length and mode, NULL if none */
+static const EVP_CIPHER *aes_cipher(int key_len, int ctr)
+{
+    switch(key_len) {
+        case 16:
+            return ctr ? EVP_aes_128_ctr() : EVP_aes_128_cbc();
+        case 24:
+            return ctr ? EVP_aes_192_ctr() : EVP_aes_192_cbc();
+        case 32:
+            return ctr ? EVP_aes_256_ctr() : EVP_aes_256_cbc();
+        default:
+            return NULL;
+    }
+}
+
+/* Runs the CBC-MAC over data, keeping its last output block */
+static int ccm_stream_mac(ccm_stream_t *ccm, const uint8_t *data, size_t len)
+{
+    int out_len = 0;
+
+    while (len > 0) {
+        size_t piece = (len < CCM_STREAM_CHUNK_BYTES) ? len
+                                                      : CCM_STREAM_CHUNK_BYTES;
+
+        if (1 != EVP_EncryptUpdate(ccm->mac, ccm->scratch, &out_len, data,
+                                   (int)piece)) {
+            return 0;
+        }
+        if (out_len >= AES_BLOCK_BYTES) {
+            memcpy(ccm->last, ccm->scratch + out_len - AES_BLOCK_BYTES,
+                   AES_BLOCK_BYTES);
+        }
+        ccm->mac_bytes += piece;
+        data += piece;
+        len  -= piece;
+    }
+
+    return 1;
+}
+#endif
 
+ccm_stream_t *ccm_stream_new(unsigned char *key, int key_len, unsigned char *iv,
+    int iv_len, size_t msg_len, int tag_len, int32_t *err_value, char *err_str)
+{
 #ifdef REMOVE_ENCRYPTION
-    UNUSED(plaintext);
-    UNUSED(plaintext_len);
-    UNUSED(aad);
-    UNUSED(aad_len);
     UNUSED(key);
     UNUSED(key_len);
     UNUSED(iv);
     UNUSED(iv_len);
-    UNUSED(out_file);
-    UNUSED(tag);
+    UNUSED(msg_len);
     UNUSED(tag_len);
-    UNUSED(err_value);
     UNUSED(err_str);
 
-    return CAL_NO_CRYPTO_API_ERROR;
+    *err_value = CAL_NO_CRYPTO_API_ERROR;
+    return NULL;
 #else
-    EVP_CIPHER_CTX *ctx;
-
-    int len;
-    size_t ciphertext_len;
-
-    unsigned char *ciphertext = NULL;
-    ciphertext = (unsigned char *)malloc(plaintext_len + EVP_MAX_BLOCK_LENGTH);
-    if (NULL == ciphertext) {
-        handle_errors("Failed to allocate memory for encrypted data",
-                      err_value, err_str);
-        return *err_value;
+    ccm_stream_t *ccm = NULL;
+    uint8_t block[AES_BLOCK_BYTES];  /**< B0 then A0 */
+    uint8_t zero[AES_BLOCK_BYTES] = {0};
+    int q = 15 - iv_len;             /**< Bytes of the length field */
+    int out_len = 0;
+    int i;
+
+    /* The length must fit the q bytes left by the nonce */
+    if (iv_len < 7 || iv_len > 13 || tag_len < 4 || tag_len > 16 ||
+        (tag_len & 1) || (q < (int)sizeof(size_t) && (msg_len >> (8 * q)))) {
+        handle_errors("Invalid AES-CCM parameters", err_value, err_str);
+        return NULL;
+    }
+    if (NULL == aes_cipher(key_len, 0)) {
+        handle_errors("Invalid key length for AES-CCM operation", err_value,
+                      err_str);
+        return NULL;
     }
 
-    FILE *fho = NULL;
-    int err = 0;
-    do{
-        /* Create and initialise the context */
-        if (!(ctx = EVP_CIPHER_CTX_new())) {
-            handle_errors("Failed to allocate ccm context structure",
-                          err_value, err_str);
-            break;
-        }
+    ccm = calloc(1, sizeof(ccm_stream_t));
+    if (NULL == ccm ||
+        NULL == (ccm->scratch = malloc(CCM_STREAM_CHUNK_BYTES +
+                                       AES_BLOCK_BYTES)) ||
+        NULL == (ccm->ctr = EVP_CIPHER_CTX_new()) ||
+        NULL == (ccm->mac = EVP_CIPHER_CTX_new())) {
+        handle_errors("Failed to allocate ccm context structure", err_value,
+                      err_str);
+        ccm_stream_free(ccm);
+        return NULL;
+    }
+    ccm->remaining = msg_len;
+    ccm->tag_len   = tag_len;
 
-        /* Initialise the encryption operation. */
-        switch(key_len) {
-            case 16:
-                err = EVP_EncryptInit_ex(ctx, EVP_aes_128_ccm(), NULL, NULL, NULL);
-                break;
-            case 24:
-                err = EVP_EncryptInit_ex(ctx, EVP_aes_192_ccm(), NULL, NULL, NULL);
-                break;
-            case 32:
-                err = EVP_EncryptInit_ex(ctx, EVP_aes_256_ccm(), NULL, NULL, NULL);
-                break;
-            default:
-                handle_errors("Failed to allocate ccm context structure",
-                              err_value, err_str);
-                free(ciphertext);
-                return *err_value;
+    do {
+        /* B0: flags, nonce and message length, no additional data */
+        block[0] = (uint8_t)((((tag_len - 2) / 2) << 3) | (q - 1));
+        memcpy(block + 1, iv, iv_len);
+        for (i = 0; i < q; i++) {
+            block[AES_BLOCK_BYTES - 1 - i] =
+                (i < (int)sizeof(size_t)) ? (uint8_t)(msg_len >> (8 * i)) : 0;
         }
 
-        if (err != 1) {
-            handle_errors("Failed to initialize ccm context structure",
-                          err_value, err_str);
+        if (1 != EVP_EncryptInit_ex(ccm->mac, aes_cipher(key_len, 0), NULL,
+                                    key, zero) ||
+            1 != EVP_CIPHER_CTX_set_padding(ccm->mac, 0) ||
+            !ccm_stream_mac(ccm, block, AES_BLOCK_BYTES)) {
             break;
         }
 
-        /*
-         * Setting IV len to 7. Not strictly necessary as this is the default
-         * but shown here for the purposes of this example
-         */
-        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_IVLEN, iv_len, NULL)) {
-            handle_errors("Failed to initialize IV", err_value, err_str);
+        /* A0: flags, nonce and a zero counter, A1 follows for the data */
+        memset(block, 0, sizeof(block));
+        block[0] = (uint8_t)(q - 1);
+        memcpy(block + 1, iv, iv_len);
+
+        if (1 != EVP_EncryptInit_ex(ccm->ctr, aes_cipher(key_len, 1), NULL,
+                                    key, block) ||
+            1 != EVP_EncryptUpdate(ccm->ctr, ccm->s0, &out_len, zero,
+                                   AES_BLOCK_BYTES)) {
             break;
         }
 
-        /* Set tag length */
-        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_TAG, tag_len, NULL);
+        return ccm;
+    } while(0);
 
-        /* Initialise key and IV */
-        if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, iv)) {
-            handle_errors("Failed to intialize key", err_value, err_str);
-            break;
+    handle_errors("Failed to initialize ccm context structure", err_value,
+                  err_str);
+    ccm_stream_free(ccm);
+    return NULL;
+#endif
+}
+
+int32_t ccm_stream_update(ccm_stream_t *ccm, const unsigned char *plaintext,
+    unsigned char *ciphertext, size_t len, int32_t *err_value, char *err_str)
+{
+#ifdef REMOVE_ENCRYPTION
+    UNUSED(ccm);
+    UNUSED(plaintext);
+    UNUSED(ciphertext);
+    UNUSED(len);
+    UNUSED(err_str);
+
+    *err_value = CAL_NO_CRYPTO_API_ERROR;
+    return *err_value;
+#else
+    int out_len = 0;
+
+    if (len > ccm->remaining) {
+        handle_errors("More data than announced for AES-CCM", err_value,
+                      err_str);
+        return *err_value;
+    }
+    ccm->remaining -= len;
+
+    if (!ccm_stream_mac(ccm, plaintext, len)) {
+        handle_errors("Failed to authenticate", err_value, err_str);
+        return *err_value;
+    }
+
+    while (len > 0) {
+        size_t piece = (len < CCM_STREAM_CHUNK_BYTES) ? len
+                                                      : CCM_STREAM_CHUNK_BYTES;
+
+        if (1 != EVP_EncryptUpdate(ccm->ctr, ciphertext, &out_len, plaintext,
+                                   (int)piece)) {
+            handle_errors("Failed to encrypt", err_value, err_str);
+            return *err_value;
         }
+        plaintext  += piece;
+        ciphertext += piece;
+        len        -= piece;
+    }
+
+    return *err_value;
+#endif
+}
+
+int32_t ccm_stream_final(ccm_stream_t *ccm, unsigned char *tag,
+    int32_t *err_value, char *err_str)
+{
+#ifdef REMOVE_ENCRYPTION
+    UNUSED(ccm);
+    UNUSED(tag);
+    UNUSED(err_str);
+
+    *err_value = CAL_NO_CRYPTO_API_ERROR;
+    return *err_value;
+#else
+    uint8_t zero[AES_BLOCK_BYTES] = {0};
+    int i;
+
+    if (ccm->remaining != 0) {
+        handle_errors("Less data than announced for AES-CCM", err_value,
+                      err_str);
+        return *err_value;
+    }
+
+    /* The CBC-MAC runs over the message padded with zeros to a block */
+    if (!ccm_stream_mac(ccm, zero,
+            (AES_BLOCK_BYTES - ccm->mac_bytes % AES_BLOCK_BYTES) %
+            AES_BLOCK_BYTES)) {
+        handle_errors("Failed to get tag", err_value, err_str);
+        return *err_value;
+    }
+
+    for (i = 0; i < ccm->tag_len; i++) {
+        tag[i] = ccm->last[i] ^ ccm->s0[i];
+    }
+
+    return *err_value;
+#endif
+}
+
+void ccm_stream_free(ccm_stream_t *ccm)
+{
+#ifndef REMOVE_ENCRYPTION
+    if (NULL == ccm) {
+        return;
+    }
+    EVP_CIPHER_CTX_free(ccm->ctr);
+    EVP_CIPHER_CTX_free(ccm->mac);
+    free(ccm->scratch);
+    OPENSSL_cleanse(ccm, sizeof(*ccm));
+    free(ccm);
+#else
+    UNUSED(ccm);
+#endif
+}
+
+int32_t encryptccm(FILE *in, size_t plaintext_len, unsigned char *aad,
+    int aad_len, unsigned char *key, int key_len, unsigned char *iv, int iv_len,
+    const char * out_file, unsigned char *tag, int tag_len, int32_t *err_value,
+    char *err_str) {
 
-        /* Provide the total plaintext length */
-        if (1 != EVP_EncryptUpdate(ctx, NULL, &len, NULL, plaintext_len)) {
-            handle_errors("Failed to initialize length parameter", err_value, err_str);
+#ifdef REMOVE_ENCRYPTION
+    UNUSED(in);
+    UNUSED(plaintext_len);
+    UNUSED(aad);
+    UNUSED(aad_len);
+    UNUSED(key);
+    UNUSED(key_len);
+    UNUSED(iv);
+    UNUSED(iv_len);
+    UNUSED(out_file);
+    UNUSED(tag);
+    UNUSED(tag_len);
+    UNUSED(err_value);
+    UNUSED(err_str);
+
+    return CAL_NO_CRYPTO_API_ERROR;
+#else
+    ccm_stream_t *ccm = NULL;
+    unsigned char *plaintext = NULL;
+    unsigned char *ciphertext = NULL;
+    size_t left = plaintext_len;
+    size_t piece;
+    FILE *fho = NULL;
+
+    /* No additional data is authenticated */
+    UNUSED(aad);
+    UNUSED(aad_len);
+
+    do {
+        ccm = ccm_stream_new(key, key_len, iv, iv_len, plaintext_len, tag_len,
+                             err_value, err_str);
+        if (NULL == ccm) {
             break;
         }
 
-        /*
-         * Provide the message to be encrypted, and obtain the encrypted output.
-         * EVP_EncryptUpdate can only be called once for this
-         */
-        if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, plaintext, plaintext_len)) {
-            handle_errors("Failed to encrypt", err_value, err_str);
+        plaintext  = malloc(CCM_STREAM_CHUNK_BYTES);
+        ciphertext = malloc(CCM_STREAM_CHUNK_BYTES);
+        if (NULL == plaintext || NULL == ciphertext) {
+            handle_errors("Failed to allocate memory for encrypted data",
+                          err_value, err_str);
             break;
         }
-        ciphertext_len = len;
 
         /* Open out_file for writing */
         fho = fopen(out_file, "wb");
@@ -158,37 +340,41 @@ int32_t encryptccm(unsigned char *plaintext, int plaintext_len, unsigned char *a
             break;
         }
 
-        /* Write encrypted data to out file */
-        if (fwrite(ciphertext, 1, ciphertext_len, fho) != ciphertext_len) {
-            handle_errors("Cannot write file", err_value, err_str);
-            break;
-        }
+        /* Encrypt the data a chunk at a time */
+        while (left > 0) {
+            piece = (left < CCM_STREAM_CHUNK_BYTES) ? left
+                                                    : CCM_STREAM_CHUNK_BYTES;
 
-        /*
-         * Finalise the encryption. Normally ciphertext bytes may be written at
-         * this stage, but this does not occur in CCM mode
-         */
-        if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) {
-            handle_errors("Failed to finalize", err_value, err_str);
-            break;
+            if (fread(plaintext, 1, piece, in) != piece) {
+                handle_errors("Cannot read file", err_value, err_str);
+                break;
+            }
+            if (CAL_SUCCESS != ccm_stream_update(ccm, plaintext, ciphertext,
+                                                 piece, err_value, err_str)) {
+                break;
+            }
+            if (fwrite(ciphertext, 1, piece, fho) != piece) {
+                handle_errors("Cannot write file", err_value, err_str);
+                break;
+            }
+            left -= piece;
         }
-        ciphertext_len += len;
-
-        /* Get the tag */
-        if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_GET_TAG, 16, tag)) {
-            handle_errors("Failed to get tag", err_value, err_str);
+        if (left > 0) {
             break;
         }
 
+        /* Get the tag */
+        ccm_stream_final(ccm, tag, err_value, err_str);
     } while(0);
 
     /* Clean up */
-    EVP_CIPHER_CTX_free(ctx);
+    ccm_stream_free(ccm);
 
-    if (fho) {
-        fclose(fho);
+    if (fho && fclose(fho) != 0 && *err_value == CAL_SUCCESS) {
+        handle_errors("Cannot write file", err_value, err_str);
     }
 
+    free(plaintext);
     free(ciphertext);
 
     return *err_value;
@@ -196,26 +382,18 @@ int32_t encryptccm(unsigned char *plaintext, int plaintext_len, unsigned char *a
 }
 
 int32_t encryptcbc(unsigned char *plaintext, int plaintext_len, unsigned char *key,
-    int key_len, unsigned char *iv, const char * out_file, int32_t *err_value, char *err_str)
+    int key_len, unsigned char *iv, unsigned char *ciphertext, int32_t *err_value,
+    char *err_str)
 {
 #ifdef REMOVE_ENCRYPTION
     return CAL_NO_CRYPTO_API_ERROR;
 #else
     EVP_CIPHER_CTX *ctx;
     int len;
-    size_t ciphertext_len;
-    unsigned char *ciphertext = NULL;
-    ciphertext = (unsigned char *)malloc(plaintext_len);
-    if (NULL == ciphertext) {
-        handle_errors("Failed to allocate memory for encrypted data",
-                      err_value, err_str);
-        return *err_value;
-    }
 
     /* Create and initialise the context */
     if(!(ctx = EVP_CIPHER_CTX_new())) {
         handle_errors("Fail to allocate AES-CBC context", err_value, err_str);
-        free(ciphertext);
         return *err_value;
     }
 
@@ -234,7 +412,7 @@ int32_t encryptcbc(unsigned char *plaintext, int plaintext_len, unsigned char *k
                 break;
             default:
                 handle_errors("Invalid key length for AES-CBC operation", err_value, err_str);
-                free(ciphertext);
+                EVP_CIPHER_CTX_free(ctx);
                 return *err_value;
         }
 
@@ -263,35 +441,17 @@ int32_t encryptcbc(unsigned char *plaintext, int plaintext_len, unsigned char *k
             handle_errors("Fail to encrypt with AES-CBC", err_value, err_str);
             break;
         }
-        ciphertext_len = len;
 
-        /* Finalise the encryption. Further ciphertext bytes may be written */
+        /* Finalise the encryption. No padding, so no further bytes */
         if(1 != EVP_EncryptFinal_ex(ctx, ciphertext + len, &len)) {
             handle_errors("Fail to finalise AES-CBC encryption", err_value, err_str);
             break;
         }
-        ciphertext_len += len;
-
-        /* Write encrypted data to out file */
-        FILE *out = fopen(out_file, "wb");
-        if (NULL == out) {
-            handle_errors("Cannot open temporary out file during AES-CBC operation", err_value, err_str);
-            break;
-        }
-
-        if (fwrite(ciphertext, 1, ciphertext_len, out) != ciphertext_len) {
-            handle_errors("Fail to write temporary out file during AES-CBC operation", err_value, err_str);
-            break;
-        }
-
-        fclose(out);
 
     } while(0);
 
     EVP_CIPHER_CTX_free(ctx);
 
-    free(ciphertext);
-
     return *err_value;
 #endif
 }
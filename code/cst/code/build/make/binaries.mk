@@ -29,11 +29,17 @@ include ../build/make/init.mk
 LIB_BACKEND_SSL    := libbackend-ssl.a
 LIB_BACKEND_PKCS11 := libbackend-pkcs11.a
 LIB_FRONTEND       := libfrontend.a
+LIB_CST            := libcst.a
+LIB_CST_SHARED     := libcst$(SHLIBEXT)
 
 EXE_SRKTOOL        := srktool$(EXEEXT)
 EXE_CST            := cst$(EXEEXT)
 EXE_CONVLB         := convlb$(EXEEXT)
 
+# Tests run by the check target
+TESTS              := ccm_stream_test$(EXEEXT)
+TEST_SCRIPTS       := aut_dat_concurrent.sh
+
 # Compiler and linker paths
 #===============================================================================
 CINCLUDES := $(SUBSYS:%=-I$(CST_CODE_PATH)/%/hdr)
@@ -45,6 +51,14 @@ LDOPTIONS += -L$(_OPENSSL_PATH)
 include ../build/make/$(TOOLCHAIN).mk
 include ../build/make/objects.mk
 
+# The code signing library holds the front end and both backends, the same
+# objects the cst executable links. The PKCS#11 backend objects defining
+# only functions the SSL backend also defines are never linked and left out.
+OBJECTS_PKCS11_SHADOWED := eng_cms.o eng_dek.o eng_auth.o
+OBJECTS_LIBCST := $(OBJECTS_FRONTEND) $(OBJECTS_BACKEND_SSL) \
+                  $(filter-out $(OBJECTS_FRONTEND) $(OBJECTS_PKCS11_SHADOWED),\
+                               $(OBJECTS_BACKEND_PKCS11))
+
 # Build header dependency files list
 #===============================================================================
 DEPLIST := $(subst .o,.d,$(OBJECTS))
@@ -61,16 +75,28 @@ ifeq ($(OSTYPE),mingw32)
 EXECUTABLES += $(DST)/keys/$(EXE_CONVLB)
 endif
 
+# Libraries and header to be released and where
+LIBRARIES := $(DST)/$(OSTYPE)/lib/$(LIB_CST)
+LIBRARIES += $(DST)/$(OSTYPE)/lib/$(LIB_CST_SHARED)
+LIB_HEADERS := $(CST_CODE_PATH)/front_end/hdr/libcst.h
+
 BUILDS := $(EXECUTABLES)
 
 build: $(notdir $(BUILDS))
 
+lib: $(notdir $(LIBRARIES))
+
 rel_bin: rel_exe
 
 rel_exe: $(notdir $(EXECUTABLES))
 	@echo "Copy executables"
 	$(foreach EXE,$(EXECUTABLES),$(CP) $(notdir $(EXE)) $(EXE) ; strip $(EXE) ;)
 
+rel_lib: lib
+	@echo "Copy libraries"
+	$(foreach LIB,$(LIBRARIES),$(CP) $(notdir $(LIB)) $(LIB) ;)
+	$(CP) $(LIB_HEADERS) $(DST)/$(OSTYPE)/include
+
 $(EXE_SRKTOOL): $(OBJECTS_SRKTOOL)
 
 $(LIB_BACKEND_SSL): $(OBJECTS_BACKEND_SSL)
@@ -78,10 +104,21 @@ $(LIB_BACKEND_PKCS11): $(OBJECTS_BACKEND_PKCS11)
 
 $(LIB_FRONTEND): $(OBJECTS_FRONTEND)
 
-$(EXE_CST): $(LIB_FRONTEND) $(LIB_BACKEND_SSL) $(LIB_BACKEND_PKCS11)
+$(EXE_CST): $(OBJECTS_CST) $(LIB_FRONTEND) $(LIB_BACKEND_SSL) $(LIB_BACKEND_PKCS11)
+
+$(LIB_CST): $(OBJECTS_LIBCST)
+$(LIB_CST_SHARED): $(OBJECTS_LIBCST)
 
 $(EXE_CONVLB): $(OBJECTS_CONVLB)
 
+ccm_stream_test$(EXEEXT): $(OBJECTS_TEST) $(LIB_BACKEND_SSL)
+
+check: $(TESTS) $(EXE_CST) $(EXE_SRKTOOL)
+	@echo "Run tests"
+	$(foreach TEST,$(TESTS),./$(TEST) &&) true
+	$(foreach SCRIPT,$(TEST_SCRIPTS),\
+	    sh $(CST_CODE_PATH)/test/src/$(SCRIPT) $(EXE_CST) $(EXE_SRKTOOL) &&) true
+
 clean:
 	@echo "Clean obj.$(OSTYPE)"
 	@$(FIND) . -type f ! -name "Makefile" -execdir $(RM) {} +
@@ -22,13 +22,16 @@ OBJCOPY := objcopy
 
 # C compiler flags
 #==============================================================================
-COPTIONS += -std=c99 -D_POSIX_C_SOURCE=200809L -Wall -Werror -pedantic -fPIC -g
+COPTIONS += -std=c99 -D_POSIX_C_SOURCE=200809L -Wall -Werror -pedantic -fPIC -pthread -g
 
 # Linker flags
 #==============================================================================
 LDOPTIONS += -g
 
-LDLIBS := -lcrypto -ldl
+# Flag linking a shared library
+LDSHARED := -shared
+
+LDLIBS := -lssl -lcrypto -ldl -lpthread
 
 # Archiver flags
 #==============================================================================
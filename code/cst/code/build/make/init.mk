@@ -17,7 +17,7 @@
 # Define subsystems and source location
 #==============================================================================
 CST_CODE_PATH := $(ROOTPATH)/code
-SUBSYS        := common back_end-ssl back_end-pkcs11 srktool front_end convlb
+SUBSYS        := common back_end-ssl back_end-pkcs11 srktool front_end convlb test
 VPATH         := $(SUBSYS:%=$(CST_CODE_PATH)/%/src)
 
 # Common commands
@@ -18,4 +18,6 @@ ifeq ($(ENCRYPTION), no)
 	CDEFINES := -DREMOVE_ENCRYPTION
 endif
 
+SHLIBEXT = .so
+
 OPENSSL_CONFIG := linux-x86_64 --prefix="/opt/cst-ssl" --openssldir="/opt/cst-ssl"
@@ -32,7 +32,10 @@ COPTIONS += -std=c99 -D_POSIX_C_SOURCE=200809L -Wall -Werror -g
 #==============================================================================
 LDOPTIONS += -g -static
 
-LDLIBS := -lcrypto -lcrypt32 -lgdi32 -lws2_32
+# Flag linking a shared library
+LDSHARED := -shared
+
+LDLIBS := -lssl -lcrypto -lcrypt32 -lgdi32 -lws2_32 -lpthread
 
 # Archiver flags
 #==============================================================================
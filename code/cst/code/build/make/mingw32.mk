@@ -22,5 +22,6 @@ ifeq ($(ENCRYPTION), no)
 endif
 
 EXEEXT = .exe
+SHLIBEXT = .dll
 
 OPENSSL_CONFIG := mingw --cross-compile-prefix=i686-w64-mingw32- enable-capieng
@@ -23,6 +23,8 @@ OBJECTS :=
 OBJECTS_BACKEND :=
 OBJECTS_FRONTEND :=
 OBJECTS_SRKTOOL :=
+OBJECTS_CST :=
+OBJECTS_TEST :=
 
 # include object files for each subsystem.  Subsystems are defined in init.mk
 
@@ -16,4 +16,6 @@ ifeq ($(ENCRYPTION), no)
 	CDEFINES := -DREMOVE_ENCRYPTION
 endif
 
+SHLIBEXT = .dylib
+
 OPENSSL_CONFIG := darwin64-x86_64-cc --prefix="/opt/cst-ssl" --openssldir="/opt/cst-ssl"
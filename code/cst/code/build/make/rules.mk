@@ -26,6 +26,10 @@ LFLAGS  := -t
 	@echo "Create archive $@"
 	$(AR) $(ARFLAGS) $@ $^
 
+%$(SHLIBEXT):
+	@echo "Link shared library $@"
+	$(LD) $(LDSHARED) $^ $(LDFLAGS) -o $@
+
 %.exe:
 	@echo "Link $@"
 	$(LD) $^ $(LDFLAGS) -o $@
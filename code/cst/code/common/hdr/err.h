@@ -37,6 +37,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 =============================================================================
 @endverbatim */
 
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <setjmp.h>
+
 /*===========================================================================
                          FUNCTION PROTOTYPES
 =============================================================================*/
@@ -52,11 +57,25 @@ extern "C" {
  *
  * @pre  @a err is not NULL
  *
- * @post Program exits with exit code 1.
+ * @post Program exits with exit code 1, unless a recovery point has been
+ *       registered with set_error_recovery().
  */
 void
 error(const char *err, ...);
 
+/** Register error recovery point
+ *
+ * Once registered, error() no longer exits the program but jumps back to
+ * @a env with a value of 1. This lets long running callers, like the
+ * signing daemon, abort a single job without terminating the process.
+ * The recovery point only applies to errors raised by the calling thread.
+ *
+ * @param[in] env Recovery point set up with setjmp(), NULL restores the
+ *                default behaviour of exiting the program
+ */
+void
+set_error_recovery(jmp_buf *env);
+
 #ifdef __cplusplus
 }
 #endif
@@ -63,6 +63,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
                                        *   strings in X.509 certificates using
                                        *   Generalized Time format
                                        */
+#define KEY_HEAP_BYTES            (256 * 1024) /**< Locked key memory */
+#define KEY_HEAP_MIN_BYTES        32   /**< Smallest locked allocation */
+
 #define PEM_FILE_EXTENSION        ".pem"   /* PEM file extention */
 #define PEM_FILE_EXTENSION_BYTES  4        /* Length of pem extention */
 
@@ -165,6 +168,21 @@ RSA_get0_key(const RSA *r, const BIGNUM **n, const BIGNUM **e, const BIGNUM **d)
 extern void
 openssl_initialize();
 
+/** openssl_lock_keys
+ *
+ * Sets up the OpenSSL secure heap, so that the private key material and
+ * the cached key passphrases are kept in locked memory, never swapped
+ * out nor dumped with the process. Must be called before any key is read.
+ * Memory locks are not inherited by forked processes.
+ *
+ * @retval TRUE the secure heap is locked in memory
+ *
+ * @retval FALSE the heap cannot be set up or locked, for instance when
+ *         RLIMIT_MEMLOCK is too low
+ */
+extern int
+openssl_lock_keys(void);
+
 /** Computes hash digest
  *
  * Calls openssl API to generate hash for the given data in buf.
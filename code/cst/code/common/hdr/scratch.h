@@ -0,0 +1,53 @@
+/*
+   Copyright 2026 CST contributors
+   SPDX-License-Identifier: BSD-3-Clause
+
+   ===========================================================================
+
+   @file    scratch.h
+
+   @brief   Per-process scratch space for the temporary files created while
+            processing a CSF, so several tool instances can share a working
+            directory.
+
+   ===========================================================================
+ */
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Get the path of a scratch file
+ *
+ * The first call creates a directory private to the process under $TMPDIR,
+ * /tmp if unset. Every scratch file lives in that directory.
+ *
+ * @param[in] name Base name of the scratch file
+ *
+ * @pre  @a name is not NULL and contains no directory separator
+ *
+ * @post Calls error() if the scratch directory cannot be created
+ *
+ * @returns Path of the scratch file, valid until scratch_cleanup() is called
+ */
+char *
+scratch_path(const char *name);
+
+/** Remove the scratch files and directory
+ *
+ * Also registered with atexit() when the scratch directory is created.
+ * A later scratch_path() call creates a new directory.
+ */
+void
+scratch_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCRATCH_H */
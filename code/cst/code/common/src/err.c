@@ -41,6 +41,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "err.h"
 
 /*===========================================================================
@@ -48,6 +49,30 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 =============================================================================*/
 extern const char *g_tool_name;
 
+/*===========================================================================
+                               LOCAL VARIABLES
+=============================================================================*/
+/** Recovery points used by error() instead of exiting, one per thread */
+static pthread_key_t error_recovery;
+
+/** Creates the error_recovery key once */
+static pthread_once_t error_recovery_once = PTHREAD_ONCE_INIT;
+
+/** Set if the error_recovery key was created */
+static int error_recovery_ready = 0;
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  create_error_recovery
+---------------------------*/
+static void create_error_recovery(void)
+{
+    error_recovery_ready = (pthread_key_create(&error_recovery, NULL) == 0);
+}
+
 /*===========================================================================
                                GLOBAL FUNCTIONS
 =============================================================================*/
@@ -58,6 +83,7 @@ extern const char *g_tool_name;
 void error(const char *err, ...)
 {
     va_list args;
+    jmp_buf *env = NULL;
 
     va_start(args, err);
 
@@ -67,5 +93,28 @@ void error(const char *err, ...)
 
     va_end(args);
 
+    pthread_once(&error_recovery_once, create_error_recovery);
+    if (error_recovery_ready)
+    {
+        env = pthread_getspecific(error_recovery);
+    }
+
+    if (env != NULL)
+    {
+        longjmp(*env, 1);
+    }
+
     exit(1);
 }
+
+/*--------------------------
+  set_error_recovery
+---------------------------*/
+void set_error_recovery(jmp_buf *env)
+{
+    pthread_once(&error_recovery_once, create_error_recovery);
+    if (error_recovery_ready)
+    {
+        pthread_setspecific(error_recovery, env);
+    }
+}
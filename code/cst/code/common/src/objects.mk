@@ -19,6 +19,7 @@
 OBJECTS += \
     openssl_helper.o \
     srk_helper.o \
+    scratch.o \
     err.o
 
 OBJECTS_SRKTOOL += \
@@ -30,4 +31,5 @@ OBJECTS_FRONTEND += \
     openssl_helper.o \
     srk_helper.o \
     misc_helper.o \
+    scratch.o \
     err.o
@@ -51,6 +51,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <openssl/x509v3.h>
 #include <openssl/pem.h>
 #include <openssl/err.h>
+#include <openssl/crypto.h>
 #include "openssl_helper.h"
 #include "version.h"
 #include <openssl/rand.h>
@@ -185,6 +186,22 @@ openssl_initialize(void)
 }
 
 
+/*--------------------------
+  openssl_lock_keys
+---------------------------*/
+
+int
+openssl_lock_keys(void)
+{
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+    /* Returns 2 when the heap is allocated but could not be locked */
+    return (CRYPTO_secure_malloc_init(KEY_HEAP_BYTES, KEY_HEAP_MIN_BYTES) == 1)
+           ? TRUE : FALSE;
+#else
+    return FALSE;
+#endif
+}
+
 /*--------------------------
   generate_hash
 ---------------------------*/
@@ -385,6 +402,7 @@ read_private_key(const char *filename, pem_password_cb *password_cb,
             return NULL;
         }
     }
+    BIO_free(private_key);
     return pkey;
 }
 
@@ -521,6 +539,37 @@ calculate_hash(const char *in_file,
     return err_value;
 }
 
+/*--------------------------
+  calculate_hash_buffer
+---------------------------*/
+int32_t
+calculate_hash_buffer(const uint8_t *data,
+                      size_t data_bytes,
+                      hash_alg_t hash_alg,
+                      uint8_t *buf,
+                      int32_t *pbuf_bytes)
+{
+    const EVP_MD *sign_md; /**< Ptr to digest name */
+    unsigned int hash_bytes; /**< Length of the resulting hash */
+
+    sign_md = EVP_get_digestbyname(get_digest_name(hash_alg));
+    if (sign_md == NULL) {
+        return CAL_INVALID_ARGUMENT;
+    }
+
+    if (*pbuf_bytes < EVP_MD_size(sign_md)) {
+        return CAL_INSUFFICIENT_BUFFER_LEN;
+    }
+
+    if (!EVP_Digest(data, data_bytes, buf, &hash_bytes, sign_md, NULL)) {
+        return CAL_CRYPTO_API_ERROR;
+    }
+
+    *pbuf_bytes = hash_bytes;
+
+    return CAL_SUCCESS;
+}
+
 /*--------------------------
   ver_sig_data
 ---------------------------*/
@@ -531,7 +580,8 @@ int32_t ver_sig_data(const char *in_file,
                      uint8_t    *sig_buf,
                      size_t     sig_buf_bytes)
 {
-    EVP_PKEY *pkey                = X509_get_pubkey(read_certificate(cert_file));
+    X509     *cert                = read_certificate(cert_file);
+    EVP_PKEY *pkey                = X509_get_pubkey(cert);
     const EVP_MD   *hash_type     = EVP_get_digestbyname(get_digest_name(hash_alg));
     int32_t        hash_bytes     = HASH_BYTES_MAX;
     uint8_t        *hash          = OPENSSL_malloc(HASH_BYTES_MAX);
@@ -539,6 +589,9 @@ int32_t ver_sig_data(const char *in_file,
     uint8_t        *ecdsa_der     = NULL;
     uint32_t       ecdsa_der_size = 0;
 
+    /* The public key holds its own reference */
+    X509_free(cert);
+
     if (NULL == in_file)       return CAL_INVALID_ARGUMENT;
     if (NULL == pkey)          return CAL_INVALID_ARGUMENT;
     if (NULL == hash_type)     return CAL_INVALID_ARGUMENT;
@@ -0,0 +1,158 @@
+/*
+   Copyright 2026 CST contributors
+   SPDX-License-Identifier: BSD-3-Clause
+
+   ===========================================================================
+
+   @file    scratch.c
+
+   @brief   Per-process scratch space for the temporary files created while
+            processing a CSF.
+
+   ===========================================================================
+ */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "err.h"
+#include "scratch.h"
+
+/*===========================================================================
+                               LOCAL CONSTANTS
+=============================================================================*/
+#define SCRATCH_DIR_TEMPLATE "cst-XXXXXX" /**< mkdtemp() template */
+#define SCRATCH_DEFAULT_ROOT "/tmp"       /**< Used when TMPDIR is unset */
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/* Scratch files handed out so far */
+typedef struct scratch_file {
+    struct scratch_file *next;
+    char *name;                     /**< Base name given by the caller */
+    char *path;                     /**< Full path in the scratch directory */
+} scratch_file_t;
+
+/*===========================================================================
+                               LOCAL VARIABLES
+=============================================================================*/
+/** Private directory of the process, NULL until first needed */
+static char *scratch_dir = NULL;
+
+/** Head of the scratch files list */
+static scratch_file_t *scratch_files = NULL;
+
+/** Whether scratch_cleanup() is registered with atexit() */
+static int cleanup_registered = 0;
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  create_scratch_dir
+---------------------------*/
+static void
+create_scratch_dir(void)
+{
+    const char *root = getenv("TMPDIR");
+
+    if (root == NULL || root[0] == '\0')
+    {
+        root = SCRATCH_DEFAULT_ROOT;
+    }
+
+    scratch_dir = malloc(strlen(root) + sizeof(SCRATCH_DIR_TEMPLATE) + 1);
+    if (scratch_dir == NULL)
+    {
+        error("Cannot allocate memory for the scratch directory name");
+    }
+    sprintf(scratch_dir, "%s/%s", root, SCRATCH_DIR_TEMPLATE);
+
+    if (mkdtemp(scratch_dir) == NULL)
+    {
+        free(scratch_dir);
+        scratch_dir = NULL;
+        error("Cannot create a scratch directory under %s", root);
+    }
+
+    if (!cleanup_registered)
+    {
+        atexit(scratch_cleanup);
+        cleanup_registered = 1;
+    }
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  scratch_path
+---------------------------*/
+char *
+scratch_path(const char *name)
+{
+    scratch_file_t *file = scratch_files;
+
+    while (file != NULL && strcmp(file->name, name) != 0)
+    {
+        file = file->next;
+    }
+
+    if (file != NULL)
+    {
+        return file->path;
+    }
+
+    if (scratch_dir == NULL)
+    {
+        create_scratch_dir();
+    }
+
+    file = calloc(1, sizeof(scratch_file_t));
+    if (file == NULL ||
+        (file->name = malloc(strlen(name) + 1)) == NULL ||
+        (file->path = malloc(strlen(scratch_dir) + strlen(name) + 2)) == NULL)
+    {
+        error("Cannot allocate memory for a scratch file name");
+    }
+    strcpy(file->name, name);
+    sprintf(file->path, "%s/%s", scratch_dir, name);
+
+    file->next = scratch_files;
+    scratch_files = file;
+
+    return file->path;
+}
+
+/*--------------------------
+  scratch_cleanup
+---------------------------*/
+void
+scratch_cleanup(void)
+{
+    scratch_file_t *file = NULL;
+
+    while (scratch_files != NULL)
+    {
+        file = scratch_files;
+        scratch_files = file->next;
+        remove(file->path);
+        free(file->name);
+        free(file->path);
+        free(file);
+    }
+
+    if (scratch_dir != NULL)
+    {
+        rmdir(scratch_dir);
+        free(scratch_dir);
+        scratch_dir = NULL;
+    }
+}
@@ -67,6 +67,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define CAL_NO_CRYPTO_API_ERROR    (-11) /* Error when Encryption is disabled*/
 #define CAL_INVALID_SIGNATURE      (-12) /* Error when verifying isignature  */
 #define CAL_INSUFFICIENT_MEMORY    (-13) /* Buffer length is not sufficient  */
+#define CAL_NOT_SUPPORTED          (-14) /* Operation not supported by API   */
 #define CAL_LAST_ERROR            (-100) /* Max error codes for adapt layer  */
 
 #define FILE_BUF_SIZE             (1024) /* 1K buf for file read/file write  */
@@ -132,6 +133,16 @@ typedef struct _AEAD {
     uint8_t *uch;
 } AEAD_t;
 
+/** Piece of the data encrypted by gen_auth_encrypted_segments() */
+typedef struct aead_segment {
+    uint8_t *data;      /**< Plaintext on input, ciphertext on output */
+    size_t  bytes;      /**< Size of data */
+} aead_segment_t;
+
+/** Data encryption key shared by the encrypted data of a CSF, generated or
+ *  read by the first gen_auth_encrypted function using it */
+typedef struct dek dek_t;
+
 /*===========================================================================
                      GLOBAL VARIABLE DECLARATIONS
 =============================================================================*/
@@ -194,6 +205,103 @@ typedef int32_t
 
 extern gen_sig_data_fptr gen_sig_data;
 
+/** Generate Signature Data from a Buffer Function Pointer
+ *
+ * Same as #gen_sig_data_fptr, except that the data to sign is given in
+ * memory so that no intermediate file is needed in nominal mode.
+ *
+ * @param[in] data buffer holding the binary data to sign
+ *
+ * @param[in] data_bytes size of @a data in bytes
+ *
+ * @param[in] data_name name identifying the data. It is never opened, HSM
+ *                      mode uses it to name the exported data and the
+ *                      signing request entry.
+ *
+ * @param[in] cert_file path to signer certificate file
+ *
+ * @param[in] hash_alg hash algorithm in #hash_alg_t
+ *
+ * @param[in] sig_fmt signature format in #sig_fmt_t
+ *
+ * @param[out] sig_buf buffer to return signature data
+ *
+ * @param[in,out] sig_buf_bytes input size of sig_buf allocated by caller
+ *                              output size of signature data returned by API
+ *
+ * @post Errors are printed to STDERR
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_FILE_NOT_FOUND invalid path in one of the arguments
+ *
+ * @retval #CAL_INVALID_SIG_DATA_SIZE size insufficient to generate sig data
+ *
+ * @retval #CAL_INVALID_ARGUMENT one of the input arguments is invalid
+ */
+typedef int32_t
+(*gen_sig_data_buffer_fptr)(const uint8_t* data,
+                            size_t data_bytes,
+                            const char* data_name,
+                            const char* cert_file,
+                            hash_alg_t hash_alg,
+                            sig_fmt_t sig_fmt,
+                            uint8_t* sig_buf,
+                            size_t *sig_buf_bytes,
+                            func_mode_t mode);
+
+extern gen_sig_data_buffer_fptr gen_sig_data_buffer;
+
+/** Generate Signature Data from a Digest Function Pointer
+ *
+ * Same as #gen_sig_data_buffer_fptr, except that the caller has already
+ * hashed the data to sign with @a hash_alg, so that the data itself does
+ * not have to be held in memory. Backends that need the data, or do not
+ * support @a sig_fmt or @a mode, return #CAL_NOT_SUPPORTED and the caller
+ * falls back to #gen_sig_data_buffer. May be NULL if the backend has no
+ * digest support at all.
+ *
+ * @param[in] digest message digest of the data to sign
+ *
+ * @param[in] digest_bytes size of @a digest in bytes
+ *
+ * @param[in] cert_file path to signer certificate file
+ *
+ * @param[in] hash_alg hash algorithm @a digest was computed with
+ *
+ * @param[in] sig_fmt signature format in #sig_fmt_t
+ *
+ * @param[out] sig_buf buffer to return signature data
+ *
+ * @param[in,out] sig_buf_bytes input size of sig_buf allocated by caller
+ *                              output size of signature data returned by API
+ *
+ * @post Errors are printed to STDERR
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_NOT_SUPPORTED the signature needs the data itself
+ *
+ * @retval #CAL_FILE_NOT_FOUND invalid path in one of the arguments
+ *
+ * @retval #CAL_INVALID_ARGUMENT one of the input arguments is invalid
+ */
+typedef int32_t
+(*gen_sig_data_digest_fptr)(const uint8_t* digest,
+                            size_t digest_bytes,
+                            const char* cert_file,
+                            hash_alg_t hash_alg,
+                            sig_fmt_t sig_fmt,
+                            uint8_t* sig_buf,
+                            size_t *sig_buf_bytes,
+                            func_mode_t mode);
+
+extern gen_sig_data_digest_fptr gen_sig_data_digest;
+
+/** Set if the backend generates signatures of data buffers from several
+ *  threads at once */
+extern uint32_t gen_sig_data_concurrent;
+
   /** Read Certificate Function Pointer
    *
    * Hook for the read_certificate() method supported from the backend. Reads
@@ -220,6 +328,8 @@ extern read_certificate_fptr read_certificate;
  *
  * API generates authenticated encrypted data for given plain-text data file
  *
+ * @param[in,out] dek data encryption key of the CSF
+ *
  * @param[in] in_file plaintext, extracted and concatenated as for signing
  *
  * @param[out] out_file ciphertext (file name is input)
@@ -252,7 +362,8 @@ extern read_certificate_fptr read_certificate;
  *
  * @retval #CAL_MAC_LEN_INCORRECT the mac_bytes is not correct
  */
-int32_t gen_auth_encrypted_data(const char* in_file,
+int32_t gen_auth_encrypted_data(dek_t *dek,
+                     const char* in_file,
                      const char* out_file,
                      aead_alg_t aead_alg,
                      uint8_t *aad,
@@ -266,6 +377,113 @@ int32_t gen_auth_encrypted_data(const char* in_file,
                      const char* key_file,
                      int reuse_dek);
 
+/** Generate authenticated encrypted data in memory
+ *
+ * API encrypts the concatenation of @a segments in place, as
+ * gen_auth_encrypted_data() does for the same data held in a file. The
+ * segments may point into different buffers, such as the mapped files
+ * holding the blocks of a command, so that the data is never copied.
+ *
+ * @param[in,out] dek data encryption key of the CSF
+ *
+ * @param[in,out] segments plaintext to encrypt, replaced by the ciphertext
+ *
+ * @param[in] segment_count number of @a segments
+ *
+ * @param[in] aead_alg only AES_CCM supported for now.
+ *
+ * @param[out] aad additional authenticated data
+ *
+ * @param[in] aad_bytes size of aad (additional authenticated data)
+ *
+ * @param[out] nonce nonce bytes to return
+ *
+ * @param[in] nonce_bytes size of nonce
+ *
+ * @param[out] mac output MAC
+ *
+ * @param[in] mac_bytes size of MAC
+ *
+ * @param[in] key_bytes size of symmetric key
+ *
+ * @param[in] cert_file certificate for DEK (data enctyption key) encryption
+ *
+ * @param[out] key_file encrypted symmetric key (file name is input)
+ *
+ * @param[in] reuse_dek set if @a key_file already holds the symmetric key
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_INVALID_ARGUMENT unsupported algorithm
+ *
+ * @retval #CAL_FILE_NOT_FOUND the symmetric key cannot be read
+ *
+ * @retval #CAL_CRYPTO_API_ERROR the encryption failed
+ */
+int32_t gen_auth_encrypted_segments(dek_t *dek,
+                     aead_segment_t *segments,
+                     size_t segment_count,
+                     aead_alg_t aead_alg,
+                     uint8_t *aad,
+                     size_t aad_bytes,
+                     uint8_t *nonce,
+                     size_t nonce_bytes,
+                     uint8_t *mac,
+                     size_t mac_bytes,
+                     size_t key_bytes,
+                     const char* cert_file,
+                     const char* key_file,
+                     int reuse_dek);
+
+/** Generate encrypted data in memory
+ *
+ * API encrypts a buffer with the data encryption key shared by every
+ * encrypted data of the CSF, as gen_auth_encrypted_data() does for a file.
+ * May be called from several threads at once.
+ *
+ * @param[in,out] dek data encryption key of the CSF
+ *
+ * @param[in] plaintext data to encrypt
+ *
+ * @param[in] plaintext_bytes size of @a plaintext, a multiple of
+ *            #AES_BLOCK_BYTES
+ *
+ * @param[out] ciphertext encrypted data, @a plaintext_bytes long
+ *
+ * @param[in] aead_alg only AES_CBC supported for now.
+ *
+ * @param[in] iv initialization vector
+ *
+ * @param[in] iv_bytes size of @a iv, #AES_BLOCK_BYTES
+ *
+ * @param[in] key_bytes size of symmetric key
+ *
+ * @param[in] cert_file certificate for DEK (data enctyption key) encryption
+ *
+ * @param[out] key_file encrypted symmetric key (file name is input)
+ *
+ * @param[in] reuse_dek set if @a key_file already holds the symmetric key
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_INVALID_ARGUMENT unsupported algorithm or IV size
+ *
+ * @retval #CAL_FILE_NOT_FOUND the symmetric key cannot be read
+ *
+ * @retval #CAL_CRYPTO_API_ERROR the encryption failed
+ */
+int32_t gen_auth_encrypted_buffer(dek_t *dek,
+                     const uint8_t *plaintext,
+                     size_t plaintext_bytes,
+                     uint8_t *ciphertext,
+                     aead_alg_t aead_alg,
+                     const uint8_t *iv,
+                     size_t iv_bytes,
+                     size_t key_bytes,
+                     const char* cert_file,
+                     const char* key_file,
+                     int reuse_dek);
+
 /** Computes hash digest from a given input file
  *
  * This function differs from the generate_hash() function in
@@ -302,6 +520,40 @@ calculate_hash(const char *in_file,
                uint8_t *buf,
                int32_t *pbuf_bytes);
 
+/** Computes hash digest from a given input buffer
+ *
+ * Same as calculate_hash() for data already held in memory.
+ *
+ * @param[in] data Input data
+ *
+ * @param[in] data_bytes Size of @a data in bytes
+ *
+ * @param[in] hash_alg Hash digest algorithm from #hash_alg_t
+ *
+ * @param[out] buf holds the resulting hash value
+ *
+ * @param[in,out] pbuf_bytes on input, holds the size of @a buf in bytes,
+ *                on output pbuf_bytes is updated to hold the size of the
+ *                resulting hash in bytes.
+ *
+ * @pre @a data, @a buf, and @a pbuf_bytes must not be NULL
+ *
+ * @retval #CAL_SUCCESS API completed its task successfully
+ *
+ * @retval #CAL_INVALID_ARGUMENT if @a hash_alg contains an unsupported
+ *         algorithm
+ *
+ * @retval #CAL_INSUFFICIENT_BUFFER_LEN @a buf cannot hold the hash
+ *
+ * @retval #CAL_CRYPTO_API_ERROR otherwise
+ */
+int32_t
+calculate_hash_buffer(const uint8_t *data,
+                      size_t data_bytes,
+                      hash_alg_t hash_alg,
+                      uint8_t *buf,
+                      int32_t *pbuf_bytes);
+
 /** Verify Signature Data
  *
  * Verifies a signature for the given data file, signer certificate,
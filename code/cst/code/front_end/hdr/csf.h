@@ -41,8 +41,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                                 INCLUDES
 =============================================================================*/
+#include <setjmp.h>
 #include "adapt_layer.h"
 #include "arch_types.h"
+#include "scratch.h"
 
 /*===========================================================================
                                 MACROS
@@ -77,6 +79,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ERROR_GENERATING_RANDOM_KEY     (CAL_LAST_ERROR - 26)
 #define ERROR_IN_ENCRYPTION             (CAL_LAST_ERROR - 27)
 #define ERROR_CMD_INSTALL_SECKEY_EXPECTED (CAL_LAST_ERROR - 28)
+#define ERROR_JOB_ABORTED               (CAL_LAST_ERROR - 29)
+#define ERROR_BATCH_JOB_FAILED          (CAL_LAST_ERROR - 30)
 
 /* Strings used in generating error messages */
 #define STR_IN_CMD (" in command ")
@@ -89,13 +93,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define STR_ERR_USING_CERT (" using certificate ")
 #define STR_CERTIFICATE (" Certificate")
 
-/* Temporary files created during csf processing */
+/* Names of the signed CSF and image data */
 #define FILE_SIG_CSF_DATA ("csfsig.bin")
 #define FILE_SIG_IMG_DATA ("imgsig.bin")
 
-#define FILE_PLAIN_DATA   ("rawbytes.bin")
-#define FILE_ENCRYPTED_DATA  ("encbytes.bin")
-
 /* HAB4 macros */
 #define HAB4 (0x40)
 
@@ -105,6 +106,16 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /* Max size of buffer to allocate for csf cmds */
 #define HAB_CSF_BYTES_MAX (768)
 
+/* Signatures requested at once from backends signing concurrently */
+#define SIGN_REQUESTS_DEFAULT (4)
+#define SIGN_REQUESTS_MAX (16)
+
+/* Max length of the error details logged while processing a CSF */
+#define MAX_ERROR_STR_LEN (512)
+
+/* Max size of buffer for signature bytes */
+#define SIGNATURE_BUFFER_SIZE (1024)
+
 /**< Max. nonce bytes in 16B AES blk */
 #define MAX_NONCE_BYTES             (13)
 
@@ -125,7 +136,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ERR_IF_INIT_MULT_TIMES(flag)                                     \
     if (flag)                                                            \
     {                                                                    \
-        log_arg_cmd(arg->type, " argument already specified", cmd->type);\
+        log_arg_cmd(ctx, arg->type, " argument already specified",   \
+                    cmd->type);                                          \
         return ERROR_INVALID_ARGUMENT;                                   \
     }                                                                    \
     flag = true
@@ -133,7 +145,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ERR_IF_UNS_ARG(flag, arg)                                        \
         if (flag)                                                        \
         {                                                                \
-            log_arg_cmd(arg, STR_ILLEGAL, cmd->type);                    \
+            log_arg_cmd(ctx, arg, STR_ILLEGAL, cmd->type);               \
             return ERROR_UNSUPPORTED_ARGUMENT;                           \
         }
 
@@ -299,8 +311,20 @@ typedef struct command {
                                     /*    csf start address                  */
 } command_t;
 
+/* CSF processing context, see struct cst_context below */
+typedef struct cst_context cst_context_t;
+
+/* Authenticate Data command waiting for its signature */
+typedef struct aut_dat_job aut_dat_job_t;
+
+/* File holding Authenticate or Decrypt Data blocks */
+typedef struct block_file block_file_t;
+
+/* Files holding the blocks of a CSF, with the lock sharing them */
+typedef struct block_files block_files_t;
+
 /* Command handler function type */
-typedef int32_t (*command_handler_f)(command_t* cmd);
+typedef int32_t (*command_handler_f)(cst_context_t *ctx, command_t* cmd);
 
 /* Map of label and value, these labels appear on RHS of argument in CSF */
 typedef struct map {
@@ -343,6 +367,12 @@ typedef struct aes_key {
     char * key_file;
 } aes_key_t;
 
+/* File read in place of a file referenced by the CSF */
+typedef struct file_map {
+    const char *name;               /* Filename as written in the CSF       */
+    char *path;                     /* File actually read                   */
+} file_map_t;
+
 typedef struct ahab_data_s {
     char      *srk_table;
     char      *srk_entry;
@@ -362,50 +392,85 @@ typedef struct ahab_data_s {
     uint32_t  image_indexes;
 } ahab_data_t;
 
-/*===========================================================================
-                              EXTERN
-=============================================================================*/
+/* State of a CSF being processed. Every CSF gets its own context, so
+   the batch jobs of cst parse and sign several CSFs at the same time in one
+   process. The backend and the command line options are not part of it:
+   they are process-wide, set before the first CSF and only read after */
+struct cst_context {
+    void *scanner;                  /* Reentrant lexer reading the CSF      */
+    int32_t lexer_eof;              /* Set once the lexer reached the end   */
+    int32_t error_code;             /* Last error code                      */
+    char error_log[MAX_ERROR_STR_LEN + 1]; /* Details of the errors         */
+    uint8_t csf_buffer[HAB_CSF_BYTES_MAX]; /* Buffer for CSF data           */
+    uint32_t csf_buffer_index;      /* Index in CSF buffer, used to keep
+          track of current position in buf as data is appended to csf buffer */
+    command_t *cmd_head;            /* Pointer to head of command list      */
+    command_t *cmd_current;         /* Pointer to current cmd being
+                                     processed in command list               */
+    uint8_t cmd_seq_stage;          /* Checks the order of the commands     */
+    char *key_certs[HAB_KEY_PUBLIC_MAX]; /* Img key files                   */
+    aes_key_t aes_keys[HAB_KEY_SECRET_MAX]; /* AES keys                     */
+    tgt_t target;                   /* Target, HAB or AHAB                  */
+    uint8_t hab_version;            /* HAB version in CSF                   */
+    uint8_t ahab_version;           /* AHAB version in CSF                  */
+    func_mode_t mode;               /* Functional mode                      */
+    uint32_t hash_alg;              /* Default hash algorithm               */
+    uint32_t engine;                /* Default engine                       */
+    uint32_t engine_config;         /* Default engine configuration         */
+    uint32_t cert_format;           /* Default certificate format           */
+    sig_fmt_t sig_format;           /* Default signature format             */
+    uint32_t unlock_rng;            /* Set if UNLOCK RNG command is present */
+    uint32_t init_rng;              /* Set if INIT RNG command is present   */
+    int32_t no_ca;                  /* Set if Install NOCAK is used         */
+    int32_t srk_set_hab4;           /* SRK set of HAB4 CSFs                 */
+    ahab_data_t ahab_data;          /* AHAB data                            */
+    command_t unlk_cmd;             /* Unlock RNG command added by cst      */
+    argument_t unlk_args[2];
+    keyword_t unlk_keywords[2];
+    const file_map_t *file_map;     /* Files replaced, NULL if none         */
+    size_t file_map_count;          /* Number of entries in file_map        */
+    aut_dat_job_t *aut_dat_jobs;    /* Authenticate Data commands to sign   */
+    block_files_t *block_files;     /* Files holding blocks, opened once    */
+    dek_t *dek;                     /* Data encryption key of the CSF       */
+    jmp_buf error_recovery;         /* Where error() returns to, if set     */
+};
+
 /*===========================================================================
                               GLOBAL VARIABLES
 =============================================================================*/
-extern int32_t g_error_code;             /* Global error code              */
-extern uint8_t g_csf_buffer[]; /* Buffer for CSF data                  */
-extern uint32_t g_csf_buffer_index;  /* Index in CSF buffer, used to keep
-          track of current position in buf as data is appended to csf buffer */
-
-extern char *g_key_certs[];         /* Array of pointers to img key files   */
-extern aes_key_t g_aes_keys[];         /* Array of aes keys */
-extern uint8_t g_hab_version;  /* Global to hold hab version in CSF    */
-extern uint32_t g_hash_alg;          /* Holds default hash algorithm         */
-extern uint32_t g_engine;            /* Holds default engine                 */
-extern uint32_t g_engine_config;     /* Holds default engine configuration   */
-extern uint32_t g_csf_type;          /* Holds default csf type               */
-extern uint32_t g_cert_format;       /* Holds default certificate format     */
-extern sig_fmt_t g_sig_format;       /* Holds default signature format       */
-extern uint32_t g_unlock_rng;        /* Set if UNLOCK RNG command is present */
-extern uint32_t g_init_rng;          /* Set if INIT RNG command is present   */
-extern command_t *g_cmd_current;     /* Pointer to current cmd being
-                                     processed in command list               */
-extern command_t *g_cmd_head;        /* Pointer to head of command list      */
+/* Command line options, set before the first CSF and shared by every CSF */
 extern char * g_cert_dek;    /* Public key certificate to encrypt dek*/
 extern uint32_t g_reuse_dek;         /* Set if DEK is provided */
-extern tgt_t g_target;               /* Global to hold target                */
-extern uint8_t g_ahab_version;       /* Global to hold ahab version          */
-extern ahab_data_t g_ahab_data;      /* Global to hold AHAB data             */
-extern func_mode_t g_mode;           /* Global to hold functional mode       */
-
+extern uint32_t g_in_place;          /* Set if AHAB output is patched        */
+extern uint32_t g_sign_requests;     /* Max signatures requested at once     */
 extern bool g_verbose;               /* Option to print verbose info         */
 
 /*===========================================================================
                               GLOBAL FUNCTIONS
 =============================================================================*/
 
+/* Allocates a context for processing a CSF */
+extern cst_context_t *cst_context_new(void);
+/* Frees a context and the commands list it holds */
+extern void cst_context_free(cst_context_t *ctx);
+/* Parses and processes the CSF text read from fi */
+extern int32_t cst_process_csf(cst_context_t *ctx, FILE *fi,
+                               char *out_bin_csf);
+/* Selects the backend generating the signatures, for the whole process */
+extern int32_t set_backend(const char *backend);
+
+#if defined _WIN32 || defined __CYGWIN__
+/* Reads a line from fp, the C library lacks it */
+extern int getline(char **lineptr, size_t *n, FILE *fp);
+#endif
+
 /* Set the value of label in str */
-extern int32_t set_label(keyword_t *keyword);
+extern int32_t set_label(cst_context_t *ctx, keyword_t *keyword);
 /* Sets the id in the given argument */
-extern int32_t set_argument_type(argument_t *arg);
+extern int32_t set_argument_type(cst_context_t *ctx, argument_t *arg);
 /* Reads cert/sig file and saves data ptr in cmd->cert_sig_data */
-extern int32_t save_file_data(command_t *cmd, char *file, uint8_t *data,
+extern int32_t save_file_data(cst_context_t *ctx, command_t *cmd,
+        char *file, uint8_t *data,
         size_t len, int32_t add_header, uint8_t **crt_hash, size_t *hash_len,
         int32_t hash_alg);
 
@@ -413,13 +478,34 @@ extern int32_t save_file_data(command_t *cmd, char *file, uint8_t *data,
 extern int32_t append_uid_to_buffer(number_t *uid, uint8_t *buf,
                                     int32_t *bytes_written);
 
-/* Creates signature data file for the given data */
-extern int32_t create_sig_file(char *file, char *cert_file,
-        sig_fmt_t sig_fmt, uint8_t *data,
+/* Creates signature data for the given data and saves it in cmd */
+extern int32_t create_sig_data(cst_context_t *ctx, command_t *cmd,
+        char *data_name,
+        char *cert_file, sig_fmt_t sig_fmt, const uint8_t *data,
         size_t data_size);
 
+/* Same as create_sig_data for a digest of the data, CAL_NOT_SUPPORTED if
+ * the backend needs the data itself */
+extern int32_t create_sig_data_digest(cst_context_t *ctx, command_t *cmd,
+        char *data_name, char *cert_file, sig_fmt_t sig_fmt,
+        const uint8_t *digest, size_t digest_size);
+
+/* Saves the signature gen_sig_data_digest returned sig_ret for in cmd */
+extern int32_t save_sig_data(cst_context_t *ctx, command_t *cmd,
+        char *data_name, char *cert_file, int32_t sig_ret, uint8_t *sig,
+        size_t sig_size);
+
+/* Signs the queued Authenticate Data commands */
+extern int32_t sign_authenticate_data(cst_context_t *ctx);
+
+/* Drops the queued Authenticate Data commands */
+extern void free_authenticate_data(cst_context_t *ctx);
+
+/* Closes the files holding the blocks of the CSF */
+extern void free_block_files(cst_context_t *ctx);
+
 /* Called by parser on each command */
-extern int32_t handle_command(command_t *cmd);
+extern int32_t handle_command(cst_context_t *ctx, command_t *cmd);
 
 /* Converts hash alg to string name */
 extern char* hab_hash_alg_to_digest_name(int32_t hash_alg);
@@ -432,28 +518,26 @@ extern int32_t get_hab4_engine_config(const int32_t engine,
                                       const eng_cfg_t eng_cfg);
 
 /* AHAB signature handler function */
-extern int32_t handle_ahab_signature(void);
+extern int32_t handle_ahab_signature(cst_context_t *ctx);
 
 /* Individual CSF command handler functions */
-extern int32_t cmd_handler_header(command_t* cmd);
-extern int32_t cmd_handler_installsrk(command_t *cmd);
-extern int32_t cmd_handler_installcsfk(command_t *cmd);
-extern int32_t cmd_handler_installnocak(command_t *cmd);
-extern int32_t cmd_handler_authenticatecsf(command_t *cmd);
-extern int32_t cmd_handler_installkey(command_t *cmd);
-extern int32_t cmd_handler_authenticatedata(command_t *cmd);
-extern int32_t cmd_handler_installsecretkey(command_t *cmd);
-extern int32_t cmd_handler_decryptdata(command_t *cmd);
-extern int32_t cmd_handler_nop(command_t *cmd);
-extern int32_t cmd_handler_setengine(command_t *cmd);
-extern int32_t cmd_handler_init(command_t *cmd);
-extern int32_t cmd_handler_unlock(command_t *cmd);
-extern int32_t cmd_handler_installcrt(command_t *cmd);
-extern int32_t csf(char * output_binary_csf);
-
-extern int yylex(void);
-
-extern void log_error_msg(char* error_msg);
-extern void log_arg_cmd(arguments_t arg, char *msg, commands_t cmd);
-extern void log_cmd(commands_t cmd, char *msg);
+extern int32_t cmd_handler_header(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_installsrk(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_installcsfk(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_installnocak(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_authenticatecsf(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_installkey(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_authenticatedata(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_installsecretkey(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_decryptdata(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_nop(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_setengine(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_init(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_unlock(cst_context_t *ctx, command_t *cmd);
+extern int32_t cmd_handler_installcrt(cst_context_t *ctx, command_t *cmd);
+
+extern void log_error_msg(cst_context_t *ctx, char* error_msg);
+extern void log_arg_cmd(cst_context_t *ctx, arguments_t arg, char *msg,
+                        commands_t cmd);
+extern void log_cmd(cst_context_t *ctx, commands_t cmd, char *msg);
 #endif // __CSF_H
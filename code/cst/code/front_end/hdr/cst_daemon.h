@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CST_DAEMON_H
+#define CST_DAEMON_H
+/*===========================================================================*/
+/**
+    @file    cst_daemon.h
+
+    @brief   Persistent signing service. A long running cst process accepts
+             CSF jobs over a local UNIX socket, so OpenSSL initialization
+             and the parsed keys and certificates are shared by every job
+             instead of being rebuilt by each cst invocation. The same
+             job processing serves the batch manifest mode.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                            INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdint.h>
+#include "csf.h"
+
+/*===========================================================================
+                              CONSTANTS
+=============================================================================*/
+/** Max bytes of the CSF text accepted in a single job */
+#define CST_DAEMON_MAX_CSF_BYTES    (1024 * 1024)
+
+/** Max bytes of the client working directory path */
+#define CST_DAEMON_MAX_PATH_BYTES   (4096)
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/** Job handler
+ *
+ * Processes the CSF text read from @a csf in the context @a ctx created
+ * for the job, and writes the resulting binary into @a out_file.
+ *
+ * @returns #SUCCESS or one of the error codes defined in csf.h
+ */
+typedef int32_t (*cst_job_handler_t)(cst_context_t *ctx, FILE *csf,
+                                     char *out_file);
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Run the signing daemon
+ *
+ * Listens on @a socket_path and processes the submitted jobs one after the
+ * other until the process is terminated. Every job gets a new context.
+ *
+ * Every request is made of the client working directory followed by the
+ * CSF text, each one prefixed by its length as a 32-bit big endian value.
+ * Files referenced by the CSF are resolved relative to the client working
+ * directory. The reply is the 32-bit big endian job status followed by the
+ * length prefixed output binary, empty if the job failed.
+ *
+ * A job calling error() is aborted and reported as #ERROR_JOB_ABORTED, the
+ * daemon keeps serving the next requests.
+ *
+ * @param[in] ctx         Context receiving the error details
+ *
+ * @param[in] socket_path Path of the UNIX socket to create
+ *
+ * @param[in] handler     Function processing each job
+ *
+ * @pre  @a ctx, @a socket_path and @a handler must not be NULL
+ *
+ * @returns only on error, with #ERROR_OPENING_FILE
+ */
+int32_t
+cst_daemon_serve(cst_context_t *ctx, const char *socket_path,
+                 cst_job_handler_t handler);
+
+/** Submit a job to a signing daemon
+ *
+ * Sends @a in_csf to the daemon listening on @a socket_path and writes the
+ * returned binary to @a out_file.
+ *
+ * @param[in] ctx         Context receiving the error details
+ *
+ * @param[in] socket_path Path of the daemon UNIX socket
+ *
+ * @param[in] in_csf      Input CSF text filename
+ *
+ * @param[in] out_file    Output binary filename
+ *
+ * @pre  @a ctx, @a socket_path, @a in_csf and @a out_file must not be NULL
+ *
+ * @returns #SUCCESS, the job status reported by the daemon, or one of
+ *          #ERROR_OPENING_FILE, #ERROR_READING_FILE, #ERROR_WRITING_FILE,
+ *          #ERROR_INSUFFICIENT_MEMORY on local failures
+ */
+int32_t
+cst_daemon_submit(cst_context_t *ctx, const char *socket_path,
+                  const char *in_csf, const char *out_file);
+
+/** Process the jobs listed in a batch manifest
+ *
+ * Every non blank manifest line holds an input CSF text filename and the
+ * output binary filename, separated by blanks. Lines starting with '#' are
+ * comments. Relative paths are resolved against the working directory.
+ *
+ * Up to @a workers jobs run concurrently, on threads of this process, each
+ * one taking the next job not yet started. Every job gets a new context,
+ * while the certificates and keys loaded by the backend are shared by all
+ * the jobs. With a single worker the jobs run one after the other.
+ *
+ * A job calling error() is aborted and reported as #ERROR_JOB_ABORTED, the
+ * next jobs are still processed.
+ *
+ * @param[in] ctx         Context receiving the error details
+ *
+ * @param[in] manifest    Manifest filename
+ *
+ * @param[in] workers     Max jobs run concurrently, capped to
+ *                        #THREAD_POOL_MAX_THREADS
+ *
+ * @param[in] handler     Function processing each job
+ *
+ * @pre  @a ctx, @a manifest and @a handler must not be NULL
+ *
+ * @returns #SUCCESS if every job succeeded, #ERROR_BATCH_JOB_FAILED if
+ *          any did not, or one of #ERROR_OPENING_FILE,
+ *          #ERROR_INVALID_ARGUMENT, #ERROR_INSUFFICIENT_MEMORY if the
+ *          manifest could not be processed
+ */
+int32_t
+cst_daemon_batch(cst_context_t *ctx, const char *manifest, uint32_t workers,
+                 cst_job_handler_t handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CST_DAEMON_H */
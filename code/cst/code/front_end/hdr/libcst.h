@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef LIBCST_H
+#define LIBCST_H
+/*===========================================================================*/
+/**
+    @file    libcst.h
+
+    @brief   Code signing library interface. Signs a CSF description in
+             process and returns the signed binary CSF, or the signed AHAB
+             container, in memory. Errors are reported through return codes,
+             the library never exits the calling process.
+
+             The library is single-threaded: its functions must be called
+             from one thread at a time.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                            INCLUDE FILES
+=============================================================================*/
+#include <stddef.h>
+#include <stdint.h>
+
+/*===========================================================================
+                              CONSTANTS
+=============================================================================*/
+/** Returned by every library function on success. Errors are reported with
+ *  the negative error codes listed in csf.h.
+ */
+#define CST_LIB_SUCCESS             (0)
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/** Input buffer
+ *
+ * Stands for the file the CSF references with @a name, either as the
+ * File argument of a command or as the file of an Authenticate Data block.
+ * Certificates and keys are still read from their files, as the private
+ * key of a certificate is located from the certificate filename.
+ */
+typedef struct cst_lib_input {
+    const char    *name;            /**< Filename as written in the CSF     */
+    const uint8_t *data;            /**< Content standing for the file      */
+    size_t        size;             /**< Bytes in @a data                   */
+} cst_lib_input_t;
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Initialize the library
+ *
+ * Must be called once, before any other library function. The backend is
+ * selected for the whole process.
+ *
+ * @param[in] backend Signing backend, "ssl" or "pkcs11", NULL for "ssl"
+ *
+ * @returns #CST_LIB_SUCCESS, or a negative error code if @a backend is not
+ *          supported
+ */
+int32_t
+cst_lib_init(const char *backend);
+
+/** Sign a CSF
+ *
+ * Processes the CSF text in @a csf like cst does with its --input file.
+ * Files the CSF references with the name of one of @a inputs are read from
+ * that input instead.
+ *
+ * For HAB targets @a output receives the binary CSF, for AHAB targets the
+ * signed image, as cst would write into its --output file.
+ *
+ * Calls must be serialized by the caller, even for unrelated CSFs: the
+ * scratch files holding the inputs and the output, the backend selected by
+ * cst_lib_init() and the signing options are shared by the whole process.
+ *
+ * @param[in]  csf           CSF text, not necessarily NUL terminated
+ *
+ * @param[in]  csf_bytes     Bytes in @a csf
+ *
+ * @param[in]  inputs        Buffers standing for files, may be NULL if
+ *                           @a input_count is 0
+ *
+ * @param[in]  input_count   Number of @a inputs
+ *
+ * @param[out] output        Allocated output, to be freed with
+ *                           cst_lib_free()
+ *
+ * @param[out] output_bytes  Bytes in @a output
+ *
+ * @param[out] err_msg       Details of the error, such as the offending
+ *                           file or command, may be NULL
+ *
+ * @param[in]  err_msg_bytes Size of @a err_msg
+ *
+ * @pre  @a csf, @a output and @a output_bytes must not be NULL
+ *
+ * @post @a output is NULL on error
+ *
+ * @returns #CST_LIB_SUCCESS, or a negative error code
+ */
+int32_t
+cst_lib_sign(const char *csf, size_t csf_bytes,
+             const cst_lib_input_t *inputs, size_t input_count,
+             uint8_t **output, size_t *output_bytes,
+             char *err_msg, size_t err_msg_bytes);
+
+/** Free an output returned by cst_lib_sign()
+ *
+ * @param[in] output Output to free, may be NULL
+ */
+void
+cst_lib_free(uint8_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCST_H */
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef SIG_CACHE_H
+#define SIG_CACHE_H
+/*===========================================================================*/
+/**
+    @file    sig_cache.h
+
+    @brief   On-disk cache of the generated signatures, keyed by the digest
+             of the signed payload, the fingerprint of the signer
+             certificate, the hash algorithm and the signature format.
+             Payloads unchanged since a previous run get their signature
+             back without calling the backend, which matters most when
+             the key lives in an HSM.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                            INCLUDE FILES
+=============================================================================*/
+#include <stdint.h>
+#include <stddef.h>
+#include "adapt_layer.h"
+
+/*===========================================================================
+                              CONSTANTS
+=============================================================================*/
+/** Extension of the cache entries */
+#define SIG_CACHE_EXT               ".sig"
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Enable the signature cache
+ *
+ * The cache is disabled unless this is called. Entries are never
+ * checked against the certificate when read back: the directory must be
+ * trusted as much as the keys themselves.
+ *
+ * @param[in] dir Existing directory holding the entries, NULL to disable
+ *                the cache
+ *
+ * @retval #SUCCESS the cache is enabled or disabled
+ *
+ * @retval #ERROR_INVALID_ARGUMENT @a dir is not a directory
+ */
+int32_t
+sig_cache_set_dir(const char *dir);
+
+/** Generate the signature of a buffer through the cache
+ *
+ * Same as gen_sig_data_buffer(). The signature is taken from the cache if
+ * it holds one for the payload, else generated by the backend and saved
+ * in the cache. HSM mode signature requests are never cached.
+ *
+ * May be called from several threads at once.
+ */
+int32_t
+sig_cache_gen_sig_data_buffer(const uint8_t *data, size_t data_bytes,
+                              const char *data_name, const char *cert_file,
+                              hash_alg_t hash_alg, sig_fmt_t sig_fmt,
+                              uint8_t *sig_buf, size_t *sig_buf_bytes,
+                              func_mode_t mode);
+
+/** Generate the signature of a digest through the cache
+ *
+ * Same as gen_sig_data_digest(), for a digest computed with @a hash_alg.
+ * Shares the entries of sig_cache_gen_sig_data_buffer(), so a payload
+ * signed from its data is found again from its digest and conversely.
+ *
+ * May be called from several threads at once.
+ */
+int32_t
+sig_cache_gen_sig_data_digest(const uint8_t *digest, size_t digest_bytes,
+                              const char *cert_file, hash_alg_t hash_alg,
+                              sig_fmt_t sig_fmt, uint8_t *sig_buf,
+                              size_t *sig_buf_bytes, func_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIG_CACHE_H */
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+/*===========================================================================*/
+/**
+    @file    thread_pool.h
+
+    @brief   Runs independent tasks on a pool of threads sized after the
+             number of online processors.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                            INCLUDE FILES
+=============================================================================*/
+#include <stddef.h>
+
+/*===========================================================================
+                              CONSTANTS
+=============================================================================*/
+/** Max threads running the tasks, the calling thread included */
+#define THREAD_POOL_MAX_THREADS     (64)
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/** Task
+ *
+ * Processes the item @a index of the work described by @a arg. Tasks run
+ * concurrently: they must only update the state of their own item, and
+ * must report errors through it rather than calling error().
+ */
+typedef void (*thread_pool_task_t)(void *arg, size_t index);
+
+/*===========================================================================
+                         FUNCTION PROTOTYPES
+=============================================================================*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Run tasks concurrently
+ *
+ * Calls @a task for every index from 0 to @a count - 1, each index once,
+ * on up to one thread per processor the process may run on, so that
+ * taskset -c 0 runs them one after the other. The calling thread runs
+ * tasks too, and is the only one if threads cannot be created.
+ *
+ * @param[in] count Number of tasks
+ *
+ * @param[in] task  Function processing each task
+ *
+ * @param[in] arg   Argument passed to every @a task call
+ *
+ * @pre  @a task must not be NULL
+ *
+ * @post Every task is done
+ */
+void
+thread_pool_run(size_t count, thread_pool_task_t task, void *arg);
+
+/** Run tasks concurrently on a given number of threads
+ *
+ * Same as thread_pool_run(), on up to @a threads threads whatever the
+ * number of processors. Meant for tasks spending most of their time
+ * waiting, such as on a remote signing device.
+ *
+ * @param[in] count   Number of tasks
+ *
+ * @param[in] threads Max threads running the tasks, the calling thread
+ *                    included, capped to #THREAD_POOL_MAX_THREADS
+ *
+ * @param[in] task    Function processing each task
+ *
+ * @param[in] arg     Argument passed to every @a task call
+ *
+ * @pre  @a task must not be NULL
+ *
+ * @post Every task is done
+ */
+void
+thread_pool_run_threads(size_t count, size_t threads, thread_pool_task_t task,
+                        void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREAD_POOL_H */
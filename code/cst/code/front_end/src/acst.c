@@ -42,16 +42,27 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 =============================================================================*/
 #include <string.h>
 #include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <openssl/x509v3.h>
 #include "err.h"
 #include "srk_helper.h"
 #include "misc_helper.h"
+#include "thread_pool.h"
+#include "sig_cache.h"
 
 /*===========================================================================
                                LOCAL CONSTANTS
 =============================================================================*/
-#define MAX_ERR_MSG_BYTES (1024)
 #define FILE_EXT_BIN      ".bin"
+#define COPY_BLOCK_BYTES  (1024 * 1024)
 
 /*===========================================================================
                                  LOCAL MACROS
@@ -61,11 +72,37 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                   LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 =============================================================================*/
+/* Image of a container to encrypt */
+typedef struct image_job {
+    struct ahab_container_image_s *image; /**< Image header               */
+    uint8_t    index;                   /**< Image index in the container */
+    long       offset;                  /**< Image offset in the source   */
+    uint8_t    *data;                   /**< Encrypted image              */
+    uint8_t    iv[SHA256_DIGEST_LENGTH]; /**< Digest holding the IV       */
+    uint8_t    hash[SHA512_DIGEST_LENGTH]; /**< Digest of encrypted image */
+    size_t     hash_size;               /**< Bytes in hash                */
+    const char *err;                    /**< Error message, NULL if none  */
+} image_job_t;
+
+/* Output file patched in place */
+#ifdef _WIN32
+typedef FILE *output_t;
+#else
+typedef int output_t;
+#endif
+
+/* Images encrypted by the thread pool */
+typedef struct image_set {
+    const char  *source;                /**< Source file of the images    */
+    dek_t       *dek;                   /**< DEK shared by the images     */
+    const char  *key;                   /**< DEK file                     */
+    uint8_t     key_length;             /**< DEK bytes                    */
+    image_job_t *jobs;                  /**< Images to encrypt            */
+} image_set_t;
 
 /*===========================================================================
                             LOCAL VARIABLES
 =============================================================================*/
-static char err_msg[MAX_ERR_MSG_BYTES];
 
 /*===========================================================================
                             LOCAL FUNCTION PROTOTYPES
@@ -140,6 +177,8 @@ convert_byte_str_to_file(byte_str_t *data, const char *filename);
  *
  * Generates a signature over the input data
  *
+ * @param[in]  ctx  Context of the CSF being processed
+ *
  * @param[in]  data Input byte string to be signed
  *
  * @param[in]  key  Certificate used to sign
@@ -153,34 +192,124 @@ convert_byte_str_to_file(byte_str_t *data, const char *filename);
  * @post none
  */
 static void
-generate_signature(byte_str_t *data,
+generate_signature(cst_context_t *ctx,
+                   byte_str_t *data,
                    const char *data_filename_prefix,
                    const char *key,
                    hash_alg_t hash,
                    byte_str_t *sign,
                    const char *sign_filename);
 
+/** Copy a file
+ *
+ * Copies the whole content of @a src at the start of @a dst, in the
+ * kernel when possible, otherwise by large blocks.
+ *
+ * @param[in]  src      Opened source file
+ *
+ * @param[in]  dst      Opened destination file
+ *
+ * @param[in]  dst_name Destination filename, for error messages
+ *
+ * @pre @a src, @a dst and @a dst_name must not be NULL
+ *
+ * @post none
+ */
+static void
+copy_file(FILE *src, FILE *dst, const char *dst_name);
+
+/** Write data at an offset
+ *
+ * Overwrites the bytes of @a out at @a offset with @a data
+ *
+ * @param[in]  out      Opened output file
+ *
+ * @param[in]  offset   Where to write @a data
+ *
+ * @param[in]  data     Bytes to write
+ *
+ * @param[in]  bytes    Size of @a data
+ *
+ * @param[in]  filename Name of @a out, for error messages
+ *
+ * @pre @a data and @a filename must not be NULL
+ *
+ * @post none
+ */
+static void
+write_at(output_t out, long offset, const uint8_t *data, size_t bytes,
+         const char *filename);
+
+/** Patch a file
+ *
+ * Overwrites the bytes of @a filename holding the container and the
+ * encrypted images, leaving the other bytes untouched.
+ *
+ * @param[in]  filename    File to patch
+ *
+ * @param[in]  data        Signed container
+ *
+ * @param[in]  offsets     Where to find the container in the file
+ *
+ * @param[in]  images      Encrypted images
+ *
+ * @param[in]  image_count Number of @a images
+ *
+ * @pre @a filename, @a data and @a offsets must not be NULL
+ *
+ * @post none
+ */
+static void
+patch_file(const char  *filename,
+           byte_str_t  *data,
+           offsets_t   *offsets,
+           image_job_t *images,
+           uint8_t     image_count);
+
 /** Generate the final output
  *
- * Generates the ouput file expected by the user
+ * Generates the ouput file expected by the user: a copy of the source
+ * file with the signed container and the encrypted images written at
+ * their offsets. The destination is only patched when it is the source
+ * file or when --in-place is given.
+ *
+ * @param[in]  src         Unsigned source file
  *
- * @param[in]  src     Unsigned source file
+ * @param[in]  data        Signed container
  *
- * @param[in]  data    Signed container
+ * @param[in]  offsets     Where to find the container in the source file
  *
- * @param[in]  offsets Where to find the container in the source file
+ * @param[in]  images      Encrypted images
  *
- * @param[in]  dst     Signed destination file
+ * @param[in]  image_count Number of @a images
  *
- * @pre @a src, @a data and @a offsets must not be NULL
+ * @param[in]  dst         Signed destination file
+ *
+ * @pre @a src, @a data, @a offsets and @a dst must not be NULL
  *
  * @post Program exits with exit code 0 on success.
  */
 static void
-generate_output(FILE       *dst_tmp,
-                byte_str_t *data,
-                offsets_t  *offsets,
-                const char *dst);
+generate_output(const char  *src,
+                byte_str_t  *data,
+                offsets_t   *offsets,
+                image_job_t *images,
+                uint8_t     image_count,
+                const char  *dst);
+
+/** Encrypt an image
+ *
+ * Reads an image from the source file, encrypts it and hashes the result.
+ * Runs on the thread pool, so errors are reported in the image job.
+ *
+ * @param[in] arg   #image_set_t holding the image
+ *
+ * @param[in] index Index of the image job in the set
+ *
+ * @post the job holds the encrypted image or an error message
+ */
+static void
+encrypt_image(void *arg, size_t index);
 
 /*===========================================================================
                             LOCAL FUNCTIONS
@@ -241,8 +370,7 @@ size_t get_signature_size(const char *filename)
     cert = read_certificate(filename);
     if (NULL == cert)
     {
-        snprintf(err_msg, MAX_ERR_MSG_BYTES, "Unable to read %s", filename);
-        error(err_msg);
+        error("Unable to read %s", filename);
     }
 
     /* Extract public key information */
@@ -250,11 +378,7 @@ size_t get_signature_size(const char *filename)
     if (NULL == pkey)
     {
         X509_free(cert);
-        snprintf(err_msg,
-                 MAX_ERR_MSG_BYTES,
-                 "Unable to retrieve the public key from %s",
-                 filename);
-        error(err_msg);
+        error("Unable to retrieve the public key from %s", filename);
     }
 
     /* Compute the size of the signature generated by using this key pair */
@@ -300,11 +424,7 @@ void convert_to_nxp_format(const char *filename,
     cert = read_certificate(filename);
     if (NULL == cert)
     {
-        snprintf(err_msg,
-                    MAX_ERR_MSG_BYTES,
-                    "Unable to read %s",
-                    filename);
-        error(err_msg);
+        error("Unable to read %s", filename);
     }
 
     /* Get the public key  */
@@ -385,21 +505,13 @@ void convert_byte_str_to_file(byte_str_t *data, const char *filename)
     /* Open the destination file */
     if ((file = fopen(filename, "wb")) == NULL)
     {
-        snprintf(err_msg,
-                 MAX_ERR_MSG_BYTES,
-                 "Unable to create binary file %s",
-                 filename);
-        error(err_msg);
+        error("Unable to create binary file %s", filename);
     }
 
     /* Write the data */
     if (data->entry_bytes != fwrite(data->entry, 1, data->entry_bytes, file))
     {
-        snprintf(err_msg,
-                 MAX_ERR_MSG_BYTES,
-                 "Unable to write to binary file %s",
-                 filename);
-        error(err_msg);
+        error("Unable to write to binary file %s", filename);
     }
 
     fclose (file);
@@ -408,7 +520,8 @@ void convert_byte_str_to_file(byte_str_t *data, const char *filename)
 /*--------------------------
   generate_signature
 ---------------------------*/
-void generate_signature(byte_str_t *data,
+void generate_signature(cst_context_t *ctx,
+                        byte_str_t *data,
                         const char *data_filename_prefix,
                         const char *key,
                         hash_alg_t hash,
@@ -433,8 +546,7 @@ void generate_signature(byte_str_t *data,
     skey = read_certificate(key);
     if (NULL == skey)
     {
-        snprintf(err_msg, MAX_ERR_MSG_BYTES, "Unable to read %s", key);
-        error(err_msg);
+        error("Unable to read %s", key);
     }
 
     /* Get the public key  */
@@ -442,11 +554,7 @@ void generate_signature(byte_str_t *data,
     if (NULL == pkey)
     {
         X509_free(skey);
-        snprintf(err_msg,
-                 MAX_ERR_MSG_BYTES,
-                 "Unable to retrieve the public key from %s",
-                 key);
-        error(err_msg);
+        error("Unable to retrieve the public key from %s", key);
     }
 
     /* Build the signature struct */
@@ -524,19 +632,25 @@ void generate_signature(byte_str_t *data,
            FILE_EXT_BIN,
            sizeof(FILE_EXT_BIN));
 
-    /* Create a tmp file for the signing process */
-    convert_byte_str_to_file(data, data_filename);
+    /* The data file is only needed when exported to the HSM or when
+     * checking a provided signature */
+    if ((MODE_HSM == ctx->mode) || (NULL != sig_filename))
+    {
+        convert_byte_str_to_file(data, data_filename);
+    }
 
     if (NULL == sig_filename)
     {
         /* Generate the signature */
-        if (SUCCESS != gen_sig_data(data_filename,
-                                    key,
-                                    hash,
-                                    sig_fmt,
-                                    sig->entry + sig_hdr_bytes,
-                                    &sig_bytes,
-                                    g_mode))
+        if (SUCCESS != sig_cache_gen_sig_data_buffer(data->entry,
+                                                     data->entry_bytes,
+                                                     data_filename,
+                                                     key,
+                                                     hash,
+                                                     sig_fmt,
+                                                     sig->entry + sig_hdr_bytes,
+                                                     &sig_bytes,
+                                                     ctx->mode))
         {
             error("Unable to generate the signature");
         }
@@ -547,9 +661,7 @@ void generate_signature(byte_str_t *data,
 
         if (sig_bytes != sig_data.entry_bytes)
         {
-            snprintf(err_msg, MAX_ERR_MSG_BYTES,
-                     "The length of the signature file %s is not valid", sig_filename);
-            error(err_msg);
+            error("The length of the signature file %s is not valid", sig_filename);
         }
 
         if (CAL_SUCCESS != ver_sig_data(data_filename,
@@ -559,9 +671,7 @@ void generate_signature(byte_str_t *data,
                                         sig_data.entry,
                                         sig_data.entry_bytes))
         {
-            snprintf(err_msg, MAX_ERR_MSG_BYTES,
-                     "The signature file %s is not valid", sig_filename);
-            error(err_msg);
+            error("The signature file %s is not valid", sig_filename);
         }
 
         memcpy(sig->entry + sig_hdr_bytes, sig_data.entry, sig_data.entry_bytes);
@@ -569,15 +679,16 @@ void generate_signature(byte_str_t *data,
         free(sig_data.entry);
     }
 
-    if (MODE_HSM != g_mode)
+    if ((MODE_HSM != ctx->mode) && (NULL != sig_filename))
     {
         if (0 != remove(data_filename))
         {
-            snprintf(err_msg, MAX_ERR_MSG_BYTES, "Unable to delete %s", data_filename);
-            error(err_msg);
+            error("Unable to delete %s", data_filename);
         }
     }
 
+    free(data_filename);
+
     if (sig->entry_bytes != (sig_hdr_bytes + sig_bytes))
     {
         error("Unexpected signature length");
@@ -585,246 +696,326 @@ void generate_signature(byte_str_t *data,
 }
 
 /*--------------------------
-  generate_output
+  copy_file
 ---------------------------*/
-void generate_output(FILE        *dst_tmp,
-                     byte_str_t  *data,
-                     offsets_t   *offsets,
-                     const char  *dst)
+void copy_file(FILE *src, FILE *dst, const char *dst_name)
 {
-    FILE     *file_dst = NULL;
-    char     chr;
-    uint32_t count, read_size;
-
-    /* Create destination file */
-    if ((file_dst = fopen(dst, "wb")) == NULL)
-    {
-        snprintf(err_msg,
-                 MAX_ERR_MSG_BYTES,
-                 "Unable to create binary file %s",
-                 dst);
-        error(err_msg);
+    uint8_t *block = NULL;
+    size_t  bytes  = 0;
+
+#ifdef __linux__
+    struct stat info;
+    off_t       offset = 0;
+    ssize_t     sent   = 0;
+
+    /* Let the kernel copy the data, whatever it cannot is copied below */
+    if (0 == fstat(fileno(src), &info)) {
+        while (offset < info.st_size) {
+            sent = sendfile(fileno(dst), fileno(src), &offset,
+                            info.st_size - offset);
+            if (sent <= 0) {
+                break;
+            }
+        }
+    }
+    if (0 != fseek(src, offset, SEEK_SET) || 0 != fseek(dst, offset, SEEK_SET)) {
+        error("Unable to write to binary file %s", dst_name);
     }
+#endif
 
-    /* Fill destination file with source data until first offset */
-    fseek(dst_tmp, 0, SEEK_SET);
-    count = 0;
-    while (offsets->first != count)
-    {
-        if (1 != fread(&chr, 1, 1, dst_tmp))
-        {
-            snprintf(err_msg, MAX_ERR_MSG_BYTES, "Unexpected read termination");
-            error(err_msg);
-        }
+    block = malloc(COPY_BLOCK_BYTES);
+    if (NULL == block) {
+        error("Cannot allocate memory for copying the source file");
+    }
 
-        if (1 != fwrite(&chr, 1, 1, file_dst))
-        {
-            snprintf(err_msg,
-                    MAX_ERR_MSG_BYTES,
-                    "Unable to write to binary file %s",
-                    dst);
-            error(err_msg);
+    while (0 != (bytes = fread(block, 1, COPY_BLOCK_BYTES, src))) {
+        if (bytes != fwrite(block, 1, bytes, dst)) {
+            error("Unable to write to binary file %s", dst_name);
         }
-
-        count++;
     }
 
-    /* Fill destination file with input data */
-    if (data->entry_bytes != fwrite(data->entry, 1, data->entry_bytes, file_dst))
-    {
-        snprintf(err_msg,
-                 MAX_ERR_MSG_BYTES,
-                 "Unable to write to binary file %s",
-                 dst);
-        error(err_msg);
+    if (ferror(src)) {
+        error("Unexpected read termination");
     }
 
-    /* Fill destination file with remaining source data */
-    fseek(dst_tmp, data->entry_bytes, SEEK_CUR);
-    do
-    {
-        read_size = fread(&chr, 1, 1, dst_tmp);
+    free(block);
+}
 
-        if (1 < read_size)
-        {
-            snprintf(err_msg, MAX_ERR_MSG_BYTES, "Unexpected read");
-            error(err_msg);
-        }
+/*--------------------------
+  write_at
+---------------------------*/
+void write_at(output_t out, long offset, const uint8_t *data, size_t bytes,
+              const char *filename)
+{
+#ifdef _WIN32
+    if (0 != fseek(out, offset, SEEK_SET)
+        || bytes != fwrite(data, 1, bytes, out)) {
+        error("Unable to write to binary file %s", filename);
+    }
+#else
+    ssize_t written;
 
-        if (read_size != fwrite(&chr, 1, read_size, file_dst))
-        {
-            snprintf(err_msg,
-                    MAX_ERR_MSG_BYTES,
-                    "Unable to write to binary file %s",
-                    dst);
-            error(err_msg);
+    while (bytes > 0) {
+        written = pwrite(out, data, bytes, offset);
+        if (written <= 0) {
+            error("Unable to write to binary file %s", filename);
         }
-    } while (0 != read_size);
-
-    fclose(dst_tmp);
-    fclose(file_dst);
-
-    printf("CSF Processed successfully and signed image available in %s\n", dst);
-    exit(0);
+        data   += written;
+        bytes  -= written;
+        offset += written;
+    }
+#endif
 }
 
 /*--------------------------
-  encrypt_images
+  patch_file
 ---------------------------*/
-void encrypt_images(ahab_data_t *ahab_data,
-                    byte_str_t *cont_hdr,
-                    const char *key,
-                    uint8_t key_length,
-                    FILE *destination)
+void patch_file(const char  *filename,
+                byte_str_t  *data,
+                offsets_t   *offsets,
+                image_job_t *images,
+                uint8_t     image_count)
 {
-    struct ahab_container_header_s *container_header
-        = (struct ahab_container_header_s *)cont_hdr->entry;
+#ifdef _WIN32
+    output_t out = fopen(filename, "r+b");
 
-    if (container_header->nrImages > AHAB_MAX_NR_IMAGES) {
-        error("Invalid number of images");
+    if (NULL == out) {
+        error("Unable to open binary file %s", filename);
     }
+#else
+    output_t out = open(filename, O_WRONLY);
 
-    if (!(((1U << container_header->nrImages) - 1) & ahab_data->image_indexes)) {
-        error("At least one image must be encrypted");
+    if (out < 0) {
+        error("Unable to open binary file %s", filename);
     }
+#endif
 
-    /** Encrypt the images **/
-
-    size_t digest_size;
+    for (uint8_t i = 0; i < image_count; i++) {
+        write_at(out, images[i].offset, images[i].data,
+                 images[i].image->image_size, filename);
+    }
 
-    struct ahab_container_image_s *image = get_ahab_image_array(container_header);
+    /* The container goes last, it may overlap the images */
+    write_at(out, offsets->first, data->entry, data->entry_bytes, filename);
 
-    for (uint8_t i = 0; i < container_header->nrImages; i++) {
+#ifdef _WIN32
+    if (0 != fclose(out)) {
+#else
+    if (0 != close(out)) {
+#endif
+        error("Unable to write to binary file %s", filename);
+    }
+}
 
-        if (0 == image->image_size || 0 == (ahab_data->image_indexes & (1U << i))) {
-            image++;
-            continue;
+/*--------------------------
+  generate_output
+---------------------------*/
+void generate_output(const char  *src,
+                     byte_str_t  *data,
+                     offsets_t   *offsets,
+                     image_job_t *images,
+                     uint8_t     image_count,
+                     const char  *dst)
+{
+    FILE        *file_src = NULL;
+    FILE        *file_dst = NULL;
+    struct stat src_info;
+    struct stat dst_info;
+    bool        same_file = (0 == strcmp(src, dst));
+
+    /* Writing the destination must not truncate the source it is read from */
+    if (!same_file && 0 == stat(src, &src_info) && 0 == stat(dst, &dst_info)) {
+        same_file = (0 != src_info.st_ino)
+                    && (src_info.st_dev == dst_info.st_dev)
+                    && (src_info.st_ino == dst_info.st_ino);
+
+        /* A destination patched in place must hold the source image */
+        if (g_in_place && !same_file && src_info.st_size != dst_info.st_size) {
+            error("The size of %s does not match the size of %s", dst, src);
         }
+    }
 
-        uint8_t hash_type = ahab_container_image_get_hash(image);
-        int32_t hash_size = ahab_get_hash_size_by_sha_type(hash_type);
-
-        if (hash_size < 0) {
-            error("Unsupported hash algorithm for image integrity");
+    if (!same_file && !g_in_place) {
+        if ((file_src = fopen(src, "rb")) == NULL) {
+            error("Cannot open %s", src);
         }
 
-        uint8_t *hash = malloc(hash_size);
-
-        if (NULL ==  hash) {
-            error("Cannot allocate memory for the hash value of the plaintext");
+        /* Create destination file */
+        if ((file_dst = fopen(dst, "wb")) == NULL) {
+            error("Unable to create binary file %s", dst);
         }
 
-        /* Retrieve image data */
+        /* Fill destination file with source data */
+        copy_file(file_src, file_dst, dst);
 
-        offsets_t offsets = {
-            .first  = ahab_data->offsets.first + image->image_offset,
-            .second = offsets.first + image->image_size
-        };
+        fclose(file_src);
+        if (0 != fclose(file_dst)) {
+            error("Unable to write to binary file %s", dst);
+        }
+    }
 
-        byte_str_t image_data;
+    /* Write the encrypted images and the signed container */
+    patch_file(dst, data, offsets, images, image_count);
 
-        read_file(ahab_data->source, &image_data, &offsets);
+    printf("CSF Processed successfully and signed image available in %s\n", dst);
+}
 
-        if (NULL == image_data.entry) {
-            error("Cannot allocate memory for the image index %d", i);
+/*--------------------------
+  encrypt_image
+---------------------------*/
+void encrypt_image(void *arg, size_t index)
+{
+    image_set_t *set = arg;
+    image_job_t *job = &set->jobs[index];
+    size_t      image_size = job->image->image_size;
+    uint8_t     hash_type  = ahab_container_image_get_hash(job->image);
+    uint8_t     *plaintext = NULL;
+    uint8_t     *digest    = NULL;
+    size_t      digest_size;
+    FILE        *source    = NULL;
+    size_t      iv_length  = 16; /* The IV size for AES-CBC is 128 bits */
+
+    do {
+        /* Retrieve image data */
+        plaintext = malloc(image_size);
+        job->data = malloc(image_size);
+        if (NULL == plaintext || NULL == job->data) {
+            job->err = "Cannot allocate memory for the image index %d";
+            break;
         }
 
-        /* Create a temporary file with the data to be enrypted */
-        FILE *plaintext = fopen(FILE_PLAIN_DATA, "wb");
-        if (NULL == plaintext) {
-            error("Cannot create temporary file for plaintext");
+        source = fopen(set->source, "rb");
+        if (NULL == source
+            || 0 != fseek(source, job->offset, SEEK_SET)
+            || image_size != fread(plaintext, 1, image_size, source)) {
+            job->err = "Cannot read the image index %d";
+            break;
         }
-        if (image_data.entry_bytes != fwrite(image_data.entry, 1, image_data.entry_bytes, plaintext)) {
-            error("Fail to update the plaintext temporary file");
+
+        /* The IV is the end of the plaintext digest */
+        digest = generate_hash(plaintext,
+                               image_size,
+                               get_digest_name(SHA_256),
+                               &digest_size);
+        if (NULL == digest || SHA256_DIGEST_LENGTH != digest_size) {
+            job->err = "Fail to generate IV of image index %d";
+            break;
         }
-        fclose(plaintext);
+        memcpy(job->iv, digest, SHA256_DIGEST_LENGTH);
+        free(digest);
 
         /* Encrypt image data */
+        if (CAL_SUCCESS != gen_auth_encrypted_buffer(
+                               set->dek,
+                               plaintext,
+                               image_size,
+                               job->data,
+                               AES_CBC,
+                               job->iv + SHA256_DIGEST_LENGTH - iv_length,
+                               iv_length,
+                               set->key_length,
+                               g_cert_dek,
+                               set->key,
+                               g_reuse_dek)) {
+            job->err = "Fail to generate encrypted data for image index %d";
+            break;
+        }
 
-        size_t iv_length = 16; /* The IV size for AES-CBC is 128 bits */
-        uint8_t *iv = malloc(SHA256_DIGEST_LENGTH);
-
-        if (NULL == iv) {
-            error("Cannot allocate memory for the IV");
+        digest = generate_hash(job->data,
+                               image_size,
+                               get_digest_name(ahab_hash_2_cst_hash(hash_type)),
+                               &digest_size);
+        if (NULL == digest || digest_size != job->hash_size) {
+            job->err = "Fail to generate hash of encrypted data of image index %d";
+            break;
         }
+        memcpy(job->hash, digest, job->hash_size);
+    } while (0);
 
-        iv = generate_hash(image_data.entry,
-                        image_data.entry_bytes,
-                        get_digest_name(SHA_256),
-                        &digest_size);
+    if (NULL != source) {
+        fclose(source);
+    }
+    free(digest);
+    free(plaintext);
+}
 
-        if (SHA256_DIGEST_LENGTH != digest_size) {
-            error("Fail to generate IV of image index %d", i);
-        }
+/*--------------------------
+  encrypt_images
+---------------------------*/
+void encrypt_images(dek_t *dek,
+                    ahab_data_t *ahab_data,
+                    byte_str_t *cont_hdr,
+                    const char *key,
+                    uint8_t key_length,
+                    image_job_t *jobs,
+                    uint8_t *job_count)
+{
+    struct ahab_container_header_s *container_header
+        = (struct ahab_container_header_s *)cont_hdr->entry;
+    image_set_t set = {ahab_data->source, dek, key, key_length, jobs};
 
-        int32_t err_value = gen_auth_encrypted_data(
-            FILE_PLAIN_DATA,
-            FILE_ENCRYPTED_DATA,
-            AES_CBC,
-            NULL,
-            0,
-            iv + SHA256_DIGEST_LENGTH - iv_length,
-            iv_length,
-            NULL,
-            0,
-            key_length,
-            g_cert_dek,
-            key,
-            g_reuse_dek);
-
-        if (0 != remove(FILE_PLAIN_DATA)) {
-            error("Cannot delete %s", FILE_PLAIN_DATA);
-        }
+    if (container_header->nrImages > AHAB_MAX_NR_IMAGES) {
+        error("Invalid number of images");
+    }
 
-        if (CAL_SUCCESS != err_value) {
-            error("Fail to generate encrypted data for image index %d", i);
-        }
+    if (!(((1U << container_header->nrImages) - 1) & ahab_data->image_indexes)) {
+        error("At least one image must be encrypted");
+    }
 
-        /* Replace image data by encrypted data */
+    /** Encrypt the images **/
 
-        byte_str_t enc_data;
+    struct ahab_container_image_s *image = get_ahab_image_array(container_header);
 
-        read_file(FILE_ENCRYPTED_DATA, &enc_data, NULL);
+    uint8_t count = 0;
 
-        if (NULL == enc_data.entry) {
-            error("Cannot allocate memory for the encrypted data of the image index %d", i);
-        }
+    memset(jobs, 0, AHAB_MAX_NR_IMAGES * sizeof(image_job_t));
 
-        if (0 != remove(FILE_ENCRYPTED_DATA)) {
-            error("Cannot delete %s", FILE_ENCRYPTED_DATA);
-        }
+    for (uint8_t i = 0; i < container_header->nrImages; i++) {
 
-        if (image->image_size != enc_data.entry_bytes) {
-            error("Unexpected size of encryted data of image index %d (%d)", i, enc_data.entry_bytes);
+        if (0 == image[i].image_size || 0 == (ahab_data->image_indexes & (1U << i))) {
+            continue;
         }
 
-        hash = generate_hash(enc_data.entry,
-                            enc_data.entry_bytes,
-                            get_digest_name(ahab_hash_2_cst_hash(hash_type)),
-                            &digest_size);
+        int32_t hash_size = ahab_get_hash_size_by_sha_type(
+                                ahab_container_image_get_hash(&image[i]));
 
-        if (digest_size != (size_t)hash_size) {
-            error("Fail to generate hash of encrypted data of image index %d", i);
+        if (hash_size < 0) {
+            error("Unsupported hash algorithm for image integrity");
         }
 
-        memcpy(image->iv, iv, SHA256_DIGEST_LENGTH);
-        memcpy(image->hash, hash, hash_size);
-        memset(image->hash + hash_size, 0, SHA512_DIGEST_LENGTH - hash_size);
-        image->flags |= IMAGE_FLAGS_ENCRYPTED;
+        jobs[count].image     = &image[i];
+        jobs[count].index     = i;
+        jobs[count].offset    = ahab_data->offsets.first + image[i].image_offset;
+        jobs[count].hash_size = hash_size;
+        count++;
+    }
+
+    /* The images are independent, they are encrypted concurrently */
+    thread_pool_run(count, encrypt_image, &set);
 
-        fseek(destination, offsets.first, SEEK_SET);
+    for (uint8_t k = 0; k < count; k++) {
 
-        if (enc_data.entry_bytes != fwrite(enc_data.entry, 1, enc_data.entry_bytes, destination)) {
-            error("Fail to replace image index %d with encrypted data", i);
+        if (NULL != jobs[k].err) {
+            for (uint8_t j = 0; j < count; j++) {
+                free(jobs[j].data);
+            }
+            error(jobs[k].err, jobs[k].index);
         }
+    }
+
+    /* Update the image headers, the encrypted data is written with the
+     * output */
+    for (uint8_t k = 0; k < count; k++) {
 
-        free(enc_data.entry);
-        free(image_data.entry);
-        free(hash);
-        free(iv);
+        image = jobs[k].image;
 
-        image++;
+        memcpy(image->iv, jobs[k].iv, SHA256_DIGEST_LENGTH);
+        memcpy(image->hash, jobs[k].hash, jobs[k].hash_size);
+        memset(image->hash + jobs[k].hash_size, 0, SHA512_DIGEST_LENGTH - jobs[k].hash_size);
+        image->flags |= IMAGE_FLAGS_ENCRYPTED;
     }
+
+    *job_count = count;
 }
 
 /*===========================================================================
@@ -834,9 +1025,9 @@ void encrypt_images(ahab_data_t *ahab_data,
 /*--------------------------
   convert_certificate
 ---------------------------*/
-int32_t handle_ahab_signature(void)
+int32_t handle_ahab_signature(cst_context_t *ctx)
 {
-    ahab_data_t *ahab_data = &g_ahab_data;
+    ahab_data_t *ahab_data = &ctx->ahab_data;
     byte_str_t  srk_table  = {NULL, 0};
     byte_str_t  cert       = {NULL, 0};
     byte_str_t  cert_sign  = {NULL, 0};
@@ -849,6 +1040,8 @@ int32_t handle_ahab_signature(void)
     byte_str_t  blob       = {NULL, 0};
     hash_alg_t  hash       = INVALID_DIGEST;
     const char  *sign_key  = NULL;
+    image_job_t images[AHAB_MAX_NR_IMAGES];
+    uint8_t     image_count = 0;
 
     /* Get SRK table */
     if (NULL == ahab_data->srk_table)
@@ -873,7 +1066,7 @@ int32_t handle_ahab_signature(void)
                               hash,
                               get_signature_size(ahab_data->srk_entry));
 
-        generate_signature(&cert,
+        generate_signature(ctx, &cert,
                            "certificate-",
                            ahab_data->srk_entry,
                            hash,
@@ -897,28 +1090,12 @@ int32_t handle_ahab_signature(void)
         error("Offsets are not consistent with the input binary to be signed");
     }
 
-    /* Copy source to temporary file */
-    FILE *source = fopen(ahab_data->source, "rb");
-    if (NULL == source ) {
-        error("Cannot open %s", ahab_data->source);
-    }
-    FILE *destination = tmpfile();
-    if (NULL == destination) {
-        error("Cannot create temporary file");
-    }
-
-    char byte;
-    while (0 != fread(&byte, 1, 1, source)) {
-        if (1 != fwrite(&byte, 1, 1, destination)) {
-            error("Fail to fill the temporary file");
-        }
-    }
-
     /* Handle a DEK if requested */
     if (NULL != ahab_data->dek)
     {
         /* Encrypt the images */
-        encrypt_images(ahab_data, &cont_hdr, ahab_data->dek, ahab_data->dek_length, destination);
+        encrypt_images(ctx->dek, ahab_data, &cont_hdr, ahab_data->dek,
+                       ahab_data->dek_length, images, &image_count);
 
         blob.entry_bytes = AHAB_BLOB_HEADER + CAAM_BLOB_OVERHEAD_NORMAL + ahab_data->dek_length;
         blob.entry = malloc(blob.entry_bytes);
@@ -1038,7 +1215,7 @@ int32_t handle_ahab_signature(void)
 
     free(sign_blk.entry);
 
-    generate_signature(&cont_unsig,
+    generate_signature(ctx, &cont_unsig,
                        "container-",
                        sign_key,
                        hash,
@@ -1052,12 +1229,18 @@ int32_t handle_ahab_signature(void)
     free(signature.entry);
 
     /* Generate the output file */
-    generate_output(destination,
+    generate_output(ahab_data->source,
                     &container,
                     &ahab_data->offsets,
+                    images,
+                    image_count,
                     ahab_data->destination);
 
     free(container.entry);
+    for (uint8_t i = 0; i < image_count; i++)
+    {
+        free(images[i].data);
+    }
 
     return SUCCESS;
 }
@@ -46,6 +46,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 #define HAB_FUTURE
 #include "hab_cmd.h"
 #include <openssl/bio.h>
@@ -54,8 +61,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <openssl/cms.h>
 #include <openssl/err.h>
 #include <openssl/pem.h>
+#include <openssl/evp.h>
 #include "openssl_helper.h"
 #include "csf.h"
+#include "thread_pool.h"
+#include "sig_cache.h"
 
 /*===========================================================================
                                 MACROS
@@ -63,34 +73,123 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define HAB4_AUT_DAT_CMD_SIG_OFFSET    (8) /**< Offset to signature data */
 #define BYTES_64KB               (0x10000) /**< Define for 64KB */
 #define BYTES_16MB             (0x1000000) /**< Define for 16MB */
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/** File holding blocks, opened once per CSF for all its blocks */
+struct block_file {
+    struct block_file *next;    /**< Next file of the CSF */
+    const char *filename;       /**< Filename given in the block lists */
+    size_t size;                /**< Bytes in the file when opened */
+    int writable;               /**< Set if opened for writing blocks back */
+#ifdef _WIN32
+    FILE *fh;                   /**< Blocks are read in chunks */
+#else
+    int fd;                     /**< Descriptor mapped on first read */
+    uint8_t *data;              /**< Mapped file content, NULL if not yet */
+    int data_writable;          /**< Set if data is a writable mapping */
+#endif
+};
+
+/** Files holding the blocks of a CSF, shared by the hashing threads */
+struct block_files {
+    pthread_mutex_t lock;       /**< Protects the mappings of the files, or
+                                     their stream positions on Windows */
+    block_file_t *head;         /**< Files, most recently opened first */
+};
+
+/** Authenticate Data command waiting for its signature */
+struct aut_dat_job {
+    struct aut_dat_job *next;   /**< Next command, in CSF order */
+    command_t *cmd;             /**< Command receiving the signature */
+    block_t *blocks;            /**< Blocks to sign */
+    size_t data_size;           /**< Total bytes of the blocks */
+    char *cert_file;            /**< Certificate of the signing key */
+    sig_fmt_t sig_fmt;          /**< Signature format */
+    int32_t ret_val;            /**< Status of the hashing or gathering */
+    const char *err_name;       /**< File the blocks failed to read from */
+    uint8_t digest[EVP_MAX_MD_SIZE]; /**< Digest of the blocks */
+    unsigned int digest_bytes;  /**< 0 unless the blocks were hashed */
+    int signed_ahead;           /**< Set if the pool generated the signature */
+    int32_t sig_ret;            /**< Status of the signature signed ahead */
+    uint8_t sig[SIGNATURE_BUFFER_SIZE]; /**< Signature signed ahead */
+    size_t sig_bytes;           /**< Bytes of sig */
+};
+
+/** Jobs hashed by the thread pool */
+typedef struct hash_set {
+    aut_dat_job_t **jobs;       /**< Jobs to hash */
+    const EVP_MD *md;           /**< Digest algorithm of the CSF */
+    int sign_data;              /**< Set to sign the blocks data instead */
+    hash_alg_t hash_alg;        /**< Hash algorithm, for the backend */
+    func_mode_t mode;           /**< Mode of the CSF, for the backend */
+    block_files_t *files;       /**< Files holding the blocks */
+} hash_set_t;
+
 /*===========================================================================
                           LOCAL FUNCTION DECLARATIONS
 =============================================================================*/
-static int32_t process_authenticatedata_arguments(command_t* cmd, block_t **block,
+static int32_t process_authenticatedata_arguments(cst_context_t *ctx,
+        command_t* cmd, block_t **block,
         int32_t *vfy_index, int32_t *engine, int32_t *engine_cfg,
         sig_fmt_t *sig_format, int32_t *hash_alg,
         size_t *mac_bytes, char** src, offsets_t *offsets, char** sign);
 
-static int32_t hab4_authenticate_data(sig_fmt_t sig_format, int32_t engine,
+static int32_t hab4_authenticate_data(cst_context_t *ctx,
+        sig_fmt_t sig_format, int32_t engine,
         int32_t engine_cfg, int32_t vfy_index, block_t *block, uint8_t *buf,
         int32_t *cmd_len, size_t* size_blocks);
 
-static int32_t validate_block_arguments(block_t *block_list, commands_t cmd_type);
+static int32_t validate_block_arguments(cst_context_t *ctx,
+        block_t *block_list, commands_t cmd_type);
 
-int32_t write_encrypted_data_to_blocks(const char* file, block_t * block);
-
-int32_t read_data_to_encrypt_from_blocks(const char* file, block_t * block);
+static int32_t encrypt_blocks(cst_context_t *ctx, block_t *block_list,
+        int32_t key_index, uint8_t *nonce, size_t nonce_bytes, uint8_t *mac,
+        size_t mac_bytes);
 
 static size_t length_field_bytes(size_t msg_bytes);
 
-static int32_t generate_and_save_aead_data(uint8_t * nonce,
+static int32_t open_block_file(cst_context_t *ctx, const char *filename,
+        int writable, block_file_t **file);
+
+static block_file_t *find_block_file(block_files_t *files,
+        const block_t *block);
+
+#ifndef _WIN32
+static uint8_t *map_block_file(block_files_t *files, block_file_t *file,
+        int writable);
+
+static void unmap_block_file(block_files_t *files, block_file_t *file);
+#endif
+
+static int32_t read_block(block_files_t *files, const block_t *block,
+        EVP_MD_CTX *md_ctx, uint8_t *buf, const char **err_name);
+
+static int32_t write_block(block_files_t *files, const block_t *block,
+        const uint8_t *buf, const char **err_name);
+
+static void hash_job(aut_dat_job_t *job, const EVP_MD *md,
+        block_files_t *files);
+
+static void hash_task(void *arg, size_t index);
+
+static int32_t gather_job(aut_dat_job_t *job, block_files_t *files,
+        const uint8_t **data, uint8_t **copy);
+
+static void sign_data_task(void *arg, size_t index);
+
+static void hash_jobs(cst_context_t *ctx, const EVP_MD *md);
+
+static int32_t sign_job(cst_context_t *ctx, aut_dat_job_t *job);
+
+static int32_t generate_and_save_aead_data(cst_context_t *ctx,
+                                    command_t *cmd,
+                                    uint8_t * nonce,
                                     size_t nonce_bytes,
                                     uint8_t * mac,
-                                    size_t mac_bytes,
-                                    const char * out_file);
+                                    size_t mac_bytes);
 
-int g_no_ca = 0;
-int32_t g_srk_set_hab4 = SRK_SET_OEM;
 /*===========================================================================
                           LOCAL FUNCTION DEFINITIONS
 =============================================================================*/
@@ -106,6 +205,8 @@ int32_t g_srk_set_hab4 = SRK_SET_OEM;
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the command is only used to get arguments list
  *
  * @param[out] block, returns block ptr of arg->value.block for arg BLOCKS
@@ -124,7 +225,8 @@ int32_t g_srk_set_hab4 = SRK_SET_OEM;
  *
  * @retval #SUCCESS  completed its task successfully
  */
-static int32_t process_authenticatedata_arguments(command_t* cmd,
+static int32_t process_authenticatedata_arguments(cst_context_t *ctx,
+        command_t* cmd,
         block_t **block, int32_t *vfy_index, int32_t *engine,
         int32_t *engine_cfg, sig_fmt_t *sig_format, int32_t *hash_alg,
         size_t *mac_bytes, char** src,
@@ -151,7 +253,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *block = arg->value.block;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -161,7 +263,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *vfy_index = arg->value.number->num_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -171,7 +273,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *engine = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -187,7 +289,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -197,7 +299,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *sig_format = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -207,7 +309,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *hash_alg = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -219,7 +321,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -229,7 +331,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *src = arg->value.keyword->string_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -243,7 +345,7 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -252,12 +354,12 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
                 *sign = arg->value.keyword->string_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
         default:
-            log_arg_cmd(arg->type, NULL, cmd->type);
+            log_arg_cmd(ctx, arg->type, NULL, cmd->type);
             return ERROR_UNSUPPORTED_ARGUMENT;
         };
 
@@ -272,10 +374,14 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
  *
  * @par Purpose
  *
- * Validate arguments for each block in the block list.
+ * Validate arguments for each block in the block list. The files holding
+ * the blocks are opened in the file table of the CSF, Decrypt Data files
+ * for writing.
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] block_list, pointer to block list
  *
  * @param[in] cmd_type, command type
@@ -284,33 +390,31 @@ static int32_t process_authenticatedata_arguments(command_t* cmd,
  *
  * @retval #ERROR_FILE_NOT_PRESENT file to get block data is not present
  *
+ * @retval #ERROR_OPENING_FILE file cannot be opened for writing
+ *
  * @retval #ERROR_INVALID_BLOCK_ARGUMENTS on any other check fails
  */
-int32_t validate_block_arguments(block_t *block_list, commands_t cmd_type)
+int32_t validate_block_arguments(cst_context_t *ctx,
+        block_t *block_list, commands_t cmd_type)
 {
     int32_t ret_val = SUCCESS;
     block_t *block = block_list;
+    block_file_t *file = NULL;
 
     while(block != NULL)
     {
-        FILE *fh = fopen(block->block_filename, "rb");
-        uint32_t file_size = 0;
-
-        if(fh == NULL)
+        /* Opened once for every block of the CSF, writable to encrypt */
+        ret_val = open_block_file(ctx, block->block_filename,
+                                  (cmd_type == CmdDecryptData), &file);
+        if(ret_val != SUCCESS)
         {
-            log_error_msg(block->block_filename);
-            ret_val = ERROR_FILE_NOT_PRESENT;
+            log_error_msg(ctx, block->block_filename);
             break;
         }
 
-        /* Get the size of the file */
-        fseek(fh, 0, SEEK_END);
-        file_size = ftell(fh);
-        fclose(fh);
-
-        if((block->start + block->length) > file_size)
+        if(((uint64_t)block->start + block->length) > (uint64_t)file->size)
         {
-            log_arg_cmd(Blocks, STR_BLKS_INVALID_LENGTH, cmd_type);
+            log_arg_cmd(ctx, Blocks, STR_BLKS_INVALID_LENGTH, cmd_type);
 
             ret_val = ERROR_INVALID_BLOCK_ARGUMENTS;
             break;
@@ -322,13 +426,13 @@ int32_t validate_block_arguments(block_t *block_list, commands_t cmd_type)
 }
 
 /**
- * Updates g_csf_buffer with authenticate csf command
+ * Updates ctx->csf_buffer with authenticate csf command
  *
  * @par Purpose
  *
  * Collects necessary arguments from csf file, validate the arguments, set
  * default values for arguments if missing from csf file.
- * Calls Macro AUT_CSF to update g_csf_buffer with authenticate csf command.
+ * Calls Macro AUT_CSF to update ctx->csf_buffer with authenticate csf command.
  *
  * @par Operation
  *
@@ -336,33 +440,33 @@ int32_t validate_block_arguments(block_t *block_list, commands_t cmd_type)
  *
  * @retval #SUCCESS  completed its task successfully
  *
- * @retval Errors returned by create_sig_file and save_file_data functions
+ * @retval Errors returned by create_sig_data and save_file_data functions
  */
-int32_t cmd_handler_authenticatecsf(command_t* cmd)
+int32_t cmd_handler_authenticatecsf(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;  /**< Used for return value */
     sig_fmt_t sig_format = SIG_FMT_UNDEF; /**< Holds sig format argument value */
     int32_t engine = -1;        /**< Holds engine argument value */
     int32_t engine_cfg = -1;    /**< Holds engine configuration arg value */
 
-    uint32_t csfk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
+    uint32_t csfk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
 
     /* The Authenticate CSF command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
     PRINT_V("Authenticate CSF\n");
 
     /* Adjust CSFK index if NOCAK */
-    if ( g_no_ca == 1 ) {
+    if ( ctx->no_ca == 1 ) {
         csfk_idx = HAB_IDX_CSFK;
     }
 
     /* get the arguments */
-    ret_val = process_authenticatedata_arguments(cmd, NULL,
+    ret_val = process_authenticatedata_arguments(ctx, cmd, NULL,
         NULL, &engine, &engine_cfg, &sig_format, NULL, NULL, NULL, NULL, NULL);
 
     if(ret_val != SUCCESS)
@@ -373,27 +477,27 @@ int32_t cmd_handler_authenticatecsf(command_t* cmd)
     /* generate authenticate csf command */
     do {
 
-        if(g_hab_version >= HAB4)
+        if(ctx->hab_version >= HAB4)
         {
             /* validate the arguments */
             if(engine == HAB_ENG_ANY && engine_cfg != 0)
             {
-                log_arg_cmd(EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
+                log_arg_cmd(ctx, EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             /* set the defaults if not provided */
             if(SIG_FMT_UNDEF == sig_format)
-                sig_format = g_sig_format;
+                sig_format = ctx->sig_format;
             else if (sig_format != SIG_FMT_CMS)
             {
-                log_arg_cmd(SignatureFormat, " different from CMS"STR_ILLEGAL, cmd->type);
+                log_arg_cmd(ctx, SignatureFormat, " different from CMS"STR_ILLEGAL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             if(engine == -1)
-                engine = g_engine;
+                engine = ctx->engine;
             if(engine_cfg == -1)
-                engine_cfg = g_engine_config;
+                engine_cfg = ctx->engine_config;
 
             engine_cfg = get_hab4_engine_config(engine, (const eng_cfg_t)engine_cfg);
 
@@ -402,13 +506,13 @@ int32_t cmd_handler_authenticatecsf(command_t* cmd)
              */
             if(engine_cfg == ERROR_INVALID_ENGINE_CFG)
             {
-                log_arg_cmd(EngineConfiguration, NULL, cmd->type);
+                log_arg_cmd(ctx, EngineConfiguration, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             if(engine_cfg == ERROR_INVALID_ENGINE)
             {
-                log_arg_cmd(EngineName, NULL, cmd->type);
+                log_arg_cmd(ctx, EngineName, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
@@ -422,12 +526,12 @@ int32_t cmd_handler_authenticatecsf(command_t* cmd)
                 };                 /**< Macro will output authenticate csf
                                         command bytes in aut_csf buffer */
 
-                memcpy(&g_csf_buffer[g_csf_buffer_index], aut_csf,
+                memcpy(&ctx->csf_buffer[ctx->csf_buffer_index], aut_csf,
                     AUT_CSF_BYTES);
 
-                cmd->start_offset_cert_sig = g_csf_buffer_index + HAB4_AUT_DAT_CMD_SIG_OFFSET;
+                cmd->start_offset_cert_sig = ctx->csf_buffer_index + HAB4_AUT_DAT_CMD_SIG_OFFSET;
 
-                g_csf_buffer_index += AUT_CSF_BYTES;
+                ctx->csf_buffer_index += AUT_CSF_BYTES;
             }
         }
     } while(0);
@@ -436,7 +540,7 @@ int32_t cmd_handler_authenticatecsf(command_t* cmd)
 }
 
 /**
- * Updates g_csf_buffer with authenticate data command
+ * Updates ctx->csf_buffer with authenticate data command
  *
  * @par Purpose
  *
@@ -468,7 +572,8 @@ int32_t cmd_handler_authenticatecsf(command_t* cmd)
  *
  * @retval #SUCCESS  completed its task successfully
  */
-static int32_t hab4_authenticate_data(sig_fmt_t sig_format, int32_t engine,
+static int32_t hab4_authenticate_data(cst_context_t *ctx,
+        sig_fmt_t sig_format, int32_t engine,
     int32_t engine_cfg, int32_t vfy_index, block_t *block, uint8_t *buf,
     int32_t *cmd_len, size_t* size_blocks)
 {
@@ -487,51 +592,808 @@ static int32_t hab4_authenticate_data(sig_fmt_t sig_format, int32_t engine,
         };                /**< Macro will initialize length buffer with
                               4 bytes length */
 
-        memcpy(&buf[*cmd_len], start, 4);
-        memcpy(&buf[*cmd_len + 4], length, 4);
+        memcpy(&buf[*cmd_len], start, 4);
+        memcpy(&buf[*cmd_len + 4], length, 4);
+
+        *cmd_len += 8;
+        *size_blocks += block->length;
+        block = block->next;
+        num_blocks ++;
+    }
+    {
+        uint8_t pcl;
+
+        switch (sig_format) {
+        case SIG_FMT_CMS:
+            pcl = HAB_PCL_CMS;
+            break;
+        case SIG_FMT_AEAD:
+            pcl = HAB_PCL_AEAD;
+            break;
+        default:
+            return ERROR_INVALID_ARGUMENT;
+        }
+
+        uint8_t aut_dat[] =  {
+            AUT_IMG(num_blocks, HAB_CMD_AUT_DAT_CLR, vfy_index,
+                pcl,
+                engine, engine_cfg, 0)
+        };                /**< Macro will output authenticate data
+                                        command bytes in aut_dat buffer */
+
+        memcpy(buf, aut_dat, AUT_DAT_BASE_BYTES);
+    }
+
+    return SUCCESS;
+}
+
+/**
+ * Opens a file holding blocks
+ *
+ * @par Purpose
+ *
+ * Each distinct file of the CSF is opened and sized once, whatever the
+ * number of blocks and commands referencing it, and stays open until the
+ * context is freed. Its content is mapped in memory by map_block_file()
+ * only when a block is first read, Windows builds read it in chunks
+ * instead.
+ *
+ * Must be called from the thread processing the CSF.
+ *
+ * @par Operation
+ *
+ * @param[in,out] ctx, context holding the files of the CSF
+ *
+ * @param[in] filename, file to open
+ *
+ * @param[in] writable, set to write blocks back, a file opened read only
+ *            by a previous command is opened again for writing
+ *
+ * @param[out] file, the file
+ *
+ * @retval #SUCCESS  the file is open
+ *
+ * @retval #ERROR_FILE_NOT_PRESENT the file cannot be opened
+ *
+ * @retval #ERROR_OPENING_FILE the file cannot be opened for writing
+ *
+ * @retval #ERROR_INSUFFICIENT_MEMORY cannot allocate the file
+ */
+static int32_t open_block_file(cst_context_t *ctx, const char *filename,
+        int writable, block_file_t **file)
+{
+    block_file_t *entry = NULL;
+    struct stat info;
+
+    if (ctx->block_files == NULL)
+    {
+        ctx->block_files = calloc(1, sizeof(block_files_t));
+        if (ctx->block_files == NULL)
+        {
+            return ERROR_INSUFFICIENT_MEMORY;
+        }
+        pthread_mutex_init(&ctx->block_files->lock, NULL);
+    }
+
+    for (entry = ctx->block_files->head; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->filename, filename) == 0)
+        {
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        entry = calloc(1, sizeof(block_file_t));
+        if (entry == NULL)
+        {
+            return ERROR_INSUFFICIENT_MEMORY;
+        }
+        entry->filename = filename;
+        entry->writable = writable;
+#ifdef _WIN32
+        entry->fh = fopen(filename, writable ? "rb+" : "rb");
+        if (entry->fh == NULL || fstat(fileno(entry->fh), &info) != 0)
+        {
+            if (entry->fh != NULL)
+            {
+                fclose(entry->fh);
+            }
+            free(entry);
+            return writable ? ERROR_OPENING_FILE : ERROR_FILE_NOT_PRESENT;
+        }
+#else
+        entry->fd = open(filename, writable ? O_RDWR : O_RDONLY);
+        if (entry->fd < 0 || fstat(entry->fd, &info) != 0)
+        {
+            if (entry->fd >= 0)
+            {
+                close(entry->fd);
+            }
+            free(entry);
+            return writable ? ERROR_OPENING_FILE : ERROR_FILE_NOT_PRESENT;
+        }
+#endif
+        entry->size = (size_t)info.st_size;
+        entry->next = ctx->block_files->head;
+        ctx->block_files->head = entry;
+    }
+    else if (writable && !entry->writable)
+    {
+        /* Same file, its size is known already */
+#ifdef _WIN32
+        FILE *fh = fopen(filename, "rb+");
+
+        if (fh == NULL)
+        {
+            return ERROR_OPENING_FILE;
+        }
+        fclose(entry->fh);
+        entry->fh = fh;
+#else
+        int fd = open(filename, O_RDWR);
+
+        if (fd < 0)
+        {
+            return ERROR_OPENING_FILE;
+        }
+        close(entry->fd);
+        entry->fd = fd;
+#endif
+        entry->writable = 1;
+    }
+
+    *file = entry;
+    return SUCCESS;
+}
+
+/**
+ * Closes the files holding the blocks of the CSF
+ *
+ * @param[in,out] ctx, context holding the files
+ */
+void free_block_files(cst_context_t *ctx)
+{
+    block_files_t *files = ctx->block_files;
+    block_file_t *file = NULL;
+
+    if (files == NULL)
+    {
+        return;
+    }
+
+    while (files->head != NULL)
+    {
+        file = files->head;
+        files->head = file->next;
+#ifdef _WIN32
+        fclose(file->fh);
+#else
+        unmap_block_file(files, file);
+        close(file->fd);
+#endif
+        free(file);
+    }
+
+    pthread_mutex_destroy(&files->lock);
+    free(files);
+    ctx->block_files = NULL;
+}
+
+/**
+ * Finds the file holding a block
+ *
+ * @param[in] files, files opened by open_block_file(), may be NULL
+ *
+ * @param[in] block, block to look for
+ *
+ * @retval the file holding @a block, NULL if the file is not opened or
+ *         is smaller than the block requires
+ */
+static block_file_t *find_block_file(block_files_t *files,
+        const block_t *block)
+{
+    block_file_t *file = (files != NULL) ? files->head : NULL;
+
+    while (file != NULL &&
+           strcmp(file->filename, block->block_filename) != 0)
+    {
+        file = file->next;
+    }
+
+    if (file == NULL ||
+        ((uint64_t)block->start + block->length) > (uint64_t)file->size)
+    {
+        return NULL;
+    }
+
+    return file;
+}
+
+#ifndef _WIN32
+/**
+ * Maps the content of a file holding blocks
+ *
+ * @par Purpose
+ *
+ * Files are mapped on first use, so that validated blocks that end up
+ * never read cost no mapping. Read only mappings are shared by the
+ * hashing threads. Writable mappings are copy on write: the blocks can be
+ * encrypted in place in the mapping, then written back with write_block().
+ *
+ * @par Operation
+ *
+ * @param[in,out] files, files of the CSF, holding the lock
+ *
+ * @param[in,out] file, file opened by open_block_file()
+ *
+ * @param[in] writable, set to map the file for writing, replacing a read
+ *            only mapping. No other thread may read the file meanwhile
+ *
+ * @retval the content of the file, NULL if it cannot be mapped or is
+ *         empty
+ */
+static uint8_t *map_block_file(block_files_t *files, block_file_t *file,
+        int writable)
+{
+    uint8_t *data = NULL;
+    void *map = NULL;
+
+    pthread_mutex_lock(&files->lock);
+    do {
+        if (file->data != NULL && (file->data_writable || !writable))
+        {
+            break;
+        }
+        if (file->data != NULL)
+        {
+            munmap(file->data, file->size);
+            file->data = NULL;
+        }
+        if (file->size == 0)
+        {
+            break;
+        }
+
+        map = mmap(NULL, file->size,
+                   writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                   MAP_PRIVATE, file->fd, 0);
+        if (map == MAP_FAILED)
+        {
+            break;
+        }
+        file->data = map;
+        file->data_writable = writable;
+        posix_madvise(map, file->size, POSIX_MADV_SEQUENTIAL);
+    } while(0);
+    data = file->data;
+    pthread_mutex_unlock(&files->lock);
+
+    return data;
+}
+
+/**
+ * Drops the mapping of a file holding blocks
+ *
+ * The next map_block_file() maps the file again, with any block written
+ * back since.
+ *
+ * @param[in,out] files, files of the CSF, holding the lock
+ *
+ * @param[in,out] file, file opened by open_block_file()
+ */
+static void unmap_block_file(block_files_t *files, block_file_t *file)
+{
+    pthread_mutex_lock(&files->lock);
+    if (file->data != NULL)
+    {
+        munmap(file->data, file->size);
+        file->data = NULL;
+        file->data_writable = 0;
+    }
+    pthread_mutex_unlock(&files->lock);
+}
+#endif
+
+/**
+ * Reads a block
+ *
+ * @par Purpose
+ *
+ * Either feeds the bytes of @a block to a digest or copies them to a
+ * buffer. May be called from several threads at once.
+ *
+ * @par Operation
+ *
+ * @param[in] files, files opened by open_block_file()
+ *
+ * @param[in] block, block to read
+ *
+ * @param[in] md_ctx, digest to update, NULL to copy the block to @a buf
+ *
+ * @param[out] buf, buffer receiving the block, used if @a md_ctx is NULL
+ *
+ * @param[out] err_name, file that cannot be read on error
+ *
+ * @retval #SUCCESS  the block is read
+ *
+ * @retval #ERROR_READING_FILE the file is not opened or cannot be read
+ */
+static int32_t read_block(block_files_t *files, const block_t *block,
+        EVP_MD_CTX *md_ctx, uint8_t *buf, const char **err_name)
+{
+    block_file_t *file = find_block_file(files, block);
+
+    *err_name = block->block_filename;
+
+    if (file == NULL)
+    {
+        return ERROR_READING_FILE;
+    }
+
+#ifdef _WIN32
+    {
+        uint8_t chunk[BYTES_64KB];  /**< Holds the block being hashed */
+        uint8_t *dest = NULL;
+        size_t done = 0;
+        size_t bytes = 0;
+        int ok = 1;
+
+        while (ok && done < block->length)
+        {
+            bytes = block->length - done;
+            if (bytes > sizeof(chunk))
+            {
+                bytes = sizeof(chunk);
+            }
+            dest = (md_ctx == NULL) ? buf + done : chunk;
+
+            /* The stream position is shared by the hashing threads */
+            pthread_mutex_lock(&files->lock);
+            ok = (fseek(file->fh, block->start + done, SEEK_SET) == 0 &&
+                  fread(dest, 1, bytes, file->fh) == bytes);
+            pthread_mutex_unlock(&files->lock);
+
+            if (ok && dest == chunk)
+            {
+                ok = EVP_DigestUpdate(md_ctx, chunk, bytes);
+            }
+            done += bytes;
+        }
+        if (!ok)
+        {
+            return ERROR_READING_FILE;
+        }
+    }
+#else
+    {
+        const uint8_t *data = NULL;
+
+        if (block->length == 0)
+        {
+            return SUCCESS;
+        }
+        data = map_block_file(files, file, 0);
+        if (data == NULL)
+        {
+            return ERROR_READING_FILE;
+        }
+        if (md_ctx == NULL)
+        {
+            memcpy(buf, data + block->start, block->length);
+        }
+        else if (!EVP_DigestUpdate(md_ctx, data + block->start,
+                                   block->length))
+        {
+            return ERROR_READING_FILE;
+        }
+    }
+#endif
+
+    return SUCCESS;
+}
+
+/**
+ * Writes a block back to its file
+ *
+ * @param[in] files, files opened writable by open_block_file()
+ *
+ * @param[in] block, block to write
+ *
+ * @param[in] buf, new content of the block
+ *
+ * @param[out] err_name, file that cannot be written on error
+ *
+ * @retval #SUCCESS  the block is written
+ *
+ * @retval #ERROR_WRITING_FILE the file cannot be written
+ */
+static int32_t write_block(block_files_t *files, const block_t *block,
+        const uint8_t *buf, const char **err_name)
+{
+    const block_file_t *file = find_block_file(files, block);
+
+    *err_name = block->block_filename;
+
+    if (file == NULL || !file->writable)
+    {
+        return ERROR_WRITING_FILE;
+    }
+
+#ifdef _WIN32
+    if (fseek(file->fh, block->start, SEEK_SET) != 0 ||
+        fwrite(buf, 1, block->length, file->fh) != block->length ||
+        fflush(file->fh) != 0)
+    {
+        return ERROR_WRITING_FILE;
+    }
+#else
+    {
+        size_t done = 0;
+        ssize_t bytes = 0;
+
+        while (done < block->length)
+        {
+            bytes = pwrite(file->fd, buf + done, block->length - done,
+                           (off_t)block->start + done);
+            if (bytes <= 0)
+            {
+                return ERROR_WRITING_FILE;
+            }
+            done += (size_t)bytes;
+        }
+    }
+#endif
+
+    return SUCCESS;
+}
+
+/**
+ * Hashes the blocks of a job
+ *
+ * @par Purpose
+ *
+ * Computes the digest of the blocks straight from their files. Runs on the
+ * hashing threads, so only the job is updated.
+ *
+ * @par Operation
+ *
+ * @param[in,out] job, job to hash, its status is set in job->ret_val
+ *
+ * @param[in] md, digest algorithm
+ *
+ * @param[in] files, files holding the blocks
+ */
+static void hash_job(aut_dat_job_t *job, const EVP_MD *md,
+        block_files_t *files)
+{
+    block_t *block = NULL;
+    EVP_MD_CTX *md_ctx = NULL;   /**< Digest of the blocks data */
+
+    job->ret_val = SUCCESS;
+
+    do {
+        md_ctx = EVP_MD_CTX_new();
+        if (md_ctx == NULL || !EVP_DigestInit_ex(md_ctx, md, NULL))
+        {
+            job->ret_val = ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+        for (block = job->blocks; block != NULL; block = block->next)
+        {
+            job->ret_val = read_block(files, block, md_ctx, NULL,
+                                      &job->err_name);
+            if (job->ret_val != SUCCESS)
+            {
+                break;
+            }
+        }
+        if (job->ret_val != SUCCESS)
+        {
+            break;
+        }
+        if (!EVP_DigestFinal_ex(md_ctx, job->digest, &job->digest_bytes))
+        {
+            job->digest_bytes = 0;
+            job->ret_val = ERROR_INSUFFICIENT_MEMORY;
+        }
+    } while(0);
+
+    EVP_MD_CTX_free(md_ctx);
+}
+
+/**
+ * Hashes the blocks of a job of a #hash_set_t
+ *
+ * @param[in] arg, #hash_set_t holding the job
+ *
+ * @param[in] index, index of the job in the set
+ */
+static void hash_task(void *arg, size_t index)
+{
+    hash_set_t *set = arg;
+
+    hash_job(set->jobs[index], set->md, set->files);
+}
+
+/**
+ * Gathers the blocks of a job in a buffer
+ *
+ * Blocks following each other in one file are given straight from the
+ * file mapping, so the data sent to the backend is never copied. Other
+ * jobs get their blocks copied in an allocated buffer.
+ *
+ * @param[in,out] job, job to gather, job->err_name is set to the file the
+ *                blocks could not be read from
+ *
+ * @param[in] files, files holding the blocks
+ *
+ * @param[out] data, blocks data, valid until the files are closed
+ *
+ * @param[out] copy, buffer allocated for @a data, to free with free(),
+ *             NULL if @a data points into the file mapping
+ *
+ * @retval #SUCCESS  the blocks are in @a data
+ *
+ * @retval #ERROR_INSUFFICIENT_MEMORY or errors returned by read_block
+ */
+static int32_t gather_job(aut_dat_job_t *job, block_files_t *files,
+        const uint8_t **data, uint8_t **copy)
+{
+    int32_t ret_val = SUCCESS;
+    block_t *block = NULL;
+    size_t offset_in_data = 0;
+
+    *data = NULL;
+    *copy = NULL;
+    job->err_name = NULL;
+
+#ifndef _WIN32
+    /* Contiguous blocks of one file */
+    block = job->blocks;
+    while (block != NULL && block->next != NULL &&
+           strcmp(block->next->block_filename, block->block_filename) == 0 &&
+           block->next->start == block->start + block->length)
+    {
+        block = block->next;
+    }
+    if (block != NULL && block->next == NULL && job->data_size > 0)
+    {
+        block_file_t *file = find_block_file(files, job->blocks);
+        const uint8_t *mapping = NULL;
+
+        job->err_name = job->blocks->block_filename;
+        if (file == NULL)
+        {
+            return ERROR_READING_FILE;
+        }
+        mapping = map_block_file(files, file, 0);
+        if (mapping == NULL)
+        {
+            return ERROR_READING_FILE;
+        }
+        *data = mapping + job->blocks->start;
+        return SUCCESS;
+    }
+#endif
+
+    do {
+        *copy = malloc(job->data_size);
+        if (*copy == NULL)
+        {
+            ret_val = ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+        for (block = job->blocks; block != NULL; block = block->next)
+        {
+            ret_val = read_block(files, block, NULL, *copy + offset_in_data,
+                                 &job->err_name);
+            if (ret_val != SUCCESS)
+            {
+                break;
+            }
+            offset_in_data += block->length;
+        }
+    } while(0);
+
+    if (ret_val != SUCCESS)
+    {
+        free(*copy);
+        *copy = NULL;
+    }
+    else
+    {
+        *data = *copy;
+    }
+
+    return ret_val;
+}
+
+/**
+ * Signs the blocks data of a job of a #hash_set_t
+ *
+ * Used instead of hash_task() for backends signing data buffers from
+ * several threads at once, such as a remote signing server.
+ *
+ * @param[in] arg, #hash_set_t holding the job
+ *
+ * @param[in] index, index of the job in the set
+ */
+static void sign_data_task(void *arg, size_t index)
+{
+    hash_set_t *set = arg;
+    aut_dat_job_t *job = set->jobs[index];
+    const uint8_t *data = NULL;  /**< Blocks data */
+    uint8_t *copy = NULL;        /**< Set if the blocks were copied */
+
+    job->ret_val = gather_job(job, set->files, &data, &copy);
+    if (job->ret_val != SUCCESS)
+    {
+        return;
+    }
+
+    job->sig_bytes = sizeof(job->sig);
+    job->sig_ret = sig_cache_gen_sig_data_buffer(data, job->data_size,
+        FILE_SIG_IMG_DATA, job->cert_file, set->hash_alg, job->sig_fmt,
+        job->sig, &job->sig_bytes, set->mode);
+    job->signed_ahead = 1;
+
+    free(copy);
+}
+
+/**
+ * Hashes the blocks of every job
+ *
+ * @par Purpose
+ *
+ * Commands are independent until their signatures are laid out in the
+ * CSF, so their blocks are hashed concurrently on the thread pool.
+ * Backends signing the data itself from several threads get the blocks
+ * data of every job signed concurrently instead of hashed, with at most
+ * g_sign_requests signatures requested at once.
+ *
+ * @par Operation
+ *
+ * @param[in,out] ctx, context holding the jobs to hash
+ *
+ * @param[in] md, digest algorithm
+ */
+static void hash_jobs(cst_context_t *ctx, const EVP_MD *md)
+{
+    hash_set_t set;
+    aut_dat_job_t *jobs = ctx->aut_dat_jobs;
+    aut_dat_job_t *job = NULL;
+    size_t count = 0;
+
+    for (job = jobs; job != NULL; job = job->next)
+    {
+        count++;
+    }
+
+    set.md = md;
+    set.sign_data = (gen_sig_data_concurrent != 0);
+    set.hash_alg = hab_hash_alg_to_hash_alg_type(ctx->hash_alg);
+    set.mode = ctx->mode;
+    set.files = ctx->block_files;
+    set.jobs = malloc(count * sizeof(aut_dat_job_t *));
+    if (set.jobs == NULL)
+    {
+        /* Hash them one after the other */
+        for (job = jobs; job != NULL; job = job->next)
+        {
+            hash_job(job, md, ctx->block_files);
+        }
+        return;
+    }
+
+    count = 0;
+    for (job = jobs; job != NULL; job = job->next)
+    {
+        set.jobs[count++] = job;
+    }
+
+    if (set.sign_data)
+    {
+        /* Threads mostly wait for the backend, up to one per request
+           the backend is sent at once */
+        thread_pool_run_threads(count,
+            (count < g_sign_requests) ? count : g_sign_requests,
+            sign_data_task, &set);
+    }
+    else
+    {
+        thread_pool_run(count, hash_task, &set);
+    }
+
+    free(set.jobs);
+}
+
+/**
+ * Generates the signature of a job
+ *
+ * @par Purpose
+ *
+ * Signs the digest of the blocks when they were hashed and the backend
+ * supports it, so that the blocks data is never held in memory. Backends
+ * that need the data itself get the blocks gathered in a buffer instead.
+ *
+ * @par Operation
+ *
+ * @param[in] ctx, context of the CSF being processed
+ *
+ * @param[in] job, job to sign
+ *
+ * @retval #SUCCESS  the signature is saved in the command
+ *
+ * @retval Errors returned by the hashing, create_sig_data_digest and
+ *         create_sig_data
+ */
+static int32_t sign_job(cst_context_t *ctx, aut_dat_job_t *job)
+{
+    int32_t ret_val = job->ret_val;
+    const uint8_t *data = NULL;  /**< Blocks data for the fallback */
+    uint8_t *copy = NULL;        /**< Set if the blocks were copied */
+
+    do {
+        if (ret_val != SUCCESS)
+        {
+            if (job->err_name != NULL)
+            {
+                log_error_msg(ctx, (char *)job->err_name);
+            }
+            break;
+        }
 
-        *cmd_len += 8;
-        *size_blocks += block->length;
-        block = block->next;
-        num_blocks ++;
-    }
-    {
-        uint8_t pcl;
+        if (job->signed_ahead)
+        {
+            ret_val = save_sig_data(ctx, job->cmd, FILE_SIG_IMG_DATA,
+                job->cert_file, job->sig_ret, job->sig, job->sig_bytes);
+            if (ret_val != CAL_NOT_SUPPORTED)
+            {
+                break;
+            }
+        }
+        else if (job->digest_bytes > 0)
+        {
+            ret_val = create_sig_data_digest(ctx, job->cmd, FILE_SIG_IMG_DATA,
+                job->cert_file, job->sig_fmt, job->digest, job->digest_bytes);
+            if (ret_val != CAL_NOT_SUPPORTED)
+            {
+                break;
+            }
+        }
 
-        switch (sig_format) {
-        case SIG_FMT_CMS:
-            pcl = HAB_PCL_CMS;
-            break;
-        case SIG_FMT_AEAD:
-            pcl = HAB_PCL_AEAD;
+        /* The backend signs the data itself, gather the blocks */
+        ret_val = gather_job(job, ctx->block_files, &data, &copy);
+        if (ret_val != SUCCESS)
+        {
+            if (job->err_name != NULL)
+            {
+                log_error_msg(ctx, (char *)job->err_name);
+            }
             break;
-        default:
-            return ERROR_INVALID_ARGUMENT;
         }
 
-        uint8_t aut_dat[] =  {
-            AUT_IMG(num_blocks, HAB_CMD_AUT_DAT_CLR, vfy_index,
-                pcl,
-                engine, engine_cfg, 0)
-        };                /**< Macro will output authenticate data
-                                        command bytes in aut_dat buffer */
+        ret_val = create_sig_data(ctx, job->cmd, FILE_SIG_IMG_DATA,
+            job->cert_file, job->sig_fmt, data, job->data_size);
+    } while(0);
 
-        memcpy(buf, aut_dat, AUT_DAT_BASE_BYTES);
-    }
+    free(copy);
 
-    return SUCCESS;
+    return ret_val;
 }
 
 /**
- * Updates g_csf_buffer with authenticate data command
+ * Updates ctx->csf_buffer with authenticate data command
  *
  * @par Purpose
  *
  * Collects necessary arguments from csf file, validate the arguments,
  * set default values for arguments if missing from csf file.
- * Updates g_csf_buffer with authenticate data command.
- * Finally generates image signature and assigns the buffer
- * address with signature data to the command.
+ * Updates ctx->csf_buffer with authenticate data command.
+ * Finally queues the command so that sign_authenticate_data() generates
+ * the image signature and assigns it to the command.
  *
  * @par Operation
  *
@@ -539,9 +1401,9 @@ static int32_t hab4_authenticate_data(sig_fmt_t sig_format, int32_t engine,
  *
  * @retval #SUCCESS  completed its task successfully
  *
- * @retval Errors returned by create_sig_file and save_file_data functions
+ * @retval Errors returned by hab4_authenticate_data
  */
-int32_t cmd_handler_authenticatedata(command_t* cmd)
+int32_t cmd_handler_authenticatedata(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;   /**< Used for return value */
     sig_fmt_t sig_format = SIG_FMT_UNDEF; /**< Holds sig format argument value */
@@ -552,35 +1414,32 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
     block_t *block = NULL;       /**< Holds address of block list argument */
     char* cert_file;             /**< Ptr to name of certificate file */
     size_t blocks_data_size=0;  /**< Bytes occupied by block data in cmd */
-    uint8_t *data = NULL;        /**< Mem to read data blocks */
-    int32_t offset_in_data;      /**< Used in the loop for reading block
-                                      data */
     int32_t cmd_len = 0;         /**< Used to track command length */
-    FILE * fh = NULL;            /**< File pointer to open and read block
-                                      data from binary files */
+    aut_dat_job_t *job = NULL;   /**< Signature to generate */
+    aut_dat_job_t **tail = NULL; /**< End of the jobs list */
 
-    uint32_t srk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_SRK : HAB_IDX_SRK1;
-    uint32_t csfk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
+    uint32_t srk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_SRK : HAB_IDX_SRK1;
+    uint32_t csfk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
 
     PRINT_V("Authenticate data\n");
 
     /* Adjust CSFK index if NOCAK */
-    if (g_no_ca == 1) {
+    if (ctx->no_ca == 1) {
         csfk_idx = HAB_IDX_CSFK;
     }
 
     /* get the arguments */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        ret_val = process_authenticatedata_arguments(
+        ret_val = process_authenticatedata_arguments(ctx, 
                       cmd,  NULL, NULL, NULL,
                       NULL, NULL, NULL,
-                      NULL, &g_ahab_data.source, &g_ahab_data.offsets,
-                      &g_ahab_data.signature);
+                      NULL, &ctx->ahab_data.source, &ctx->ahab_data.offsets,
+                      &ctx->ahab_data.signature);
     }
     else
     {
-        ret_val = process_authenticatedata_arguments(cmd, &block, &vfy_index,
+        ret_val = process_authenticatedata_arguments(ctx, cmd, &block, &vfy_index,
             &engine, &engine_cfg, &sig_format, &hash_alg, NULL, NULL, NULL, NULL);
     }
 
@@ -592,17 +1451,17 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
     /* generate authenticate data command */
     do {
 
-        if (TGT_AHAB == g_target)
+        if (TGT_AHAB == ctx->target)
         {
-            if(NULL == g_ahab_data.source)
+            if(NULL == ctx->ahab_data.source)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
-            if(false == g_ahab_data.offsets.init)
+            if(false == ctx->ahab_data.offsets.init)
             {
-                log_arg_cmd(Offsets, NULL, cmd->type);
+                log_arg_cmd(ctx, Offsets, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
@@ -612,36 +1471,36 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
             /* validate the arguments */
             if(engine == HAB_ENG_ANY && engine_cfg != 0)
             {
-                log_arg_cmd(EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
+                log_arg_cmd(ctx, EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             if(vfy_index == -1)
             {
-                log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             if(block == NULL )
             {
-                log_arg_cmd(Blocks, NULL, cmd->type);
+                log_arg_cmd(ctx, Blocks, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
-            ret_val = validate_block_arguments(block, cmd->type);
+            ret_val = validate_block_arguments(ctx, block, cmd->type);
             if(ret_val != SUCCESS)
             {
                 break;
             }
 
-            if(g_hab_version >= HAB4)
+            if(ctx->hab_version >= HAB4)
             {
                 /* validate the arguments */
                 if(vfy_index == srk_idx)
                 {
-                    if (g_no_ca == 0)
+                    if (ctx->no_ca == 0)
                     {
-                        log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                        log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
 
                         ret_val = ERROR_INVALID_ARGUMENT;
                         break;
@@ -649,7 +1508,7 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
                 }
                 if(vfy_index == csfk_idx)
                 {
-                    log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                    log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
 
                     ret_val = ERROR_INVALID_ARGUMENT;
                     break;
@@ -657,23 +1516,23 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
                 if((vfy_index != VFY_IDX_AUT_DAT_FAST_AUTH) && \
                    (vfy_index < VFY_IDX_AUT_DAT_MIN || vfy_index > VFY_IDX_AUT_DAT_MAX))
                 {
-                    log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                    log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
 
                     ret_val = ERROR_INVALID_ARGUMENT;
                     break;
                 }
                 /* set the defaults if not provided */
                 if(SIG_FMT_UNDEF == sig_format)
-                    sig_format = g_sig_format;
+                    sig_format = ctx->sig_format;
                 else if (sig_format != SIG_FMT_CMS)
                 {
-                    log_arg_cmd(SignatureFormat, " different from CMS"STR_ILLEGAL, cmd->type);
+                    log_arg_cmd(ctx, SignatureFormat, " different from CMS"STR_ILLEGAL, cmd->type);
                     return ERROR_UNSUPPORTED_ARGUMENT;
                 }
                 if(engine == -1)
-                    engine = g_engine;
+                    engine = ctx->engine;
                 if(engine_cfg == -1)
-                    engine_cfg = g_engine_config;
+                    engine_cfg = ctx->engine_config;
 
                 engine_cfg = get_hab4_engine_config(engine, (const eng_cfg_t)engine_cfg);
 
@@ -682,97 +1541,65 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
                 */
                 if(engine_cfg == ERROR_INVALID_ENGINE_CFG)
                 {
-                    log_arg_cmd(EngineConfiguration, NULL, cmd->type);
+                    log_arg_cmd(ctx, EngineConfiguration, NULL, cmd->type);
                     ret_val = ERROR_INVALID_ARGUMENT;
                     break;
                 }
                 if(engine_cfg == ERROR_INVALID_ENGINE)
                 {
-                    log_arg_cmd(EngineName, NULL, cmd->type);
+                    log_arg_cmd(ctx, EngineName, NULL, cmd->type);
                     ret_val = ERROR_INVALID_ARGUMENT;
                     break;
                 }
 
                 /* generate AUT_IMG command */
-                ret_val = hab4_authenticate_data(sig_format, engine, engine_cfg,
-                    vfy_index, block, &g_csf_buffer[g_csf_buffer_index], &cmd_len,
+                ret_val = hab4_authenticate_data(ctx, sig_format, engine, engine_cfg,
+                    vfy_index, block, &ctx->csf_buffer[ctx->csf_buffer_index], &cmd_len,
                     &blocks_data_size);
                 if(ret_val != SUCCESS)
                 {
                     break;
                 }
-                cmd->start_offset_cert_sig = g_csf_buffer_index +
+                cmd->start_offset_cert_sig = ctx->csf_buffer_index +
                     HAB4_AUT_DAT_CMD_SIG_OFFSET;
 
-                g_csf_buffer_index += cmd_len;
+                ctx->csf_buffer_index += cmd_len;
             }
 
-            if (g_no_ca == 0)
+            if (ctx->no_ca == 0)
             {
-                cert_file = g_key_certs[vfy_index];
+                cert_file = ctx->key_certs[vfy_index];
 
                 if (NULL == cert_file) {
-                    log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                    log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
                     ret_val = ERROR_INVALID_ARGUMENT;
                     break;
                 }
             }
             else
             {
-                cert_file = g_key_certs[csfk_idx];
+                cert_file = ctx->key_certs[csfk_idx];
             }
-            /* Get the total size for the blocks data and allocate memory */
-            offset_in_data = 0;
-            data = malloc(blocks_data_size);
-            if(data == NULL)
+            /* The signature is generated with the other Authenticate Data
+             * commands once the CSF is parsed */
+            job = calloc(1, sizeof(aut_dat_job_t));
+            if(job == NULL)
             {
                 ret_val = ERROR_INSUFFICIENT_MEMORY;
                 break;
             }
-            /* Read the data from block files into data buffer */
-            while(block != NULL)
-            {
-                fh = fopen(block->block_filename, "rb");
-                if(fh == NULL)
-                {
-                    log_error_msg(block->block_filename);
-                    ret_val = ERROR_OPENING_FILE;
-                    break;
-                }
-
-                fseek(fh, block->start, SEEK_SET);
-                if(fread(data+offset_in_data, 1, block->length, fh)
-                    != block->length)
-                {
-                    log_error_msg(block->block_filename);
-                    ret_val = ERROR_READING_FILE;
-                    break;
-                }
-                offset_in_data += block->length;
-                fclose(fh);
-                block = block->next;
-            }
-            if(ret_val != SUCCESS)
-            {
-                break;
-            }
-
-            /* Generate signature for the data */
-            ret_val = create_sig_file(FILE_SIG_IMG_DATA, cert_file,
-                (g_hab_version >= HAB4) ? SIG_FMT_CMS : SIG_FMT_PKCS1,
-                data, blocks_data_size);
-
-            if(ret_val != SUCCESS)
-            {
-                break;
-            }
-            /* Save the signature data into command */
-            ret_val = save_file_data(cmd, FILE_SIG_IMG_DATA, NULL, 0,
-                (g_hab_version >= HAB4), NULL, NULL, g_hash_alg);
-            if(ret_val != SUCCESS)
+            job->cmd = cmd;
+            job->blocks = block;
+            job->data_size = blocks_data_size;
+            job->cert_file = cert_file;
+            job->sig_fmt = (ctx->hab_version >= HAB4) ? SIG_FMT_CMS
+                                                      : SIG_FMT_PKCS1;
+
+            for(tail = &ctx->aut_dat_jobs; *tail != NULL;
+                tail = &(*tail)->next)
             {
-                break;
             }
+            *tail = job;
         }
     } while(0);
 
@@ -780,232 +1607,153 @@ int32_t cmd_handler_authenticatedata(command_t* cmd)
 }
 
 /**
- * Read plain text data to encrypt from files specified in blocks and writes it
- * to file.
+ * Encrypts the blocks of a Decrypt Data command in their files
  *
  * @par Purpose
  *
- * This function reads all given data blocks to encrypt and writes it to the file.
- * At the end of this function all data for encryption specified in block array
- * are written to the file.
+ * The blocks are encrypted in place in their mapped files, as a single
+ * message made of the blocks one after the other, then written back.
+ * Windows builds read each block in a buffer instead. The files were
+ * opened for writing when the blocks were validated.
  *
  * @par Operation
  *
- * @param[in] file, filename to write data for encryption
+ * @param[in] ctx, context of the CSF being processed
  *
- * @param[in] block, array of blocks
+ * @param[in] block_list, blocks to encrypt
  *
- * @retval #SUCCESS  completed its task successfully
+ * @param[in] key_index, index of the secret key in ctx->aes_keys
+ *
+ * @param[out] nonce, nonce generated for the encryption
+ *
+ * @param[in] nonce_bytes, size of @a nonce
  *
- * @retval Errors when fopen, fread or fwrite fails
+ * @param[out] mac, MAC of the encrypted data
+ *
+ * @param[in] mac_bytes, size of @a mac
+ *
+ * @retval #SUCCESS  every block file holds the encrypted data
+ *
+ * @retval Errors when the files cannot be opened, read or written, or
+ *         when the encryption fails
  */
-int32_t read_data_to_encrypt_from_blocks(const char* file, block_t * block)
+static int32_t encrypt_blocks(cst_context_t *ctx, block_t *block_list,
+        int32_t key_index, uint8_t *nonce, size_t nonce_bytes, uint8_t *mac,
+        size_t mac_bytes)
 {
-    int32_t ret_val = SUCCESS;    /**< Used for return value */
-    FILE *fh = NULL;              /**< File handle for input reading */
-    FILE *fho = NULL;             /**< File handle for output writing */
-    uint32_t bytes_to_read;        /**< Variable to keep track bytes to read */
-    uint32_t offset;               /**< Offset to start of block in file */
-    uint32_t bytes_read_this_iter; /**< Bytes read in a while loop */
-    uint8_t input_buffer[FILE_BUF_SIZE];   /**< Mem to read data blocks */
-
-    fho = fopen(file, "wb");
-    if(fho == NULL)
+    int32_t ret_val = SUCCESS;
+    block_files_t *files = ctx->block_files; /**< Files holding the blocks */
+    block_file_t *file = NULL;
+    block_t *block = NULL;
+    aead_segment_t *segments = NULL;     /**< Blocks data, in CSF order */
+    size_t count = 0;                    /**< Number of blocks */
+    size_t i = 0;
+    const char *err_name = NULL;
+
+    for (block = block_list; block != NULL; block = block->next)
     {
-        log_error_msg((char*)file);
-        return (ERROR_OPENING_FILE);
+        count++;
     }
 
-    /* Copy blocks for encryption into file */
-    while(block != NULL)
-    {
-        bytes_to_read = block->length;
-        offset = block->start;
-
-        /*
-         * Open the file in read mode
-         */
-        fh = fopen(block->block_filename, "rb");
-        if(fh == NULL)
+    do {
+        segments = calloc(count, sizeof(aead_segment_t));
+        if (segments == NULL)
         {
-            log_error_msg(block->block_filename);
-            ret_val = ERROR_OPENING_FILE;
+            ret_val = ERROR_INSUFFICIENT_MEMORY;
             break;
         }
 
-        /*
-         * The loop below reads size of input_buffer amount of data per
-         * iteration from the file, and writes it to the
-         * file.
-         */
-        while(1)
+        for (block = block_list, i = 0; block != NULL; block = block->next, i++)
         {
-            if(bytes_to_read < FILE_BUF_SIZE)
-            {
-                bytes_read_this_iter = bytes_to_read;
-            }
-            else
+            file = find_block_file(files, block);
+            if (file == NULL || !file->writable)
             {
-                bytes_read_this_iter = FILE_BUF_SIZE;
+                log_error_msg(ctx, block->block_filename);
+                ret_val = ERROR_READING_FILE;
+                break;
             }
-
-            /* Seek to the current offset, init to block->start */
-            fseek(fh, offset, SEEK_SET);
-
-            /* Read data into input buffer */
-            if(fread(input_buffer, 1, bytes_read_this_iter, fh) !=
-                bytes_read_this_iter)
+            segments[i].bytes = block->length;
+#ifdef _WIN32
+            segments[i].data = malloc(block->length);
+            if (segments[i].data == NULL)
             {
-                log_error_msg(block->block_filename);
-                ret_val = ERROR_READING_FILE;
+                ret_val = ERROR_INSUFFICIENT_MEMORY;
                 break;
             }
-
-            /* Append data to temp file */
-            if(fwrite(input_buffer, 1, bytes_read_this_iter, fho) !=
-                bytes_read_this_iter)
+            ret_val = read_block(files, block, NULL, segments[i].data,
+                                 &err_name);
+            if (ret_val != SUCCESS)
             {
-                log_error_msg((char*) file);
-                ret_val = ERROR_WRITING_FILE;
+                log_error_msg(ctx, (char *)err_name);
                 break;
             }
+#else
+            if (block->length > 0)
+            {
+                uint8_t *data = map_block_file(files, file, 1);
 
-            /* Update offset and bytes_to_read */
-            offset += bytes_read_this_iter;
-            bytes_to_read -= bytes_read_this_iter;
-
-            /* Exit the loop if done */
-            if(bytes_to_read <= 0)
-                break;
+                if (data == NULL)
+                {
+                    log_error_msg(ctx, block->block_filename);
+                    ret_val = ERROR_READING_FILE;
+                    break;
+                }
+                segments[i].data = data + block->start;
+            }
+#endif
         }
-
-        fclose(fh);
-        fh = NULL;
-
-        if(ret_val != CAL_SUCCESS)
+        if (ret_val != SUCCESS)
+        {
             break;
+        }
 
-        /* Go for next block */
-        block = block->next;
-    }
-
-    fclose(fho);
-    fho = NULL;
-
-    return ret_val;
-}
-
-/**
- * Write encrypted data from file into the target files specified in blocks
- *
- * @par Purpose
- *
- * Loops through all blocks and write back encrypted data replacing the plain
- * text data. At the end of this function all files specified in block array
- * are updated with encrypted data.
- *
- * @par Operation
- *
- * @param[in] file, input file with encrypted data
- *
- * @param[in] block, array of blocks
- *
- * @retval #SUCCESS  completed its task successfully
- *
- * @retval Errors when fopen, fread or fwrite fails
- */
-int32_t write_encrypted_data_to_blocks(const char* file, block_t * block)
-{
-    int32_t ret_val = SUCCESS;    /**< Used for return value */
-    FILE * fh = NULL;             /**< File handle for input reading */
-    FILE * fho = NULL;            /**< File handle for output writing */
-    uint32_t bytes_to_read;        /**< Variable to keep track bytes to read */
-    uint32_t offset;               /**< Offset to start of block in file */
-    uint32_t bytes_read_this_iter; /**< Bytes read in a while loop */
-    uint8_t input_buffer[FILE_BUF_SIZE];  /**< Mem to read data blocks */
-
-    fh = fopen(file, "rb");
-    if(fh == NULL)
-    {
-        log_error_msg((char*)file);
-        return ERROR_OPENING_FILE;
-    }
-
-    /* Start encryption of data specified in blocks */
-    while(block != NULL)
-    {
-        bytes_to_read = block->length;
-        offset = block->start;
-
-        /*
-         * Open the file in read write mode
-         */
-        fho = fopen(block->block_filename, "rb+");
-        if(fho == NULL)
+        ret_val = gen_auth_encrypted_segments(ctx->dek, segments, count,
+                    AES_CCM,
+                    NULL,
+                    0,
+                    nonce,
+                    nonce_bytes,
+                    mac,
+                    mac_bytes,
+                    ctx->aes_keys[key_index].key_bytes,
+                    g_cert_dek,
+                    ctx->aes_keys[key_index].key_file,
+                    g_reuse_dek);
+        if (ret_val != CAL_SUCCESS)
         {
-            log_error_msg(block->block_filename);
-            ret_val = ERROR_OPENING_FILE;
+            log_error_msg(ctx, "CRYPTO API Failure");
             break;
         }
 
-        /*
-         * The loop below reads size of input_buffer amount of data per
-         * iteration from the file, and writes it to the
-         * file.
-         */
-        while(1)
+        /* Replace plain text in blocks filenames with encrypted data */
+        for (block = block_list, i = 0; block != NULL; block = block->next, i++)
         {
-            if(bytes_to_read < FILE_BUF_SIZE)
-            {
-                bytes_read_this_iter = bytes_to_read;
-            }
-            else
-            {
-                bytes_read_this_iter = FILE_BUF_SIZE;
-            }
-
-            /* Seek to the current offset, init to block->start */
-            fseek(fho, offset, SEEK_SET);
-
-            /* Read encrypted data into input_buffer */
-            if(fread(input_buffer, 1, bytes_read_this_iter, fh) !=
-                bytes_read_this_iter)
-            {
-                log_error_msg((char*)file);
-                ret_val = ERROR_READING_FILE;
-                break;
-            }
-
-            /* Write encrypted data to block file */
-            if(fwrite(input_buffer, 1, bytes_read_this_iter, fho) !=
-                bytes_read_this_iter)
+            ret_val = write_block(files, block, segments[i].data, &err_name);
+            if (ret_val != SUCCESS)
             {
-                log_error_msg(block->block_filename);
-                ret_val = ERROR_WRITING_FILE;
+                log_error_msg(ctx, (char *)err_name);
                 break;
             }
-
-            /* Update offset and bytes_to_read */
-            offset += bytes_read_this_iter;
-            bytes_to_read -= bytes_read_this_iter;
-
-            /* Exit the loop if done */
-            if(bytes_to_read <= 0)
-                break;
         }
+    } while(0);
 
-        fclose(fho);
-        fho = NULL;
-
-        if(ret_val != CAL_SUCCESS)
-            break;
-
-        /* Go for next block */
-        block = block->next;
+#ifdef _WIN32
+    for (i = 0; segments != NULL && i < count; i++)
+    {
+        free(segments[i].data);
     }
-
-    fclose(fh);
-    fh = NULL;
+#else
+    /* Readers map the files again, with the blocks written back */
+    for (file = (files != NULL) ? files->head : NULL; file != NULL;
+         file = file->next)
+    {
+        if (file->data_writable)
+        {
+            unmap_block_file(files, file);
+        }
+    }
+#endif
+    free(segments);
 
     return ret_val;
 }
@@ -1050,10 +1798,15 @@ size_t length_field_bytes(size_t msg_bytes)
  * @par Purpose
  *
  * Generates HAB AEAD data structure using nonce and MAC bytes and saves the
- * binary AEAD structure into the given out_file.
+ * binary AEAD structure in the command. The structure is kept in memory, so
+ * the CSFs processed concurrently by a batch never share a file.
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
+ * @param[in] cmd decrypt data command the AEAD data is saved in
+ *
  * @param[in] nonce nonce data bytes
  *
  * @param[in] nonce_bytes size of nonce in bytes
@@ -1062,22 +1815,18 @@ size_t length_field_bytes(size_t msg_bytes)
  *
  * @param[in] mac_bytes size of MAC in bytes
  *
- * @param[in] out_file file name to save the AEAD data bytes
- *
  * @retval #SUCCESS  completed its task successfully
  *
- * @retval Errors return errors on failures due to any file io or mem alloc
+ * @retval Errors return errors on failures due to mem alloc
  */
-int32_t generate_and_save_aead_data(uint8_t * nonce,
+int32_t generate_and_save_aead_data(cst_context_t *ctx, command_t *cmd,
+                                    uint8_t * nonce,
                                     size_t nonce_bytes,
                                     uint8_t * mac,
-                                    size_t mac_bytes,
-                                    const char * out_file)
+                                    size_t mac_bytes)
 {
     int32_t ret_val = SUCCESS;
 
-    FILE * fh = NULL;
-
     size_t aead_bytes;
 
     uint8_t * aead = NULL;
@@ -1102,24 +1851,11 @@ int32_t generate_and_save_aead_data(uint8_t * nonce,
         memcpy(&aead[4], nonce, nonce_bytes);    /**< next comes nonce_bytes */
         memcpy(&aead[4+nonce_bytes], mac, mac_bytes);   /**< and finally mac */
 
-        /* Write aead data to FILE_SIG_IMG_DATA */
-        fh = fopen(out_file, "wb");
-        if(fh == NULL)
-        {
-            log_error_msg(FILE_SIG_IMG_DATA);
-            ret_val = ERROR_OPENING_FILE;
-            break;
-        }
-        if(fwrite(aead, 1, aead_bytes, fh) != aead_bytes)
-        {
-            log_error_msg(FILE_SIG_IMG_DATA);
-            ret_val = ERROR_WRITING_FILE;
-            break;
-        }
+        /* Attach a copy of the aead data to command */
+        ret_val = save_file_data(ctx, cmd, NULL, aead, aead_bytes,
+            (ctx->hab_version >= HAB4), NULL, NULL, ctx->hash_alg);
     }while (0);
 
-    if(fh)
-        fclose(fh);
     if(aead)
         free(aead);
 
@@ -1127,13 +1863,13 @@ int32_t generate_and_save_aead_data(uint8_t * nonce,
 }
 
 /**
- * Updates g_csf_buffer with authenticate data command for decryption
+ * Updates ctx->csf_buffer with authenticate data command for decryption
  *
  * @par Purpose
  *
  * Collects necessary arguments from csf file, validate the arguments,
  * set default values for arguments if missing from csf file.
- * Updates g_csf_buffer with authenticate data command.
+ * Updates ctx->csf_buffer with authenticate data command.
  * Encrypts data and saves output MAC data with hdr in the CSF and
  * points aut_start of aut_dat cmd to location of MAC data in CSF.
  *
@@ -1143,9 +1879,9 @@ int32_t generate_and_save_aead_data(uint8_t * nonce,
  *
  * @retval #SUCCESS  completed its task successfully
  *
- * @retval Errors returned by create_sig_file and save_file_data functions
+ * @retval Errors returned by create_sig_data and save_file_data functions
  */
-int32_t cmd_handler_decryptdata(command_t* cmd)
+int32_t cmd_handler_decryptdata(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;     /**< Used for return value */
     int32_t engine = -1;           /**< Holds engine argument value */
@@ -1161,14 +1897,14 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
     uint8_t nonce[MAX_NONCE_BYTES];/**< Buffer to hold nonce bytes */
 
     /* The Decrypt Data command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
     /* This command is supported from HAB 4.1 onwards */
-    if(g_hab_version <= HAB4)
+    if(ctx->hab_version <= HAB4)
     {
         ret_val = ERROR_INVALID_COMMAND;
         return ret_val;
@@ -1177,7 +1913,7 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
     PRINT_V("Decrypt Data\n");
 
     /* get the arguments */
-    ret_val = process_authenticatedata_arguments(cmd, &block,
+    ret_val = process_authenticatedata_arguments(ctx, cmd, &block,
         &vfy_index, &engine, &engine_cfg, NULL, NULL, (size_t *)&mac_bytes, NULL, NULL, NULL);
     if(ret_val != SUCCESS)
     {
@@ -1190,20 +1926,28 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
         /* Check for mandatory arguments */
         if(vfy_index == -1)
         {
-            log_arg_cmd(VerificationIndex, NULL, cmd->type);
+            log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
             ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
             break;
         }
 
         if(block == NULL )
         {
-            log_arg_cmd(Blocks, NULL, cmd->type);
+            log_arg_cmd(ctx, Blocks, NULL, cmd->type);
             ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
             break;
         }
 
+        /* Blocks of the previous Authenticate Data commands are hashed
+         * before this command encrypts its block files in place */
+        ret_val = sign_authenticate_data(ctx);
+        if(ret_val != SUCCESS)
+        {
+            break;
+        }
+
         /* validate the arguments */
-        ret_val = validate_block_arguments(block, cmd->type);
+        ret_val = validate_block_arguments(ctx, block, cmd->type);
         if(ret_val != SUCCESS)
         {
             break;
@@ -1211,14 +1955,14 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
 
         if((engine == HAB_ENG_ANY) && (engine_cfg != 0))
         {
-            log_arg_cmd(EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
+            log_arg_cmd(ctx, EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
         }
 
         if(vfy_index >= HAB_KEY_SECRET_MAX)
         {
-            log_arg_cmd(VerificationIndex, NULL, cmd->type);
+            log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
 
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
@@ -1228,25 +1972,25 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
          * Check to make sure vfy_index is same as tgt_index
          * specified with previous install secret key command
          */
-        if (g_aes_keys[vfy_index].key_file == NULL)
+        if (ctx->aes_keys[vfy_index].key_file == NULL)
         {
-            log_arg_cmd(VerificationIndex, NULL, cmd->type);
+            log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
         }
 
         /* set the defaults if not provided */
         if(engine == -1)
-            engine = g_engine;
+            engine = ctx->engine;
         if(engine_cfg == -1)
-            engine_cfg = g_engine_config;
+            engine_cfg = ctx->engine_config;
         if(mac_bytes == -1)
             mac_bytes = 16;
 
         /* Valid mac_bytes are 4, 6, 8, 10, 12, 14 and 16 */
         if((mac_bytes < 4) || (mac_bytes > 16) || (mac_bytes % 2))
         {
-            log_arg_cmd(MacBytes, NULL, cmd->type);
+            log_arg_cmd(ctx, MacBytes, NULL, cmd->type);
 
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
@@ -1269,13 +2013,13 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
         if(engine_cfg == ERROR_INVALID_ENGINE_CFG)
         {
 
-            log_arg_cmd(EngineConfiguration, NULL, cmd->type);
+            log_arg_cmd(ctx, EngineConfiguration, NULL, cmd->type);
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
         }
         if(engine_cfg == ERROR_INVALID_ENGINE)
         {
-            log_arg_cmd(EngineName, NULL, cmd->type);
+            log_arg_cmd(ctx, EngineName, NULL, cmd->type);
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
         }
@@ -1289,7 +2033,7 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
             /* Validate block length to be an exact  multiple of 16 */
             if(tmpblock->length % 16)
             {
-                log_arg_cmd(Blocks, "Block length not a multiple of 16",
+                log_arg_cmd(ctx, Blocks, "Block length not a multiple of 16",
                     cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
@@ -1301,8 +2045,8 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
             break;
 
         /* generate AUT_IMG command */
-        ret_val = hab4_authenticate_data(SIG_FMT_AEAD, engine, engine_cfg,
-            vfy_index, block, &g_csf_buffer[g_csf_buffer_index], &cmd_len,
+        ret_val = hab4_authenticate_data(ctx, SIG_FMT_AEAD, engine, engine_cfg,
+            vfy_index, block, &ctx->csf_buffer[ctx->csf_buffer_index], &cmd_len,
             &blocks_data_size);
         if(ret_val != SUCCESS)
         {
@@ -1310,63 +2054,26 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
         }
 
         /* Save the offset to store aead data in the output buffer */
-        cmd->start_offset_cert_sig = g_csf_buffer_index +
+        cmd->start_offset_cert_sig = ctx->csf_buffer_index +
             HAB4_AUT_DAT_CMD_SIG_OFFSET;
 
-        g_csf_buffer_index += cmd_len;
+        ctx->csf_buffer_index += cmd_len;
 
         /* Calculate nonce bytes */
         nonce_bytes = AES_BLOCK_BYTES - FLAG_BYTES -
             length_field_bytes(blocks_data_size);
 
-        /* Read data from blocks for encryption into FILE_PLAIN_DATA */
-        ret_val = read_data_to_encrypt_from_blocks(FILE_PLAIN_DATA, block);
+        /* Encrypt the blocks in their files */
+        ret_val = encrypt_blocks(ctx, block, vfy_index, nonce, nonce_bytes,
+            mac, mac_bytes);
         if(ret_val != SUCCESS)
         {
             break;
         }
 
-        /*
-         * Call backend to encrypt data from FILE_PLAIN_DATA and save
-         * encrypted data in FILE_ENCRYPTED_DATA
-         */
-        ret_val = gen_auth_encrypted_data(FILE_PLAIN_DATA,
-                    FILE_ENCRYPTED_DATA,
-                    AES_CCM,
-                    NULL,
-                    0,
-                    nonce,
-                    nonce_bytes,
-                    mac,
-                    mac_bytes,
-                    g_aes_keys[vfy_index].key_bytes,
-                    g_cert_dek,
-                    g_aes_keys[vfy_index].key_file,
-                    g_reuse_dek);
-        if(ret_val != CAL_SUCCESS)
-        {
-            log_error_msg("CRYPTO API Failure");
-            break;
-        }
-
-        /* Replace plain text in blocks filenames with encrypted data */
-        ret_val = write_encrypted_data_to_blocks(FILE_ENCRYPTED_DATA, block);
-        if(ret_val != CAL_SUCCESS)
-        {
-            break;
-        }
-
-        /* Generate AEAD using nonce and mac and save the result in file */
-        ret_val = generate_and_save_aead_data(nonce, nonce_bytes, mac,
-            mac_bytes, FILE_SIG_IMG_DATA);
-        if(ret_val != SUCCESS)
-        {
-            break;
-        }
-
-        /* Attach the aead data from file to command */
-        ret_val = save_file_data(cmd, FILE_SIG_IMG_DATA, NULL, 0,
-            (g_hab_version >= HAB4), NULL, NULL, g_hash_alg);
+        /* Generate AEAD using nonce and mac and save the result in command */
+        ret_val = generate_and_save_aead_data(ctx, cmd, nonce, nonce_bytes,
+            mac, mac_bytes);
         if(ret_val != SUCCESS)
         {
             break;
@@ -1376,9 +2083,83 @@ int32_t cmd_handler_decryptdata(command_t* cmd)
          * Set the key index to NULL to prevent same secret key used by
          * another decrypt data command.
          */
-        g_aes_keys[vfy_index].key_file = NULL;
-        g_aes_keys[vfy_index].key_bytes = 0;
+        ctx->aes_keys[vfy_index].key_file = NULL;
+        ctx->aes_keys[vfy_index].key_bytes = 0;
     } while(0);
 
     return ret_val;
 }
+
+/**
+ * Generates the signatures of the queued Authenticate Data commands
+ *
+ * @par Purpose
+ *
+ * The Authenticate Data handler only lays out the command, its signature
+ * is generated here once the commands it depends on are known. The blocks
+ * of every command are hashed concurrently, then the digests are signed
+ * one after the other in CSF order, as the backends keep process wide
+ * state such as the certificate and key caches. Backends that sign data
+ * buffers from several threads, such as the remote signing server, are
+ * instead given the blocks data of every command on the thread pool, and
+ * the signatures are saved in CSF order.
+ *
+ * HSM mode and backends without digest signing get the blocks data
+ * instead, gathered one command at a time.
+ *
+ * @par Operation
+ *
+ * @param[in] ctx, context of the CSF being processed
+ *
+ * @retval #SUCCESS  every signature is saved in its command
+ *
+ * @retval Errors returned while hashing or signing, the remaining
+ *         commands are left unsigned
+ */
+int32_t sign_authenticate_data(cst_context_t *ctx)
+{
+    int32_t ret_val = SUCCESS;
+    aut_dat_job_t *job = NULL;
+    const EVP_MD *md = NULL;
+
+    if (ctx->aut_dat_jobs == NULL)
+    {
+        return SUCCESS;
+    }
+
+    md = EVP_get_digestbyname(hab_hash_alg_to_digest_name(ctx->hash_alg));
+    if (gen_sig_data_digest != NULL && ctx->mode != MODE_HSM && md != NULL)
+    {
+        hash_jobs(ctx, md);
+    }
+
+    for (job = ctx->aut_dat_jobs; job != NULL; job = job->next)
+    {
+        ret_val = sign_job(ctx, job);
+        if (ret_val != SUCCESS)
+        {
+            break;
+        }
+    }
+
+    free_authenticate_data(ctx);
+
+    return ret_val;
+}
+
+/**
+ * Drops the queued Authenticate Data commands
+ *
+ * @param[in] ctx, context of the CSF being processed
+ */
+void free_authenticate_data(cst_context_t *ctx)
+{
+    aut_dat_job_t *job = NULL;
+
+    while (ctx->aut_dat_jobs != NULL)
+    {
+        job = ctx->aut_dat_jobs;
+        ctx->aut_dat_jobs = job->next;
+        free(job);
+    }
+}
@@ -63,24 +63,23 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                           LOCAL FUNCTION DECLARATIONS
 =============================================================================*/
-static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
+static int32_t process_installkey_arguments(cst_context_t *ctx,
+        command_t* cmd, char** cert_file,
         int32_t* src_index, int32_t* tgt_index,int32_t* hash_alg,
         int32_t* cert_format, char** key_file, int32_t *key_length,
         uint32_t* blob_address, char** src, int32_t *perm, char** sign,
         int32_t *src_set, int32_t *revocations, uint32_t *key_identifier,
         uint32_t *image_indexes);
 
-static int32_t hab4_install_key(int32_t src_index, int32_t tgt_index,
+static int32_t hab4_install_key(cst_context_t *ctx,
+        int32_t src_index, int32_t tgt_index,
         int32_t hash_alg, int32_t cert_format, uint8_t* crt_hash,
         size_t hash_len, uint8_t* buf, int32_t* cmd_len);
 
-static int32_t hab4_install_secret_key(int32_t src_index, int32_t tgt_index,
+static int32_t hab4_install_secret_key(cst_context_t *ctx,
+        int32_t src_index, int32_t tgt_index,
         uint32_t blob_address, uint8_t *buf, int32_t *cmd_len);
 
-extern int g_no_ca;
-
-extern int32_t g_srk_set_hab4;
-
 /*===========================================================================
                              LOCAL FUNCTION DEFINITIONS
 =============================================================================*/
@@ -95,6 +94,8 @@ extern int32_t g_srk_set_hab4;
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the command is only used to get arguments list
  *
  * @param[out] cert_file, returns pointer to string for arg FILENAME
@@ -115,7 +116,8 @@ extern int32_t g_srk_set_hab4;
  *
  * @retval #SUCCESS  completed its task successfully
  */
-static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
+static int32_t process_installkey_arguments(cst_context_t *ctx,
+        command_t* cmd, char** cert_file,
         int32_t* src_index, int32_t* tgt_index, int32_t* hash_alg,
         int32_t* cert_format, char** key_file, int32_t *key_length,
         uint32_t *blob_address, char** src, int32_t *perm, char** sign,
@@ -151,7 +153,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *cert_file = arg->value.keyword->string_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -162,7 +164,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *src_index = arg->value.number->num_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -172,7 +174,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *tgt_index = arg->value.number->num_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -182,7 +184,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *hash_alg = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -192,7 +194,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *cert_format = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -204,7 +206,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -216,7 +218,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -228,7 +230,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -238,7 +240,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *src = arg->value.keyword->string_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -250,7 +252,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -260,7 +262,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
                 *sign = arg->value.keyword->string_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -272,7 +274,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -284,7 +286,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -296,7 +298,7 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -308,12 +310,12 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
         default:
-            log_arg_cmd(arg->type, NULL, cmd->type);
+            log_arg_cmd(ctx, arg->type, NULL, cmd->type);
             return ERROR_UNSUPPORTED_ARGUMENT;
         };
 
@@ -336,6 +338,8 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] src_index, source index to use in the command
  *
  * @param[in] tgt_index, target index to use in the command
@@ -353,7 +357,8 @@ static int32_t process_installkey_arguments(command_t* cmd, char** cert_file,
  *
  * @retval #SUCCESS  completed its task successfully
  */
-static int32_t hab4_install_key(int32_t src_index, int32_t tgt_index, int32_t hash_alg,
+static int32_t hab4_install_key(cst_context_t *ctx,
+        int32_t src_index, int32_t tgt_index, int32_t hash_alg,
              int32_t cert_format, uint8_t* crt_hash, size_t hash_len, uint8_t* buf,
              int32_t* cmd_len)
 {
@@ -394,6 +399,8 @@ static int32_t hab4_install_key(int32_t src_index, int32_t tgt_index, int32_t ha
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] src_index, source index to use in the command
  *
  * @param[in] tgt_index, target index to use in the command
@@ -408,7 +415,8 @@ static int32_t hab4_install_key(int32_t src_index, int32_t tgt_index, int32_t ha
  *
  * @retval #SUCCESS  completed its task successfully
  */
-static int32_t hab4_install_secret_key(int32_t src_index, int32_t tgt_index,
+static int32_t hab4_install_secret_key(cst_context_t *ctx,
+        int32_t src_index, int32_t tgt_index,
           uint32_t blob_address, uint8_t *buf, int32_t *cmd_len)
 {
     *cmd_len = INS_KEY_BASE_BYTES;
@@ -439,6 +447,8 @@ static int32_t hab4_install_secret_key(int32_t src_index, int32_t tgt_index,
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the csf command
  *
  * @retval #SUCCESS  completed its task successfully
@@ -450,7 +460,7 @@ static int32_t hab4_install_secret_key(int32_t src_index, int32_t tgt_index,
  *
  * @retval Errors returned by hab4_install_key
  */
-int32_t cmd_handler_installsrk(command_t* cmd)
+int32_t cmd_handler_installsrk(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;  /**< Used for returning error value */
     int32_t src_index = -1;     /**< Hold cmd's source index argument value */
@@ -467,15 +477,15 @@ int32_t cmd_handler_installsrk(command_t* cmd)
     /* get the arguments */
     /* srk key cert is at index 0 */
 
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        ret_val = process_installkey_arguments(cmd, &g_ahab_data.srk_table,
-            &src_index, NULL, NULL, NULL, NULL, NULL, NULL, &g_ahab_data.srk_entry, NULL, NULL,
+        ret_val = process_installkey_arguments(ctx, cmd, &ctx->ahab_data.srk_table,
+            &src_index, NULL, NULL, NULL, NULL, NULL, NULL, &ctx->ahab_data.srk_entry, NULL, NULL,
             &src_set, &revocations, NULL, NULL);
     }
     else
     {
-        ret_val = process_installkey_arguments(cmd, &key_cert,
+        ret_val = process_installkey_arguments(ctx, cmd, &key_cert,
             &src_index, NULL, &hash_alg, &cert_format, NULL, NULL, NULL, NULL, NULL, NULL,
             &src_set, NULL, NULL, NULL);
     }
@@ -486,34 +496,34 @@ int32_t cmd_handler_installsrk(command_t* cmd)
     }
 
     do {
-        if (TGT_AHAB == g_target)
+        if (TGT_AHAB == ctx->target)
         {
             byte_str_t ahab_srk_table = {NULL, 0};
 
-            if(NULL == g_ahab_data.srk_table)
+            if(NULL == ctx->ahab_data.srk_table)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
 
             /* Read the srk table file into temporary buffer */
             /*** NOTE: read_file() allocates memory that must be freed ***/
-            read_file(g_ahab_data.srk_table, &ahab_srk_table, NULL);
+            read_file(ctx->ahab_data.srk_table, &ahab_srk_table, NULL);
             if(!ahab_srk_table.entry || ahab_srk_table.entry_bytes <= 0)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_MEMORY;
                 break;
             }
 
             /* Check for valid tag and AHAB version in Super Root Key table
-             * saved at g_ahab_data.srk_table
+             * saved at ctx->ahab_data.srk_table
              */
             if((((struct ahab_container_srk_table_s *)(ahab_srk_table.entry))->tag != SRK_TABLE_TAG) || \
                (((struct ahab_container_srk_table_s *)(ahab_srk_table.entry))->version != SRK_TABLE_VERSION))
             {
-                log_arg_cmd(Filename, g_ahab_data.srk_table, cmd->type);
+                log_arg_cmd(ctx, Filename, ctx->ahab_data.srk_table, cmd->type);
                 ret_val = ERROR_INVALID_SRK_TABLE;
                 free(ahab_srk_table.entry);
                 break;
@@ -526,57 +536,57 @@ int32_t cmd_handler_installsrk(command_t* cmd)
 
             if (src_index == -1)
             {
-                log_arg_cmd(SourceIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, SourceIndex, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             else if (src_index < 0 || src_index > 3)
             {
-                log_arg_cmd(SourceIndex, " must be between 0 and 3", cmd->type);
+                log_arg_cmd(ctx, SourceIndex, " must be between 0 and 3", cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             else
             {
-                g_ahab_data.srk_index = src_index;
+                ctx->ahab_data.srk_index = src_index;
             }
             if (src_set == -1)
             {
-                log_arg_cmd(SourceSet, NULL, cmd->type);
+                log_arg_cmd(ctx, SourceSet, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             else if ((src_set != SRK_SET_OEM) && (src_set != SRK_SET_NXP))
             {
-                log_arg_cmd(SourceSet, " must be equal to OEM or NXP", cmd->type);
+                log_arg_cmd(ctx, SourceSet, " must be equal to OEM or NXP", cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             else
             {
-                g_ahab_data.srk_set = (src_set == SRK_SET_NXP) ?
+                ctx->ahab_data.srk_set = (src_set == SRK_SET_NXP) ?
                                       HEADER_FLAGS_SRK_SET_NXP :
                                       HEADER_FLAGS_SRK_SET_OEM;
             }
             if (revocations == -1)
             {
-                log_arg_cmd(Revocations, NULL, cmd->type);
+                log_arg_cmd(ctx, Revocations, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             else if (revocations < 0 || revocations > 0xF)
             {
-                log_arg_cmd(Revocations, " must define a 4-bit bitmask", cmd->type);
+                log_arg_cmd(ctx, Revocations, " must define a 4-bit bitmask", cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             else
             {
-                g_ahab_data.revocations = revocations;
+                ctx->ahab_data.revocations = revocations;
             }
         }
         else
-        if(g_hab_version >= HAB4)
+        if(ctx->hab_version >= HAB4)
         {
             /* SRK set */
             if (src_set == -1)
@@ -585,32 +595,32 @@ int32_t cmd_handler_installsrk(command_t* cmd)
             }
             else if ((src_set != SRK_SET_OEM) && (src_set != SRK_SET_NXP))
             {
-                log_arg_cmd(SourceSet, " must be equal to OEM or NXP", cmd->type);
+                log_arg_cmd(ctx, SourceSet, " must be equal to OEM or NXP", cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
-            g_srk_set_hab4 = src_set;
+            ctx->srk_set_hab4 = src_set;
 
-            srk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_SRK : HAB_IDX_SRK1;
+            srk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_SRK : HAB_IDX_SRK1;
 
-            g_key_certs[srk_idx] = key_cert;
+            ctx->key_certs[srk_idx] = key_cert;
 
             /* validate the arguments */
-            if(g_key_certs[srk_idx] == NULL)
+            if(ctx->key_certs[srk_idx] == NULL)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             if(src_index == -1)
             {
-                log_arg_cmd(SourceIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, SourceIndex, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             else if (src_index < SRC_IDX_INS_KEY_MIN || src_index > SRC_IDX_INS_KEY_MAX)
             {
-                log_arg_cmd(SourceIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, SourceIndex, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
@@ -618,7 +628,7 @@ int32_t cmd_handler_installsrk(command_t* cmd)
             /* certificate format is not an option */
             if(cert_format != -1)
             {
-                log_arg_cmd(CertificateFormat, NULL, cmd->type);
+                log_arg_cmd(ctx, CertificateFormat, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
@@ -626,10 +636,10 @@ int32_t cmd_handler_installsrk(command_t* cmd)
             if(cert_format == -1)
                 cert_format = HAB_PCL_SRK;
             if(hash_alg == -1)
-                hash_alg = g_hash_alg;
+                hash_alg = ctx->hash_alg;
 
             /* Read data from cert and save the data pointer into command */
-            ret_val = save_file_data(cmd, g_key_certs[srk_idx], NULL, 0,
+            ret_val = save_file_data(ctx, cmd, ctx->key_certs[srk_idx], NULL, 0,
                 0, NULL, NULL, hash_alg);
             if(ret_val != SUCCESS)
                 break;
@@ -641,20 +651,20 @@ int32_t cmd_handler_installsrk(command_t* cmd)
                (cmd->cert_sig_data[SRK_TABLE_VER_OFFSET] != HAB4))
             {
                 ret_val = ERROR_INVALID_SRK_TABLE;
-                log_error_msg(g_key_certs[srk_idx]);
+                log_error_msg(ctx, ctx->key_certs[srk_idx]);
                 break;
             }
-            cmd->start_offset_cert_sig = g_csf_buffer_index +
+            cmd->start_offset_cert_sig = ctx->csf_buffer_index +
                 HAB4_INSTALL_KEY_CMD_CERT_OFFSET;
 
             /* generate INS_SRK command */
-            ret_val = hab4_install_key(src_index, srk_idx,
+            ret_val = hab4_install_key(ctx, src_index, srk_idx,
                 hash_alg, cert_format, NULL, 0,
-                &g_csf_buffer[g_csf_buffer_index], &cmd_len);
+                &ctx->csf_buffer[ctx->csf_buffer_index], &cmd_len);
             if(ret_val != SUCCESS)
                 break;
 
-            g_csf_buffer_index += cmd_len;
+            ctx->csf_buffer_index += cmd_len;
         }
     } while(0);
 
@@ -674,6 +684,8 @@ int32_t cmd_handler_installsrk(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the csf command
  *
  * @retval #SUCCESS  completed its task successfully
@@ -685,7 +697,7 @@ int32_t cmd_handler_installsrk(command_t* cmd)
  *
  * @retval Errors returned by hab4_install_key
  */
-int32_t cmd_handler_installcsfk(command_t* cmd)
+int32_t cmd_handler_installcsfk(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;  /**< Used for returning error value */
     int32_t cert_format = -1;   /**< Holds certificate format argument value */
@@ -693,13 +705,13 @@ int32_t cmd_handler_installcsfk(command_t* cmd)
     uint8_t *cert_data = NULL;  /**< DER encoded certificate data */
     int32_t cert_len = 0;       /**< length of certificate data */
 
-    uint32_t srk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_SRK : HAB_IDX_SRK1;
-    uint32_t csfk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
+    uint32_t srk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_SRK : HAB_IDX_SRK1;
+    uint32_t csfk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
 
     /* The Install CSFK command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
@@ -707,7 +719,7 @@ int32_t cmd_handler_installcsfk(command_t* cmd)
 
     /* get the arguments */
     /* csf key is at index 1 */
-    ret_val = process_installkey_arguments(cmd, &g_key_certs[csfk_idx],
+    ret_val = process_installkey_arguments(ctx, cmd, &ctx->key_certs[csfk_idx],
         NULL, NULL, NULL, &cert_format, NULL, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL);
 
@@ -718,50 +730,50 @@ int32_t cmd_handler_installcsfk(command_t* cmd)
 
     /* generate install key csf command */
     do {
-        if(g_hab_version >= HAB4)
+        if(ctx->hab_version >= HAB4)
         {
             /* validate the arguments */
-            if(g_key_certs[csfk_idx] == NULL)
+            if(ctx->key_certs[csfk_idx] == NULL)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             if(cert_format == HAB_PCL_SRK)
             {
-                log_arg_cmd(CertificateFormat, NULL, cmd->type);
+                log_arg_cmd(ctx, CertificateFormat, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             /* set the defaults if not provided */
             if(cert_format == -1)
-                cert_format = g_cert_format;
+                cert_format = ctx->cert_format;
 
             /* Read data from cert and save the data pointer into command */
             cert_len = get_der_encoded_certificate_data(
-                g_key_certs[csfk_idx], &cert_data);
+                ctx->key_certs[csfk_idx], &cert_data);
             if(cert_len == 0)
             {
                 ret_val = ERROR_INVALID_PKEY_CERTIFICATE;
-                log_error_msg(g_key_certs[csfk_idx]);
+                log_error_msg(ctx, ctx->key_certs[csfk_idx]);
                 break;
             }
 
-            ret_val = save_file_data(cmd, NULL, cert_data, cert_len,
+            ret_val = save_file_data(ctx, cmd, NULL, cert_data, cert_len,
                 1, NULL, NULL, HAB_ALG_ANY);
             if(ret_val != SUCCESS)
                 break;
 
-            cmd->start_offset_cert_sig = g_csf_buffer_index +
+            cmd->start_offset_cert_sig = ctx->csf_buffer_index +
                 HAB4_INSTALL_KEY_CMD_CERT_OFFSET;
 
             /* generate INS_CSFK command */
-            ret_val = hab4_install_key(srk_idx,
+            ret_val = hab4_install_key(ctx, srk_idx,
                 csfk_idx, HAB_ALG_ANY, cert_format, NULL, 0,
-                &g_csf_buffer[g_csf_buffer_index], &cmd_len);
+                &ctx->csf_buffer[ctx->csf_buffer_index], &cmd_len);
             if(ret_val != SUCCESS)
                 break;
-            g_csf_buffer_index += cmd_len;
+            ctx->csf_buffer_index += cmd_len;
         }
     } while(0);
 
@@ -775,7 +787,7 @@ int32_t cmd_handler_installcsfk(command_t* cmd)
  *
  * Collects necessary arguments from csf file, validate the arguments, set
  * default values for arguments if missing from csf file.
- * For HAB4 only, this is the same as cmd_handler_installcsfk(), except it
+ * For HAB4 only, this is the same as cmd_handler_installcsfk(ctx), except it
  * does not generate and write the install key command in the csf buffer.
  *
  * @par Operation
@@ -791,7 +803,7 @@ int32_t cmd_handler_installcsfk(command_t* cmd)
  *
  * @retval Errors returned by hab4_install_key
  */
-int32_t cmd_handler_installnocak(command_t* cmd)
+int32_t cmd_handler_installnocak(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;  /**< Used for returning error value */
     int32_t cert_format = -1;   /**< Holds certificate format argument value */
@@ -802,18 +814,18 @@ int32_t cmd_handler_installnocak(command_t* cmd)
     uint32_t csfk_idx = HAB_IDX_CSFK;
 
    /* The Install NOCAK command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
     PRINT_V("Install no CAK\n");
 
-    g_no_ca = 1;
+    ctx->no_ca = 1;
     /* get the arguments */
     /* csf key is at index 1 */
-    ret_val = process_installkey_arguments(cmd, &g_key_certs[csfk_idx],
+    ret_val = process_installkey_arguments(ctx, cmd, &ctx->key_certs[csfk_idx],
         NULL, NULL, NULL, &cert_format, NULL, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL);
 
@@ -824,44 +836,44 @@ int32_t cmd_handler_installnocak(command_t* cmd)
 
     /* generate install key csf command */
     do {
-        if(g_hab_version >= HAB4)
+        if(ctx->hab_version >= HAB4)
         {
             /* validate the arguments */
-            if(g_key_certs[csfk_idx] == NULL)
+            if(ctx->key_certs[csfk_idx] == NULL)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             if(cert_format == HAB_PCL_SRK)
             {
-                log_arg_cmd(CertificateFormat, NULL, cmd->type);
+                log_arg_cmd(ctx, CertificateFormat, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             /* set the defaults if not provided */
             if(cert_format == -1)
-                cert_format = g_cert_format;
+                cert_format = ctx->cert_format;
 
             /* Read data from cert and save the data pointer into command */
             cert_len = get_der_encoded_certificate_data(
-                g_key_certs[csfk_idx], &cert_data);
+                ctx->key_certs[csfk_idx], &cert_data);
             if(cert_len == 0)
             {
                 ret_val = ERROR_INVALID_PKEY_CERTIFICATE;
-                log_error_msg(g_key_certs[csfk_idx]);
+                log_error_msg(ctx, ctx->key_certs[csfk_idx]);
                 break;
             }
 
-            ret_val = save_file_data(cmd, NULL, cert_data, cert_len,
+            ret_val = save_file_data(ctx, cmd, NULL, cert_data, cert_len,
                 1, NULL, NULL, HAB_ALG_ANY);
             if(ret_val != SUCCESS)
                 break;
 
-            cmd->start_offset_cert_sig = g_csf_buffer_index +
+            cmd->start_offset_cert_sig = ctx->csf_buffer_index +
                 HAB4_INSTALL_KEY_CMD_CERT_OFFSET;
 
-            g_csf_buffer_index += cmd_len;
+            ctx->csf_buffer_index += cmd_len;
         }
     } while(0);
 
@@ -881,6 +893,8 @@ int32_t cmd_handler_installnocak(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the csf command
  *
  * @retval #SUCCESS  completed its task successfully
@@ -892,7 +906,7 @@ int32_t cmd_handler_installnocak(command_t* cmd)
  *
  * @retval Errors returned by hab4_install_key
  */
-int32_t cmd_handler_installkey(command_t* cmd)
+int32_t cmd_handler_installkey(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;  /**< Used for returning error value */
     int32_t vfy_index = -1;     /**< Holds verification index argument value */
@@ -907,16 +921,16 @@ int32_t cmd_handler_installkey(command_t* cmd)
     int32_t cert_len = 0;       /**< length of certificate data */
 
     /* The Install Key command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
     PRINT_V("Install key\n");
 
     /* get the arguments */
-    ret_val = process_installkey_arguments(cmd, &img_key_crt,
+    ret_val = process_installkey_arguments(ctx, cmd, &img_key_crt,
         &vfy_index, &tgt_index, &hash_alg, &cert_format, NULL, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL);
 
@@ -927,32 +941,32 @@ int32_t cmd_handler_installkey(command_t* cmd)
 
     /* generate install key csf command */
     do {
-        if(g_hab_version >= HAB4)
+        if(ctx->hab_version >= HAB4)
         {
             /* validate the arguments */
             if(img_key_crt == NULL)
             {
-                log_arg_cmd(Filename, NULL, cmd->type);
+                log_arg_cmd(ctx, Filename, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             if(vfy_index == -1)
             {
-                log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             else if ((vfy_index != VFY_IDX_INS_KEY_SRK) && \
 	             (vfy_index < VFY_IDX_INS_KEY_MIN || vfy_index > VFY_IDX_INS_KEY_MAX))
             {
-                log_arg_cmd(VerificationIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, VerificationIndex, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
 
             if(tgt_index == -1)
             {
-                log_arg_cmd(TargetIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, TargetIndex, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
@@ -962,31 +976,31 @@ int32_t cmd_handler_installkey(command_t* cmd)
                 || tgt_index == HAB_IDX_SRK1
                 || tgt_index == HAB_IDX_CSFK1
             ) {
-                log_arg_cmd(TargetIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, TargetIndex, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             if(cert_format == HAB_PCL_SRK)
             {
-                log_arg_cmd(CertificateFormat, NULL, cmd->type);
+                log_arg_cmd(ctx, CertificateFormat, NULL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
 
             if(tgt_index >= HAB_KEY_PUBLIC_MAX)
             {
-                log_arg_cmd(TargetIndex, STR_EXCEED_MAX, cmd->type);
+                log_arg_cmd(ctx, TargetIndex, STR_EXCEED_MAX, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
             /* set the defaults if not provided */
             if(cert_format == -1)
-                cert_format = g_cert_format;
+                cert_format = ctx->cert_format;
             if(hash_alg == -1)
                 hash_alg = HAB_ALG_ANY;
 
-            /* Save the file name pointer at tgt_index of g_key_certs */
-            g_key_certs[tgt_index] = img_key_crt;
+            /* Save the file name pointer at tgt_index of ctx->key_certs */
+            ctx->key_certs[tgt_index] = img_key_crt;
 
             /* Read data from cert and save the data pointer into command */
             cert_len = get_der_encoded_certificate_data(img_key_crt,
@@ -994,26 +1008,26 @@ int32_t cmd_handler_installkey(command_t* cmd)
             if(cert_len == 0)
             {
                 ret_val = ERROR_INVALID_PKEY_CERTIFICATE;
-                log_error_msg(img_key_crt);
+                log_error_msg(ctx, img_key_crt);
                 break;
             }
 
-            ret_val = save_file_data(cmd, NULL, cert_data, cert_len,
+            ret_val = save_file_data(ctx, cmd, NULL, cert_data, cert_len,
                 1, NULL, NULL, HAB_ALG_ANY);
             if(ret_val != SUCCESS)
                 break;
 
-            cmd->start_offset_cert_sig = g_csf_buffer_index +
+            cmd->start_offset_cert_sig = ctx->csf_buffer_index +
                 HAB4_INSTALL_KEY_CMD_CERT_OFFSET;
 
             /* generate INS_IMGK command */
-            ret_val = hab4_install_key(vfy_index, tgt_index,
+            ret_val = hab4_install_key(ctx, vfy_index, tgt_index,
                 hash_alg, cert_format, crt_hash, hash_len,
-                &g_csf_buffer[g_csf_buffer_index], &cmd_len);
+                &ctx->csf_buffer[ctx->csf_buffer_index], &cmd_len);
             if(ret_val != SUCCESS)
                 break;
 
-            g_csf_buffer_index += cmd_len;
+            ctx->csf_buffer_index += cmd_len;
         }
     } while(0);
 
@@ -1043,6 +1057,8 @@ int32_t cmd_handler_installkey(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the csf command
  *
  * @retval #SUCCESS  completed its task successfully
@@ -1052,7 +1068,7 @@ int32_t cmd_handler_installkey(command_t* cmd)
  * @retval #ERROR_INVALID_ARGUMENT, passed in arguments are invalid or do not
  *          make sense
  */
-int32_t cmd_handler_installsecretkey(command_t* cmd)
+int32_t cmd_handler_installsecretkey(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val = SUCCESS;      /**< Used for returning error value */
     int32_t vfy_index = -1;         /**< Holds verification index argument value */
@@ -1067,20 +1083,20 @@ int32_t cmd_handler_installsecretkey(command_t* cmd)
     PRINT_V("Install Secret Key\n");
 
     /* get the arguments */
-    if (TGT_AHAB != g_target) {
+    if (TGT_AHAB != ctx->target) {
         /* This command is supported from HAB 4.1 onwards */
-        if(g_hab_version <= HAB4)
+        if(ctx->hab_version <= HAB4)
         {
             ret_val = ERROR_INVALID_COMMAND;
             return ret_val;
         }
 
-        ret_val = process_installkey_arguments(cmd, NULL, &vfy_index, &tgt_index,
+        ret_val = process_installkey_arguments(ctx, cmd, NULL, &vfy_index, &tgt_index,
             NULL, NULL, &secret_key, &key_length, &blob_address, NULL, NULL, NULL,
             NULL, NULL, NULL, NULL);
     }
     else {
-        ret_val = process_installkey_arguments(cmd, NULL, NULL, NULL,
+        ret_val = process_installkey_arguments(ctx, cmd, NULL, NULL, NULL,
             NULL, NULL, &secret_key, &key_length, NULL, NULL, NULL, NULL,
             NULL, NULL, &key_identifier, &images_indexes);
     }
@@ -1097,30 +1113,30 @@ int32_t cmd_handler_installsecretkey(command_t* cmd)
         /* Output key file is a must */
         if(secret_key == NULL)
         {
-            log_arg_cmd(Key, NULL, cmd->type);
+            log_arg_cmd(ctx, Key, NULL, cmd->type);
             ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
             break;
         }
 
-        if (TGT_AHAB != g_target) {
+        if (TGT_AHAB != ctx->target) {
             /* Target index is a must */
             if(tgt_index == -1)
             {
-                log_arg_cmd(TargetIndex, NULL, cmd->type);
+                log_arg_cmd(ctx, TargetIndex, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             /* Blob address is also needed */
             if(blob_address == 0)
             {
-                log_arg_cmd(BlobAddress, NULL, cmd->type);
+                log_arg_cmd(ctx, BlobAddress, NULL, cmd->type);
                 ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
                 break;
             }
             /* Target index cannot be greater than max allowed */
             if(tgt_index >= HAB_KEY_SECRET_MAX)
             {
-                log_arg_cmd(TargetIndex, STR_EXCEED_MAX, cmd->type);
+                log_arg_cmd(ctx, TargetIndex, STR_EXCEED_MAX, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
@@ -1133,7 +1149,7 @@ int32_t cmd_handler_installsecretkey(command_t* cmd)
             {
                 if(vfy_index > HAB_SNVS_CMK)
                 {
-                    log_arg_cmd(VerificationIndex, STR_EXCEED_MAX, cmd->type);
+                    log_arg_cmd(ctx, VerificationIndex, STR_EXCEED_MAX, cmd->type);
                     ret_val = ERROR_INVALID_ARGUMENT;
                     break;
             }
@@ -1153,30 +1169,30 @@ int32_t cmd_handler_installsecretkey(command_t* cmd)
                (key_length != AES_KEY_LEN_192) &&
                (key_length != AES_KEY_LEN_256))
             {
-                log_arg_cmd(KeyLength, STR_ILLEGAL, cmd->type);
+                log_arg_cmd(ctx, KeyLength, STR_ILLEGAL, cmd->type);
                 ret_val = ERROR_INVALID_ARGUMENT;
                 break;
             }
         }
 
-        if (TGT_AHAB != g_target) {
+        if (TGT_AHAB != ctx->target) {
             /* Calculate dek length in bytes and save secret_key name */
-            g_aes_keys[tgt_index].key_bytes = (key_length / BYTE_SIZE_BITS);
-            g_aes_keys[tgt_index].key_file = secret_key;
+            ctx->aes_keys[tgt_index].key_bytes = (key_length / BYTE_SIZE_BITS);
+            ctx->aes_keys[tgt_index].key_file = secret_key;
 
             /* Generate Install key command for the secret key */
-            ret_val = hab4_install_secret_key(vfy_index, tgt_index,
-                blob_address, &g_csf_buffer[g_csf_buffer_index], &cmd_len);
+            ret_val = hab4_install_secret_key(ctx, vfy_index, tgt_index,
+                blob_address, &ctx->csf_buffer[ctx->csf_buffer_index], &cmd_len);
             if(ret_val != SUCCESS)
                 break;
 
-            g_csf_buffer_index += cmd_len;
+            ctx->csf_buffer_index += cmd_len;
         }
         else {
-            g_ahab_data.dek = secret_key;
-            g_ahab_data.dek_length = (key_length / BYTE_SIZE_BITS);
-            g_ahab_data.key_identifier = key_identifier;
-            g_ahab_data.image_indexes = images_indexes;
+            ctx->ahab_data.dek = secret_key;
+            ctx->ahab_data.dek_length = (key_length / BYTE_SIZE_BITS);
+            ctx->ahab_data.key_identifier = key_identifier;
+            ctx->ahab_data.image_indexes = images_indexes;
         }
     } while(0);
 
@@ -1194,6 +1210,8 @@ int32_t cmd_handler_installsecretkey(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the csf command
  *
  * @retval #SUCCESS  completed its task successfully
@@ -1203,23 +1221,23 @@ int32_t cmd_handler_installsecretkey(command_t* cmd)
  * @retval #ERROR_INVALID_ARGUMENT, passed in arguments are invalid or do not
  *          make sense
  */
-int32_t cmd_handler_installcrt(command_t* cmd)
+int32_t cmd_handler_installcrt(cst_context_t *ctx, command_t* cmd)
 {
     int32_t ret_val;          /**< Used for returning error value   */
     int32_t permissions = -1; /**< Holds permissions argument value */
 
     /* The Install Certificate command is invalid when AHAB is not targeted */
-    if (TGT_AHAB != g_target)
+    if (TGT_AHAB != ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
     PRINT_V("Install Certificate\n");
 
     /* get the arguments */
-    ret_val = process_installkey_arguments(cmd, &g_ahab_data.certificate,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &permissions, &g_ahab_data.cert_sign,
+    ret_val = process_installkey_arguments(ctx, cmd, &ctx->ahab_data.certificate,
+        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &permissions, &ctx->ahab_data.cert_sign,
         NULL, NULL, NULL, NULL);
 
     if (SUCCESS != ret_val)
@@ -1229,27 +1247,27 @@ int32_t cmd_handler_installcrt(command_t* cmd)
 
     do {
         /* validate the arguments */
-        if (NULL == g_ahab_data.certificate)
+        if (NULL == ctx->ahab_data.certificate)
         {
-            log_arg_cmd(Filename, NULL, cmd->type);
+            log_arg_cmd(ctx, Filename, NULL, cmd->type);
             ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
             break;
         }
         if (-1 == permissions)
         {
-            log_arg_cmd(Permissions, NULL, cmd->type);
+            log_arg_cmd(ctx, Permissions, NULL, cmd->type);
             ret_val = ERROR_INSUFFICIENT_ARGUMENTS;
             break;
         }
         else if (0xFF < permissions)
         {
-            log_arg_cmd(Permissions, STR_GREATER_THAN_255, cmd->type);
+            log_arg_cmd(ctx, Permissions, STR_GREATER_THAN_255, cmd->type);
             ret_val = ERROR_INVALID_ARGUMENT;
             break;
         }
         else
         {
-            g_ahab_data.permissions = EXTRACT_BYTE(permissions, 0);
+            ctx->ahab_data.permissions = EXTRACT_BYTE(permissions, 0);
         }
     } while(0);
 
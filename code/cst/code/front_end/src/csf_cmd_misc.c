@@ -69,10 +69,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                              LOCAL FUNCTION DECLARATION
 =============================================================================*/
-static int32_t process_setengine_arguments(command_t* cmd, int32_t *engine,
+static int32_t process_setengine_arguments(cst_context_t *ctx,
+        command_t* cmd, int32_t *engine,
             int32_t *engine_cfg, int32_t *hash_alg);
 
-static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t cmd_id);
+static int32_t cmd_handler_init_unlock(cst_context_t *ctx,
+        command_t* cmd, uint8_t cmd_id);
 /*===========================================================================
                              LOCAL FUNCTION DEFINITIONS
 =============================================================================*/
@@ -88,6 +90,8 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t cmd_id);
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, the command is only used to get arguments list
  *
  * @param[out] engine, returns value for arg ENGINE
@@ -98,7 +102,8 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t cmd_id);
  *
  * @retval #SUCCESS  completed its task successfully
  */
-static int32_t process_setengine_arguments(command_t* cmd, int32_t *engine,
+static int32_t process_setengine_arguments(cst_context_t *ctx,
+        command_t* cmd, int32_t *engine,
             int32_t *engine_cfg, int32_t *hash_alg)
 {
     uint32_t i;
@@ -118,7 +123,7 @@ static int32_t process_setengine_arguments(command_t* cmd, int32_t *engine,
                 *engine = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -134,7 +139,7 @@ static int32_t process_setengine_arguments(command_t* cmd, int32_t *engine,
             }
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
@@ -144,12 +149,12 @@ static int32_t process_setengine_arguments(command_t* cmd, int32_t *engine,
                 *hash_alg = arg->value.keyword->unsigned_value;
             else
             {
-                log_arg_cmd(arg->type, NULL, cmd->type);
+                log_arg_cmd(ctx, arg->type, NULL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
             break;
         default:
-            log_arg_cmd(arg->type, NULL, cmd->type);
+            log_arg_cmd(ctx, arg->type, NULL, cmd->type);
             return ERROR_UNSUPPORTED_ARGUMENT;
         };
 
@@ -168,11 +173,13 @@ static int32_t process_setengine_arguments(command_t* cmd, int32_t *engine,
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
  * @param[in] csf header cmd
  *
  * @retval #SUCCESS
  */
-int32_t cmd_handler_header(command_t* cmd)
+int32_t cmd_handler_header(cst_context_t *ctx, command_t* cmd)
 {
     uint32_t i;              /**< Loop index */
     argument_t *arg;         /**< Ptr to command's argument */
@@ -194,7 +201,7 @@ int32_t cmd_handler_header(command_t* cmd)
         {
         case Target:
             ERR_IF_INIT_MULT_TIMES(flag_target);
-            g_target = arg->value.keyword->unsigned_value;
+            ctx->target = arg->value.keyword->unsigned_value;
             break;
 
         case Version:
@@ -205,36 +212,36 @@ int32_t cmd_handler_header(command_t* cmd)
 
         case Mode:
             ERR_IF_INIT_MULT_TIMES(flag_mode);
-            g_mode = arg->value.keyword->unsigned_value;
+            ctx->mode = arg->value.keyword->unsigned_value;
             break;
 
         case HashAlgorithm:
             ERR_IF_INIT_MULT_TIMES(flag_hash_alg);
-            g_hash_alg = arg->value.keyword->unsigned_value;
+            ctx->hash_alg = arg->value.keyword->unsigned_value;
             break;
 
         case EngineName:
             ERR_IF_INIT_MULT_TIMES(flag_eng);
-            g_engine = arg->value.keyword->unsigned_value;
+            ctx->engine = arg->value.keyword->unsigned_value;
             break;
 
         case EngineConfiguration:
             ERR_IF_INIT_MULT_TIMES(flag_eng_cfg);
             /* Engine configuration could be number or keyword */
             if (arg->value_type == NUMBER_TYPE)
-                g_engine_config = arg->value.number->num_value;
+                ctx->engine_config = arg->value.number->num_value;
             else
-                g_engine_config = arg->value.keyword->unsigned_value;
+                ctx->engine_config = arg->value.keyword->unsigned_value;
             break;
 
         case CertificateFormat:
             ERR_IF_INIT_MULT_TIMES(flag_crt_fmt);
-            g_cert_format = arg->value.keyword->unsigned_value;
+            ctx->cert_format = arg->value.keyword->unsigned_value;
             break;
 
         case SignatureFormat:
             ERR_IF_INIT_MULT_TIMES(flag_sig_fmt);
-            g_sig_format = arg->value.keyword->unsigned_value;
+            ctx->sig_format = arg->value.keyword->unsigned_value;
             break;
 
         default:
@@ -247,57 +254,57 @@ int32_t cmd_handler_header(command_t* cmd)
     /* Validate arguments */
 
     /* If no target is specified, HAB is default */
-    if(TGT_UNDEF == g_target)
-        g_target = TGT_HAB;
+    if(TGT_UNDEF == ctx->target)
+        ctx->target = TGT_HAB;
 
-    if (MODE_UNDEF == g_mode)
-        g_mode = MODE_NOMINAL;
-    else if (MODE_HSM == g_mode)
+    if (MODE_UNDEF == ctx->mode)
+        ctx->mode = MODE_NOMINAL;
+    else if (MODE_HSM == ctx->mode)
     {
         if (-1 != access(SIG_REQ_FILENAME, F_OK))
         {
             if (0 != remove(SIG_REQ_FILENAME))
             {
-                log_arg_cmd(Mode, SIG_REQ_FILENAME, cmd->type);
+                log_arg_cmd(ctx, Mode, SIG_REQ_FILENAME, cmd->type);
                 return ERROR_OPENING_FILE;
             }
         }
     }
 
     /* If AHAB is not targeted */
-    if (TGT_AHAB != g_target)
+    if (TGT_AHAB != ctx->target)
     {
-        g_hab_version = version;
+        ctx->hab_version = version;
 
-        if (g_hab_version == 0)
+        if (ctx->hab_version == 0)
         {
-            log_arg_cmd(Version, NULL, cmd->type);
+            log_arg_cmd(ctx, Version, NULL, cmd->type);
             return ERROR_INSUFFICIENT_ARGUMENTS;
         }
 
-        if(g_hab_version >= HAB4)
+        if(ctx->hab_version >= HAB4)
         {
-            g_csf_buffer[CSF_HDR_HAB4_TAG_OFFSET] = HAB_TAG_CSF;
-            g_csf_buffer[CSF_HDR_HAB4_VERSION_OFFSET] = g_hab_version;
+            ctx->csf_buffer[CSF_HDR_HAB4_TAG_OFFSET] = HAB_TAG_CSF;
+            ctx->csf_buffer[CSF_HDR_HAB4_VERSION_OFFSET] = ctx->hab_version;
         }
 
-        if (g_engine == HAB_ENG_ANY && g_engine_config != 0)
+        if (ctx->engine == HAB_ENG_ANY && ctx->engine_config != 0)
         {
-            log_arg_cmd(EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
+            log_arg_cmd(ctx, EngineName, STR_ENG_ANY_CFG_NOT_ZERO, cmd->type);
             return ERROR_INVALID_ARGUMENT;
         }
 
-        if (g_hab_version >= HAB4)
+        if (ctx->hab_version >= HAB4)
         {
             /*
             * Set default for globals if not specified.
             * And return an error if the sig format is not supported.
             */
-            if(SIG_FMT_UNDEF == g_sig_format)
-                g_sig_format = SIG_FMT_CMS;
-            else if (g_sig_format != SIG_FMT_CMS)
+            if(SIG_FMT_UNDEF == ctx->sig_format)
+                ctx->sig_format = SIG_FMT_CMS;
+            else if (ctx->sig_format != SIG_FMT_CMS)
             {
-                log_arg_cmd(SignatureFormat, " different from CMS"STR_ILLEGAL, cmd->type);
+                log_arg_cmd(ctx, SignatureFormat, " different from CMS"STR_ILLEGAL, cmd->type);
                 return ERROR_UNSUPPORTED_ARGUMENT;
             }
 
@@ -305,18 +312,18 @@ int32_t cmd_handler_header(command_t* cmd)
             * Set default for globals if not specified.
             * And return an error if the cert format is not supported.
             */
-            if(g_cert_format == 0)
-                g_cert_format = HAB_PCL_X509;
+            if(ctx->cert_format == 0)
+                ctx->cert_format = HAB_PCL_X509;
 
-            if(g_hash_alg == 0)
-                g_hash_alg = HAB_ALG_SHA256;
+            if(ctx->hash_alg == 0)
+                ctx->hash_alg = HAB_ALG_SHA256;
 
-            g_csf_buffer_index = CSF_HDR_HAB4_LENGTH ;
+            ctx->csf_buffer_index = CSF_HDR_HAB4_LENGTH ;
         }
     }
     else
     {
-        g_ahab_version = version;
+        ctx->ahab_version = version;
 
         ERR_IF_UNS_ARG(flag_hash_alg, HashAlgorithm);
         ERR_IF_UNS_ARG(flag_eng,      EngineName);
@@ -337,11 +344,13 @@ int32_t cmd_handler_header(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
  * @param[in] cmd
  *
  * @retval #SUCCESS
  */
-int32_t cmd_handler_nop(command_t* cmd)
+int32_t cmd_handler_nop(cst_context_t *ctx, command_t* cmd)
 {
     uint8_t nop_cmd[] = {
         NOP()
@@ -351,16 +360,16 @@ int32_t cmd_handler_nop(command_t* cmd)
     UNUSED(cmd);
 
     /* The NOP command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
-    if(g_hab_version >= HAB4)
+    if(ctx->hab_version >= HAB4)
     {
-        memcpy(&g_csf_buffer[g_csf_buffer_index], nop_cmd, NOP_BYTES);
-        g_csf_buffer_index += NOP_BYTES;
+        memcpy(&ctx->csf_buffer[ctx->csf_buffer_index], nop_cmd, NOP_BYTES);
+        ctx->csf_buffer_index += NOP_BYTES;
     }
 
     return SUCCESS;
@@ -378,11 +387,13 @@ int32_t cmd_handler_nop(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
  * @param[in] cmd
  *
  * @retval #SUCCESS
  */
-int32_t cmd_handler_setengine(command_t* cmd)
+int32_t cmd_handler_setengine(cst_context_t *ctx, command_t* cmd)
 {
     int32_t hash_alg = -1;      /**< Holds the value of hash algorithm argument */
     int32_t engine = -1;        /**< Holds the value of engine argument */
@@ -390,18 +401,18 @@ int32_t cmd_handler_setengine(command_t* cmd)
     int32_t ret_val = SUCCESS;  /**< Holds return value */
 
     /* The Set Engine command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
-    if(g_hab_version < HAB4)
+    if(ctx->hab_version < HAB4)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
-    ret_val = process_setengine_arguments(cmd, &engine, &engine_cfg, &hash_alg);
+    ret_val = process_setengine_arguments(ctx, cmd, &engine, &engine_cfg, &hash_alg);
     if(ret_val != SUCCESS)
     {
         return ret_val;
@@ -413,19 +424,19 @@ int32_t cmd_handler_setengine(command_t* cmd)
      */
     if(engine == -1)
     {
-        log_arg_cmd(EngineName, NULL, cmd->type);
+        log_arg_cmd(ctx, EngineName, NULL, cmd->type);
         return ERROR_INSUFFICIENT_ARGUMENTS;
     }
     if(hash_alg == -1)
     {
-        log_arg_cmd(HashAlgorithm, NULL, cmd->type);
+        log_arg_cmd(ctx, HashAlgorithm, NULL, cmd->type);
         return ERROR_INSUFFICIENT_ARGUMENTS;
     }
 
     /* use default from header if not provided */
     if(engine_cfg == -1)
     {
-        engine_cfg = g_engine_config;
+        engine_cfg = ctx->engine_config;
     }
 
     engine_cfg = get_hab4_engine_config(engine, (const eng_cfg_t)engine_cfg);
@@ -435,12 +446,12 @@ int32_t cmd_handler_setengine(command_t* cmd)
      */
     if(engine_cfg == ERROR_INVALID_ENGINE_CFG)
     {
-        log_arg_cmd(EngineConfiguration, NULL, cmd->type);
+        log_arg_cmd(ctx, EngineConfiguration, NULL, cmd->type);
         return ERROR_INVALID_ARGUMENT;
     }
     if(engine_cfg == ERROR_INVALID_ENGINE)
     {
-        log_arg_cmd(EngineName, NULL, cmd->type);
+        log_arg_cmd(ctx, EngineName, NULL, cmd->type);
         return ERROR_INVALID_ARGUMENT;
     }
 
@@ -450,8 +461,8 @@ int32_t cmd_handler_setengine(command_t* cmd)
         };                /**< Macro will output set eng
                                 command bytes in set_eng buffer */
 
-        memcpy(&g_csf_buffer[g_csf_buffer_index], set_eng, SET_ENG_BYTES);
-        g_csf_buffer_index += SET_ENG_BYTES;
+        memcpy(&ctx->csf_buffer[ctx->csf_buffer_index], set_eng, SET_ENG_BYTES);
+        ctx->csf_buffer_index += SET_ENG_BYTES;
     }
 
     return SUCCESS;
@@ -467,13 +478,16 @@ int32_t cmd_handler_setengine(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
  * @param[in] cmd
  *
  * @param[in] hab command id
  *
  * @retval #SUCCESS
  */
-static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
+static int32_t cmd_handler_init_unlock(cst_context_t *ctx,
+        command_t* cmd, uint8_t hab_cmd_id)
 {
     uint32_t i;                /**< Loop index */
     int32_t engine = -1;       /**< Holds the value of engine argument */
@@ -514,7 +528,7 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
             /* Validate if only 1 Engine is specified */
             if(arg->value_count > 1)
             {
-                log_arg_cmd(arg->type, " must have only 1 Engine", cmd->type);
+                log_arg_cmd(ctx, arg->type, " must have only 1 Engine", cmd->type);
                 return ERROR_INVALID_ARGUMENT;
             }
             break;
@@ -531,7 +545,7 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
             uid_bytes = arg->value_count;
             break;
         default:
-            log_arg_cmd(arg->type, NULL, cmd->type);
+            log_arg_cmd(ctx, arg->type, NULL, cmd->type);
             return ERROR_INVALID_ARGUMENT;
         };
 
@@ -539,7 +553,7 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
     }
     if(engine == -1)
     {
-        log_arg_cmd(EngineName, NULL, cmd->type);
+        log_arg_cmd(ctx, EngineName, NULL, cmd->type);
         return ERROR_INSUFFICIENT_ARGUMENTS;
     }
 
@@ -551,14 +565,14 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
             switch(engine)
             {
                 case HAB_ENG_SRTC:
-                    log_arg_cmd(Features, NULL, cmd->type);
+                    log_arg_cmd(ctx, Features, NULL, cmd->type);
                     return ERROR_INVALID_ARGUMENT;
                 case HAB_ENG_CAAM:
                     if(!(strncmp(feature->string_value, "MID", 3) == 0 ||
                          strncmp(feature->string_value, "RNG", 3) == 0 ||
                          strncmp(feature->string_value, "MFG", 3) == 0 ))
                     {
-                        log_arg_cmd(Features, " invalid for the specified engine", cmd->type);
+                        log_arg_cmd(ctx, Features, " invalid for the specified engine", cmd->type);
                         return ERROR_INVALID_ARGUMENT;
                     }
                     break;
@@ -566,7 +580,7 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
                     if(!(strncmp(feature->string_value, "LPSWR", 5) == 0 ||
                          strncmp(feature->string_value, "ZMKWRITE", 8) == 0 ))
                     {
-                        log_arg_cmd(Features, " invalid for the specified engine", cmd->type);
+                        log_arg_cmd(ctx, Features, " invalid for the specified engine", cmd->type);
                         return ERROR_INVALID_ARGUMENT;
                     }
                     break;
@@ -576,12 +590,12 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
                          strncmp(feature->string_value, "SCS", 3) == 0 ||
                          strncmp(feature->string_value, "JTAG", 4) == 0 ))
                     {
-                        log_arg_cmd(Features, " invalid for the specified engine", cmd->type);
+                        log_arg_cmd(ctx, Features, " invalid for the specified engine", cmd->type);
                         return ERROR_INVALID_ARGUMENT;
                     }
                     break;
                 default:
-                    log_arg_cmd(EngineName, NULL, cmd->type);
+                    log_arg_cmd(ctx, EngineName, NULL, cmd->type);
                     return ERROR_INVALID_ARGUMENT;
             }
             features |= feature->unsigned_value;
@@ -597,11 +611,11 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
     /* Set flags if this is Unlock RNG or Init RNG command */
     if (engine == HAB_ENG_CAAM) {
         if ((hab_cmd_id == HAB_CMD_UNLK) && (features & HAB_CAAM_UNLOCK_RNG)) {
-            g_unlock_rng = 1;
+            ctx->unlock_rng = 1;
         }
 
         if ((hab_cmd_id == HAB_CMD_INIT) && (features & HAB_CAAM_INIT_RNG)) {
-            g_init_rng = 1;
+            ctx->init_rng = 1;
         }
     }
 
@@ -617,13 +631,13 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
             (features & HAB_OCOTP_UNLOCK_FIELD_RETURN)) &&
             (uid == NULL))
         {
-            log_arg_cmd(UID, NULL, cmd->type);
+            log_arg_cmd(ctx, UID, NULL, cmd->type);
             return ERROR_INSUFFICIENT_ARGUMENTS;
         }
         /* UID must not be provided to unlock SRK_REVOKE feature */
         if((features == HAB_OCOTP_UNLOCK_SRK_REVOKE) && (uid != NULL))
         {
-            log_arg_cmd(UID, NULL, cmd->type);
+            log_arg_cmd(ctx, UID, NULL, cmd->type);
             return ERROR_INVALID_ARGUMENT;
         }
     }
@@ -643,8 +657,8 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
             HDR(hab_cmd_id, cmd_len, engine)
         };                            /**< Macro will output init
                                      command bytes in init buffer */
-        memcpy(&g_csf_buffer[g_csf_buffer_index], init, HDR_BYTES);
-        g_csf_buffer_index += HDR_BYTES;
+        memcpy(&ctx->csf_buffer[ctx->csf_buffer_index], init, HDR_BYTES);
+        ctx->csf_buffer_index += HDR_BYTES;
 
         /* Push OR'ed features into buffer */
         if(num_features > 0)
@@ -653,15 +667,15 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
                 EXPAND_UINT32(features)
                     };                /**< Macro will 4 bytes for
                                       feature in feature_value buffer */
-            memcpy(&g_csf_buffer[g_csf_buffer_index], feature_value, 4);
-            g_csf_buffer_index += 4;
+            memcpy(&ctx->csf_buffer[ctx->csf_buffer_index], feature_value, 4);
+            ctx->csf_buffer_index += 4;
         }
         /* Add UID for only unlock cmd */
         if (hab_cmd_id == HAB_CMD_UNLK)
         {
             while(uid)
             {
-                g_csf_buffer[g_csf_buffer_index++] = uid->num_value;
+                ctx->csf_buffer[ctx->csf_buffer_index++] = uid->num_value;
                 uid = uid->next;
             }
         }
@@ -680,27 +694,29 @@ static int32_t cmd_handler_init_unlock(command_t* cmd, uint8_t hab_cmd_id)
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
  * @param[in] cmd
  *
  * @retval #SUCCESS
  *
  * @retval #ERROR_INVALID_COMMAND
  */
-int32_t cmd_handler_init(command_t* cmd)
+int32_t cmd_handler_init(cst_context_t *ctx, command_t* cmd)
 {
     /* The Init command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
-    if(g_hab_version < HAB4)
+    if(ctx->hab_version < HAB4)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
-    return cmd_handler_init_unlock(cmd, HAB_CMD_INIT);
+    return cmd_handler_init_unlock(ctx, cmd, HAB_CMD_INIT);
 }
 
 /**
@@ -713,26 +729,28 @@ int32_t cmd_handler_init(command_t* cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx context of the CSF being processed
+ *
  * @param[in] cmd
  *
  * @retval #SUCCESS
  *
  * @retval #ERROR_INVALID_COMMAND
  */
-int32_t cmd_handler_unlock(command_t* cmd)
+int32_t cmd_handler_unlock(cst_context_t *ctx, command_t* cmd)
 {
     /* The Install Key command is invalid when AHAB is targeted */
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
-    if(g_hab_version < HAB4)
+    if(ctx->hab_version < HAB4)
     {
-        log_cmd(cmd->type, STR_ILLEGAL);
+        log_cmd(ctx, cmd->type, STR_ILLEGAL);
         return ERROR_INVALID_COMMAND;
     }
 
-    return cmd_handler_init_unlock(cmd, HAB_CMD_UNLK);
+    return cmd_handler_init_unlock(ctx, cmd, HAB_CMD_UNLK);
 }
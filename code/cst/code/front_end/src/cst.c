@@ -2,10 +2,10 @@
 /**
     @file    cst.c
 
-    @brief   Code signing tool's main file, calls parser to parse CSF
+    @brief   Code signing tool's CSF processing, calls parser to parse CSF
              commands and creates output binary csf with csf commands data,
              certificates and signatures generated while processing csf
-             commands.
+             commands. The command line lives in cst_main.c.
 
 @verbatim
 =============================================================================
@@ -49,7 +49,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include <string.h>
 #include <strings.h> /* strcasecmp */
-#include <getopt.h>
 #include <errno.h>
 #define HAB_FUTURE
 #include "hab_cmd.h"
@@ -66,6 +65,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "csf.h"
 #include "ssl_backend.h"
 #include "pkcs11_backend.h"
+#include "cst_daemon.h"
+#include "sig_cache.h"
 
 #define LOG_DEBUG printf("[CARLOS_DEBUG] "); printf
 extern void utils_print_bio_array(uint8_t *buffer, size_t len, char* msg);
@@ -73,156 +74,36 @@ extern void utils_print_bio_array(uint8_t *buffer, size_t len, char* msg);
 /*===========================================================================
                                 MACROS
 =============================================================================*/
-/* Max size of buffer for signature bytes */
-#define SIGNATURE_BUFFER_SIZE (1024)
-
-#define MAX_ERROR_STR_LEN     (512)
-#define MIN_NUM_CLI_ARGS      3 /* Minimum number of command line arguments */
 #define WORD_ALIGN(x) (((x + (4-1)) / 4) * 4) /**< Aligns x to next word */
 #define RNG_SEED_BYTES        (128) /* MAX bytes to seed RNG */
 
-#define CST_FAILURE_EXIT_CODE (1) /* code returned from main on failure */
 /*===========================================================================
                                 EXTERNS
 =============================================================================*/
-/* parser function */
-extern int32_t yyparse(void);
-extern FILE *yyin;
-extern int g_no_ca;
-extern int32_t g_srk_set_hab4;
+/* parser and lexer functions */
+extern int32_t yyparse(cst_context_t *ctx, void *scanner);
+extern int yylex_init_extra(cst_context_t *ctx, void **scanner);
+extern void yyset_in(FILE *in, void *scanner);
+extern int yylex_destroy(void *scanner);
 /*===========================================================================
                   INSTANTIATE GLOBAL VARIABLES
 =============================================================================*/
 
 const char *g_tool_name = "CST"; /**< Global holds tool name */
 
-/* Assign default implementation for read_certificate() and gen_sig_data() */
+/* Assign default implementation for read_certificate() and gen_sig_data(),
+   replaced by set_backend() for the whole process */
 read_certificate_fptr read_certificate = ssl_read_certificate;
 gen_sig_data_fptr gen_sig_data = ssl_gen_sig_data;
-
-/**
- * Points to the input CSF text file
- */
-char * g_in_csf_file = NULL;
-
-/**
- * The errors generated while processing csf will be stored in g_error_code,
- *  it always show the last error.
- */
-int32_t g_error_code = SUCCESS;
-
-/**
- * The buffer of max size HAB_CSF_BYTES_MAX to place CSF commands
- */
-uint8_t g_csf_buffer[HAB_CSF_BYTES_MAX];
-
-/**
- * Always shows the position in g_csf_buffer where data can be written. It
- * also gives the size of csf data (commands only)
- */
-uint32_t g_csf_buffer_index = 0;
+gen_sig_data_buffer_fptr gen_sig_data_buffer = ssl_gen_sig_data_buffer;
+gen_sig_data_digest_fptr gen_sig_data_digest = ssl_gen_sig_data_digest;
+uint32_t gen_sig_data_concurrent = 0;
 
 /**
  * CST tool verbose option initialize as 0
  */
 bool g_verbose = 0;
 
-/**
- * AHAB data
- */
-ahab_data_t g_ahab_data = {
-    NULL, NULL, 0, 0, 0, NULL, NULL, 0, NULL, {false, 0, 0}, NULL, NULL, NULL, 0, 0, 0
-};
-
-/**
- * Array of size HAB_KEY_PUBLIC_MAX for key cert file names.
- */
-char *g_key_certs[HAB_KEY_PUBLIC_MAX] = {
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
-};
-
-/**
- * Array of AES keys.
- */
-aes_key_t g_aes_keys[HAB_KEY_SECRET_MAX] = {
-    {0, NULL},
-    {0, NULL},
-    {0, NULL},
-    {0, NULL},
-    {0, NULL},
-    {0, NULL}
-};
-
-/**
- * Shows the target specified. Can be either HAB or AHAB only.
- */
-tgt_t g_target = TGT_UNDEF;
-
-/**
- * Shows the hab version specified in csf.
- */
-uint8_t g_hab_version = 0x00;
-
-/**
- * Store the ahab version for future usage
- */
-uint8_t g_ahab_version = 0x00;
-
-/**
- * Store the functional mode
- */
-func_mode_t g_mode = MODE_UNDEF;
-
-/**
- * Shows default hash algorithm specified in header command of csf file.
- */
-uint32_t g_hash_alg = 0;
-
-/**
- * Shows default engine pecified in header command of csf file.
- */
-uint32_t g_engine = 0;
-
-/**
- * Shows default engine configuration specified in header command of csf file.
- */
-uint32_t g_engine_config = 0;
-
-/**
- * Shows default certificate format specified in header command of csf file.
- */
-uint32_t g_cert_format = 0;
-
-/**
- * Shows default signature format specified in header command of csf file.
- */
-sig_fmt_t g_sig_format = SIG_FMT_UNDEF;
-
-/**
- * Set if Unlock RNG command is present in CSF
- */
-uint32_t g_unlock_rng = 0;
-
-/**
- * Set if Init RNG command is present in CSF
- */
-uint32_t g_init_rng = 0;
-
-/**
- * Points to the head of commands list.
- */
-command_t *g_cmd_head = NULL;
-
-/**
- * Points to the current command being processed from the commands list.
- */
-command_t *g_cmd_current = NULL;
-
-/**
- * Used to check the correct order of the parsed CSF commands
- */
-uint8_t g_cmd_seq_stage = WAITING_FOR_HEADER_STATE;
-
 /**
  * Points to the argument passed on command line for public key
  * certificate for encrypting the dek
@@ -233,33 +114,19 @@ char * g_cert_dek = NULL;
  * Set if a DEK is provided to encrypt the image
  */
 uint32_t g_reuse_dek = 0;
+
 /**
- * Set to skip user agreement prompt
+ * Set if the AHAB output file is patched instead of rewritten
  */
-uint32_t g_skip = 0;
+uint32_t g_in_place = 0;
 
+/**
+ * Max signatures requested at once from backends signing concurrently
+ */
+uint32_t g_sign_requests = SIGN_REQUESTS_DEFAULT;
 /*===========================================================================
                   LOCAL VARIABLES
 =============================================================================*/
-/** Valid short command line option letters. */
-const char* const short_options = "lvh:lvhdso:i:c:b:";
-
-/** Valid long command line options. */
-const struct option long_options[] =
-{
-    {"license", no_argument, 0, 'l'},
-    {"version", no_argument,  0, 'v'},
-    {"verbose", no_argument,  0, 'g'},
-    {"help", no_argument, 0, 'h'},
-    {"output", required_argument,  0, 'o'},
-    {"input", required_argument,  0, 'i'},
-    {"cert", required_argument,  0, 'c'},
-    {"dek", no_argument,  0, 'd'},
-    {"skip", no_argument,  0, 's'},
-    {"backend", required_argument, 0, 'b'},
-    {NULL, 0, NULL, 0}
-};
-
 /**
  * Map of argument string specified in csf to argument Id.
  */
@@ -401,22 +268,14 @@ static map_t label_map[] = {
  */
 static uint32_t label_count = sizeof(label_map)/sizeof(label_map[0]);
 
-/**
- * Buffer to log more meaningful error messages of max len MAX_ERROR_STR_LEN.
- * +1 extra to allow for null terminator.
- */
-char error_log[MAX_ERROR_STR_LEN+1];
-
 /*===========================================================================
                           LOCAL FUNCTION DECLARATIONS
 =============================================================================*/
-static int update_offsets_in_csf(uint8_t * buf, command_t *cmd_csf,
-                          uint32_t csf_len);
-static void print_usage(void);
-static void process_cmdline_args(int argc, char* argv[], char **out_bin_csf);
-static void print_error_msg(const int32_t error_code);
-static void prompt_key_reuse_msg(void);
-static int32_t check_command_sequence(command_t *cmd);
+static int update_offsets_in_csf(cst_context_t *ctx, uint8_t * buf,
+                          command_t *cmd_csf, uint32_t csf_len);
+static int32_t check_command_sequence(cst_context_t *ctx, command_t *cmd);
+static void map_files(cst_context_t *ctx, command_t *cmd);
+static void free_cmd_list(cst_context_t *ctx, command_t *cmd);
 
 #if defined _WIN32 || defined __CYGWIN__
 #define GETLINE_MINSIZE 16
@@ -485,23 +344,25 @@ int getline(char **lineptr, size_t *n, FILE *fp) {
  *
  * @par Purpose
  *
- * Appends error_msg to error_log.
+ * Appends error_msg to the error log of the context.
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] error_msg, Null terminated string for error messages,
  *
  * @retval None
  */
-void log_error_msg(char* error_msg)
+void log_error_msg(cst_context_t *ctx, char* error_msg)
 {
-    size_t log_len = strlen(error_log);
+    size_t log_len = strlen(ctx->error_log);
     size_t input_len = strlen(error_msg);
 
     if (log_len + input_len > MAX_ERROR_STR_LEN)
         input_len = MAX_ERROR_STR_LEN - log_len;
 
-    strncat(error_log, error_msg, input_len);
+    strncat(ctx->error_log, error_msg, input_len);
 }
 
 /** logs argument name and command name given their types
@@ -512,15 +373,17 @@ void log_error_msg(char* error_msg)
  * it can be called for generating text for invalid argument error string and
  * for other error types.
  * Ex strings that can be generated:
- * 1. log_arg_cmd(Engine, NULL, AuthenticateData) can be called for
+ * 1. log_arg_cmd(ctx, Engine, NULL, AuthenticateData) can be called for
  * ERROR_INVALID_ARGUMENT and output text looks like "Invalid argument Engine
  * in command AuthenticateData"
- * 2. log_arg_cmd(Engine, STR_ENG_ANY_CFG_NOT_ZERO, AuthenticateData) can be
+ * 2. log_arg_cmd(ctx, Engine, STR_ENG_ANY_CFG_NOT_ZERO, AuthenticateData) can be
  * called for ERROR_INVALID_ARGUMENT and output text looks like "Invalid
  * argument Engine is ANY but configuration not 0 in command AuthenticateData"
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] arg, expects argument type,
  *
  * @param[in] msg, if not NULL then it will be included after argument name
@@ -529,7 +392,8 @@ void log_error_msg(char* error_msg)
  *
  * @retval None
  */
-void log_arg_cmd(arguments_t arg, char * msg, commands_t cmd)
+void log_arg_cmd(cst_context_t *ctx, arguments_t arg, char * msg,
+                 commands_t cmd)
 {
     uint32_t i;               /**< Loop counter */
 
@@ -537,20 +401,20 @@ void log_arg_cmd(arguments_t arg, char * msg, commands_t cmd)
     {
         if (argument_map[i].value == arg)
         {
-            log_error_msg(argument_map[i].label);
+            log_error_msg(ctx, argument_map[i].label);
         }
     }
 
     if (msg != NULL)
-        log_error_msg(msg);
+        log_error_msg(ctx, msg);
 
-    log_error_msg(STR_IN_CMD);
+    log_error_msg(ctx, STR_IN_CMD);
 
     for (i=0; i<command_count; i++)
     {
         if (command_map[i].type == cmd)
         {
-            log_error_msg(command_map[i].name);
+            log_error_msg(ctx, command_map[i].name);
         }
     }
 }
@@ -562,19 +426,21 @@ void log_arg_cmd(arguments_t arg, char * msg, commands_t cmd)
  * The function generates string of type "cmd-name error msg",
  * it can be called for generating text for invalid command error strings
  * Ex strings that can be generated:
- * 1. log_cmd(CmdUnlock, STR_ILLEGAL) can be called for
+ * 1. log_cmd(ctx, CmdUnlock, STR_ILLEGAL) can be called for
  * ERROR_INVALID_COMMAND and output text looks like "Invalid command Unlock is
  * illegal for given HAB version"
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, expects command type,
  *
  * @param[in] msg, if not NULL then it will be included after command name
  *
  * @retval None
  */
-void log_cmd(commands_t cmd, char * msg)
+void log_cmd(cst_context_t *ctx, commands_t cmd, char * msg)
 {
     uint32_t i;               /**< Loop counter */
 
@@ -582,12 +448,12 @@ void log_cmd(commands_t cmd, char * msg)
     {
         if (command_map[i].type == cmd)
         {
-            log_error_msg(command_map[i].name);
+            log_error_msg(ctx, command_map[i].name);
         }
     }
 
     if (msg != NULL)
-        log_error_msg(msg);
+        log_error_msg(ctx, msg);
 }
 
 /** set label
@@ -600,6 +466,8 @@ void log_cmd(commands_t cmd, char * msg)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in][out] keyword, type keyword_t [in] is string_value and [out] is
  *                         uint32_t value,
  *
@@ -607,7 +475,7 @@ void log_cmd(commands_t cmd, char * msg)
  *
  * @retval #ERROR_UNDEFINED_LABEL  if keyword does not match with entries in label_map
  */
-int32_t set_label(keyword_t *keyword)
+int32_t set_label(cst_context_t *ctx, keyword_t *keyword)
 {
     uint32_t i;               /**< Loop counter */
 
@@ -622,7 +490,7 @@ int32_t set_label(keyword_t *keyword)
         return SUCCESS;
     }
 
-    log_error_msg(keyword->string_value);
+    log_error_msg(ctx, keyword->string_value);
     return ERROR_UNDEFINED_LABEL;
 }
 
@@ -670,13 +538,15 @@ int32_t append_uid_to_buffer(number_t *uid, uint8_t *buf,
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in][out] arg, type argument_t [in] is name and [out] is type
  *
  * @retval #SUCCESS  completed its task successfully
  *
  * @retval #ERROR_INVALID_ARGUMENT  if argument does not match with entries in argument_map
  */
-int32_t set_argument_type(argument_t *arg)
+int32_t set_argument_type(cst_context_t *ctx, argument_t *arg)
 {
     uint32_t i;               /**< Loop counter */
 
@@ -690,7 +560,7 @@ int32_t set_argument_type(argument_t *arg)
         return SUCCESS;
     }
 
-    log_error_msg(arg->name);
+    log_error_msg(ctx, arg->name);
     return ERROR_INVALID_ARGUMENT;
 }
 
@@ -704,6 +574,8 @@ int32_t set_argument_type(argument_t *arg)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, command type
  *
  * @retval SUCCESS  completed its task successfully
@@ -722,19 +594,19 @@ int32_t set_argument_type(argument_t *arg)
  * @retval ERROR_CMD_INSTALL_KEY_EXPECTED a Install Key command is expected
  *         but was not found.
  */
-static int32_t check_command_sequence(command_t *cmd)
+static int32_t check_command_sequence(cst_context_t *ctx, command_t *cmd)
 {
 
     /* True for each commands : CmdHeader must be the first
-     * to define g_target, g_hab_version and other global defaults.
+     * to define the target, HAB version and other CSF defaults.
      */
     if ((cmd->type != CmdHeader) &&
-       (g_cmd_seq_stage == WAITING_FOR_HEADER_STATE))
+       (ctx->cmd_seq_stage == WAITING_FOR_HEADER_STATE))
     {
         return ERROR_CMD_HEADER_NOT_FIRST;
     }
 
-    if (TGT_AHAB == g_target)
+    if (TGT_AHAB == ctx->target)
     {
         /* If AHAB is targeted, no specific order is expected (except header) */
         return SUCCESS;
@@ -744,9 +616,9 @@ static int32_t check_command_sequence(command_t *cmd)
     {
     case CmdHeader:
     /* Need to check header command appears only once. */
-        if (g_cmd_seq_stage == WAITING_FOR_HEADER_STATE)
+        if (ctx->cmd_seq_stage == WAITING_FOR_HEADER_STATE)
         {
-            g_cmd_seq_stage = INSTALL_SRK_STATE;
+            ctx->cmd_seq_stage = INSTALL_SRK_STATE;
         }
         else
         {
@@ -755,59 +627,59 @@ static int32_t check_command_sequence(command_t *cmd)
         break;
     case CmdInstallSRK:
     /* Check that next command is CmdInstallSRK */
-        if (g_cmd_seq_stage > INSTALL_SRK_STATE)
+        if (ctx->cmd_seq_stage > INSTALL_SRK_STATE)
         {
             return ERROR_CMD_IS_ALREADY_USED;
         }
         else
         {
-            g_cmd_seq_stage = INSTALL_CSFK_STATE;
+            ctx->cmd_seq_stage = INSTALL_CSFK_STATE;
         }
         break;
     case CmdInstallCSFK:
     case CmdInstallNOCAK:
     /* Check that next command is CmdInstallCSFK or CmdInstallNOCAK*/
-        if (g_cmd_seq_stage > INSTALL_CSFK_STATE)
+        if (ctx->cmd_seq_stage > INSTALL_CSFK_STATE)
         {
             return ERROR_CMD_IS_ALREADY_USED;
         }
-        else if (g_cmd_seq_stage < INSTALL_CSFK_STATE)
+        else if (ctx->cmd_seq_stage < INSTALL_CSFK_STATE)
         {
             return ERROR_CMD_INSTALL_SRK_EXPECTED;
         }
         else
         {
-            g_cmd_seq_stage = AUTH_CSF_STATE;
+            ctx->cmd_seq_stage = AUTH_CSF_STATE;
         }
         break;
     case CmdAuthenticateCSF:
     /* Check that next command is CmdAuthenticateCSF */
-        if (g_cmd_seq_stage > AUTH_CSF_STATE)
+        if (ctx->cmd_seq_stage > AUTH_CSF_STATE)
         {
             return ERROR_CMD_IS_ALREADY_USED;
         }
-        else if (g_cmd_seq_stage < AUTH_CSF_STATE)
+        else if (ctx->cmd_seq_stage < AUTH_CSF_STATE)
         {
             return ERROR_CMD_INSTALL_CSFK_EXPECTED;
         }
         else
         {
-            g_cmd_seq_stage = AUTH_CSF_NO_KEY_STATE;
+            ctx->cmd_seq_stage = AUTH_CSF_NO_KEY_STATE;
         }
         break;
     case CmdInstallKEY:
      /* Check that CmdInstallKey is used after CmdAuthenticateCSF.
      * This must be called before any CmdAuthenticateData.
      */
-        if (g_cmd_seq_stage >= AUTH_CSF_NO_KEY_STATE)
+        if (ctx->cmd_seq_stage >= AUTH_CSF_NO_KEY_STATE)
         {
-            if (g_cmd_seq_stage == AUTH_CSF_WITH_ENC_KEY_STATE)
+            if (ctx->cmd_seq_stage == AUTH_CSF_WITH_ENC_KEY_STATE)
             {
-                g_cmd_seq_stage = AUTH_CSF_WITH_BOTH_KEY_STATE;
+                ctx->cmd_seq_stage = AUTH_CSF_WITH_BOTH_KEY_STATE;
             }
             else
             {
-                g_cmd_seq_stage = AUTH_CSF_WITH_APP_KEY_STATE;
+                ctx->cmd_seq_stage = AUTH_CSF_WITH_APP_KEY_STATE;
             }
         }
         else
@@ -821,13 +693,13 @@ static int32_t check_command_sequence(command_t *cmd)
      * Note that it does not ensure that the installed key is the one
      * that is going to be used by the authenticate data command !
      */
-        if (g_cmd_seq_stage < AUTH_CSF_NO_KEY_STATE)
+        if (ctx->cmd_seq_stage < AUTH_CSF_NO_KEY_STATE)
         {
             return ERROR_CMD_EXPECTED_AFTER_AUT_CSF;
         }
-        else if ((g_no_ca == 0) &&
-                 ((g_cmd_seq_stage == AUTH_CSF_NO_KEY_STATE) ||
-                  (g_cmd_seq_stage == AUTH_CSF_WITH_ENC_KEY_STATE)))
+        else if ((ctx->no_ca == 0) &&
+                 ((ctx->cmd_seq_stage == AUTH_CSF_NO_KEY_STATE) ||
+                  (ctx->cmd_seq_stage == AUTH_CSF_WITH_ENC_KEY_STATE)))
         {
             return ERROR_CMD_INSTALL_KEY_EXPECTED;
         }
@@ -836,19 +708,19 @@ static int32_t check_command_sequence(command_t *cmd)
     /* Check that CmdInstallSecretKey is used after CmdAuthenticateCSF.
      * This must be called before any CmdDecryptData.
      */
-        if (g_hab_version <= HAB4)
+        if (ctx->hab_version <= HAB4)
         {
             return ERROR_INVALID_COMMAND;
         }
-        else if (g_cmd_seq_stage >= AUTH_CSF_NO_KEY_STATE)
+        else if (ctx->cmd_seq_stage >= AUTH_CSF_NO_KEY_STATE)
         {
-            if (g_cmd_seq_stage == AUTH_CSF_WITH_APP_KEY_STATE)
+            if (ctx->cmd_seq_stage == AUTH_CSF_WITH_APP_KEY_STATE)
             {
-                g_cmd_seq_stage = AUTH_CSF_WITH_BOTH_KEY_STATE;
+                ctx->cmd_seq_stage = AUTH_CSF_WITH_BOTH_KEY_STATE;
             }
             else
             {
-                g_cmd_seq_stage = AUTH_CSF_WITH_ENC_KEY_STATE;
+                ctx->cmd_seq_stage = AUTH_CSF_WITH_ENC_KEY_STATE;
             }
 
         }
@@ -861,16 +733,16 @@ static int32_t check_command_sequence(command_t *cmd)
     /* Check that CmdDecryptData is used after CmdAuthenticateCSF.
      * This must be called after a CmdInstallSecretKey.
      */
-        if (g_hab_version <= HAB4)
+        if (ctx->hab_version <= HAB4)
         {
             return ERROR_INVALID_COMMAND;
         }
-        else if (g_cmd_seq_stage < AUTH_CSF_NO_KEY_STATE)
+        else if (ctx->cmd_seq_stage < AUTH_CSF_NO_KEY_STATE)
         {
             return ERROR_CMD_EXPECTED_AFTER_AUT_CSF;
         }
-        else if ((g_cmd_seq_stage == AUTH_CSF_NO_KEY_STATE) ||
-                 (g_cmd_seq_stage == AUTH_CSF_WITH_APP_KEY_STATE))
+        else if ((ctx->cmd_seq_stage == AUTH_CSF_NO_KEY_STATE) ||
+                 (ctx->cmd_seq_stage == AUTH_CSF_WITH_APP_KEY_STATE))
         {
             return ERROR_CMD_INSTALL_SECKEY_EXPECTED;
         }
@@ -882,7 +754,7 @@ static int32_t check_command_sequence(command_t *cmd)
     case CmdUnlock:
     /* Must be used after CmdAuthenticateCSF for HAB4.
      */
-        if (g_cmd_seq_stage < AUTH_CSF_NO_KEY_STATE)
+        if (ctx->cmd_seq_stage < AUTH_CSF_NO_KEY_STATE)
         {
             return ERROR_CMD_EXPECTED_AFTER_AUT_CSF;
         }
@@ -910,6 +782,8 @@ static int32_t check_command_sequence(command_t *cmd)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, type command_t [in] is name and [out] is Id
  *
  * @retval #SUCCESS  completed its task successfully
@@ -928,7 +802,7 @@ static int32_t check_command_sequence(command_t *cmd)
  * @retval ERROR_CMD_INSTALL_KEY_EXPECTED a Install Key command is expected
  *         but was not found.
  */
-int32_t handle_command(command_t *cmd)
+int32_t handle_command(cst_context_t *ctx, command_t *cmd)
 {
     uint32_t i;               /**< Loop counter */
     int32_t ret = ERROR_INVALID_COMMAND;
@@ -943,16 +817,18 @@ int32_t handle_command(command_t *cmd)
     {
         cmd->type = command_map[i].type;
 
+        map_files(ctx, cmd);
+
         /* check if the command is correctly placed in the sequence */
-        ret = check_command_sequence(cmd);
+        ret = check_command_sequence(ctx, cmd);
 
         if (ret == SUCCESS)
         {
-            return (command_map[i].handler(cmd));
+            return (command_map[i].handler(ctx, cmd));
         }
     }
 
-    log_error_msg(cmd->name);
+    log_error_msg(ctx, cmd->name);
     return ret;
 }
 
@@ -1171,6 +1047,8 @@ int32_t get_hab4_engine_config(const int32_t engine, const eng_cfg_t eng_cfg)
  *
  * @par Operation
  *
+ * @param[in] ctx, context of the CSF being processed
+ *
  * @param[in] cmd, csf command where the file data (certificate or signature)
  *            pointer and size are saved
  * @param[in] file, cert or signature file name, NULL if data is provided.
@@ -1199,9 +1077,9 @@ int32_t get_hab4_engine_config(const int32_t engine, const eng_cfg_t eng_cfg)
  *
  * @retval #ERROR_CALCULATING_HASH, error in function get_hash
  */
-int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
-                       size_t cert_len, int32_t add_header, uint8_t **crt_hash,
-                       size_t *hash_len, int32_t hash_alg)
+int32_t save_file_data(cst_context_t *ctx, command_t *cmd, char *file,
+                       uint8_t *cert_data, size_t cert_len, int32_t add_header,
+                       uint8_t **crt_hash, size_t *hash_len, int32_t hash_alg)
 {
     size_t file_size;          /**< File size is read into it, useful in
                                     calulating length field of cmd header */
@@ -1240,7 +1118,7 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
         fh = fopen(file, "rb");
         if (fh == NULL)
         {
-            log_error_msg(file);
+            log_error_msg(ctx, file);
             return ERROR_FILE_NOT_PRESENT;
         }
 
@@ -1259,7 +1137,7 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
      * This will be the size of data we need to allocate.
      */
 
-    if (g_hab_version >= HAB4)
+    if (ctx->hab_version >= HAB4)
     {
         /**
          * With HAB4, each sig and cert has to start at a word boundary due
@@ -1285,7 +1163,7 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
         {
             if (fread(data+header_bytes, 1, file_size, fh) != (size_t)file_size)
             {
-                log_error_msg(file);
+                log_error_msg(ctx, file);
                 ret_val = ERROR_READING_FILE;
                 break;
             }
@@ -1298,7 +1176,7 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
         if (header_bytes != 0)
         {
             uint8_t hdr[] = {
-                HDR(hdr_tag, (file_size + header_bytes), g_hab_version)
+                HDR(hdr_tag, (file_size + header_bytes), ctx->hab_version)
             };       /**< Macro will output header bytes into hdr buffer */
 
             memcpy(data, hdr, header_bytes);
@@ -1317,9 +1195,9 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
             if (crt_hash == NULL)
             {
                 if (file)
-                    log_error_msg(file);
+                    log_error_msg(ctx, file);
                 else
-                    log_error_msg(STR_CERTIFICATE);
+                    log_error_msg(ctx, STR_CERTIFICATE);
 
                 ret_val = ERROR_CALCULATING_HASH;
                 break;
@@ -1335,17 +1213,21 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
     return ret_val;
 }
 
-/** creates signature file
+/** creates signature data
  *
  * @par Purpose
  *
  * Function calls adapt_layer api to generate signature data for the given
  * data, signature format, signature algorithm and certificate. The
- * generated signature data is saved into the file.
+ * generated signature data is saved into the command.
  *
  * @par Operation
  *
- * @param[in] file, filename for the signature
+ * @param[in] ctx, context of the CSF being processed
+ *
+ * @param[in] cmd, command the signature belongs to
+ *
+ * @param[in] data_name, name identifying the data to sign
  *
  * @param[in] cert_file, certificate file of signing key.
  *
@@ -1358,374 +1240,244 @@ int32_t save_file_data(command_t *cmd, char *file, uint8_t *cert_data,
  *
  * @retval #SUCCESS if everything goes fine
  *
- * @retval #ERROR_OPENING_FILE, fopen returns NULL
- *
- * @retval #ERROR_READING_FILE, fread returns incorrect number of bytes read
+ * @retval #ERROR_INSUFFICIENT_MEMORY, cannot allocate the signature data
  *
- * @retval #ERROR_CALCULATING_HASH, error in function get_hash
+ * @retval Errors returned by gen_sig_data_buffer
  */
-int32_t create_sig_file(char *file, char *cert_file,
-        sig_fmt_t sig_fmt, uint8_t *data,
+int32_t create_sig_data(cst_context_t *ctx, command_t *cmd, char *data_name,
+        char *cert_file, sig_fmt_t sig_fmt, const uint8_t *data,
         size_t data_size)
 {
     uint8_t sig[SIGNATURE_BUFFER_SIZE];  /**< Signature buffer on stack */
     hash_alg_t hash;    /**< Hash algorithm to pass into adaptation layer API */
     int32_t ret_val = SUCCESS; /**< Return and keep track of error status */
-    FILE *fh = NULL;           /**< File pointer */
 
-    LOG_DEBUG("create_sig_file file %s\n", file);
-    LOG_DEBUG("create_sig_file CERT file %s\n", cert_file);
-
-    hash = hab_hash_alg_to_hash_alg_type(g_hash_alg);
+    hash = hab_hash_alg_to_hash_alg_type(ctx->hash_alg);
     /**
-     * sig_size as input to gen_sig_data shows the size of buffer for
-     * signature data and gen_sig_data returns actual size of signature
+     * sig_size as input to gen_sig_data_buffer shows the size of buffer for
+     * signature data and gen_sig_data_buffer returns actual size of signature
      * data in this argument
      */
     size_t sig_size = SIGNATURE_BUFFER_SIZE;
 
-    do {
-        /**
-         * Create the binary file for storing data to sign. This file
-         * will be an input to gen_sig_data API
-         */
-        fh = fopen(file, "wb");
-        if (fh == NULL)
-        {
-            log_error_msg(file);
-            ret_val = ERROR_OPENING_FILE;
-            break;
-        }
-
-        if (fwrite(data, 1, data_size, fh) !=
-            data_size)
-        {
-            log_error_msg(file);
-            ret_val = ERROR_WRITING_FILE;
-            break;
-        }
-
-        fclose(fh);
-
-        /**
-         * Calling gen_sig_data to generate signature for data in file using
-         * certificate in cert_file. The signature data will be returned in
-         * sig and size of signature data in sig_size
-         */
-        // LOG_DEBUG("call gen_sig_data file %s\n", file);
-        // LOG_DEBUG("call gen_sig_data cert file %s\n", cert_file);
-        // LOG_DEBUG("call gen_sig_data hash type %d\n", hash);
-        // LOG_DEBUG("call gen_sig_data sig fmt %d\n", sig_fmt);
-        ret_val = gen_sig_data(file, cert_file, hash, sig_fmt,
-            sig, (size_t *)&sig_size, g_mode);
-        if (ret_val != SUCCESS)
-        {
-            log_error_msg(STR_ERR_SIG_GEN);
-            log_error_msg(file);
-            log_error_msg(STR_ERR_USING_CERT);
-            log_error_msg(cert_file);
-            break;
-        }
-        // LOG_DEBUG("call gen_sig_data sig size %zu\n", sig_size);
-
-        /**
-         * We use the same file to store signature data, opening it again
-         * in write mode will re-create the file.
-         */
-        fh = fopen(file, "wb");
-        if (fh == NULL)
-        {
-            log_error_msg(file);
-            ret_val = ERROR_OPENING_FILE;
-            break;
-        }
-        if (fwrite(sig, 1, sig_size, fh) != sig_size)
-        {
-            log_error_msg(file);
-            ret_val = ERROR_WRITING_FILE;
-            break;
-        }
-        fclose(fh);
-    } while(0);
+    /**
+     * Calling gen_sig_data_buffer to generate signature for data using
+     * certificate in cert_file. The signature data will be returned in
+     * sig and size of signature data in sig_size
+     */
+    ret_val = sig_cache_gen_sig_data_buffer(data, data_size, data_name,
+        cert_file, hash, sig_fmt, sig, &sig_size, ctx->mode);
+    if (ret_val != SUCCESS)
+    {
+        log_error_msg(ctx, STR_ERR_SIG_GEN);
+        log_error_msg(ctx, data_name);
+        log_error_msg(ctx, STR_ERR_USING_CERT);
+        log_error_msg(ctx, cert_file);
+        return ret_val;
+    }
+    printf("Sign Done! Signature size is %zu\n", sig_size);
 
-    return ret_val;
+    /* Save the signature data into command */
+    return save_file_data(ctx, cmd, NULL, sig, sig_size,
+        (ctx->hab_version >= HAB4), NULL, NULL, ctx->hash_alg);
 }
 
-/*===========================================================================
-                           LOCAL FUNCTION DEFINITION
-=============================================================================*/
-/** update_offsets_in_csf
+/** creates signature data from a digest
  *
  * @par Purpose
  *
- * This function is used in the second pass to update csf buffer with offsets
- * to signatures and certificates and csf length in header.
+ * Same as create_sig_data(), for data already hashed by the caller with
+ * the hash algorithm of the CSF.
  *
  * @par Operation
  *
- * @param[in] buf,  pointer to csf data
+ * @param[in] ctx, context of the CSF being processed
  *
- * @param[in] cmd_csf,  pointer to command for authenticate csf
+ * @param[in] cmd, command the signature belongs to
  *
- * @param[in] csf_len,  length of csf data
+ * @param[in] data_name, name identifying the data to sign
+ *
+ * @param[in] cert_file, certificate file of signing key.
+ *
+ * @param[in] sig_fmt, signature format of type sig_fmt_t defined in
+ *            adapt_layer.h
+ *
+ * @param[in] digest, message digest of the data to sign
+ *
+ * @param[in] digest_size, size of digest
  *
  * @retval #SUCCESS if everything goes fine
+ *
+ * @retval #CAL_NOT_SUPPORTED if the backend must be given the data, no
+ *         error is logged
+ *
+ * @retval Errors returned by gen_sig_data_digest
  */
-extern void utils_print_bio_array(uint8_t *buffer, size_t len, char* msg);
-static int update_offsets_in_csf(uint8_t * buf, command_t * cmd_csf, uint32_t csf_len)
+int32_t create_sig_data_digest(cst_context_t *ctx, command_t *cmd,
+        char *data_name, char *cert_file, sig_fmt_t sig_fmt,
+        const uint8_t *digest, size_t digest_size)
 {
-    int32_t cert_sig_offset = 0;    /**< Used to keep track of certificate or
-                                         Signature offsets in the cmd */
-    command_t * cmd;                /**< Ptr to command_t, used in the loop to
-                                       go through cmd list and update offsets
-                                       to certificate and signature data */
+    uint8_t sig[SIGNATURE_BUFFER_SIZE];  /**< Signature buffer on stack */
+    size_t sig_size = SIGNATURE_BUFFER_SIZE;
+    int32_t ret_val = SUCCESS; /**< Return and keep track of error status */
 
-    /* Update offsets in csf, set header.length */
-    if (g_hab_version >= HAB4)
+    if (gen_sig_data_digest == NULL)
     {
-        buf[CSF_HDR_LENGTH_OFFSET] = ((csf_len & 0xFF00) >> 8);
-        buf[CSF_HDR_LENGTH_OFFSET+1] = (csf_len & 0xFF);
+        return CAL_NOT_SUPPORTED;
     }
 
-    /* Loop through the csf commands and set sig/cert offsets for each command except
-       the authenticate csf command. The auth csf command offset will be updated last,
-       after all commands have been updated. This will ensure the csf signature is the
-       last signature in the csf data.
-    */
-    cmd = g_cmd_head;
-    cert_sig_offset = csf_len;
-    while(cmd != NULL)
-    {
-      if (cmd->start_offset_cert_sig > 0)
-        {
-            uint8_t offset_bytes[] = {
-                EXPAND_UINT32((uint32_t)cert_sig_offset)
-            };         /**< Macro puts offets into the buffer */
-
-            memcpy(&buf[cmd->start_offset_cert_sig], offset_bytes, 4);
-        }
-
-        cert_sig_offset += cmd->size_cert_sig;
-        cmd = cmd->next;
-    }
-    /* Finally, update the csf command offset */
-    uint8_t offset_bytes[] = { EXPAND_UINT32((uint32_t)cert_sig_offset) };
-    memcpy(&buf[cmd_csf->start_offset_cert_sig], offset_bytes, 4);
-    /* done with update offsets in csf */
+    ret_val = sig_cache_gen_sig_data_digest(digest, digest_size, cert_file,
+        hab_hash_alg_to_hash_alg_type(ctx->hash_alg), sig_fmt, sig,
+        &sig_size, ctx->mode);
 
-    return SUCCESS;
+    return save_sig_data(ctx, cmd, data_name, cert_file, ret_val, sig,
+        sig_size);
 }
-/** set_backend
+
+/** saves a signature generated apart
  *
  * @par Purpose
  *
- * This function is used to reassign backend API function pointers
- * to an alternate supported implementation.
+ * Completes create_sig_data_digest() or create_sig_data() for a signature
+ * generated apart, possibly on another thread: saves it in the command, or
+ * logs why it could not be generated.
  *
  * @par Operation
  *
- * @param[in] backend,  pointer to backend type string
+ * @param[in] ctx, context of the CSF being processed
+ *
+ * @param[in] cmd, command the signature belongs to
+ *
+ * @param[in] data_name, name identifying the signed data
+ *
+ * @param[in] cert_file, certificate file of signing key.
+ *
+ * @param[in] sig_ret, value returned by gen_sig_data_digest or
+ *            gen_sig_data_buffer
+ *
+ * @param[in] sig, signature returned with @a sig_ret
+ *
+ * @param[in] sig_size, size of sig
  *
  * @retval #SUCCESS if everything goes fine
+ *
+ * @retval #CAL_NOT_SUPPORTED if the backend must be given the data, no
+ *         error is logged
+ *
+ * @retval @a sig_ret if the signature was not generated
  */
-static int set_backend(char *backend)
+int32_t save_sig_data(cst_context_t *ctx, command_t *cmd,
+        char *data_name, char *cert_file, int32_t sig_ret, uint8_t *sig,
+        size_t sig_size)
 {
-  if ( !strcmp("pkcs11", backend) ) {
-    read_certificate = pkcs11_read_certificate;
-    gen_sig_data = pkcs11_gen_sig_data;
+    if (sig_ret == CAL_NOT_SUPPORTED)
     {
-      /* Verify OpenSSL pkcs11 engine is available */
-      openssl_initialize();
-      ENGINE *engine;
-
-      OPENSSL_init_crypto(OPENSSL_INIT_ADD_ALL_CIPHERS |
-                          OPENSSL_INIT_ADD_ALL_DIGESTS |
-                          OPENSSL_INIT_LOAD_CONFIG,
-                          NULL);
-
-      ERR_clear_error();
-      ENGINE_load_builtin_engines();
-      engine = ENGINE_by_id("pkcs11");
-
-      if (engine == NULL) {
-        printf("engine not found:\t%s\n\n",ERR_reason_error_string(ERR_get_error()));
-        return ERROR_INVALID_ARGUMENT;
-      }
+        return sig_ret;
     }
-  } else if ( !strcmp("ssl", backend) ) {
-    read_certificate = ssl_read_certificate;
-    gen_sig_data = ssl_gen_sig_data;
-  } else {
-    printf("Unsupported backend: %s\n",backend);
-    return ERROR_INVALID_ARGUMENT;
-  }
+    if (sig_ret != SUCCESS)
+    {
+        log_error_msg(ctx, STR_ERR_SIG_GEN);
+        log_error_msg(ctx, data_name);
+        log_error_msg(ctx, STR_ERR_USING_CERT);
+        log_error_msg(ctx, cert_file);
+        return sig_ret;
+    }
+    printf("Sign Done! Signature size is %zu\n", sig_size);
 
-  return SUCCESS;
+    /* Save the signature data into command */
+    return save_file_data(ctx, cmd, NULL, sig, sig_size,
+        (ctx->hab_version >= HAB4), NULL, NULL, ctx->hash_alg);
 }
 
-/** prints the command line usage
+/** Allocate a CSF context
  *
- * Prints the usage information for running cst. It also shows
- * examples of command line parameters to cst
+ * @par Purpose
  *
- * @pre  This function is called from process_cmdline_args() if failed to
- *       process command line successfully.
+ * Allocates the state describing a CSF, set to the defaults expected
+ * before the Header command is processed.
  *
- * @post The usage info will be printed out on console window.
+ * @retval the context, to be freed with cst_context_free(), or NULL if
+ *         it cannot be allocated
  */
-static void print_usage(void)
+cst_context_t *cst_context_new(void)
 {
-    printf("Usage: \n\n");
-    printf("To generate output binary CSF using Code Signing Tool \n");
-    printf("===================================================== \n\n");
-    printf("cst --output <bin_csf> --input <input_csf> \n\n");
-    printf("-o, --output <binary csf>:\n");
-    printf("    Output binary CSF filename\n\n");
-    printf("-i, --input <csf text file>:\n");
-    printf("    Input CSF text filename\n\n");
-    printf("-c, --cert <public key certificate>:\n");
-    printf("    Optional, Input public key certificate to encrypt the dek\n\n");
-    printf("-b, --backend <ssl or pkcs11>:\n");
-    printf("    Optional, Select backend. SSL backend is the default and\n");
-    printf("    uses keys stored in the local host filesystem. The PKCS11\n");
-    printf("    backend supplies an interface to PKCS11 supported keystore.\n");
-    printf("-g, --verbose:\n");
-    printf("    Optional, displays verbose information.  No ");
-    printf("additional\n    arguments are required\n\n");
-    printf("-l, --license:\n");
-    printf("    Optional, displays program license information.  No ");
-    printf("additional\n    arguments are required\n\n");
-    printf("-v, --version:\n");
-    printf("    Optional, displays the version of the tool.  No additional\n");
-    printf("    arguments are required\n\n");
-    printf("-h, --help:\n");
-    printf("    Optional, displays usage information.  No additional\n");
-    printf("    arguments are required\n\n");
-    printf("Examples:\n");
-    printf("---------\n\n");
-    printf("1. To generate out_csf.bin file from input hab4.csf, use\n");
-    printf("    cst -o out_csf.bin -i hab4.csf \n\n");
-    printf("2. To generate out_csf.bin file from input hab4.csf and");
-    printf("      output a plaintext dek, use\n");
-    printf("    cst -o out_csf.bin -i hab4.csf \n\n");
-    printf("3. To generate out_csf.bin file from input hab4.csf and \n");
-    printf("    encrypt the dek with cert.pem, use\n");
-    printf("    cst -o out_csf.bin -c cert.pem -i hab4.csf \n\n");
-    printf("4. To print program license information, use\n");
-    printf("    cst --license \n\n");
-    printf("5. This is the carlos modified version. \n\n");
+    cst_context_t *ctx = calloc(1, sizeof(cst_context_t));
+
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+
+    ctx->error_code = SUCCESS;
+    ctx->cmd_seq_stage = WAITING_FOR_HEADER_STATE;
+    ctx->target = TGT_UNDEF;
+    ctx->mode = MODE_UNDEF;
+    ctx->sig_format = SIG_FMT_UNDEF;
+    ctx->srk_set_hab4 = SRK_SET_OEM;
+
+    ctx->dek = ssl_new_dek();
+    if (ctx->dek == NULL)
+    {
+        free(ctx);
+        return NULL;
+    }
+
+    return ctx;
 }
 
-/** Process command line arguments for code signing tool (cst)
+/** Free a CSF context
  *
  * @par Purpose
  *
- * Process command line arguments for cst and calls respective
- * functions based no commands specified at command line.
+ * Frees the lexer, the commands list and the certificate or signature
+ * data attached to the commands of the context.
  *
- * @param[in] argc, number of arguments in argv
- *
- * @param[in] argv, arguments list
- *
- * @param[out] out_bin_csf, ptr to return name for binary csf
+ * @param[in] ctx, context to free, may be NULL
  */
-static void process_cmdline_args(int argc, char* argv[], char **out_bin_csf)
+void cst_context_free(cst_context_t *ctx)
 {
-    int  next_option = 0;        /**< Option count from cmd line */
-
-    do
+    if (ctx == NULL)
     {
-        next_option = getopt_long(argc, argv, short_options,
-                                  long_options, NULL);
-        switch (next_option)
-        {
-            /* Display License information */
-            case 'l':
-                print_license();
-                exit(0);
-                break;
-            /* Display version information */
-            case 'v':
-                print_version();
-                exit(0);
-                break;
-            /* Display usage */
-            case 'h':
-                print_usage();
-                exit(0);
-                break;
-            /* Display verbose information */
-            case 'g':
-                g_verbose = 1;
-                break;
-            /* Option o - output csf binary file */
-            case 'o':
-                *out_bin_csf = optarg;
-                break;
-            /* Option i - input csf text file */
-            case 'i':
-                g_in_csf_file = optarg;
-                break;
-            /* Option c - input public key cert used for
-                  encrypting dek */
-            case 'c':
-                g_cert_dek = optarg;
-                break;
-            /* Option d - input data encryption key */
-            case 'd':
-                g_reuse_dek = 1;
-                break;
-            /* Option s - skip user prompt */
-            case 's':
-                g_skip = 1;
-                break;
-            case 'b':
-                if (set_backend(optarg)) {
-                  print_usage();
-                  exit(1);
-                }
-                break;
-            case '?':
-                print_usage();
-                exit(1);
-                break;
-            default:    /* Something else: unexpected.  */
-                break;
-        }
-    } while (next_option != -1);
+        return;
+    }
 
-    /* Check for minimum number of arguments */
-    if (argc  < MIN_NUM_CLI_ARGS)
+    if (ctx->scanner != NULL)
     {
-        print_usage();
-        exit(1);
+        yylex_destroy(ctx->scanner);
     }
+    free_authenticate_data(ctx);
+    free_block_files(ctx);
+    free_cmd_list(ctx, ctx->cmd_head);
+    ssl_free_dek(ctx->dek);
+    free(ctx);
 }
 
-/** main function of cst application
+/** Process a CSF
  *
  * @par Purpose
  *
- * Main CST function.
- * Call parser to parse CSF file.
+ * Call parser to parse the CSF text.
  * Generates CSF signature for data in csf_buffer.
  * Attached the csf signature buffer to csf cmd structure.
  * Creates output csf binary file with csf_buffer data, signatures and
  *  certificates.
- * Print out error messages on stdout.
  *
  * @par Operation
  *
- * @param[in] argc, number of arguments in argv
+ * @param[in] ctx, context of the CSF, from cst_context_new()
+ *
+ * @param[in] fi, CSF text to parse
  *
- * @param[in] argv, csf output binary file to create should be passed in argv[1]
+ * @param[in] out_bin_csf, filename of the output binary csf
+ *
+ * @retval #SUCCESS if everything goes fine, the parser status or one of the
+ *         error codes defined in csf.h otherwise
  */
-int32_t main(int32_t argc, char* argv[])
+int32_t cst_process_csf(cst_context_t *ctx, FILE *fi, char *out_bin_csf)
 {
     int32_t ret_val = SUCCESS;      /**< Used for keeping track of error
                                          values returned by functions */
     FILE *fo = NULL;                /**< File pointer for output csf binary */
-    FILE *fi = NULL;                /**< File pointer for input csf text file */
     command_t *cmd = NULL;          /**< Ptr to command_t, used in the loop to
                                        go through cmd list and update offsets
                                        to certificate and signature data */
@@ -1736,53 +1488,15 @@ int32_t main(int32_t argc, char* argv[])
     command_t *cmd_csfk = NULL;      /**< Ptr to save address of install csf
                                          key command */
 
-    char *out_bin_csf = NULL;       /**< Ptr to filename for output binary csf,
-                                         an argument passed to cst */
-
-    command_t unlk_cmd;
-    argument_t unlk_args[2];
-    keyword_t unlk_keywords[2];
-
-    /* Set the backend function pointers to the openssl host backend */
-    set_backend("ssl");
-
-    memset(g_csf_buffer, 0, HAB_CSF_BYTES_MAX);
-
-    memset(error_log, 0, MAX_ERROR_STR_LEN);
-
-    openssl_initialize();
-    process_cmdline_args(argc, argv, &out_bin_csf);
-
-    if (g_reuse_dek)
-    {
-        prompt_key_reuse_msg();
-    }
-
-    if (out_bin_csf == NULL)
-    {
-        /* Can't proceed without output binary file name */
-        printf("Missing --o argument\n");
-        return 0;
-    }
-
-    if (g_in_csf_file == NULL)
+    if (ctx->scanner == NULL &&
+        yylex_init_extra(ctx, &ctx->scanner) != 0)
     {
-        printf("Missing --i argument\n");
-        return 0;
+        return ERROR_INSUFFICIENT_MEMORY;
     }
 
-    /* Open CSF text file to be read by parser */
-    fi = fopen(g_in_csf_file, "r");
-    if (!fi)
-    {
-        printf("Unable to open %s", g_in_csf_file);
-        return 0;
-    }
-
-    LOG_DEBUG("open file %s\n", g_in_csf_file);
-    // set lex to read from file handler instead of defaulting to STDIN
-    yyin = fi;
-    if ((ret_val = yyparse()) == SUCCESS)
+    /* set lex to read from file handler instead of defaulting to STDIN */
+    yyset_in(fi, ctx->scanner);
+    if ((ret_val = yyparse(ctx, ctx->scanner)) == SUCCESS)
     {
         /*
          * If the header specified CAAM as the engine,
@@ -1791,66 +1505,74 @@ int32_t main(int32_t argc, char* argv[])
          *  - It was already in CSF input file
          *  - CSF input file contains Init RNG command
          */
-        if ((g_engine == HAB_ENG_CAAM) &&
-            ((g_init_rng == 0) && (g_unlock_rng == 0)))
+        if ((ctx->engine == HAB_ENG_CAAM) &&
+            ((ctx->init_rng == 0) && (ctx->unlock_rng == 0)))
         {
-            unlk_args[0].next = &unlk_args[1];
-            unlk_args[0].name = "Engine";
-            unlk_args[0].type = EngineName;
-            unlk_args[0].value_count = 1;
-            unlk_args[0].value_type = KEYWORD_TYPE;
-            unlk_args[0].value.str = "";
-            unlk_args[0].value.keyword = &unlk_keywords[0];
-            unlk_keywords[0].next = NULL;
-            unlk_keywords[0].string_value = "CAAM";
-            unlk_keywords[0].unsigned_value = HAB_ENG_CAAM;
-
-            unlk_args[1].next = NULL;
-            unlk_args[1].name = "Features";
-            unlk_args[1].type = Features;
-            unlk_args[1].value_count = 1;
-            unlk_args[1].value_type = KEYWORD_TYPE;
-            unlk_args[1].value.str = "";
-            unlk_args[1].value.keyword = &unlk_keywords[1];
-            unlk_keywords[1].next = NULL;
-            unlk_keywords[1].string_value = "RNG";
-            unlk_keywords[1].unsigned_value = HAB_CAAM_UNLOCK_RNG;
-
-            unlk_cmd.next = NULL;
-            unlk_cmd.name = "Unlock";
-            unlk_cmd.type = CmdUnlock;
-            unlk_cmd.argument_count = 2;
-            unlk_cmd.argument = &unlk_args[0];
-            unlk_cmd.cert_sig_data = NULL;
-            unlk_cmd.size_cert_sig = 0;
-            unlk_cmd.start_offset_cert_sig = 0;
-
-            cmd_handler_unlock(&unlk_cmd);
+            ctx->unlk_args[0].next = &ctx->unlk_args[1];
+            ctx->unlk_args[0].name = "Engine";
+            ctx->unlk_args[0].type = EngineName;
+            ctx->unlk_args[0].value_count = 1;
+            ctx->unlk_args[0].value_type = KEYWORD_TYPE;
+            ctx->unlk_args[0].value.str = "";
+            ctx->unlk_args[0].value.keyword = &ctx->unlk_keywords[0];
+            ctx->unlk_keywords[0].next = NULL;
+            ctx->unlk_keywords[0].string_value = "CAAM";
+            ctx->unlk_keywords[0].unsigned_value = HAB_ENG_CAAM;
+
+            ctx->unlk_args[1].next = NULL;
+            ctx->unlk_args[1].name = "Features";
+            ctx->unlk_args[1].type = Features;
+            ctx->unlk_args[1].value_count = 1;
+            ctx->unlk_args[1].value_type = KEYWORD_TYPE;
+            ctx->unlk_args[1].value.str = "";
+            ctx->unlk_args[1].value.keyword = &ctx->unlk_keywords[1];
+            ctx->unlk_keywords[1].next = NULL;
+            ctx->unlk_keywords[1].string_value = "RNG";
+            ctx->unlk_keywords[1].unsigned_value = HAB_CAAM_UNLOCK_RNG;
+
+            ctx->unlk_cmd.next = NULL;
+            ctx->unlk_cmd.name = "Unlock";
+            ctx->unlk_cmd.type = CmdUnlock;
+            ctx->unlk_cmd.argument_count = 2;
+            ctx->unlk_cmd.argument = &ctx->unlk_args[0];
+            ctx->unlk_cmd.cert_sig_data = NULL;
+            ctx->unlk_cmd.size_cert_sig = 0;
+            ctx->unlk_cmd.start_offset_cert_sig = 0;
+
+            cmd_handler_unlock(ctx, &ctx->unlk_cmd);
 
             /* Add unlock command to end of command list */
-            cmd = g_cmd_head;
+            cmd = ctx->cmd_head;
             while (cmd->next != NULL) {
                 cmd = cmd->next;
             }
-            cmd->next = &unlk_cmd;
+            cmd->next = &ctx->unlk_cmd;
         }
 
-        if (TGT_AHAB == g_target)
+        if (TGT_AHAB == ctx->target)
         {
-            g_ahab_data.destination = out_bin_csf;
-            return handle_ahab_signature();
+            ctx->ahab_data.destination = out_bin_csf;
+            return handle_ahab_signature(ctx);
         }
 
         /* Parsing completed successfully, generate the csf signature */
         do {
-            uint32_t csfk_idx = (g_srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
+            uint32_t csfk_idx = (ctx->srk_set_hab4 == SRK_SET_OEM) ? HAB_IDX_CSFK : HAB_IDX_CSFK1;
 
             /* Adjust CSFK index if NOCAK */
-            if (g_no_ca == 1) {
+            if (ctx->no_ca == 1) {
                 csfk_idx = HAB_IDX_CSFK;
             }
 
-            cmd = g_cmd_head;
+            /* Signatures of the Authenticate Data commands are laid out
+             * before the CSF signature */
+            ret_val = sign_authenticate_data(ctx);
+            if (ret_val != SUCCESS)
+            {
+                break;
+            }
+
+            cmd = ctx->cmd_head;
 
             while(cmd != NULL)
             {
@@ -1879,22 +1601,14 @@ int32_t main(int32_t argc, char* argv[])
                 break;
             }
 
-            update_offsets_in_csf(g_csf_buffer, cmd_csf, g_csf_buffer_index);
-
-            /* create signature for csf data into FILE_SIG_CSF_DATA */
-            ret_val = create_sig_file(FILE_SIG_CSF_DATA,
-                g_key_certs[csfk_idx],
-                (g_hab_version >= HAB4) ? SIG_FMT_CMS : SIG_FMT_PKCS1,
-                g_csf_buffer,
-                g_csf_buffer_index);
-
-            if (ret_val != SUCCESS)
-            {
-                break;
-            }
+            update_offsets_in_csf(ctx, ctx->csf_buffer, cmd_csf, ctx->csf_buffer_index);
 
-            ret_val = save_file_data(cmd_csf, FILE_SIG_CSF_DATA, NULL, 0,
-                (g_hab_version >= HAB4), NULL, NULL, g_hash_alg);
+            /* create signature for csf data into cmd_csf */
+            ret_val = create_sig_data(ctx, cmd_csf, FILE_SIG_CSF_DATA,
+                ctx->key_certs[csfk_idx],
+                (ctx->hab_version >= HAB4) ? SIG_FMT_CMS : SIG_FMT_PKCS1,
+                ctx->csf_buffer,
+                ctx->csf_buffer_index);
             if (ret_val != SUCCESS)
             {
                 break;
@@ -1903,24 +1617,24 @@ int32_t main(int32_t argc, char* argv[])
             fo = fopen(out_bin_csf, "wb");
             if (fo == NULL )
             {
-                log_error_msg(out_bin_csf);
+                log_error_msg(ctx, out_bin_csf);
                 ret_val = ERROR_OPENING_FILE;
                 break;
             }
 
-            /* write g_csf_buffer to output file */
-            if (fwrite(g_csf_buffer, 1, g_csf_buffer_index, fo) !=
-                g_csf_buffer_index)
+            /* write ctx->csf_buffer to output file */
+            if (fwrite(ctx->csf_buffer, 1, ctx->csf_buffer_index, fo) !=
+                ctx->csf_buffer_index)
             {
-                log_error_msg(out_bin_csf);
+                log_error_msg(ctx, out_bin_csf);
                 ret_val = ERROR_WRITING_FILE;
                 break;
             }
 
             /* append sigs & certs to output file */
-            if (g_hab_version >= HAB4)
+            if (ctx->hab_version >= HAB4)
             {
-                cmd = g_cmd_head;
+                cmd = ctx->cmd_head;
                 while(cmd != NULL)
                 {
                     if (cmd->cert_sig_data == NULL || cmd == cmd_csf)
@@ -1931,7 +1645,7 @@ int32_t main(int32_t argc, char* argv[])
                     if (fwrite(cmd->cert_sig_data, 1, cmd->size_cert_sig, fo) !=
                             cmd->size_cert_sig)
                     {
-                        log_error_msg(out_bin_csf);
+                        log_error_msg(ctx, out_bin_csf);
                         ret_val = ERROR_WRITING_FILE;
 
                         break;
@@ -1943,182 +1657,282 @@ int32_t main(int32_t argc, char* argv[])
                   if (fwrite(cmd_csf->cert_sig_data, 1, cmd_csf->size_cert_sig, fo) !=
                       cmd_csf->size_cert_sig)
                     {
-                      log_error_msg(out_bin_csf);
+                      log_error_msg(ctx, out_bin_csf);
                       ret_val = ERROR_WRITING_FILE;
                     }
                 }
             }
             /* Reached here means everything work good and csf data generated
              * in file out_bin_csf, log the name for later use */
-            log_error_msg(out_bin_csf);
+            log_error_msg(ctx, out_bin_csf);
 
         } while(0);
     }
 
     if (fo)
         fclose(fo);
-    if (fi)
-        fclose(fi);
 
-    remove(FILE_SIG_CSF_DATA);
-    remove(FILE_SIG_IMG_DATA);
+    return ret_val;
+}
+
+/** set_backend
+ *
+ * @par Purpose
+ *
+ * This function is used to reassign backend API function pointers
+ * to an alternate supported implementation.
+ *
+ * The pointers are shared by the whole process. They must be set before
+ * the first CSF is processed, as CSFs processed concurrently read them
+ * without a lock.
+ *
+ * @par Operation
+ *
+ * @param[in] backend,  pointer to backend type string
+ *
+ * @retval #SUCCESS if everything goes fine
+ *
+ * @retval #ERROR_INVALID_ARGUMENT if the backend is not supported or its
+ *         OpenSSL engine is not available
+ */
+int32_t set_backend(const char *backend)
+{
+  if ( !strcmp("pkcs11", backend) ) {
+    read_certificate = pkcs11_read_certificate;
+    gen_sig_data = pkcs11_gen_sig_data;
+    gen_sig_data_buffer = pkcs11_gen_sig_data_buffer;
+    gen_sig_data_digest = pkcs11_gen_sig_data_digest;
+    gen_sig_data_concurrent = 0;
+    {
+      /* Verify OpenSSL pkcs11 engine is available */
+      openssl_initialize();
+      ENGINE *engine;
 
-    remove(FILE_PLAIN_DATA);
-    remove(FILE_ENCRYPTED_DATA);
+      OPENSSL_init_crypto(OPENSSL_INIT_ADD_ALL_CIPHERS |
+                          OPENSSL_INIT_ADD_ALL_DIGESTS |
+                          OPENSSL_INIT_LOAD_CONFIG,
+                          NULL);
 
-    fflush(NULL);
+      ERR_clear_error();
+      ENGINE_load_builtin_engines();
+      engine = ENGINE_by_id("pkcs11");
 
-    if (g_error_code != SUCCESS)
-    {
-        print_error_msg(g_error_code);
+      if (engine == NULL) {
+        printf("engine not found:\t%s\n\n",ERR_reason_error_string(ERR_get_error()));
+        return ERROR_INVALID_ARGUMENT;
+      }
     }
-    else
+  } else if ( !strcmp("ssl", backend) ) {
+    read_certificate = ssl_read_certificate;
+    gen_sig_data = ssl_gen_sig_data;
+    gen_sig_data_buffer = ssl_gen_sig_data_buffer;
+    gen_sig_data_digest = ssl_gen_sig_data_digest;
+    gen_sig_data_concurrent = ssl_gen_sig_data_concurrent;
+  } else {
+    printf("Unsupported backend: %s\n",backend);
+    return ERROR_INVALID_ARGUMENT;
+  }
+
+  return SUCCESS;
+}
+
+/*===========================================================================
+                           LOCAL FUNCTION DEFINITION
+=============================================================================*/
+/** update_offsets_in_csf
+ *
+ * @par Purpose
+ *
+ * This function is used in the second pass to update csf buffer with offsets
+ * to signatures and certificates and csf length in header.
+ *
+ * @par Operation
+ *
+ * @param[in] ctx,  context of the CSF being processed
+ *
+ * @param[in] buf,  pointer to csf data
+ *
+ * @param[in] cmd_csf,  pointer to command for authenticate csf
+ *
+ * @param[in] csf_len,  length of csf data
+ *
+ * @retval #SUCCESS if everything goes fine
+ */
+extern void utils_print_bio_array(uint8_t *buffer, size_t len, char* msg);
+static int update_offsets_in_csf(cst_context_t *ctx, uint8_t * buf,
+                                 command_t * cmd_csf, uint32_t csf_len)
+{
+    int32_t cert_sig_offset = 0;    /**< Used to keep track of certificate or
+                                         Signature offsets in the cmd */
+    command_t * cmd;                /**< Ptr to command_t, used in the loop to
+                                       go through cmd list and update offsets
+                                       to certificate and signature data */
+
+    /* Update offsets in csf, set header.length */
+    if (ctx->hab_version >= HAB4)
     {
-        print_error_msg(ret_val);
+        buf[CSF_HDR_LENGTH_OFFSET] = ((csf_len & 0xFF00) >> 8);
+        buf[CSF_HDR_LENGTH_OFFSET+1] = (csf_len & 0xFF);
     }
 
-    /* Return a non-zero value on error otherwise 0 */
-    if (g_error_code || ret_val)
+    /* Loop through the csf commands and set sig/cert offsets for each command except
+       the authenticate csf command. The auth csf command offset will be updated last,
+       after all commands have been updated. This will ensure the csf signature is the
+       last signature in the csf data.
+    */
+    cmd = ctx->cmd_head;
+    cert_sig_offset = csf_len;
+    while(cmd != NULL)
     {
-        return CST_FAILURE_EXIT_CODE;
+      if (cmd->start_offset_cert_sig > 0)
+        {
+            uint8_t offset_bytes[] = {
+                EXPAND_UINT32((uint32_t)cert_sig_offset)
+            };         /**< Macro puts offets into the buffer */
+
+            memcpy(&buf[cmd->start_offset_cert_sig], offset_bytes, 4);
+        }
+
+        cert_sig_offset += cmd->size_cert_sig;
+        cmd = cmd->next;
     }
+    /* Finally, update the csf command offset */
+    uint8_t offset_bytes[] = { EXPAND_UINT32((uint32_t)cert_sig_offset) };
+    memcpy(&buf[cmd_csf->start_offset_cert_sig], offset_bytes, 4);
+    /* done with update offsets in csf */
+
     return SUCCESS;
 }
-
-/** Prints error msg
+/** Map the files of a command
  *
  * @par Purpose
  *
- * Prints error message uinsg passed error_code and error_log.
+ * Replaces the files referenced by the arguments of a command with the
+ * files the context maps them to, if any.
  *
  * @par Operation
  *
- * @param[in] error_code, one of error codes defined in csf.h file
+ * @param[in] ctx, context holding the file map
  *
- * @retval None
+ * @param[in] cmd, command whose File, Signature and Blocks arguments are
+ *            updated
  */
-static void print_error_msg(const int32_t error_code)
+static void map_files(cst_context_t *ctx, command_t *cmd)
 {
-    switch (error_code)
+    argument_t *arg = NULL;         /**< Argument being mapped */
+    keyword_t *keyword = NULL;      /**< File of a File or Signature arg */
+    block_t *block = NULL;          /**< Block of a Blocks argument */
+    size_t i;                       /**< Loop counter */
+
+    for (arg = cmd->argument; arg != NULL; arg = arg->next)
     {
-    case SUCCESS:
-        printf("CSF Processed successfully and signed data available in %s\n", error_log);
-        break;
-    case ERROR_INVALID_ARGUMENT:
-        printf("Invalid argument: %s\n", error_log);
-        break;
-    case ERROR_INSUFFICIENT_ARGUMENTS:
-        printf("Missing mandatory argument %s\n", error_log);
-        break;
-    case ERROR_INVALID_COMMAND:
-        printf("Invalid command: %s\n", error_log);
-        break;
-    case ERROR_FILE_NOT_PRESENT:
-        printf("File not present %s\n", error_log);
-        break;
-    case ERROR_OPENING_FILE:
-        printf("Failed opening file %s\n", error_log);
-        break;
-    case ERROR_READING_FILE:
-        printf("Failed reading file %s\n", error_log);
-        break;
-    case ERROR_WRITING_FILE:
-        printf("Failed writing file %s\n", error_log);
-        break;
-    case ERROR_CALCULATING_HASH:
-        printf("Error calculating hash for %s\n", error_log);
-        break;
-    case ERROR_INSUFFICIENT_MEMORY:
-        printf("Memory overrun, failed to allocated enough memory %s\n", error_log);
-        break;
-    case ERROR_INVALID_BLOCK_ARGUMENTS:
-        printf("Invalid Block arguments, %s\n", error_log);
-        break;
-    case ERROR_CMD_HEADER_NOT_FIRST:
-        printf("Error in CSF: command [Header] must be the first, before" \
-               " a command [%s]\n", error_log);
-        break;
-    case ERROR_UNSUPPORTED_ARGUMENT:
-        printf("Unsupported argument: %s\n", error_log);
-        break;
-    case ERROR_UNDEFINED_LABEL:
-        printf("Undefined label: %s\n", error_log);
-        break;
-    case ERROR_AUT_CSF_CMD_NOT_FOUND:
-        printf("Failed to find authenticate CSF command %s\n", error_log);
-        break;
-    case ERROR_INS_CSFK_CMD_NOT_FOUND:
-        printf("Failed to find install csf key command %s\n", error_log);
-        break;
-    case ERROR_INVALID_SRK_TABLE:
-        printf("Super Root Key table is invalid in file %s\n", error_log);
-        break;
-    case ERROR_INVALID_PKEY_CERTIFICATE:
-        printf("Public key certificate is invalid in file %s\n", error_log);
-        break;
-    case ERROR_CMD_IS_ALREADY_USED:
-        printf("Error in CSF: multiple instances of command [%s] cannot " \
-               "be used\n", error_log);
-        break;
-    case ERROR_CMD_INSTALL_SRK_EXPECTED:
-        printf("Error in CSF: command [%s] misplaced, the command " \
-               "[Install SRK] is expected after [Header]\n", error_log);
-        break;
-    case ERROR_CMD_INSTALL_CSFK_EXPECTED:
-        printf("Error in CSF: command [%s] misplaced, the command " \
-               "[Install CSFK] is expected after [Install SRK]\n", error_log);
-        break;
-    case ERROR_CMD_EXPECTED_AFTER_AUT_CSF:
-        printf("Error in CSF: command [%s] expected after [Authenticate CSF] " \
-               "which is expected after [Install CSFK]\n", error_log);
-        break;
-    case ERROR_CMD_INSTALL_KEY_EXPECTED:
-        printf("Error in CSF: a command [Install key] is expected prior to " \
-               "the usage of the key by an [Authenticate data] command\n");
-        break;
-    case ERROR_CMD_INSTALL_SECKEY_EXPECTED:
-        printf("Error in CSF: a command [Install Secret key] is expected prior to " \
-               "the usage of the key by a [Decrypt data] command\n");
-        break;
-    case ERROR_GENERATING_RANDOM_KEY:
-        printf("An error reported by backend in generating random key %s\n", error_log);
-        break;
-    case ERROR_IN_ENCRYPTION:
-        printf("An error is reported by backend during encryption %s\n", error_log);
-        break;
-    default:
-        printf("Undefined error\n");
+        for (i = 0; i < ctx->file_map_count; i++)
+        {
+            const file_map_t *map = &ctx->file_map[i];
+
+            if ((arg->type == Filename || arg->type == Signature) &&
+                arg->value_type == KEYWORD_TYPE)
+            {
+                for (keyword = arg->value.keyword; keyword != NULL;
+                     keyword = keyword->next)
+                {
+                    if (!strcmp(keyword->string_value, map->name))
+                    {
+                        keyword->string_value = map->path;
+                    }
+                }
+            }
+            else if (arg->type == Blocks && arg->value_type == BLOCK_TYPE)
+            {
+                for (block = arg->value.block; block != NULL;
+                     block = block->next)
+                {
+                    if (!strcmp(block->block_filename, map->name))
+                    {
+                        block->block_filename = map->path;
+                    }
+                }
+            }
+        }
     }
 }
-/** Prompt user agreement for key reuse
+
+/** Free a commands list
  *
  * @par Purpose
  *
- * Prompt user agreement for resusing a data encryption key
+ * Frees the commands built by the parser, their arguments and the
+ * certificate or signature data attached to them. Strings are left alone
+ * as some of them are not owned by the commands list.
  *
- * @par Operation
+ * @param[in] ctx, context owning the commands list
  *
- * @retval None
+ * @param[in] cmd, head of the commands list
  */
-static void prompt_key_reuse_msg(void )
+static void free_cmd_list(cst_context_t *ctx, command_t *cmd)
 {
-    printf("NOTICE: Key-reuse for encryption undermines security of otherwise"
-           " trustworthy systems.\nEncrypting multiple data sets with the"
-           " same key, leaks enough information for an attacker to decrypt"
-           " any data set without knowing the encryption key.\n"
-           "The key-reuse feature is only meant to be used in development"
-           " and not production. ");
-    if (!g_skip)
+    command_t *next_cmd = NULL;     /**< Next command to free */
+    argument_t *arg = NULL;         /**< Argument being freed */
+    argument_t *next_arg = NULL;    /**< Next argument to free */
+
+    while (cmd != NULL)
     {
-        char *buffer = malloc(sizeof(char) * 32);
-        size_t bufsize = 32;
-        size_t chars_read = 0;
-        printf("\n\nBy using this option, you understand the risk"
-                   " and assume full responsability.");
-        do {
-            printf("\nDo want to continue? (y/n)");
-            chars_read = getline(&buffer, &bufsize, stdin);
-        } while (!((buffer[0] == 'Y' || buffer[0] == 'y') && chars_read == 2));
+        next_cmd = cmd->next;
+
+        /* The Unlock RNG command added by cst is not heap allocated */
+        if (cmd == &ctx->unlk_cmd)
+        {
+            cmd = next_cmd;
+            continue;
+        }
+
+        for (arg = cmd->argument; arg != NULL; arg = next_arg)
+        {
+            next_arg = arg->next;
+
+            switch (arg->value_type)
+            {
+            case KEYWORD_TYPE:
+                while (arg->value.keyword != NULL)
+                {
+                    keyword_t *keyword = arg->value.keyword;
+                    arg->value.keyword = keyword->next;
+                    free(keyword);
+                }
+                break;
+            case NUMBER_TYPE:
+                while (arg->value.number != NULL)
+                {
+                    number_t *number = arg->value.number;
+                    arg->value.number = number->next;
+                    free(number);
+                }
+                break;
+            case PAIR_TYPE:
+                while (arg->value.pair != NULL)
+                {
+                    pair_t *pair = arg->value.pair;
+                    arg->value.pair = pair->next;
+                    free(pair);
+                }
+                break;
+            case BLOCK_TYPE:
+                while (arg->value.block != NULL)
+                {
+                    block_t *block = arg->value.block;
+                    arg->value.block = block->next;
+                    free(block);
+                }
+                break;
+            default:
+                break;
+            }
+
+            free(arg);
+        }
+
+        free(cmd->cert_sig_data);
+        free(cmd);
+        cmd = next_cmd;
     }
 }
-
@@ -0,0 +1,831 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*===========================================================================*/
+/**
+    @file    cst_daemon.c
+
+    @brief   Implements the persistent signing daemon and its client.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include "csf.h"
+#include "err.h"
+#include "cst_daemon.h"
+#include "thread_pool.h"
+
+/*===========================================================================
+                               LOCAL CONSTANTS
+=============================================================================*/
+/** Template of the per job output file, created in TMPDIR */
+#define JOB_OUTPUT_TEMPLATE "cst-job-XXXXXX"
+
+/** Characters separating the fields of a batch manifest line */
+#define MANIFEST_SEPARATORS " \t\r\n"
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/* Job listed in a batch manifest */
+typedef struct batch_job {
+    char *csf_file;                 /**< Input CSF text filename           */
+    char *out_file;                 /**< Output binary filename            */
+    int32_t status;                 /**< Status of the job once processed  */
+} batch_job_t;
+
+/* Jobs of a batch, shared by the threads running them */
+typedef struct batch {
+    cst_job_handler_t handler;      /**< Function processing each job      */
+    batch_job_t *jobs;              /**< Jobs listed in the manifest       */
+} batch_t;
+
+/*===========================================================================
+                            LOCAL FUNCTION PROTOTYPES
+=============================================================================*/
+/** Write a whole buffer to a socket
+ *
+ * @returns 1 on success, 0 on failure
+ */
+static int
+send_all(int fd, const void *buf, size_t len);
+
+/** Read a whole buffer from a socket
+ *
+ * @returns 1 on success, 0 on failure or early end of stream
+ */
+static int
+recv_all(int fd, void *buf, size_t len);
+
+/** Send a 32-bit big endian length followed by @a len bytes of @a buf
+ *
+ * @returns 1 on success, 0 on failure
+ */
+static int
+send_chunk(int fd, const uint8_t *buf, uint32_t len);
+
+/** Receive a length prefixed chunk into a newly allocated buffer
+ *
+ * One extra byte is allocated and the data is NUL terminated, so text
+ * chunks can be used as C strings.
+ *
+ * @param[in]  fd      Socket to read from
+ *
+ * @param[in]  max_len Max length accepted for the chunk
+ *
+ * @param[out] len     Length of the received chunk
+ *
+ * @returns the buffer, to be freed by the caller, or NULL on failure
+ */
+static uint8_t *
+recv_chunk(int fd, uint32_t max_len, uint32_t *len);
+
+/** Load a whole file into a newly allocated buffer
+ *
+ * @returns the buffer, to be freed by the caller, or NULL on failure
+ */
+static uint8_t *
+load_file(const char *filename, uint32_t *len);
+
+/** Run a single job in a new context, recovering from error() calls
+ *
+ * @returns status of the job, #ERROR_JOB_ABORTED if it called error() or
+ *          #ERROR_INSUFFICIENT_MEMORY if the context cannot be allocated
+ */
+static int32_t
+run_job(cst_job_handler_t handler, FILE *csf, char *out_file);
+
+/** Serve a single client connection
+ *
+ * @param[in] fd      Connected client socket
+ *
+ * @param[in] handler Function processing the job
+ */
+static void
+serve_client(int fd, cst_job_handler_t handler);
+
+/** Load the jobs listed in a batch manifest
+ *
+ * @param[in]  ctx      Context receiving the error details
+ *
+ * @param[in]  manifest Manifest filename
+ *
+ * @param[out] jobs     Newly allocated jobs array, see free_manifest()
+ *
+ * @param[out] count    Number of jobs in @a jobs
+ *
+ * @returns #SUCCESS, #ERROR_OPENING_FILE, #ERROR_INVALID_ARGUMENT on a
+ *          malformed line, or #ERROR_INSUFFICIENT_MEMORY
+ */
+static int32_t
+load_manifest(cst_context_t *ctx, const char *manifest, batch_job_t **jobs,
+              uint32_t *count);
+
+/** Free the jobs returned by load_manifest() */
+static void
+free_manifest(batch_job_t *jobs, uint32_t count);
+
+/** Process a single batch job
+ *
+ * @returns status of the job
+ */
+static int32_t
+run_batch_job(cst_job_handler_t handler, batch_job_t *job);
+
+/** Thread pool task processing the batch job @a index
+ *
+ * The status of the job is saved in the job. A job calling error() is
+ * caught by the recovery point run_job() sets for the calling thread.
+ */
+static void
+batch_task(void *arg, size_t index);
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  send_all
+---------------------------*/
+int send_all(int fd, const void *buf, size_t len)
+{
+    const uint8_t *ptr = buf;
+    ssize_t written;
+
+    while (len > 0)
+    {
+        written = write(fd, ptr, len);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return 0;
+        }
+        ptr += written;
+        len -= written;
+    }
+
+    return 1;
+}
+
+/*--------------------------
+  recv_all
+---------------------------*/
+int recv_all(int fd, void *buf, size_t len)
+{
+    uint8_t *ptr = buf;
+    ssize_t bytes_read;
+
+    while (len > 0)
+    {
+        bytes_read = read(fd, ptr, len);
+        if (bytes_read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_read <= 0)
+        {
+            return 0;
+        }
+        ptr += bytes_read;
+        len -= bytes_read;
+    }
+
+    return 1;
+}
+
+/*--------------------------
+  send_chunk
+---------------------------*/
+int send_chunk(int fd, const uint8_t *buf, uint32_t len)
+{
+    uint32_t len_be = htonl(len);
+
+    return send_all(fd, &len_be, sizeof(len_be)) &&
+           send_all(fd, buf, len);
+}
+
+/*--------------------------
+  recv_chunk
+---------------------------*/
+uint8_t *recv_chunk(int fd, uint32_t max_len, uint32_t *len)
+{
+    uint32_t len_be = 0;
+    uint8_t *buf = NULL;
+
+    if (!recv_all(fd, &len_be, sizeof(len_be)))
+    {
+        return NULL;
+    }
+
+    *len = ntohl(len_be);
+    if (*len > max_len)
+    {
+        return NULL;
+    }
+
+    buf = malloc(*len + 1);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    if (!recv_all(fd, buf, *len))
+    {
+        free(buf);
+        return NULL;
+    }
+    buf[*len] = '\0';
+
+    return buf;
+}
+
+/*--------------------------
+  load_file
+---------------------------*/
+uint8_t *load_file(const char *filename, uint32_t *len)
+{
+    FILE *fh = NULL;
+    long file_size;
+    uint8_t *buf = NULL;
+
+    fh = fopen(filename, "rb");
+    if (fh == NULL)
+    {
+        return NULL;
+    }
+
+    do {
+        if (fseek(fh, 0, SEEK_END) != 0 || (file_size = ftell(fh)) < 0)
+        {
+            break;
+        }
+        rewind(fh);
+
+        /* Extra byte so an empty file still gives a valid buffer */
+        buf = malloc(file_size + 1);
+        if (buf == NULL)
+        {
+            break;
+        }
+
+        if (fread(buf, 1, file_size, fh) != (size_t)file_size)
+        {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        *len = (uint32_t)file_size;
+    } while(0);
+
+    fclose(fh);
+    return buf;
+}
+
+/*--------------------------
+  run_job
+---------------------------*/
+int32_t run_job(cst_job_handler_t handler, FILE *csf, char *out_file)
+{
+    volatile int32_t ret_val = ERROR_JOB_ABORTED;
+    cst_context_t *ctx = cst_context_new();
+
+    if (ctx == NULL)
+    {
+        return ERROR_INSUFFICIENT_MEMORY;
+    }
+
+    if (setjmp(ctx->error_recovery) == 0)
+    {
+        set_error_recovery(&ctx->error_recovery);
+        ret_val = handler(ctx, csf, out_file);
+    }
+    set_error_recovery(NULL);
+
+    /* Also releases what an aborted job left behind */
+    cst_context_free(ctx);
+
+    fflush(NULL);
+
+    return ret_val;
+}
+
+/*--------------------------
+  serve_client
+---------------------------*/
+void serve_client(int fd, cst_job_handler_t handler)
+{
+    char *cwd = NULL;          /**< Client working directory */
+    int daemon_cwd = -1;       /**< Restored once the job is done */
+    uint8_t *csf = NULL;       /**< CSF text of the job */
+    uint32_t cwd_len = 0;
+    uint32_t csf_len = 0;
+    uint8_t *out = NULL;       /**< Output binary of the job */
+    uint32_t out_len = 0;
+    FILE *fi = NULL;
+    int out_fd = -1;
+    int32_t ret_val = SUCCESS;
+    uint32_t status_be;
+    const char *tmp_dir = getenv("TMPDIR");
+    char out_file[CST_DAEMON_MAX_PATH_BYTES];
+
+    if (tmp_dir == NULL)
+    {
+        tmp_dir = "/tmp";
+    }
+
+    do {
+        cwd = (char *)recv_chunk(fd, CST_DAEMON_MAX_PATH_BYTES, &cwd_len);
+        csf = recv_chunk(fd, CST_DAEMON_MAX_CSF_BYTES, &csf_len);
+        if (cwd == NULL || csf == NULL)
+        {
+            /* Malformed request, nothing can be sent back */
+            free(cwd);
+            free(csf);
+            return;
+        }
+
+        /* The parser expects the last CSF line to be terminated */
+        if (csf_len == 0 || csf[csf_len - 1] != '\n')
+        {
+            csf[csf_len++] = '\n';
+        }
+
+        /* Relative paths of the CSF are the client's */
+        daemon_cwd = open(".", O_RDONLY);
+        if (daemon_cwd < 0 || chdir(cwd) != 0)
+        {
+            ret_val = ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        snprintf(out_file, sizeof(out_file), "%s/%s", tmp_dir,
+                 JOB_OUTPUT_TEMPLATE);
+        out_fd = mkstemp(out_file);
+        if (out_fd < 0)
+        {
+            ret_val = ERROR_OPENING_FILE;
+            break;
+        }
+        close(out_fd);
+
+        fi = fmemopen(csf, csf_len, "r");
+        if (fi == NULL)
+        {
+            ret_val = ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+
+        ret_val = run_job(handler, fi, out_file);
+        if (ret_val != SUCCESS)
+        {
+            break;
+        }
+
+        out = load_file(out_file, &out_len);
+        if (out == NULL)
+        {
+            ret_val = ERROR_READING_FILE;
+            break;
+        }
+    } while(0);
+
+    status_be = htonl((uint32_t)ret_val);
+    if (send_all(fd, &status_be, sizeof(status_be)))
+    {
+        send_chunk(fd, out, (ret_val == SUCCESS) ? out_len : 0);
+    }
+
+    if (fi)
+        fclose(fi);
+    if (out_fd >= 0)
+        unlink(out_file);
+
+    /* The next client may send a relative working directory */
+    if (daemon_cwd >= 0)
+    {
+        if (fchdir(daemon_cwd) != 0)
+        {
+            printf("Unable to restore the daemon working directory\n");
+        }
+        close(daemon_cwd);
+    }
+
+    free(out);
+    free(csf);
+    free(cwd);
+}
+
+/*--------------------------
+  load_manifest
+---------------------------*/
+int32_t load_manifest(cst_context_t *ctx, const char *manifest,
+                      batch_job_t **jobs, uint32_t *count)
+{
+    FILE *fh = NULL;
+    char *line = NULL;
+    size_t line_size = 0;
+    uint32_t line_no = 0;
+    uint32_t capacity = 0;
+    batch_job_t *list = NULL;
+    batch_job_t *grown = NULL;
+    char *csf_file = NULL;
+    char *out_file = NULL;
+    int32_t ret_val = SUCCESS;
+
+    *jobs = NULL;
+    *count = 0;
+
+    fh = fopen(manifest, "r");
+    if (fh == NULL)
+    {
+        log_error_msg(ctx, (char *)manifest);
+        return ERROR_OPENING_FILE;
+    }
+
+    while (getline(&line, &line_size, fh) != -1)
+    {
+        line_no++;
+
+        csf_file = strtok(line, MANIFEST_SEPARATORS);
+        if (csf_file == NULL || csf_file[0] == '#')
+        {
+            /* Blank or comment line */
+            continue;
+        }
+
+        out_file = strtok(NULL, MANIFEST_SEPARATORS);
+        if (out_file == NULL || strtok(NULL, MANIFEST_SEPARATORS) != NULL)
+        {
+            snprintf(line, line_size, "%s line %u", manifest, line_no);
+            log_error_msg(ctx, line);
+            ret_val = ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        if (*count == capacity)
+        {
+            capacity = (capacity == 0) ? 16 : capacity * 2;
+            grown = realloc(list, capacity * sizeof(batch_job_t));
+            if (grown == NULL)
+            {
+                ret_val = ERROR_INSUFFICIENT_MEMORY;
+                break;
+            }
+            list = grown;
+        }
+
+        list[*count].csf_file = malloc(strlen(csf_file) + 1);
+        list[*count].out_file = malloc(strlen(out_file) + 1);
+        list[*count].status = ERROR_JOB_ABORTED;
+        if (list[*count].csf_file == NULL || list[*count].out_file == NULL)
+        {
+            free(list[*count].csf_file);
+            free(list[*count].out_file);
+            ret_val = ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+        strcpy(list[*count].csf_file, csf_file);
+        strcpy(list[*count].out_file, out_file);
+        (*count)++;
+    }
+
+    free(line);
+    fclose(fh);
+
+    if (ret_val != SUCCESS)
+    {
+        free_manifest(list, *count);
+        *count = 0;
+        return ret_val;
+    }
+
+    *jobs = list;
+    return SUCCESS;
+}
+
+/*--------------------------
+  free_manifest
+---------------------------*/
+void free_manifest(batch_job_t *jobs, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        free(jobs[i].csf_file);
+        free(jobs[i].out_file);
+    }
+    free(jobs);
+}
+
+/*--------------------------
+  run_batch_job
+---------------------------*/
+int32_t run_batch_job(cst_job_handler_t handler, batch_job_t *job)
+{
+    uint8_t *csf = NULL;       /**< CSF text of the job */
+    uint32_t csf_len = 0;
+    FILE *fi = NULL;
+    int32_t ret_val = SUCCESS;
+
+    printf("Processing %s\n", job->csf_file);
+
+    do {
+        csf = load_file(job->csf_file, &csf_len);
+        if (csf == NULL)
+        {
+            printf("Unable to open %s\n", job->csf_file);
+            ret_val = ERROR_READING_FILE;
+            break;
+        }
+
+        /* The parser expects the last CSF line to be terminated, the
+           buffer from load_file() has room for one more byte */
+        if (csf_len == 0 || csf[csf_len - 1] != '\n')
+        {
+            csf[csf_len++] = '\n';
+        }
+
+        fi = fmemopen(csf, csf_len, "r");
+        if (fi == NULL)
+        {
+            ret_val = ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+
+        ret_val = run_job(handler, fi, job->out_file);
+    } while(0);
+
+    if (fi)
+        fclose(fi);
+    free(csf);
+
+    return ret_val;
+}
+
+/*--------------------------
+  batch_task
+---------------------------*/
+void batch_task(void *arg, size_t index)
+{
+    batch_t *batch = arg;
+
+    batch->jobs[index].status = run_batch_job(batch->handler,
+                                              &batch->jobs[index]);
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  cst_daemon_serve
+---------------------------*/
+int32_t cst_daemon_serve(cst_context_t *ctx, const char *socket_path,
+                         cst_job_handler_t handler)
+{
+    struct sockaddr_un addr;   /**< Socket address */
+    struct stat st;
+    int fd = -1;               /**< Listening socket */
+    int client = -1;           /**< Connected client socket */
+    int bound = 0;             /**< Set once the socket is bound */
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        log_error_msg(ctx, (char *)socket_path);
+        return ERROR_INVALID_ARGUMENT;
+    }
+
+    /* A client going away must not terminate the daemon */
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    /* Remove the socket left behind by a previous daemon */
+    if (stat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        unlink(socket_path);
+    }
+
+    /* Other users must never be able to connect, even before chmod */
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0)
+    {
+        mode_t mask = umask(S_IRWXG | S_IRWXO);
+
+        bound = (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        umask(mask);
+    }
+    if (fd < 0 || !bound ||
+        chmod(socket_path, S_IRUSR | S_IWUSR) != 0 ||
+        listen(fd, SOMAXCONN) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        log_error_msg(ctx, (char *)socket_path);
+        return ERROR_OPENING_FILE;
+    }
+
+    printf("CST signing daemon listening on %s\n", socket_path);
+    fflush(stdout);
+
+    for (;;)
+    {
+        client = accept(fd, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            break;
+        }
+
+        serve_client(client, handler);
+        close(client);
+    }
+
+    close(fd);
+    unlink(socket_path);
+    log_error_msg(ctx, (char *)socket_path);
+    return ERROR_OPENING_FILE;
+}
+
+/*--------------------------
+  cst_daemon_submit
+---------------------------*/
+int32_t cst_daemon_submit(cst_context_t *ctx, const char *socket_path,
+                          const char *in_csf, const char *out_file)
+{
+    struct sockaddr_un addr;   /**< Socket address */
+    char cwd[CST_DAEMON_MAX_PATH_BYTES]; /**< Working directory of the job */
+    uint8_t *csf = NULL;       /**< CSF text */
+    uint32_t csf_len = 0;
+    uint8_t *out = NULL;       /**< Output binary returned by the daemon */
+    uint32_t out_len = 0;
+    uint32_t status_be = 0;
+    int32_t ret_val = SUCCESS;
+    FILE *fo = NULL;
+    int fd = -1;
+
+    do {
+        if (strlen(socket_path) >= sizeof(addr.sun_path))
+        {
+            log_error_msg(ctx, (char *)socket_path);
+            ret_val = ERROR_INVALID_ARGUMENT;
+            break;
+        }
+
+        if (getcwd(cwd, sizeof(cwd)) == NULL)
+        {
+            log_error_msg(ctx, ".");
+            ret_val = ERROR_INSUFFICIENT_MEMORY;
+            break;
+        }
+
+        csf = load_file(in_csf, &csf_len);
+        if (csf == NULL)
+        {
+            log_error_msg(ctx, (char *)in_csf);
+            ret_val = ERROR_READING_FILE;
+            break;
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, socket_path);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 ||
+            connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            log_error_msg(ctx, (char *)socket_path);
+            ret_val = ERROR_OPENING_FILE;
+            break;
+        }
+
+        if (!send_chunk(fd, (uint8_t *)cwd, strlen(cwd)) ||
+            !send_chunk(fd, csf, csf_len))
+        {
+            log_error_msg(ctx, (char *)socket_path);
+            ret_val = ERROR_WRITING_FILE;
+            break;
+        }
+
+        if (!recv_all(fd, &status_be, sizeof(status_be)) ||
+            (out = recv_chunk(fd, UINT32_MAX - 1, &out_len)) == NULL)
+        {
+            log_error_msg(ctx, (char *)socket_path);
+            ret_val = ERROR_READING_FILE;
+            break;
+        }
+
+        ret_val = (int32_t)ntohl(status_be);
+        if (ret_val != SUCCESS)
+        {
+            /* Details are only available in the daemon output */
+            snprintf(cwd, sizeof(cwd), "%s, see the signing daemon output",
+                     in_csf);
+            log_error_msg(ctx, cwd);
+            break;
+        }
+
+        fo = fopen(out_file, "wb");
+        if (fo == NULL)
+        {
+            log_error_msg(ctx, (char *)out_file);
+            ret_val = ERROR_OPENING_FILE;
+            break;
+        }
+
+        if (fwrite(out, 1, out_len, fo) != out_len)
+        {
+            log_error_msg(ctx, (char *)out_file);
+            ret_val = ERROR_WRITING_FILE;
+            break;
+        }
+
+        log_error_msg(ctx, (char *)out_file);
+    } while(0);
+
+    if (fo)
+        fclose(fo);
+    if (fd >= 0)
+        close(fd);
+
+    free(out);
+    free(csf);
+
+    return ret_val;
+}
+
+/*--------------------------
+  cst_daemon_batch
+---------------------------*/
+int32_t cst_daemon_batch(cst_context_t *ctx, const char *manifest,
+                         uint32_t workers, cst_job_handler_t handler)
+{
+    batch_job_t *jobs = NULL;  /**< Jobs listed in the manifest */
+    batch_t batch;             /**< Jobs shared by the threads */
+    uint32_t count = 0;
+    uint32_t failed = 0;
+    uint32_t i;
+    int32_t ret_val = SUCCESS;
+
+    ret_val = load_manifest(ctx, manifest, &jobs, &count);
+    if (ret_val != SUCCESS)
+    {
+        return ret_val;
+    }
+
+    /* Every job gets its own context, the certificates and keys loaded
+       by a job are shared with the others through the backend caches */
+    batch.handler = handler;
+    batch.jobs = jobs;
+    thread_pool_run_threads(count, workers, batch_task, &batch);
+
+    for (i = 0; i < count; i++)
+    {
+        if (jobs[i].status != SUCCESS)
+        {
+            printf("Batch job failed: %s\n", jobs[i].csf_file);
+            failed++;
+        }
+    }
+    printf("Batch complete: %u of %u jobs succeeded\n",
+           count - failed, count);
+
+    if (failed != 0)
+    {
+        ret_val = ERROR_BATCH_JOB_FAILED;
+    }
+
+    free_manifest(jobs, count);
+
+    return ret_val;
+}
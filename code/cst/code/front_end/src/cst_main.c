@@ -0,0 +1,658 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*===========================================================================*/
+/**
+    @file    cst_main.c
+
+    @brief   Code signing tool's main file, processes the command line and
+             runs the CSF given with --input, a batch manifest, or the
+             signing daemon. The CSF processing itself is provided by the
+             front end library.
+
+@verbatim
+=============================================================================
+
+              Freescale Semiconductor
+      (c) Freescale Semiconductor, Inc. 2011-2015. All rights reserved.
+      Copyright 2018-2020, 2022-2023 NXP
+      Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include "openssl_helper.h"
+#include "csf.h"
+#include "cst_daemon.h"
+#include "sig_cache.h"
+
+#define LOG_DEBUG printf("[CARLOS_DEBUG] "); printf
+
+/*===========================================================================
+                                MACROS
+=============================================================================*/
+#define MIN_NUM_CLI_ARGS      3 /* Minimum number of command line arguments */
+
+#define CST_FAILURE_EXIT_CODE (1) /* code returned from main on failure */
+/*===========================================================================
+                  LOCAL VARIABLES
+=============================================================================*/
+/**
+ * Points to the input CSF text file
+ */
+static char * g_in_csf_file = NULL;
+
+/**
+ * Set to skip user agreement prompt
+ */
+static uint32_t g_skip = 0;
+
+/** Valid short command line option letters. */
+const char* const short_options = "lvh:lvhdso:i:c:b:";
+
+/** Valid long command line options. */
+const struct option long_options[] =
+{
+    {"license", no_argument, 0, 'l'},
+    {"version", no_argument,  0, 'v'},
+    {"verbose", no_argument,  0, 'g'},
+    {"help", no_argument, 0, 'h'},
+    {"output", required_argument,  0, 'o'},
+    {"input", required_argument,  0, 'i'},
+    {"cert", required_argument,  0, 'c'},
+    {"dek", no_argument,  0, 'd'},
+    {"skip", no_argument,  0, 's'},
+    {"backend", required_argument, 0, 'b'},
+    {"daemon", required_argument, 0, 'D'},
+    {"connect", required_argument, 0, 'C'},
+    {"batch", required_argument, 0, 'B'},
+    {"jobs", required_argument, 0, 'J'},
+    {"in-place", no_argument, 0, 'I'},
+    {"lock-keys", no_argument, 0, 'K'},
+    {"requests", required_argument, 0, 'R'},
+    {"sig-cache", required_argument, 0, 'G'},
+    {NULL, 0, NULL, 0}
+};
+
+/**
+ * Socket path the signing daemon listens on, NULL unless --daemon is given
+ */
+static char *daemon_socket = NULL;
+
+/**
+ * Socket path of the signing daemon jobs are submitted to, NULL unless
+ * --connect is given
+ */
+static char *connect_socket = NULL;
+
+/**
+ * Manifest of the jobs to process, NULL unless --batch is given
+ */
+static char *batch_manifest = NULL;
+
+/**
+ * Number of threads running the --batch jobs
+ */
+static uint32_t batch_jobs = 1;
+
+/**
+ * Set if private keys must be kept in locked memory, --lock-keys
+ */
+static uint32_t lock_keys = 0;
+
+/*===========================================================================
+                          LOCAL FUNCTION DECLARATIONS
+=============================================================================*/
+static void print_usage(void);
+static void process_cmdline_args(int argc, char* argv[], char **out_bin_csf);
+static void print_error_msg(cst_context_t *ctx, const int32_t error_code);
+static void prompt_key_reuse_msg(void);
+static int32_t process_daemon_job(cst_context_t *ctx, FILE *fi,
+                                  char *out_bin_csf);
+
+/*===========================================================================
+                           LOCAL FUNCTION DEFINITION
+=============================================================================*/
+/** prints the command line usage
+ *
+ * Prints the usage information for running cst. It also shows
+ * examples of command line parameters to cst
+ *
+ * @pre  This function is called from process_cmdline_args() if failed to
+ *       process command line successfully.
+ *
+ * @post The usage info will be printed out on console window.
+ */
+static void print_usage(void)
+{
+    printf("Usage: \n\n");
+    printf("To generate output binary CSF using Code Signing Tool \n");
+    printf("===================================================== \n\n");
+    printf("cst --output <bin_csf> --input <input_csf> \n\n");
+    printf("-o, --output <binary csf>:\n");
+    printf("    Output binary CSF filename\n\n");
+    printf("-i, --input <csf text file>:\n");
+    printf("    Input CSF text filename\n\n");
+    printf("-c, --cert <public key certificate>:\n");
+    printf("    Optional, Input public key certificate to encrypt the dek\n\n");
+    printf("-b, --backend <ssl or pkcs11>:\n");
+    printf("    Optional, Select backend. SSL backend is the default and\n");
+    printf("    uses keys stored in the local host filesystem. The PKCS11\n");
+    printf("    backend supplies an interface to PKCS11 supported keystore.\n");
+    printf("--requests <count>:\n");
+    printf("    Optional, max. signatures requested at once from backends\n");
+    printf("    signing concurrently, such as a remote signing server.\n");
+    printf("    4 by default, 16 at most\n\n");
+    printf("--sig-cache <directory>:\n");
+    printf("    Optional, keeps the generated signatures in the given\n");
+    printf("    existing directory, keyed by the signed payload and key.\n");
+    printf("    Unchanged payloads get their signature back from it\n");
+    printf("    instead of signing again. The directory must be trusted\n");
+    printf("    as much as the keys\n\n");
+    printf("--daemon <socket>:\n");
+    printf("    Optional, runs cst as a signing daemon serving the jobs\n");
+    printf("    submitted on the given UNIX socket. Keys and certificates\n");
+    printf("    are loaded once and shared by all jobs\n\n");
+    printf("--connect <socket>:\n");
+    printf("    Optional, submits the --input CSF to the signing daemon\n");
+    printf("    listening on the given UNIX socket and writes the result\n");
+    printf("    to --output\n\n");
+    printf("--batch <manifest>:\n");
+    printf("    Optional, processes every job listed in the manifest, one\n");
+    printf("    \"<input CSF> <output binary>\" pair per line. Lines\n");
+    printf("    starting with # are comments\n\n");
+    printf("--jobs <count>:\n");
+    printf("    Optional, number of jobs of the --batch manifest run\n");
+    printf("    concurrently, on as many threads sharing the loaded keys\n");
+    printf("    and certificates. 1 by default, 64 at most\n\n");
+    printf("--in-place:\n");
+    printf("    Optional, AHAB only. The output file already holds the\n");
+    printf("    unsigned image, usually it is the source file itself. Only\n");
+    printf("    the container and the encrypted images are written to it\n\n");
+    printf("--lock-keys:\n");
+    printf("    Optional, keeps the decrypted private keys and their\n");
+    printf("    passphrases in locked memory, never swapped out\n\n");
+    printf("-g, --verbose:\n");
+    printf("    Optional, displays verbose information.  No ");
+    printf("additional\n    arguments are required\n\n");
+    printf("-l, --license:\n");
+    printf("    Optional, displays program license information.  No ");
+    printf("additional\n    arguments are required\n\n");
+    printf("-v, --version:\n");
+    printf("    Optional, displays the version of the tool.  No additional\n");
+    printf("    arguments are required\n\n");
+    printf("-h, --help:\n");
+    printf("    Optional, displays usage information.  No additional\n");
+    printf("    arguments are required\n\n");
+    printf("Examples:\n");
+    printf("---------\n\n");
+    printf("1. To generate out_csf.bin file from input hab4.csf, use\n");
+    printf("    cst -o out_csf.bin -i hab4.csf \n\n");
+    printf("2. To generate out_csf.bin file from input hab4.csf and");
+    printf("      output a plaintext dek, use\n");
+    printf("    cst -o out_csf.bin -i hab4.csf \n\n");
+    printf("3. To generate out_csf.bin file from input hab4.csf and \n");
+    printf("    encrypt the dek with cert.pem, use\n");
+    printf("    cst -o out_csf.bin -c cert.pem -i hab4.csf \n\n");
+    printf("4. To print program license information, use\n");
+    printf("    cst --license \n\n");
+    printf("5. This is the carlos modified version. \n\n");
+    printf("6. To sign through a signing daemon, start it once with\n");
+    printf("    cst --daemon /tmp/cst.sock \n");
+    printf("   and then submit each CSF with\n");
+    printf("    cst --connect /tmp/cst.sock -o out_csf.bin -i hab4.csf \n\n");
+    printf("7. To process the jobs listed in jobs.txt 4 at a time, use\n");
+    printf("    cst --batch jobs.txt --jobs 4 \n\n");
+    printf("8. To sign the AHAB image described by ahab.csf directly in\n");
+    printf("   its source file flash.bin, use\n");
+    printf("    cst --in-place -o flash.bin -i ahab.csf \n\n");
+}
+
+/** Process command line arguments for code signing tool (cst)
+ *
+ * @par Purpose
+ *
+ * Process command line arguments for cst and calls respective
+ * functions based no commands specified at command line.
+ *
+ * @param[in] argc, number of arguments in argv
+ *
+ * @param[in] argv, arguments list
+ *
+ * @param[out] out_bin_csf, ptr to return name for binary csf
+ */
+static void process_cmdline_args(int argc, char* argv[], char **out_bin_csf)
+{
+    int  next_option = 0;        /**< Option count from cmd line */
+
+    do
+    {
+        next_option = getopt_long(argc, argv, short_options,
+                                  long_options, NULL);
+        switch (next_option)
+        {
+            /* Display License information */
+            case 'l':
+                print_license();
+                exit(0);
+                break;
+            /* Display version information */
+            case 'v':
+                print_version();
+                exit(0);
+                break;
+            /* Display usage */
+            case 'h':
+                print_usage();
+                exit(0);
+                break;
+            /* Display verbose information */
+            case 'g':
+                g_verbose = 1;
+                break;
+            /* Option o - output csf binary file */
+            case 'o':
+                *out_bin_csf = optarg;
+                break;
+            /* Option i - input csf text file */
+            case 'i':
+                g_in_csf_file = optarg;
+                break;
+            /* Option c - input public key cert used for
+                  encrypting dek */
+            case 'c':
+                g_cert_dek = optarg;
+                break;
+            /* Option d - input data encryption key */
+            case 'd':
+                g_reuse_dek = 1;
+                break;
+            /* Option s - skip user prompt */
+            case 's':
+                g_skip = 1;
+                break;
+            case 'b':
+                if (set_backend(optarg)) {
+                  print_usage();
+                  exit(1);
+                }
+                break;
+            /* Option D - run as signing daemon */
+            case 'D':
+                daemon_socket = optarg;
+                break;
+            /* Option C - submit the job to a signing daemon */
+            case 'C':
+                connect_socket = optarg;
+                break;
+            /* Option B - process the jobs of a batch manifest */
+            case 'B':
+                batch_manifest = optarg;
+                break;
+            /* Option J - number of batch jobs run concurrently */
+            case 'J':
+                batch_jobs = (uint32_t)strtoul(optarg, NULL, 0);
+                if (batch_jobs == 0) {
+                  print_usage();
+                  exit(1);
+                }
+                break;
+            /* Option I - patch the AHAB output file in place */
+            case 'I':
+                g_in_place = 1;
+                break;
+            /* Option K - keep private keys in locked memory */
+            case 'K':
+                lock_keys = 1;
+                break;
+            /* Option R - signatures requested at once */
+            case 'R':
+                g_sign_requests = (uint32_t)strtoul(optarg, NULL, 0);
+                if (g_sign_requests == 0 ||
+                    g_sign_requests > SIGN_REQUESTS_MAX) {
+                  print_usage();
+                  exit(1);
+                }
+                break;
+            /* Option G - cache the generated signatures */
+            case 'G':
+                if (sig_cache_set_dir(optarg) != SUCCESS) {
+                  fprintf(stderr, "Invalid signature cache directory %s\n",
+                          optarg);
+                  exit(1);
+                }
+                break;
+            case '?':
+                print_usage();
+                exit(1);
+                break;
+            default:    /* Something else: unexpected.  */
+                break;
+        }
+    } while (next_option != -1);
+
+    /* Check for minimum number of arguments */
+    if (argc  < MIN_NUM_CLI_ARGS)
+    {
+        print_usage();
+        exit(1);
+    }
+}
+
+/** Process a signing daemon job
+ *
+ * @par Purpose
+ *
+ * Processes the CSF of a job in the fresh context allocated for it and
+ * reports the job status like a standalone cst run would. Batch jobs call
+ * it from several threads at once.
+ *
+ * @par Operation
+ *
+ * @param[in] ctx, context of the job
+ *
+ * @param[in] fi, CSF text to parse
+ *
+ * @param[in] out_bin_csf, filename of the output binary
+ *
+ * @retval #SUCCESS if everything goes fine, error code otherwise
+ */
+static int32_t process_daemon_job(cst_context_t *ctx, FILE *fi,
+                                  char *out_bin_csf)
+{
+    int32_t ret_val = SUCCESS;      /**< Status of the job */
+
+    ret_val = cst_process_csf(ctx, fi, out_bin_csf);
+
+    if (ctx->error_code != SUCCESS)
+    {
+        ret_val = ctx->error_code;
+    }
+
+    /* AHAB reports its own output */
+    if (TGT_AHAB != ctx->target || ret_val != SUCCESS)
+    {
+        print_error_msg(ctx, ret_val);
+    }
+
+    return ret_val;
+}
+
+/** main function of cst application
+ *
+ * @par Purpose
+ *
+ * Main CST function.
+ * Process the CSF file, a batch manifest, or serve and submit signing
+ * daemon jobs.
+ * Print out error messages on stdout.
+ *
+ * @par Operation
+ *
+ * @param[in] argc, number of arguments in argv
+ *
+ * @param[in] argv, csf output binary file to create should be passed in argv[1]
+ */
+int32_t main(int32_t argc, char* argv[])
+{
+    int32_t ret_val = SUCCESS;      /**< Used for keeping track of error
+                                         values returned by functions */
+    FILE *fi = NULL;                /**< File pointer for input csf text file */
+
+    char *out_bin_csf = NULL;       /**< Ptr to filename for output binary csf,
+                                         an argument passed to cst */
+    cst_context_t *ctx = NULL;      /**< Context of the CSF, also collects the
+                                         error details of the daemon modes */
+
+    /* Set the backend function pointers to the openssl host backend */
+    set_backend("ssl");
+
+    openssl_initialize();
+    process_cmdline_args(argc, argv, &out_bin_csf);
+
+    if (lock_keys && !openssl_lock_keys())
+    {
+        printf("Warning: private keys cannot be kept in locked memory\n");
+    }
+
+    if (g_reuse_dek)
+    {
+        prompt_key_reuse_msg();
+    }
+
+    ctx = cst_context_new();
+    if (ctx == NULL)
+    {
+        printf("Memory overrun, failed to allocated enough memory\n");
+        return CST_FAILURE_EXIT_CODE;
+    }
+
+    if (daemon_socket != NULL)
+    {
+        ret_val = cst_daemon_serve(ctx, daemon_socket, process_daemon_job);
+        print_error_msg(ctx, ret_val);
+        cst_context_free(ctx);
+        return CST_FAILURE_EXIT_CODE;
+    }
+
+    if (batch_manifest != NULL)
+    {
+        ret_val = cst_daemon_batch(ctx, batch_manifest, batch_jobs,
+                                   process_daemon_job);
+        if (ret_val != SUCCESS)
+        {
+            /* Job errors were reported as each job completed */
+            print_error_msg(ctx, ret_val);
+        }
+        cst_context_free(ctx);
+        return (ret_val == SUCCESS) ? SUCCESS : CST_FAILURE_EXIT_CODE;
+    }
+
+    do {
+        if (out_bin_csf == NULL)
+        {
+            /* Can't proceed without output binary file name */
+            printf("Missing --o argument\n");
+            break;
+        }
+
+        if (g_in_csf_file == NULL)
+        {
+            printf("Missing --i argument\n");
+            break;
+        }
+
+        if (connect_socket != NULL)
+        {
+            ret_val = cst_daemon_submit(ctx, connect_socket, g_in_csf_file,
+                                        out_bin_csf);
+            print_error_msg(ctx, ret_val);
+            break;
+        }
+
+        /* Open CSF text file to be read by parser */
+        fi = fopen(g_in_csf_file, "r");
+        if (!fi)
+        {
+            printf("Unable to open %s", g_in_csf_file);
+            break;
+        }
+
+        LOG_DEBUG("open file %s\n", g_in_csf_file);
+        ret_val = cst_process_csf(ctx, fi, out_bin_csf);
+
+        fclose(fi);
+
+        /* AHAB reports its own output */
+        if (TGT_AHAB == ctx->target && ret_val == SUCCESS)
+        {
+            break;
+        }
+
+        scratch_cleanup();
+
+        fflush(NULL);
+
+        if (ctx->error_code != SUCCESS)
+        {
+            ret_val = ctx->error_code;
+        }
+        print_error_msg(ctx, ret_val);
+    } while(0);
+
+    cst_context_free(ctx);
+
+    /* Return a non-zero value on error otherwise 0 */
+    return (ret_val == SUCCESS) ? SUCCESS : CST_FAILURE_EXIT_CODE;
+}
+
+/** Prints error msg
+ *
+ * @par Purpose
+ *
+ * Prints error message uinsg passed error_code and error_log.
+ *
+ * @par Operation
+ *
+ * @param[in] ctx, context holding the error_log
+ *
+ * @param[in] error_code, one of error codes defined in csf.h file
+ *
+ * @retval None
+ */
+static void print_error_msg(cst_context_t *ctx, const int32_t error_code)
+{
+    switch (error_code)
+    {
+    case SUCCESS:
+        printf("CSF Processed successfully and signed data available in %s\n", ctx->error_log);
+        break;
+    case ERROR_INVALID_ARGUMENT:
+        printf("Invalid argument: %s\n", ctx->error_log);
+        break;
+    case ERROR_INSUFFICIENT_ARGUMENTS:
+        printf("Missing mandatory argument %s\n", ctx->error_log);
+        break;
+    case ERROR_INVALID_COMMAND:
+        printf("Invalid command: %s\n", ctx->error_log);
+        break;
+    case ERROR_FILE_NOT_PRESENT:
+        printf("File not present %s\n", ctx->error_log);
+        break;
+    case ERROR_OPENING_FILE:
+        printf("Failed opening file %s\n", ctx->error_log);
+        break;
+    case ERROR_READING_FILE:
+        printf("Failed reading file %s\n", ctx->error_log);
+        break;
+    case ERROR_WRITING_FILE:
+        printf("Failed writing file %s\n", ctx->error_log);
+        break;
+    case ERROR_CALCULATING_HASH:
+        printf("Error calculating hash for %s\n", ctx->error_log);
+        break;
+    case ERROR_INSUFFICIENT_MEMORY:
+        printf("Memory overrun, failed to allocated enough memory %s\n", ctx->error_log);
+        break;
+    case ERROR_INVALID_BLOCK_ARGUMENTS:
+        printf("Invalid Block arguments, %s\n", ctx->error_log);
+        break;
+    case ERROR_CMD_HEADER_NOT_FIRST:
+        printf("Error in CSF: command [Header] must be the first, before" \
+               " a command [%s]\n", ctx->error_log);
+        break;
+    case ERROR_UNSUPPORTED_ARGUMENT:
+        printf("Unsupported argument: %s\n", ctx->error_log);
+        break;
+    case ERROR_UNDEFINED_LABEL:
+        printf("Undefined label: %s\n", ctx->error_log);
+        break;
+    case ERROR_AUT_CSF_CMD_NOT_FOUND:
+        printf("Failed to find authenticate CSF command %s\n", ctx->error_log);
+        break;
+    case ERROR_INS_CSFK_CMD_NOT_FOUND:
+        printf("Failed to find install csf key command %s\n", ctx->error_log);
+        break;
+    case ERROR_INVALID_SRK_TABLE:
+        printf("Super Root Key table is invalid in file %s\n", ctx->error_log);
+        break;
+    case ERROR_INVALID_PKEY_CERTIFICATE:
+        printf("Public key certificate is invalid in file %s\n", ctx->error_log);
+        break;
+    case ERROR_CMD_IS_ALREADY_USED:
+        printf("Error in CSF: multiple instances of command [%s] cannot " \
+               "be used\n", ctx->error_log);
+        break;
+    case ERROR_CMD_INSTALL_SRK_EXPECTED:
+        printf("Error in CSF: command [%s] misplaced, the command " \
+               "[Install SRK] is expected after [Header]\n", ctx->error_log);
+        break;
+    case ERROR_CMD_INSTALL_CSFK_EXPECTED:
+        printf("Error in CSF: command [%s] misplaced, the command " \
+               "[Install CSFK] is expected after [Install SRK]\n", ctx->error_log);
+        break;
+    case ERROR_CMD_EXPECTED_AFTER_AUT_CSF:
+        printf("Error in CSF: command [%s] expected after [Authenticate CSF] " \
+               "which is expected after [Install CSFK]\n", ctx->error_log);
+        break;
+    case ERROR_CMD_INSTALL_KEY_EXPECTED:
+        printf("Error in CSF: a command [Install key] is expected prior to " \
+               "the usage of the key by an [Authenticate data] command\n");
+        break;
+    case ERROR_CMD_INSTALL_SECKEY_EXPECTED:
+        printf("Error in CSF: a command [Install Secret key] is expected prior to " \
+               "the usage of the key by a [Decrypt data] command\n");
+        break;
+    case ERROR_GENERATING_RANDOM_KEY:
+        printf("An error reported by backend in generating random key %s\n", ctx->error_log);
+        break;
+    case ERROR_IN_ENCRYPTION:
+        printf("An error is reported by backend during encryption %s\n", ctx->error_log);
+        break;
+    case ERROR_JOB_ABORTED:
+        printf("Signing daemon job aborted %s\n", ctx->error_log);
+        break;
+    case ERROR_BATCH_JOB_FAILED:
+        printf("One or more batch jobs failed\n");
+        break;
+    default:
+        printf("Undefined error\n");
+    }
+}
+/** Prompt user agreement for key reuse
+ *
+ * @par Purpose
+ *
+ * Prompt user agreement for resusing a data encryption key
+ *
+ * @par Operation
+ *
+ * @retval None
+ */
+static void prompt_key_reuse_msg(void )
+{
+    printf("NOTICE: Key-reuse for encryption undermines security of otherwise"
+           " trustworthy systems.\nEncrypting multiple data sets with the"
+           " same key, leaks enough information for an attacker to decrypt"
+           " any data set without knowing the encryption key.\n"
+           "The key-reuse feature is only meant to be used in development"
+           " and not production. ");
+    if (!g_skip)
+    {
+        char *buffer = malloc(sizeof(char) * 32);
+        size_t bufsize = 32;
+        size_t chars_read = 0;
+        printf("\n\nBy using this option, you understand the risk"
+                   " and assume full responsability.");
+        do {
+            printf("\nDo want to continue? (y/n)");
+            chars_read = getline(&buffer, &bufsize, stdin);
+        } while (!((buffer[0] == 'Y' || buffer[0] == 'y') && chars_read == 2));
+    }
+}
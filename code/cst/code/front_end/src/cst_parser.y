@@ -24,22 +24,15 @@
 #include <strings.h>
 #include <csf.h>
 
-extern int32_t yylineno;
-
-void yyerror(const char *str)
-{
-    fprintf(stderr,"error: line %d: %s\n",yylineno,str);
-}
-
-int32_t yywrap()
-{
-        return 1;
-}
-
-char buf[100];
-
 %}
 
+/* Reentrant parser, the CSF state lives in ctx and the lexer state in
+   scanner, so several CSFs can be parsed at the same time */
+%pure-parser
+%parse-param { cst_context_t *ctx }
+%parse-param { void *scanner }
+%lex-param { void *scanner }
+
 %union
 {
     char *str;
@@ -71,6 +64,20 @@ char buf[100];
 %type <number> number
 %type <argument> keywords
 %type <keyword> keyword
+
+%{
+extern int yylex(YYSTYPE *yylval_param, void *scanner);
+extern int yyget_lineno(void *scanner);
+
+void yyerror(cst_context_t *ctx, void *scanner, const char *str)
+{
+    char msg[MAX_ERROR_STR_LEN + 1];
+
+    snprintf(msg, sizeof(msg), "line %d: %s", yyget_lineno(scanner), str);
+    fprintf(stderr,"error: %s\n",msg);
+    log_error_msg(ctx, msg);
+}
+%}
 %%
 
 commands: /* empty */
@@ -84,29 +91,29 @@ command:
             $$ = $5;
 
             /* save the head */
-            if(g_cmd_head == NULL)
+            if(ctx->cmd_head == NULL)
             {
-                g_cmd_head = $$;
+                ctx->cmd_head = $$;
             }
 
-            /* maintain the cmd list using g_cmd_current */
-            if(g_cmd_current == NULL)
+            /* maintain the cmd list using cmd_current */
+            if(ctx->cmd_current == NULL)
             {
-                g_cmd_current = $$;
-                g_cmd_current->next = NULL;
+                ctx->cmd_current = $$;
+                ctx->cmd_current->next = NULL;
             }
             else
             {
-                g_cmd_current->next = $$;
-                g_cmd_current = g_cmd_current->next;
-                g_cmd_current->next = NULL;
+                ctx->cmd_current->next = $$;
+                ctx->cmd_current = ctx->cmd_current->next;
+                ctx->cmd_current->next = NULL;
             }
 
             $$->name = $2;              /* add name */
             $$->start_offset_cert_sig = 0;
             $$->size_cert_sig = 0;
             $$->cert_sig_data = NULL;
-            if ((g_error_code = handle_command($$)) < SUCCESS) YYERROR;
+            if ((ctx->error_code = handle_command(ctx, $$)) < SUCCESS) YYERROR;
         }
         ;
 
@@ -132,28 +139,28 @@ argument:
             /* argument record allocated when parsing pairs */
             $$ = $3;
             $$->name = $1;               /* add name */
-            if((g_error_code = set_argument_type($$)) != SUCCESS) YYERROR;
+            if((ctx->error_code = set_argument_type(ctx, $$)) != SUCCESS) YYERROR;
         }
         | label EQUALS blocks eol
         {
             /* argument record allocated when parsing blocks */
             $$ = $3;
             $$->name = $1;               /* add name */
-            if((g_error_code = set_argument_type($$)) != SUCCESS) YYERROR;
+            if((ctx->error_code = set_argument_type(ctx, $$)) != SUCCESS) YYERROR;
         }
         | label EQUALS numbers eol
         {
             /* argument record allocated when parsing numbers */
             $$ = $3;
             $$->name = $1;               /* add name */
-            if((g_error_code = set_argument_type($$)) != SUCCESS) YYERROR;
+            if((ctx->error_code = set_argument_type(ctx, $$)) != SUCCESS) YYERROR;
         }
         | label EQUALS keywords eol
         {
             /* argument record allocated when parsing numbers */
             $$ = $3;
             $$->name = $1;               /* add name */
-            if((g_error_code = set_argument_type($$)) != SUCCESS) YYERROR;
+            if((ctx->error_code = set_argument_type(ctx, $$)) != SUCCESS) YYERROR;
         }
 pairs:  pair
         {
@@ -267,7 +274,7 @@ keyword: label
             $$ = malloc(sizeof(keyword_t));
             $$->next = NULL;
             $$->string_value = $1;
-            if((g_error_code = set_label($$)) != SUCCESS) YYERROR;
+            if((ctx->error_code = set_label(ctx, $$)) != SUCCESS) YYERROR;
         }
         | FILENAME
         {
@@ -289,11 +296,9 @@ label:  WORD
         }
         | label NUMBER
         {
-	    /* Concat label with number into buf */
-	    sprintf(buf, "%s%d", $$, $2);
-	    /* Return buf to top of stack */
-	    $$ = realloc($$, strlen(buf) + 1);
-            $$ = buf;
+            /* Concat label with number, 10 digits at most */
+            $$ = realloc($$, strlen($$) + 11);
+            sprintf($$ + strlen($$), "%u", $2);
         }
         ;
 
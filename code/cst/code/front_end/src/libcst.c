@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*===========================================================================*/
+/**
+    @file    libcst.c
+
+    @brief   Implements the code signing library interface on top of the
+             CSF processing of the front end.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include "openssl_helper.h"
+#include "csf.h"
+#include "err.h"
+#include "misc_helper.h"
+#include "libcst.h"
+
+/*===========================================================================
+                               LOCAL CONSTANTS
+=============================================================================*/
+/** Scratch file receiving the output of a signing */
+#define LIBCST_OUTPUT_FILE  "libcst-output.bin"
+
+/** Scratch file holding an input, %u being the index of the input */
+#define LIBCST_INPUT_FILE   "libcst-input%u.bin"
+
+/*===========================================================================
+                            LOCAL FUNCTION PROTOTYPES
+=============================================================================*/
+/** Write the inputs into scratch files
+ *
+ * Fills @a file_map so that the CSF files named after the inputs are read
+ * from their scratch copies.
+ *
+ * @returns #SUCCESS or #ERROR_WRITING_FILE
+ */
+static int32_t
+write_inputs(cst_context_t *ctx, const cst_lib_input_t *inputs,
+             size_t input_count, file_map_t *file_map);
+
+/** Process a CSF and load its output
+ *
+ * Calls error() on fatal errors, the caller must have registered a
+ * recovery point.
+ *
+ * @returns #SUCCESS or one of the error codes defined in csf.h
+ */
+static int32_t
+sign_csf(cst_context_t *ctx, FILE *fi, const cst_lib_input_t *inputs,
+         size_t input_count, file_map_t *file_map, uint8_t **output,
+         size_t *output_bytes);
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  write_inputs
+---------------------------*/
+static int32_t
+write_inputs(cst_context_t *ctx, const cst_lib_input_t *inputs,
+             size_t input_count, file_map_t *file_map)
+{
+    char name[sizeof(LIBCST_INPUT_FILE) + 10];
+    FILE *fh = NULL;
+    size_t i;
+
+    for (i = 0; i < input_count; i++)
+    {
+        snprintf(name, sizeof(name), LIBCST_INPUT_FILE, (unsigned int)i);
+
+        file_map[i].name = inputs[i].name;
+        file_map[i].path = scratch_path(name);
+
+        fh = fopen(file_map[i].path, "wb");
+        if (fh == NULL ||
+            fwrite(inputs[i].data, 1, inputs[i].size, fh) != inputs[i].size)
+        {
+            if (fh != NULL)
+            {
+                fclose(fh);
+            }
+            log_error_msg(ctx, (char *)inputs[i].name);
+            return ERROR_WRITING_FILE;
+        }
+
+        if (fclose(fh) != 0)
+        {
+            log_error_msg(ctx, (char *)inputs[i].name);
+            return ERROR_WRITING_FILE;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/*--------------------------
+  sign_csf
+---------------------------*/
+static int32_t
+sign_csf(cst_context_t *ctx, FILE *fi, const cst_lib_input_t *inputs,
+         size_t input_count, file_map_t *file_map, uint8_t **output,
+         size_t *output_bytes)
+{
+    int32_t ret_val = SUCCESS;
+    char *out_file = scratch_path(LIBCST_OUTPUT_FILE);
+    byte_str_t out = {NULL, 0};
+
+    ret_val = write_inputs(ctx, inputs, input_count, file_map);
+    if (ret_val != SUCCESS)
+    {
+        return ret_val;
+    }
+
+    ctx->file_map = file_map;
+    ctx->file_map_count = input_count;
+
+    ret_val = cst_process_csf(ctx, fi, out_file);
+    if (ctx->error_code != SUCCESS)
+    {
+        ret_val = ctx->error_code;
+    }
+    else if (ret_val > SUCCESS)
+    {
+        /* Syntax error reported by the parser */
+        ret_val = ERROR_INVALID_COMMAND;
+    }
+
+    if (ret_val != SUCCESS)
+    {
+        return ret_val;
+    }
+
+    read_file(out_file, &out, NULL);
+
+    *output = out.entry;
+    *output_bytes = out.entry_bytes;
+
+    return SUCCESS;
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  cst_lib_init
+---------------------------*/
+int32_t
+cst_lib_init(const char *backend)
+{
+    openssl_initialize();
+
+    return set_backend((backend != NULL) ? backend : "ssl");
+}
+
+/*--------------------------
+  cst_lib_sign
+---------------------------*/
+int32_t
+cst_lib_sign(const char *csf, size_t csf_bytes,
+             const cst_lib_input_t *inputs, size_t input_count,
+             uint8_t **output, size_t *output_bytes,
+             char *err_msg, size_t err_msg_bytes)
+{
+    volatile int32_t ret_val = ERROR_JOB_ABORTED;
+    cst_context_t *ctx = NULL;      /**< Context of the CSF */
+    file_map_t *file_map = NULL;    /**< CSF files replaced by the inputs */
+    char *csf_text = NULL;          /**< Line terminated copy of the CSF */
+    FILE *fi = NULL;
+
+    if (csf == NULL || output == NULL || output_bytes == NULL ||
+        (inputs == NULL && input_count != 0))
+    {
+        return ERROR_INVALID_ARGUMENT;
+    }
+
+    *output = NULL;
+    *output_bytes = 0;
+    if (err_msg != NULL && err_msg_bytes > 0)
+    {
+        err_msg[0] = '\0';
+    }
+
+    ctx = cst_context_new();
+    file_map = calloc(input_count + 1, sizeof(file_map_t));
+    csf_text = malloc(csf_bytes + 1);
+    if (ctx == NULL || file_map == NULL || csf_text == NULL)
+    {
+        cst_context_free(ctx);
+        free(file_map);
+        free(csf_text);
+        return ERROR_INSUFFICIENT_MEMORY;
+    }
+
+    /* The parser expects the last CSF line to be terminated */
+    memcpy(csf_text, csf, csf_bytes);
+    csf_text[csf_bytes] = '\n';
+
+    fi = fmemopen(csf_text, csf_bytes + 1, "r");
+    if (fi == NULL)
+    {
+        ret_val = ERROR_INSUFFICIENT_MEMORY;
+    }
+    else if (setjmp(ctx->error_recovery) == 0)
+    {
+        set_error_recovery(&ctx->error_recovery);
+        ret_val = sign_csf(ctx, fi, inputs, input_count, file_map, output,
+                           output_bytes);
+    }
+    set_error_recovery(NULL);
+
+    if (ret_val != SUCCESS && err_msg != NULL && err_msg_bytes > 0)
+    {
+        snprintf(err_msg, err_msg_bytes, "%s", ctx->error_log);
+    }
+
+    /* Removes the inputs and output copies */
+    scratch_cleanup();
+
+    if (fi != NULL)
+    {
+        fclose(fi);
+    }
+    free(csf_text);
+    free(file_map);
+    cst_context_free(ctx);
+
+    return ret_val;
+}
+
+/*--------------------------
+  cst_lib_free
+---------------------------*/
+void
+cst_lib_free(uint8_t *output)
+{
+    free(output);
+}
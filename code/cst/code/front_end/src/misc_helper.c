@@ -47,7 +47,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                                LOCAL CONSTANTS
 =============================================================================*/
-#define MAX_ERR_MSG_BYTES (1024)
 
 /*===========================================================================
                                  LOCAL MACROS
@@ -60,7 +59,6 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /*===========================================================================
                             LOCAL VARIABLES
 =============================================================================*/
-static char err_msg[MAX_ERR_MSG_BYTES];
 
 /*===========================================================================
                             LOCAL FUNCTION PROTOTYPES
@@ -99,8 +97,7 @@ read_file(const char *filename, byte_str_t *byte_str, offsets_t *offsets)
     file = fopen(filename, "rb");
     if (NULL == file)
     {
-        snprintf(err_msg, MAX_ERR_MSG_BYTES, "Cannot open %s", filename);
-        error(err_msg);
+        error("Cannot open %s", filename);
     }
 
     /* Get the file size */
@@ -114,11 +111,7 @@ read_file(const char *filename, byte_str_t *byte_str, offsets_t *offsets)
         if ((bytes_to_read < offsets->first)
             || (bytes_to_read < offsets->second))
         {
-            snprintf(err_msg,
-                     MAX_ERR_MSG_BYTES,
-                     "Offsets defined outside the file %s",
-                     filename);
-            error(err_msg);
+            error("Offsets defined outside the file %s", filename);
         }
 
         if (offsets->first > offsets->second)
@@ -136,8 +129,7 @@ read_file(const char *filename, byte_str_t *byte_str, offsets_t *offsets)
     byte_str->entry       = malloc(bytes_to_read);
     if (NULL == byte_str->entry)
     {
-        snprintf(err_msg, MAX_ERR_MSG_BYTES, "Cannot allocate memory for handling %s", filename);
-        error(err_msg);
+        error("Cannot allocate memory for handling %s", filename);
     }
 
     memset(byte_str->entry, 0, bytes_to_read);
@@ -145,8 +137,7 @@ read_file(const char *filename, byte_str_t *byte_str, offsets_t *offsets)
 
     if (read_size != bytes_to_read)
     {
-        snprintf(err_msg, MAX_ERR_MSG_BYTES, "Unexpected read termination of %s", filename);
-        error(err_msg);
+        error("Unexpected read termination of %s", filename);
     }
 
     fclose(file);
@@ -21,7 +21,12 @@ OBJECTS += \
     csf_cmd_ins_key.o \
     csf_cmd_misc.o \
     cst.o \
+    cst_main.o \
+    cst_daemon.o \
+    libcst.o \
     acst.o \
+    thread_pool.o \
+    sig_cache.o \
     cst_lexer.o \
     cst_parser.o
 
@@ -30,6 +35,17 @@ OBJECTS_FRONTEND += \
     csf_cmd_ins_key.o \
     csf_cmd_misc.o \
     cst.o \
+    cst_daemon.o \
+    libcst.o \
     acst.o \
+    thread_pool.o \
+    sig_cache.o \
     cst_parser.o \
     cst_lexer.o
+
+OBJECTS_CST += \
+    cst_main.o
+
+# The parser header is generated along with the parser
+cst_parser.h: cst_parser.c
+cst_lexer.o: cst_parser.h
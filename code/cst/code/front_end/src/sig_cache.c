@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*===========================================================================*/
+/**
+    @file    sig_cache.c
+
+    @brief   Implements the on-disk cache of the generated signatures.
+
+             Each entry is a file named after the SHA-256 of its key,
+             holding the signature as returned by the backend. Entries are
+             written to a temporary file first and then renamed, so that
+             concurrent processes sharing the directory never read a
+             partial entry.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+#include "csf.h"
+#include "sig_cache.h"
+
+/*===========================================================================
+                              LOCAL CONSTANTS
+=============================================================================*/
+/* Hashed first into every key, to be changed with the entries layout */
+#define SIG_CACHE_KEY_TAG           "CST signature cache 1"
+
+/* Characters of an entry name, its hex key and extension */
+#define SIG_CACHE_NAME_CHARS        (2 * SHA256_DIGEST_LENGTH + \
+                                     sizeof(SIG_CACHE_EXT) - 1)
+
+/*===========================================================================
+                               LOCAL VARIABLES
+=============================================================================*/
+/* Directory of the entries, NULL while the cache is disabled */
+static char *cache_dir = NULL;
+
+/* Protects tmp_count */
+static pthread_mutex_t tmp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Tags the temporary files of this process */
+static unsigned long tmp_count = 0;
+
+/*===========================================================================
+                            LOCAL FUNCTION PROTOTYPES
+=============================================================================*/
+/** Compute the path of the entry of a signature
+ *
+ * @returns allocated path to free with free(), NULL if the cache does not
+ *          apply: disabled, HSM mode or unknown certificate
+ */
+static char *
+entry_path(const uint8_t *digest, size_t digest_bytes, const char *cert_file,
+           hash_alg_t hash_alg, sig_fmt_t sig_fmt, func_mode_t mode);
+
+/** Read an entry
+ *
+ * @returns 1 if the entry exists and fits in @a sig_buf, 0 otherwise
+ */
+static int
+read_entry(const char *path, uint8_t *sig_buf, size_t *sig_buf_bytes);
+
+/** Write an entry, failures are ignored as the signature is valid anyway */
+static void
+write_entry(const char *path, const uint8_t *sig_buf, size_t sig_buf_bytes);
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  entry_path
+---------------------------*/
+static char *
+entry_path(const uint8_t *digest, size_t digest_bytes, const char *cert_file,
+           hash_alg_t hash_alg, sig_fmt_t sig_fmt, func_mode_t mode)
+{
+    X509 *cert = NULL;
+    uint8_t fingerprint[EVP_MAX_MD_SIZE];
+    unsigned int fingerprint_bytes = 0;
+    uint8_t key[EVP_MAX_MD_SIZE];
+    unsigned int key_bytes = 0;
+    uint32_t alg_fmt[2];
+    EVP_MD_CTX *md_ctx = NULL;
+    char *path = NULL;
+    size_t dir_chars = 0;
+    unsigned int i = 0;
+    int ok = 0;
+
+    /* HSM requests only return placeholders */
+    if (cache_dir == NULL || mode == MODE_HSM || cert_file == NULL)
+    {
+        return NULL;
+    }
+
+    cert = read_certificate(cert_file);
+    if (cert == NULL)
+    {
+        return NULL;
+    }
+    ok = X509_digest(cert, EVP_sha256(), fingerprint, &fingerprint_bytes);
+    X509_free(cert);
+    if (!ok)
+    {
+        return NULL;
+    }
+
+    alg_fmt[0] = (uint32_t)hash_alg;
+    alg_fmt[1] = (uint32_t)sig_fmt;
+
+    md_ctx = EVP_MD_CTX_new();
+    ok = (md_ctx != NULL &&
+          EVP_DigestInit_ex(md_ctx, EVP_sha256(), NULL) &&
+          EVP_DigestUpdate(md_ctx, SIG_CACHE_KEY_TAG,
+                           sizeof(SIG_CACHE_KEY_TAG)) &&
+          EVP_DigestUpdate(md_ctx, alg_fmt, sizeof(alg_fmt)) &&
+          EVP_DigestUpdate(md_ctx, fingerprint, fingerprint_bytes) &&
+          EVP_DigestUpdate(md_ctx, digest, digest_bytes) &&
+          EVP_DigestFinal_ex(md_ctx, key, &key_bytes) &&
+          key_bytes == SHA256_DIGEST_LENGTH);
+    EVP_MD_CTX_free(md_ctx);
+    if (!ok)
+    {
+        return NULL;
+    }
+
+    dir_chars = strlen(cache_dir);
+    path = malloc(dir_chars + 1 + SIG_CACHE_NAME_CHARS + 1);
+    if (path == NULL)
+    {
+        return NULL;
+    }
+    memcpy(path, cache_dir, dir_chars);
+    path[dir_chars] = '/';
+    for (i = 0; i < key_bytes; i++)
+    {
+        sprintf(path + dir_chars + 1 + 2 * i, "%02x", key[i]);
+    }
+    strcpy(path + dir_chars + 1 + 2 * key_bytes, SIG_CACHE_EXT);
+
+    return path;
+}
+
+/*--------------------------
+  read_entry
+---------------------------*/
+static int
+read_entry(const char *path, uint8_t *sig_buf, size_t *sig_buf_bytes)
+{
+    FILE *fp = NULL;
+    size_t bytes = 0;
+    int extra = EOF;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    bytes = fread(sig_buf, 1, *sig_buf_bytes, fp);
+    extra = fgetc(fp);
+    fclose(fp);
+
+    /* Entries too large for the caller are regenerated */
+    if (bytes == 0 || extra != EOF)
+    {
+        return 0;
+    }
+
+    *sig_buf_bytes = bytes;
+    return 1;
+}
+
+/*--------------------------
+  write_entry
+---------------------------*/
+static void
+write_entry(const char *path, const uint8_t *sig_buf, size_t sig_buf_bytes)
+{
+    FILE *fp = NULL;
+    char *tmp_path = NULL;
+    size_t tmp_chars = strlen(path) + 64;
+    unsigned long count = 0;
+    int ok = 0;
+
+    tmp_path = malloc(tmp_chars);
+    if (tmp_path == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&tmp_lock);
+    count = tmp_count++;
+    pthread_mutex_unlock(&tmp_lock);
+    snprintf(tmp_path, tmp_chars, "%s.%ld-%lu.tmp", path, (long)getpid(),
+             count);
+
+    fp = fopen(tmp_path, "wb");
+    if (fp != NULL)
+    {
+        ok = (fwrite(sig_buf, 1, sig_buf_bytes, fp) == sig_buf_bytes);
+        ok = (fclose(fp) == 0) && ok;
+
+        /* Another process may have stored the same entry meanwhile */
+        if (!ok || rename(tmp_path, path) != 0)
+        {
+            remove(tmp_path);
+        }
+    }
+
+    free(tmp_path);
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  sig_cache_set_dir
+---------------------------*/
+int32_t
+sig_cache_set_dir(const char *dir)
+{
+    struct stat st;
+    char *copy = NULL;
+
+    if (dir != NULL)
+    {
+        if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            return ERROR_INVALID_ARGUMENT;
+        }
+        copy = malloc(strlen(dir) + 1);
+        if (copy == NULL)
+        {
+            return ERROR_INSUFFICIENT_MEMORY;
+        }
+        strcpy(copy, dir);
+    }
+
+    free(cache_dir);
+    cache_dir = copy;
+
+    return SUCCESS;
+}
+
+/*--------------------------
+  sig_cache_gen_sig_data_buffer
+---------------------------*/
+int32_t
+sig_cache_gen_sig_data_buffer(const uint8_t *data, size_t data_bytes,
+                              const char *data_name, const char *cert_file,
+                              hash_alg_t hash_alg, sig_fmt_t sig_fmt,
+                              uint8_t *sig_buf, size_t *sig_buf_bytes,
+                              func_mode_t mode)
+{
+    const EVP_MD *md = NULL;
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_bytes = 0;
+    char *path = NULL;
+    int32_t ret_val = SUCCESS;
+
+    /* Keyed by the digest the CSF uses, shared with the digest requests */
+    if (cache_dir != NULL && mode != MODE_HSM && data != NULL)
+    {
+        md = EVP_get_digestbyname(get_digest_name(hash_alg));
+        if (md != NULL &&
+            EVP_Digest(data, data_bytes, digest, &digest_bytes, md, NULL))
+        {
+            path = entry_path(digest, digest_bytes, cert_file, hash_alg,
+                              sig_fmt, mode);
+        }
+    }
+
+    if (path != NULL && sig_buf != NULL && sig_buf_bytes != NULL &&
+        read_entry(path, sig_buf, sig_buf_bytes))
+    {
+        free(path);
+        return SUCCESS;
+    }
+
+    ret_val = gen_sig_data_buffer(data, data_bytes, data_name, cert_file,
+                                  hash_alg, sig_fmt, sig_buf, sig_buf_bytes,
+                                  mode);
+    if (path != NULL && ret_val == SUCCESS)
+    {
+        write_entry(path, sig_buf, *sig_buf_bytes);
+    }
+
+    free(path);
+    return ret_val;
+}
+
+/*--------------------------
+  sig_cache_gen_sig_data_digest
+---------------------------*/
+int32_t
+sig_cache_gen_sig_data_digest(const uint8_t *digest, size_t digest_bytes,
+                              const char *cert_file, hash_alg_t hash_alg,
+                              sig_fmt_t sig_fmt, uint8_t *sig_buf,
+                              size_t *sig_buf_bytes, func_mode_t mode)
+{
+    char *path = NULL;
+    int32_t ret_val = SUCCESS;
+
+    if (digest != NULL)
+    {
+        path = entry_path(digest, digest_bytes, cert_file, hash_alg,
+                          sig_fmt, mode);
+    }
+
+    if (path != NULL && sig_buf != NULL && sig_buf_bytes != NULL &&
+        read_entry(path, sig_buf, sig_buf_bytes))
+    {
+        free(path);
+        return SUCCESS;
+    }
+
+    ret_val = gen_sig_data_digest(digest, digest_bytes, cert_file, hash_alg,
+                                  sig_fmt, sig_buf, sig_buf_bytes, mode);
+    if (path != NULL && ret_val == SUCCESS)
+    {
+        write_entry(path, sig_buf, *sig_buf_bytes);
+    }
+
+    free(path);
+    return ret_val;
+}
@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*===========================================================================*/
+/**
+    @file    thread_pool.c
+
+    @brief   Implements the thread pool running independent tasks.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#ifdef __linux__
+#define _GNU_SOURCE     /* sched_getaffinity() */
+#include <sched.h>
+#endif
+#include <stdlib.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "thread_pool.h"
+
+/*===========================================================================
+                    STRUCTURES AND OTHER TYPEDEFS
+=============================================================================*/
+/* Tasks shared by the threads of the pool */
+typedef struct thread_pool {
+    pthread_mutex_t    lock;        /**< Protects next                     */
+    size_t             next;        /**< Next task to run                  */
+    size_t             count;       /**< Number of tasks                   */
+    thread_pool_task_t task;        /**< Function processing each task     */
+    void               *arg;        /**< Argument of every task            */
+} thread_pool_t;
+
+/*===========================================================================
+                            LOCAL FUNCTION PROTOTYPES
+=============================================================================*/
+/** Thread of the pool
+ *
+ * Runs the next task not yet taken until every task is taken.
+ *
+ * @returns NULL
+ */
+static void *
+worker(void *arg);
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  worker
+---------------------------*/
+static void *
+worker(void *arg)
+{
+    thread_pool_t *pool = arg;
+    size_t index;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        index = pool->next;
+        if (index < pool->count)
+        {
+            pool->next++;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (index >= pool->count)
+        {
+            return NULL;
+        }
+        pool->task(pool->arg, index);
+    }
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  thread_pool_run
+---------------------------*/
+void
+thread_pool_run(size_t count, thread_pool_task_t task, void *arg)
+{
+    size_t thread_count = count;
+
+#if defined(__linux__) && defined(CPU_COUNT)
+    {
+        /* Processors the process may run on, as set by taskset or a cpuset */
+        cpu_set_t cpus;
+
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0 &&
+            thread_count > (size_t)CPU_COUNT(&cpus))
+        {
+            thread_count = (size_t)CPU_COUNT(&cpus);
+        }
+    }
+#elif defined(_SC_NPROCESSORS_ONLN)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+        if (online > 0 && thread_count > (size_t)online)
+        {
+            thread_count = (size_t)online;
+        }
+    }
+#else
+    thread_count = 1;
+#endif
+
+    thread_pool_run_threads(count, thread_count, task, arg);
+}
+
+/*--------------------------
+  thread_pool_run_threads
+---------------------------*/
+void
+thread_pool_run_threads(size_t count, size_t threads, thread_pool_task_t task,
+                        void *arg)
+{
+    pthread_t thread_ids[THREAD_POOL_MAX_THREADS];
+    thread_pool_t pool;
+    size_t thread_count = threads;  /**< Threads besides the calling one */
+    size_t started = 0;
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (thread_count > count)
+    {
+        thread_count = count;
+    }
+    if (thread_count > THREAD_POOL_MAX_THREADS)
+    {
+        thread_count = THREAD_POOL_MAX_THREADS;
+    }
+    if (thread_count == 0)
+    {
+        thread_count = 1;
+    }
+    thread_count--;
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pool.next  = 0;
+    pool.count = count;
+    pool.task  = task;
+    pool.arg   = arg;
+
+    /* Whatever could not be started is left to the calling thread */
+    for (started = 0; started < thread_count; started++)
+    {
+        if (pthread_create(&thread_ids[started], NULL, worker, &pool) != 0)
+        {
+            break;
+        }
+    }
+    worker(&pool);
+
+    while (started > 0)
+    {
+        pthread_join(thread_ids[--started], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+}
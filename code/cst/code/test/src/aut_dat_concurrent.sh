@@ -0,0 +1,127 @@
+#!/bin/sh
+# SPDX-License-Identifier: BSD-3-Clause
+#==============================================================================
+#
+#    File Name:  aut_dat_concurrent.sh
+#
+#    General Description: Checks that a CSF whose Authenticate Data commands
+#                         are hashed and signed concurrently is byte for byte
+#                         the CSF signed one command after the other.
+#
+#    Usage: aut_dat_concurrent.sh <cst> <srktool> [pki-dir]
+#
+#    The serial CSF is signed on one processor with one signing request at
+#    a time, the concurrent one with up to 16 requests. pki-dir holds the
+#    crts and keys directories of the signer, a throwaway PKI signed by the
+#    OpenSSL backend is generated when it is not given. The check is skipped
+#    when cst does not sign with the OpenSSL backend and pki-dir is not
+#    given.
+#
+#==============================================================================
+#
+#              Copyright 2026 CST contributors
+#
+#==============================================================================
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <cst> <srktool> [pki-dir]"
+    exit 2
+fi
+
+CST=$(realpath "$1")
+SRKTOOL=$(realpath "$2")
+PKI=${3:+$(realpath "$3")}
+CRT=sha256_2048_65537_v3_usr_crt.pem
+KEY=sha256_2048_65537_v3_usr_key.pem
+SRK=SRK1_sha256_2048_65537_v3_ca_crt.pem
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+if [ -n "$PKI" ]; then
+    cp -r "$PKI/crts" "$PKI/keys" .
+else
+    mkdir crts keys
+    printf 'basicConstraints=critical,CA:FALSE\n' > usr.ext
+    openssl req -x509 -newkey rsa:2048 -nodes -sha256 -days 1 \
+        -subj /CN=SRK1 -addext basicConstraints=critical,CA:TRUE \
+        -keyout keys/SRK1_key.pem -out crts/$SRK 2>/dev/null
+    for NAME in CSF1_1 IMG1_1; do
+        openssl req -newkey rsa:2048 -nodes -sha256 -subj /CN=$NAME \
+            -keyout keys/${NAME}_$KEY -out $NAME.csr 2>/dev/null
+        openssl x509 -req -sha256 -days 1 -set_serial 1 -extfile usr.ext \
+            -CA crts/$SRK -CAkey keys/SRK1_key.pem \
+            -in $NAME.csr -out crts/${NAME}_$CRT 2>/dev/null
+        cp crts/${NAME}_$CRT keys/
+    done
+    cp crts/$SRK keys/ca_cert_chains.crt
+fi
+
+"$SRKTOOL" -h 4 -t SRK_table.bin -e SRK_fuse.bin -d sha256 -f 1 \
+    -c crts/$SRK > /dev/null
+
+# Blocks of several sizes spread over two images, some sharing a file
+head -c 3145728 /dev/urandom > img1.bin
+head -c 1048576 /dev/urandom > img2.bin
+
+cat > aut_dat.csf <<CSF
+[Header]
+Version = 4.2
+Hash Algorithm = sha256
+Engine = ANY
+Engine Configuration = 0
+Certificate Format = X509
+Signature Format = CMS
+
+[Install SRK]
+File = "SRK_table.bin"
+Source index = 0
+
+[Install CSFK]
+File = "crts/CSF1_1_$CRT"
+
+[Authenticate CSF]
+
+[Install Key]
+Verification index = 0
+Target index = 2
+File = "crts/IMG1_1_$CRT"
+CSF
+
+for BLOCKS in \
+    '0x80000000 0x0 0x200000 "img1.bin"' \
+    '0x80200000 0x200000 0x100000 "img1.bin"' \
+    '0x81000000 0x0 0x4000 "img2.bin", \\\n         0x81010000 0x8000 0x100 "img2.bin"' \
+    '0x81100000 0x10000 0xF0000 "img2.bin"' \
+    '0x82000000 0x1000 0x1000 "img1.bin"' \
+    '0x82100000 0x0 0x100000 "img2.bin"'; do
+    printf '\n[Authenticate Data]\nVerification index = 2\nBlocks = %b\n' \
+        "$BLOCKS" >> aut_dat.csf
+done
+
+# The CMS signatures of both CSFs get the same signing time
+SOURCE_DATE_EPOCH=$(date +%s)
+export SOURCE_DATE_EPOCH
+
+if ! taskset -c 0 "$CST" --requests 1 -i aut_dat.csf -o serial.bin \
+        > serial.log 2>&1; then
+    if [ -z "$PKI" ] && grep -q "AUTOX's signer" serial.log; then
+        echo "aut_dat_concurrent: skipped, cst signs on the signing server," \
+             "give its pki-dir"
+        exit 0
+    fi
+    cat serial.log
+    echo "aut_dat_concurrent: FAILED"
+    exit 1
+fi
+"$CST" --requests 16 -i aut_dat.csf -o concurrent.bin > concurrent.log 2>&1
+
+if cmp serial.bin concurrent.bin; then
+    echo "aut_dat_concurrent: passed"
+else
+    echo "aut_dat_concurrent: FAILED"
+    exit 1
+fi
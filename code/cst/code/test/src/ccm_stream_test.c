@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*===========================================================================*/
+/**
+    @file    ccm_stream_test.c
+
+    @brief   Checks the streaming AES-CCM encryption against the one-shot
+             AES-CCM of OpenSSL, for every AES key size and for messages
+             shorter than, equal to and longer than a chunk.
+
+@verbatim
+=============================================================================
+
+    Copyright 2026 CST contributors
+
+=============================================================================
+@endverbatim */
+
+/*===========================================================================
+                                INCLUDE FILES
+=============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "ssl_wrapper.h"
+
+/*===========================================================================
+                               LOCAL CONSTANTS
+=============================================================================*/
+#define MAX_NONCE_BYTES (13)            /**< Nonce of the shortest messages */
+#define TAG_BYTES       (16)            /**< MAC used by HAB                */
+#define PIECE_BYTES     (CCM_STREAM_CHUNK_BYTES / 3 + 5)
+                                        /**< Odd pieces fed to the stream   */
+#define OUT_FILE        "ccm_stream_test.bin"
+
+/*===========================================================================
+                               LOCAL VARIABLES
+=============================================================================*/
+/** Key sizes of AES-128, AES-192 and AES-256 */
+static const int key_sizes[] = {16, 24, 32};
+
+/** Message lengths around the chunk boundaries */
+static const size_t msg_sizes[] = {
+    1,
+    16,
+    CCM_STREAM_CHUNK_BYTES - 1,
+    CCM_STREAM_CHUNK_BYTES,
+    CCM_STREAM_CHUNK_BYTES + 1,
+    2 * CCM_STREAM_CHUNK_BYTES + 17
+};
+
+/*===========================================================================
+                               LOCAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  nonce_bytes
+---------------------------*/
+static int
+nonce_bytes(size_t msg_len)
+{
+    int q = 2;          /**< Bytes of the length field, as cst sizes them */
+
+    while (q < 8 && (msg_len >> (8 * q)) != 0) {
+        q++;
+    }
+    return 15 - q;
+}
+
+/*--------------------------
+  ccm_cipher
+---------------------------*/
+static const EVP_CIPHER *
+ccm_cipher(int key_len)
+{
+    switch (key_len) {
+        case 16:
+            return EVP_aes_128_ccm();
+        case 24:
+            return EVP_aes_192_ccm();
+        default:
+            return EVP_aes_256_ccm();
+    }
+}
+
+/*--------------------------
+  encrypt_one_shot
+---------------------------*/
+static int
+encrypt_one_shot(const uint8_t *msg, size_t msg_len, uint8_t *key,
+                 int key_len, uint8_t *nonce, uint8_t *out, uint8_t *tag)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    int len = 0;
+    int ok = 0;
+
+    do {
+        if (NULL == ctx ||
+            1 != EVP_EncryptInit_ex(ctx, ccm_cipher(key_len), NULL, NULL,
+                                    NULL) ||
+            1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_IVLEN,
+                                     nonce_bytes(msg_len), NULL) ||
+            1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_TAG, TAG_BYTES,
+                                     NULL) ||
+            1 != EVP_EncryptInit_ex(ctx, NULL, NULL, key, nonce) ||
+            1 != EVP_EncryptUpdate(ctx, out, &len, msg, (int)msg_len) ||
+            1 != EVP_EncryptFinal_ex(ctx, out + len, &len) ||
+            1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_GET_TAG, TAG_BYTES,
+                                     tag)) {
+            break;
+        }
+        ok = 1;
+    } while (0);
+
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+}
+
+/*--------------------------
+  encrypt_stream
+---------------------------*/
+static int
+encrypt_stream(const uint8_t *msg, size_t msg_len, uint8_t *key,
+               int key_len, uint8_t *nonce, uint8_t *out, uint8_t *tag)
+{
+    int32_t err_value = CAL_SUCCESS;
+    char err_str[MAX_ERR_STR_BYTES];
+    ccm_stream_t *ccm = NULL;
+    size_t done = 0;
+    size_t piece;
+
+    ccm = ccm_stream_new(key, key_len, nonce, nonce_bytes(msg_len), msg_len,
+                         TAG_BYTES, &err_value, err_str);
+    if (NULL == ccm) {
+        return 0;
+    }
+
+    /* Pieces split the chunks and the AES blocks */
+    while (done < msg_len && CAL_SUCCESS == err_value) {
+        piece = (msg_len - done < PIECE_BYTES) ? msg_len - done : PIECE_BYTES;
+        ccm_stream_update(ccm, msg + done, out + done, piece, &err_value,
+                          err_str);
+        done += piece;
+    }
+    if (CAL_SUCCESS == err_value) {
+        ccm_stream_final(ccm, tag, &err_value, err_str);
+    }
+
+    ccm_stream_free(ccm);
+    return (CAL_SUCCESS == err_value);
+}
+
+/*--------------------------
+  encrypt_file
+---------------------------*/
+static int
+encrypt_file(const uint8_t *msg, size_t msg_len, uint8_t *key,
+             int key_len, uint8_t *nonce, uint8_t *out, uint8_t *tag)
+{
+    int32_t err_value = CAL_SUCCESS;
+    char err_str[MAX_ERR_STR_BYTES];
+    FILE *in = tmpfile();
+    FILE *fh = NULL;
+    int ok = 0;
+
+    do {
+        if (NULL == in || fwrite(msg, 1, msg_len, in) != msg_len ||
+            0 != fseek(in, 0, SEEK_SET)) {
+            break;
+        }
+
+        if (CAL_SUCCESS != encryptccm(in, msg_len, NULL, 0, key, key_len,
+                                      nonce, nonce_bytes(msg_len), OUT_FILE,
+                                      tag, TAG_BYTES, &err_value, err_str)) {
+            break;
+        }
+
+        fh = fopen(OUT_FILE, "rb");
+        if (NULL == fh || fread(out, 1, msg_len, fh) != msg_len ||
+            fgetc(fh) != EOF) {
+            break;
+        }
+        ok = 1;
+    } while (0);
+
+    if (NULL != fh) {
+        fclose(fh);
+    }
+    if (NULL != in) {
+        fclose(in);
+    }
+    remove(OUT_FILE);
+    return ok;
+}
+
+/*===========================================================================
+                               GLOBAL FUNCTIONS
+=============================================================================*/
+
+/*--------------------------
+  main
+---------------------------*/
+int
+main(void)
+{
+    size_t max_len = msg_sizes[sizeof(msg_sizes) / sizeof(msg_sizes[0]) - 1];
+    uint8_t *msg = malloc(max_len);
+    uint8_t *expected = malloc(max_len);
+    uint8_t *out = malloc(max_len);
+    uint8_t key[32];
+    uint8_t nonce[MAX_NONCE_BYTES];
+    uint8_t expected_tag[TAG_BYTES];
+    uint8_t tag[TAG_BYTES];
+    size_t i, k, m;
+    int failures = 0;
+
+    if (NULL == msg || NULL == expected || NULL == out) {
+        printf("Cannot allocate memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < max_len; i++) {
+        msg[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+    for (i = 0; i < sizeof(key); i++) {
+        key[i] = (uint8_t)(0xA5 ^ i);
+    }
+    for (i = 0; i < sizeof(nonce); i++) {
+        nonce[i] = (uint8_t)(0x3C + i);
+    }
+
+    for (k = 0; k < sizeof(key_sizes) / sizeof(key_sizes[0]); k++) {
+        for (m = 0; m < sizeof(msg_sizes) / sizeof(msg_sizes[0]); m++) {
+            int key_len = key_sizes[k];
+            size_t len = msg_sizes[m];
+
+            if (!encrypt_one_shot(msg, len, key, key_len, nonce, expected,
+                                  expected_tag)) {
+                printf("FAIL one-shot AES-%d-CCM, %zu bytes\n", key_len * 8,
+                       len);
+                failures++;
+                continue;
+            }
+
+            memset(out, 0, len);
+            memset(tag, 0, sizeof(tag));
+            if (!encrypt_stream(msg, len, key, key_len, nonce, out, tag) ||
+                0 != memcmp(out, expected, len) ||
+                0 != memcmp(tag, expected_tag, TAG_BYTES)) {
+                printf("FAIL ccm_stream AES-%d-CCM, %zu bytes\n", key_len * 8,
+                       len);
+                failures++;
+            }
+
+            memset(out, 0, len);
+            memset(tag, 0, sizeof(tag));
+            if (!encrypt_file(msg, len, key, key_len, nonce, out, tag) ||
+                0 != memcmp(out, expected, len) ||
+                0 != memcmp(tag, expected_tag, TAG_BYTES)) {
+                printf("FAIL encryptccm AES-%d-CCM, %zu bytes\n", key_len * 8,
+                       len);
+                failures++;
+            }
+        }
+    }
+
+    free(msg);
+    free(expected);
+    free(out);
+
+    printf("ccm_stream_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+#==============================================================================
+#
+#    File Name:  objects.mk
+#
+#    General Description: Defines the object files for the tests
+#
+#==============================================================================
+#
+#
+#
+#              Copyright 2026 CST contributors
+#
+#
+#
+#==============================================================================
+
+# List the api object files to be built
+OBJECTS += \
+    ccm_stream_test.o
+
+OBJECTS_TEST += \
+    ccm_stream_test.o